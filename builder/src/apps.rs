@@ -20,6 +20,15 @@ pub const APPS: &[App] = &[
     },
 ];
 
+/// Second instance of the example app, loaded after it by the syscall perf test so that
+/// the kernel switches between two processes. Its RAM size differs from the example app,
+/// so the two processes have different PMP regions.
+const SYSCALL_PERF_PEER_APP: App = App {
+    name: "example-app",
+    permissions: vec![],
+    minimum_ram: 56 * 1024,
+};
+
 pub struct App {
     pub name: &'static str,
     pub permissions: Vec<(u32, u32)>, // pairs of (driver, command). All console and alarm commands are allowed by default.
@@ -66,6 +75,18 @@ pub fn apps_build_flat_tbf(
         ram_start += app.minimum_ram as usize;
 
         if app.name == "example-app" && example_app {
+            if features.contains(&"test-syscall-perf") {
+                println!("Building TBF for the syscall perf peer app");
+                let peer = SYSCALL_PERF_PEER_APP;
+                let app_bin = app_build_tbf(
+                    &peer,
+                    offset,
+                    ram_start,
+                    peer.minimum_ram as usize,
+                    features,
+                )?;
+                bin.extend_from_slice(&app_bin);
+            }
             // example app is always the first app
             // and we do not want to build any more apps after it
             // so we can just break out of the loop
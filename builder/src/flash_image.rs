@@ -2,10 +2,13 @@
 
 use anyhow::{anyhow, bail, Result};
 use flash_image::{
-    FlashHeader, ImageHeader, CALIPTRA_FMC_RT_IDENTIFIER, FLASH_IMAGE_MAGIC_NUMBER, HEADER_VERSION,
-    MCU_RT_IDENTIFIER, SOC_IMAGES_BASE_IDENTIFIER, SOC_MANIFEST_IDENTIFIER,
+    image_digest_table_offset, FlashHeader, ImageDigest, ImageDigestTableHeader, ImageHeader,
+    CALIPTRA_FMC_RT_IDENTIFIER, FLASH_IMAGE_MAGIC_NUMBER, HEADER_VERSION,
+    HEADER_VERSION_WITH_DIGESTS, IMAGE_DIGEST_TABLE_MAGIC_NUMBER, MCU_RT_IDENTIFIER,
+    SOC_IMAGES_BASE_IDENTIFIER, SOC_MANIFEST_IDENTIFIER,
 };
 use mcu_config_emulator::flash::PartitionTable;
+use sha2::{Digest, Sha384};
 use std::fs::{File, OpenOptions};
 use std::io::{self, Error, ErrorKind, Read, Seek, Write};
 use std::mem::offset_of;
@@ -13,6 +16,8 @@ use zerocopy::{FromBytes, IntoBytes};
 
 const HEADER_SIZE: usize = std::mem::size_of::<FlashHeader>();
 const IMAGE_INFO_SIZE: usize = std::mem::size_of::<ImageHeader>();
+const DIGEST_TABLE_HEADER_SIZE: usize = std::mem::size_of::<ImageDigestTableHeader>();
+const IMAGE_DIGEST_SIZE: usize = std::mem::size_of::<ImageDigest>();
 
 pub struct FlashImage<'a> {
     header: FlashHeader,
@@ -21,6 +26,7 @@ pub struct FlashImage<'a> {
 
 pub struct FlashImagePayload<'a> {
     image_info: &'a [ImageHeader],
+    image_digests: Option<&'a [ImageDigest]>,
     images: &'a [FirmwareImage<'a>],
 }
 #[derive(Clone)]
@@ -40,9 +46,31 @@ impl<'a> FirmwareImage<'a> {
 
 impl<'a> FlashImage<'a> {
     pub fn new(images: &'a [FirmwareImage<'a>], image_info: &'a [ImageHeader]) -> Self {
+        Self::build(images, image_info, None)
+    }
+
+    /// Creates a flash image that carries the digest of each image, `image_info` must have
+    /// been generated by `generate_image_info_with_digests`.
+    pub fn with_digests(
+        images: &'a [FirmwareImage<'a>],
+        image_info: &'a [ImageHeader],
+        image_digests: &'a [ImageDigest],
+    ) -> Self {
+        Self::build(images, image_info, Some(image_digests))
+    }
+
+    fn build(
+        images: &'a [FirmwareImage<'a>],
+        image_info: &'a [ImageHeader],
+        image_digests: Option<&'a [ImageDigest]>,
+    ) -> Self {
         let mut header = FlashHeader {
             magic: FLASH_IMAGE_MAGIC_NUMBER.into(),
-            version: HEADER_VERSION,
+            version: if image_digests.is_some() {
+                HEADER_VERSION_WITH_DIGESTS
+            } else {
+                HEADER_VERSION
+            },
             image_count: image_info.len() as u16,
             image_headers_offset: core::mem::size_of::<FlashHeader>() as u32,
             header_checksum: 0,
@@ -52,7 +80,11 @@ impl<'a> FlashImage<'a> {
             header.as_bytes()[..offset_of!(FlashHeader, header_checksum)].as_ref(),
         );
         header.header_checksum = header_checksum;
-        let payload = FlashImagePayload::new(image_info, images);
+        let payload = FlashImagePayload {
+            image_info,
+            image_digests,
+            images,
+        };
 
         Self { header, payload }
     }
@@ -77,6 +109,16 @@ impl<'a> FlashImage<'a> {
         for info in self.payload.image_info {
             file.write_all(info.as_bytes())?;
         }
+        if let Some(image_digests) = self.payload.image_digests {
+            let table_header = ImageDigestTableHeader {
+                magic: IMAGE_DIGEST_TABLE_MAGIC_NUMBER.into(),
+                digest_count: image_digests.len() as u32,
+            };
+            file.write_all(table_header.as_bytes())?;
+            for digest in image_digests {
+                file.write_all(digest.as_bytes())?;
+            }
+        }
         for image in self.payload.images {
             file.write_all(image.data)?;
         }
@@ -95,7 +137,7 @@ impl<'a> FlashImage<'a> {
             bail!("Invalid header: incorrect magic number or header version.");
         }
 
-        if header.version != HEADER_VERSION {
+        if header.version != HEADER_VERSION && header.version != HEADER_VERSION_WITH_DIGESTS {
             bail!("Unsupported header version");
         }
         // Parse and verify checksums
@@ -106,6 +148,8 @@ impl<'a> FlashImage<'a> {
             bail!("Header checksum mismatch.");
         }
 
+        let image_digests = read_image_digests(image, &header)?;
+
         // Parse and verify image info and data
         for i in 0..header.image_count as usize {
             let offset = header.image_headers_offset as usize + (IMAGE_INFO_SIZE * i);
@@ -129,6 +173,19 @@ impl<'a> FlashImage<'a> {
                     info.identifier
                 );
             }
+            if let Some(image_digests) = &image_digests {
+                let expected = &image_digests[i];
+                if expected.identifier != info.identifier
+                    || calculate_digest(
+                        &image[info.offset as usize..info.offset as usize + info.size as usize],
+                    ) != expected.digest
+                {
+                    bail!(
+                        "Image digest mismatch for image with identifier: {}",
+                        info.identifier
+                    );
+                }
+            }
             println!("{:?}", info);
         }
 
@@ -146,10 +203,47 @@ pub fn calculate_checksum(data: &[u8]) -> u32 {
 
 impl<'a> FlashImagePayload<'a> {
     pub fn new(image_info: &'a [ImageHeader], images: &'a [FirmwareImage<'a>]) -> Self {
-        Self { image_info, images }
+        Self {
+            image_info,
+            image_digests: None,
+            images,
+        }
     }
 }
 
+pub fn calculate_digest(data: &[u8]) -> [u8; flash_image::IMAGE_DIGEST_SIZE] {
+    Sha384::digest(data).into()
+}
+
+/// Returns the image digests of `image`, or `None` if it was built without them.
+fn read_image_digests(image: &[u8], header: &FlashHeader) -> Result<Option<Vec<ImageDigest>>> {
+    let Some(table_offset) = image_digest_table_offset(header) else {
+        return Ok(None);
+    };
+    let table_header = image
+        .get(table_offset..table_offset + DIGEST_TABLE_HEADER_SIZE)
+        .and_then(|bytes| ImageDigestTableHeader::read_from_bytes(bytes).ok())
+        .ok_or_else(|| anyhow!("Image too small to contain the image digest table."))?;
+    if table_header.magic != IMAGE_DIGEST_TABLE_MAGIC_NUMBER {
+        bail!("Invalid image digest table: incorrect magic number.");
+    }
+    if !table_header.verify(header.image_count) {
+        bail!("Image digest count does not match the image count.");
+    }
+
+    let digests_offset = table_offset + DIGEST_TABLE_HEADER_SIZE;
+    let digests_size = header.image_count as usize * IMAGE_DIGEST_SIZE;
+    let digests = image
+        .get(digests_offset..digests_offset + digests_size)
+        .ok_or_else(|| anyhow!("Image too small to contain the image digests."))?;
+    Ok(Some(
+        digests
+            .chunks_exact(IMAGE_DIGEST_SIZE)
+            .map(|digest| ImageDigest::read_from_bytes(digest).unwrap())
+            .collect(),
+    ))
+}
+
 fn load_file(filename: &str) -> Result<Vec<u8>> {
     let mut buffer = Vec::new();
 
@@ -174,6 +268,7 @@ pub fn flash_image_create(
     soc_image_paths: &Option<Vec<String>>,
     offset: usize,
     output_path: &str,
+    with_digests: bool,
 ) -> Result<()> {
     let mut images: Vec<FirmwareImage> = Vec::new();
 
@@ -211,18 +306,44 @@ pub fn flash_image_create(
         soc_image_identifer += 1;
     }
 
-    let image_info = generate_image_info(images.clone());
-
-    let flash_image = FlashImage::new(&images, &image_info);
-    flash_image.write_to_file(offset, output_path)?;
+    if with_digests {
+        let (image_info, image_digests) = generate_image_info_with_digests(images.clone());
+        FlashImage::with_digests(&images, &image_info, &image_digests)
+            .write_to_file(offset, output_path)?;
+    } else {
+        let image_info = generate_image_info(images.clone());
+        FlashImage::new(&images, &image_info).write_to_file(offset, output_path)?;
+    }
 
     Ok(())
 }
 
 pub fn generate_image_info(images: Vec<FirmwareImage>) -> Vec<ImageHeader> {
-    let mut info = Vec::new();
-    let mut offset = std::mem::size_of::<FlashHeader>() as u32
+    let offset = std::mem::size_of::<FlashHeader>() as u32
         + (std::mem::size_of::<ImageHeader>() * images.len()) as u32;
+    image_info_at(&images, offset)
+}
+
+/// Generates the image headers and digests of a flash image that carries an image digest table.
+pub fn generate_image_info_with_digests(
+    images: Vec<FirmwareImage>,
+) -> (Vec<ImageHeader>, Vec<ImageDigest>) {
+    let offset = std::mem::size_of::<FlashHeader>()
+        + (std::mem::size_of::<ImageHeader>() * images.len())
+        + DIGEST_TABLE_HEADER_SIZE
+        + (IMAGE_DIGEST_SIZE * images.len());
+    let digests = images
+        .iter()
+        .map(|image| ImageDigest {
+            identifier: image.identifier,
+            digest: calculate_digest(image.data),
+        })
+        .collect();
+    (image_info_at(&images, offset as u32), digests)
+}
+
+fn image_info_at(images: &[FirmwareImage], mut offset: u32) -> Vec<ImageHeader> {
+    let mut info = Vec::new();
     for image in images.iter() {
         let mut header = ImageHeader {
             identifier: image.identifier,
@@ -339,6 +460,7 @@ mod tests {
             &soc_image_paths,
             0,
             output_path,
+            false,
         )
         .expect("Failed to build flash image");
 
@@ -499,4 +621,44 @@ mod tests {
         // Cleanup
         fs::remove_file(image_path).expect("Failed to clean up test file");
     }
+
+    #[test]
+    fn test_flash_image_verify_digests() {
+        let image_path = PROJECT_ROOT
+            .join("target")
+            .join("tmp")
+            .join("flash_image_digests.bin");
+        let image_path = image_path.to_str().unwrap();
+
+        let images = [
+            FirmwareImage {
+                identifier: CALIPTRA_FMC_RT_IDENTIFIER,
+                data: b"Valid Caliptra Firmware Data",
+            },
+            FirmwareImage {
+                identifier: MCU_RT_IDENTIFIER,
+                data: b"Valid MCU Runtime Data",
+            },
+        ];
+        let (image_info, image_digests) = generate_image_info_with_digests(images.to_vec());
+        FlashImage::with_digests(&images, &image_info, &image_digests)
+            .write_to_file(0, image_path)
+            .expect("Failed to write flash image");
+
+        let mut data = fs::read(image_path).expect("Failed to read flash image");
+        FlashImage::verify_flash_image(&data).expect("Flash image with digests should verify");
+        let header = FlashHeader::read_from_bytes(&data[..HEADER_SIZE]).unwrap();
+        assert_eq!(header.version, HEADER_VERSION_WITH_DIGESTS);
+        assert_eq!(
+            read_image_digests(&data, &header).unwrap().unwrap()[1].digest,
+            calculate_digest(images[1].data)
+        );
+
+        // Swapping two bytes keeps the checksum, only the digest catches it
+        let offset = image_info[1].offset as usize;
+        data.swap(offset, offset + 1);
+        assert!(FlashImage::verify_flash_image(&data).is_err());
+
+        fs::remove_file(image_path).expect("Failed to clean up test file");
+    }
 }
@@ -0,0 +1,165 @@
+// Licensed under the Apache-2.0 license
+
+//! Firmware milestones reported to the emulator and the cycle budgets tests
+//! enforce between them.
+
+/// Points of the MCU boot and update flows that the firmware reports.
+///
+/// The value is written to the milestone register of the emulator control
+/// device, which records the cycle count at which it was reached.
+#[repr(u32)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub enum Milestone {
+    RomStart = 1,
+    FusesRead = 2,
+    CaliptraReady = 3,
+    RuntimeStart = 4,
+    FirstSpdmResponse = 5,
+    UpdateComplete = 6,
+    FlashRecoveryStart = 7,
+    FlashRecoveryComplete = 8,
+}
+
+impl Milestone {
+    pub const ALL: [Milestone; 8] = [
+        Milestone::RomStart,
+        Milestone::FusesRead,
+        Milestone::CaliptraReady,
+        Milestone::RuntimeStart,
+        Milestone::FirstSpdmResponse,
+        Milestone::UpdateComplete,
+        Milestone::FlashRecoveryStart,
+        Milestone::FlashRecoveryComplete,
+    ];
+
+    pub fn from_id(id: u32) -> Option<Self> {
+        Self::ALL.into_iter().find(|m| *m as u32 == id)
+    }
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Milestone::RomStart => "rom_start",
+            Milestone::FusesRead => "fuses_read",
+            Milestone::CaliptraReady => "caliptra_ready",
+            Milestone::RuntimeStart => "runtime_start",
+            Milestone::FirstSpdmResponse => "first_spdm_response",
+            Milestone::UpdateComplete => "update_complete",
+            Milestone::FlashRecoveryStart => "flash_recovery_start",
+            Milestone::FlashRecoveryComplete => "flash_recovery_complete",
+        }
+    }
+
+    pub fn from_name(name: &str) -> Option<Self> {
+        Self::ALL.into_iter().find(|m| m.name() == name)
+    }
+}
+
+/// Maximum number of cycles allowed between two milestones.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct CycleBudget {
+    pub from: Milestone,
+    pub to: Milestone,
+    pub max_cycles: u64,
+}
+
+impl CycleBudget {
+    pub const fn new(from: Milestone, to: Milestone, max_cycles: u64) -> Self {
+        Self {
+            from,
+            to,
+            max_cycles,
+        }
+    }
+
+    /// Budget of `margin_percent` percent of the `baseline` cycles recorded between
+    /// the two milestones.
+    pub const fn from_baseline(
+        from: Milestone,
+        to: Milestone,
+        baseline: u64,
+        margin_percent: u64,
+    ) -> Self {
+        Self::new(from, to, baseline * margin_percent / 100)
+    }
+
+    /// Returns the cycles spent between the first time `from` and `to` were
+    /// reached, or `None` if either was not reached or they are out of order.
+    pub fn measure(&self, milestones: &[(Milestone, u64)]) -> Option<u64> {
+        let first = |m: Milestone| milestones.iter().find(|(n, _)| *n == m).map(|(_, c)| *c);
+        first(self.to)?.checked_sub(first(self.from)?)
+    }
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum BudgetError {
+    /// One of the milestones of the budget was not reached, or was reached out of order.
+    Missing(CycleBudget),
+    /// The milestones were reached, but more cycles than budgeted were spent between them.
+    Exceeded { budget: CycleBudget, cycles: u64 },
+}
+
+/// Checks the recorded milestones against every budget.
+pub fn check_budgets(
+    milestones: &[(Milestone, u64)],
+    budgets: &[CycleBudget],
+) -> Result<(), BudgetError> {
+    for budget in budgets {
+        match budget.measure(milestones) {
+            None => Err(BudgetError::Missing(*budget))?,
+            Some(cycles) if cycles > budget.max_cycles => Err(BudgetError::Exceeded {
+                budget: *budget,
+                cycles,
+            })?,
+            Some(_) => {}
+        }
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_milestone_ids_and_names() {
+        for m in Milestone::ALL {
+            assert_eq!(Milestone::from_id(m as u32), Some(m));
+            assert_eq!(Milestone::from_name(m.name()), Some(m));
+        }
+        assert_eq!(Milestone::from_id(0), None);
+        assert_eq!(Milestone::from_name("unknown"), None);
+    }
+
+    #[test]
+    fn test_check_budgets() {
+        let recorded = [
+            (Milestone::RomStart, 100),
+            (Milestone::RuntimeStart, 1100),
+            (Milestone::RuntimeStart, 5000),
+        ];
+        let ok = CycleBudget::new(Milestone::RomStart, Milestone::RuntimeStart, 1000);
+        assert_eq!(
+            CycleBudget::from_baseline(Milestone::RomStart, Milestone::RuntimeStart, 800, 125),
+            ok
+        );
+        assert_eq!(ok.measure(&recorded), Some(1000));
+        assert_eq!(check_budgets(&recorded, &[ok]), Ok(()));
+
+        let tight = CycleBudget::new(Milestone::RomStart, Milestone::RuntimeStart, 999);
+        assert_eq!(
+            check_budgets(&recorded, &[ok, tight]),
+            Err(BudgetError::Exceeded {
+                budget: tight,
+                cycles: 1000
+            })
+        );
+
+        let missing = CycleBudget::new(Milestone::RomStart, Milestone::UpdateComplete, 1000);
+        assert_eq!(
+            check_budgets(&recorded, &[missing]),
+            Err(BudgetError::Missing(missing))
+        );
+        let reversed = CycleBudget::new(Milestone::RuntimeStart, Milestone::RomStart, 1000);
+        assert_eq!(reversed.measure(&recorded), None);
+    }
+}
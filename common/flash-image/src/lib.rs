@@ -12,6 +12,8 @@ pub const SOC_IMAGES_BASE_IDENTIFIER: u32 = 0x00001000;
 
 pub const FLASH_IMAGE_MAGIC_NUMBER: u32 = u32::from_be_bytes(*b"FLSH");
 pub const HEADER_VERSION: u16 = 0x0001;
+/// Header version of flash images that carry an image digest table
+pub const HEADER_VERSION_WITH_DIGESTS: u16 = 0x0002;
 
 #[repr(C)]
 #[derive(Debug, FromBytes, IntoBytes, Immutable, KnownLayout)]
@@ -28,7 +30,7 @@ impl FlashHeader {
         if self.magic.get() != FLASH_IMAGE_MAGIC_NUMBER {
             return false;
         }
-        if self.version != HEADER_VERSION {
+        if self.version != HEADER_VERSION && self.version != HEADER_VERSION_WITH_DIGESTS {
             return false;
         }
         if self.image_count == 0 {
@@ -44,6 +46,11 @@ impl FlashHeader {
                 .fold(0u32, |acc, &byte| acc.wrapping_add(byte as u32)),
         ) == self.header_checksum
     }
+
+    /// Whether an image digest table follows the image headers.
+    pub fn has_image_digests(&self) -> bool {
+        self.version == HEADER_VERSION_WITH_DIGESTS
+    }
 }
 
 #[repr(C)]
@@ -65,3 +72,43 @@ impl ImageHeader {
         ) == self.image_header_checksum
     }
 }
+
+pub const IMAGE_DIGEST_TABLE_MAGIC_NUMBER: u32 = u32::from_be_bytes(*b"DGST");
+/// Size of a SHA-384 digest, the only algorithm used for image digests
+pub const IMAGE_DIGEST_SIZE: usize = 48;
+
+/// Header of the optional image digest table.
+///
+/// Flash images with the [`HEADER_VERSION_WITH_DIGESTS`] header version have this table
+/// directly after the image headers. It holds one [`ImageDigest`] per image, in the same
+/// order as the image headers.
+#[repr(C)]
+#[derive(Debug, FromBytes, IntoBytes, Immutable, KnownLayout)]
+pub struct ImageDigestTableHeader {
+    pub magic: U32<zerocopy::byteorder::BigEndian>,
+    pub digest_count: u32,
+}
+
+impl ImageDigestTableHeader {
+    pub fn verify(&self, image_count: u16) -> bool {
+        self.magic.get() == IMAGE_DIGEST_TABLE_MAGIC_NUMBER
+            && self.digest_count == image_count as u32
+    }
+}
+
+/// SHA-384 digest of an image, computed over the `size` bytes of its image header.
+#[repr(C)]
+#[derive(Debug, FromBytes, IntoBytes, Clone, Copy, Immutable, KnownLayout)]
+pub struct ImageDigest {
+    pub identifier: u32,
+    pub digest: [u8; IMAGE_DIGEST_SIZE],
+}
+
+/// Offset of the image digest table in the flash image described by `header`, `None` if
+/// the flash image has no image digest table.
+pub fn image_digest_table_offset(header: &FlashHeader) -> Option<usize> {
+    header.has_image_digests().then_some(
+        header.image_headers_offset as usize
+            + header.image_count as usize * core::mem::size_of::<ImageHeader>(),
+    )
+}
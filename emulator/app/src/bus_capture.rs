@@ -0,0 +1,527 @@
+/*++
+
+Licensed under the Apache-2.0 license.
+
+File Name:
+
+    bus_capture.rs
+
+Abstract:
+
+    Record and replay of the traffic injected into the emulator by host-side clients.
+
+    In record mode, the I3C commands handed to the I3C controller, the DOE requests
+    handed to the DOE mailbox and the recovery events sent by the BMC to Caliptra are
+    written to a capture file along with the emulator tick at which they were injected.
+    In replay mode, the same transactions are injected again at the same ticks without
+    the original clients, so that firmware builds can be compared on identical workloads.
+    The replay ends at the tick of the last record, where the recorded run ended.
+
+    In lockstep, the responses of the I3C targets are recorded too. They are not replayed,
+    but recording a replay gives the same capture if the firmware answered the same way
+    on the same ticks.
+
+    Recovery images are replayed by index: the image sent is the one given to the
+    emulator for the replay, so that the workload stays the same when the firmware
+    changes.
+
+    The capture file starts with CAPTURE_MAGIC, followed by records made of the tick
+    (u64), the transaction kind (u8), the payload length (u32), all little-endian, and
+    the payload.
+
+--*/
+
+use crate::{virtual_time, EMULATOR_RUNNING, EMULATOR_TICKS};
+use caliptra_emu_bus::{Event, EventData, RecoveryCommandCode};
+use emulator_bmc::Bmc;
+use emulator_periph::{I3cBusCommand, I3cBusResponse, I3cTcriCommand, I3cTcriCommandXfer};
+use std::fs::File;
+use std::io::{self, BufReader, ErrorKind, Read, Write};
+use std::path::Path;
+use std::sync::atomic::Ordering;
+use std::sync::mpsc::{self, Receiver, Sender};
+use std::sync::{Arc, Mutex};
+use std::thread;
+use zerocopy::IntoBytes;
+
+const CAPTURE_MAGIC: &[u8; 8] = b"MCUBUS01";
+const RECORD_HEADER_LEN: usize = 13;
+
+const KIND_I3C_COMMAND: u8 = 1;
+const KIND_DOE_REQUEST: u8 = 2;
+const KIND_BMC_RECOVERY_CTRL: u8 = 3;
+const KIND_BMC_RECOVERY_IMAGE: u8 = 4;
+const KIND_I3C_RESPONSE: u8 = 5;
+
+/// A transaction injected into the emulator from the host side.
+#[derive(Clone, Debug, PartialEq)]
+pub enum Transaction {
+    /// I3C command, with the target address and the raw TCRI command descriptor
+    I3cCommand { addr: u8, cmd: u64, data: Vec<u8> },
+    /// DOE data object written to the DOE mailbox
+    DoeRequest(Vec<u8>),
+    /// Write of the recovery control register by the BMC
+    BmcRecoveryCtrl(Vec<u8>),
+    /// Recovery image made available by the BMC
+    BmcRecoveryImage(u8),
+    /// I3C response, with the target address, the IBI and the raw TCRI response descriptor
+    I3cResponse {
+        addr: u8,
+        ibi: Option<u8>,
+        resp: u32,
+        data: Vec<u8>,
+    },
+}
+
+/// Where the transactions of a kind are injected on replay.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+enum ReplayChannel {
+    I3c,
+    Doe,
+    Bmc,
+}
+
+impl Transaction {
+    fn encode(&self, tick: u64) -> Vec<u8> {
+        let (kind, payload) = match self {
+            Transaction::I3cCommand { addr, cmd, data } => {
+                let mut payload = vec![*addr];
+                payload.extend_from_slice(&cmd.to_le_bytes());
+                payload.extend_from_slice(data);
+                (KIND_I3C_COMMAND, payload)
+            }
+            Transaction::DoeRequest(data) => (KIND_DOE_REQUEST, data.clone()),
+            Transaction::BmcRecoveryCtrl(payload) => (KIND_BMC_RECOVERY_CTRL, payload.clone()),
+            Transaction::BmcRecoveryImage(image_id) => (KIND_BMC_RECOVERY_IMAGE, vec![*image_id]),
+            Transaction::I3cResponse {
+                addr,
+                ibi,
+                resp,
+                data,
+            } => {
+                let mut payload = vec![*addr, ibi.is_some() as u8, ibi.unwrap_or_default()];
+                payload.extend_from_slice(&resp.to_le_bytes());
+                payload.extend_from_slice(data);
+                (KIND_I3C_RESPONSE, payload)
+            }
+        };
+        let mut record = Vec::with_capacity(RECORD_HEADER_LEN + payload.len());
+        record.extend_from_slice(&tick.to_le_bytes());
+        record.push(kind);
+        record.extend_from_slice(&(payload.len() as u32).to_le_bytes());
+        record.extend_from_slice(&payload);
+        record
+    }
+
+    fn decode(kind: u8, payload: Vec<u8>) -> io::Result<Self> {
+        let invalid = || io::Error::new(ErrorKind::InvalidData, "Invalid bus capture record");
+        match kind {
+            KIND_I3C_COMMAND => {
+                if payload.len() < 9 {
+                    return Err(invalid());
+                }
+                Ok(Transaction::I3cCommand {
+                    addr: payload[0],
+                    cmd: u64::from_le_bytes(payload[1..9].try_into().unwrap()),
+                    data: payload[9..].to_vec(),
+                })
+            }
+            KIND_DOE_REQUEST => Ok(Transaction::DoeRequest(payload)),
+            KIND_BMC_RECOVERY_CTRL => Ok(Transaction::BmcRecoveryCtrl(payload)),
+            KIND_BMC_RECOVERY_IMAGE => match payload[..] {
+                [image_id] => Ok(Transaction::BmcRecoveryImage(image_id)),
+                _ => Err(invalid()),
+            },
+            KIND_I3C_RESPONSE => {
+                if payload.len() < 7 {
+                    return Err(invalid());
+                }
+                Ok(Transaction::I3cResponse {
+                    addr: payload[0],
+                    ibi: (payload[1] != 0).then_some(payload[2]),
+                    resp: u32::from_le_bytes(payload[3..7].try_into().unwrap()),
+                    data: payload[7..].to_vec(),
+                })
+            }
+            _ => Err(invalid()),
+        }
+    }
+
+    fn from_i3c_command(command: &I3cBusCommand) -> Self {
+        Transaction::I3cCommand {
+            addr: command.addr.into(),
+            cmd: command.cmd.cmd.clone().into(),
+            data: command.cmd.data.clone(),
+        }
+    }
+
+    pub fn from_i3c_response(response: &I3cBusResponse) -> Self {
+        Transaction::I3cResponse {
+            addr: response.addr.into(),
+            ibi: response.ibi,
+            resp: u32::from_le_bytes(response.resp.resp.as_bytes().try_into().unwrap()),
+            data: response.resp.data.clone(),
+        }
+    }
+
+    fn replay_channel(&self) -> Option<ReplayChannel> {
+        match self {
+            Transaction::I3cCommand { .. } => Some(ReplayChannel::I3c),
+            Transaction::DoeRequest(_) => Some(ReplayChannel::Doe),
+            Transaction::BmcRecoveryCtrl(_) | Transaction::BmcRecoveryImage(_) => {
+                Some(ReplayChannel::Bmc)
+            }
+            // Responses come from the firmware
+            Transaction::I3cResponse { .. } => None,
+        }
+    }
+
+    /// Returns the transaction for an event sent by the BMC to Caliptra, if it is one that
+    /// changes the state of Caliptra. Reads of the recovery registers are not recorded.
+    fn from_bmc_event(event: &Event) -> Option<Self> {
+        match &event.event {
+            EventData::RecoveryBlockWrite {
+                command_code: RecoveryCommandCode::RecoveryCtrl,
+                payload,
+                ..
+            } => Some(Transaction::BmcRecoveryCtrl(payload.clone())),
+            EventData::RecoveryImageAvailable { image_id, .. } => {
+                Some(Transaction::BmcRecoveryImage(*image_id))
+            }
+            _ => None,
+        }
+    }
+}
+
+/// Writes the transactions injected into the emulator to a capture file.
+pub struct BusRecorder {
+    file: Mutex<File>,
+}
+
+impl BusRecorder {
+    pub fn create(path: &Path) -> io::Result<Arc<Self>> {
+        let mut file = File::create(path)?;
+        file.write_all(CAPTURE_MAGIC)?;
+        Ok(Arc::new(BusRecorder {
+            file: Mutex::new(file),
+        }))
+    }
+
+    /// Records `transaction` as injected at the current emulator tick. Each record is
+    /// written at once, so the capture is complete even if the emulator exits abruptly.
+    pub fn record(&self, transaction: &Transaction) {
+        let record = transaction.encode(EMULATOR_TICKS.load(Ordering::Relaxed));
+        if let Err(err) = self.file.lock().unwrap().write_all(&record) {
+            println!("Failed to record bus transaction: {}", err);
+        }
+    }
+}
+
+/// Records the I3C commands received on `rx`, returns the receiver to hand to the I3C
+/// controller instead. In lockstep, the relay forwards at quantum boundaries like the
+/// clients it sits behind, so the recorded ticks do not depend on thread scheduling.
+pub fn record_i3c_commands(
+    rx: Receiver<I3cBusCommand>,
+    recorder: Arc<BusRecorder>,
+) -> Receiver<I3cBusCommand> {
+    let (tx, recorded_rx) = mpsc::channel();
+    let client = virtual_time::reserve();
+    thread::spawn(move || {
+        let _client = client.attach();
+        while let Ok(command) = virtual_time::recv(&rx) {
+            recorder.record(&Transaction::from_i3c_command(&command));
+            if tx.send(command).is_err() {
+                break;
+            }
+        }
+    });
+    recorded_rx
+}
+
+/// Records the DOE requests sent to `tx`, returns the sender to hand to the clients instead.
+pub fn record_doe_requests(tx: Sender<Vec<u8>>, recorder: Arc<BusRecorder>) -> Sender<Vec<u8>> {
+    let (recorded_tx, rx) = mpsc::channel::<Vec<u8>>();
+    let client = virtual_time::reserve();
+    thread::spawn(move || {
+        let _client = client.attach();
+        while let Ok(request) = virtual_time::recv(&rx) {
+            recorder.record(&Transaction::DoeRequest(request.clone()));
+            if tx.send(request).is_err() {
+                break;
+            }
+        }
+    });
+    recorded_tx
+}
+
+/// Sits between the BMC and Caliptra to record the recovery events of the BMC. It is
+/// stepped by the emulator right after the BMC, so that the events reach Caliptra on the
+/// same tick as without it.
+pub struct BmcEventTap {
+    from_bmc: Receiver<Event>,
+    to_caliptra: Sender<Event>,
+    recorder: Arc<BusRecorder>,
+}
+
+impl BmcEventTap {
+    /// Returns the tap and the sender to hand to the BMC instead of `to_caliptra`.
+    pub fn new(to_caliptra: Sender<Event>, recorder: Arc<BusRecorder>) -> (Self, Sender<Event>) {
+        let (tx, from_bmc) = mpsc::channel();
+        (
+            BmcEventTap {
+                from_bmc,
+                to_caliptra,
+                recorder,
+            },
+            tx,
+        )
+    }
+
+    pub fn step(&self) {
+        while let Ok(event) = self.from_bmc.try_recv() {
+            if let Some(transaction) = Transaction::from_bmc_event(&event) {
+                self.recorder.record(&transaction);
+            }
+            let _ = self.to_caliptra.send(event);
+        }
+    }
+}
+
+/// Reads the records of a capture file in order.
+pub struct CaptureReader<R: Read> {
+    reader: R,
+}
+
+impl<R: Read> CaptureReader<R> {
+    pub fn new(mut reader: R) -> io::Result<Self> {
+        let mut magic = [0u8; CAPTURE_MAGIC.len()];
+        reader.read_exact(&mut magic)?;
+        if magic != *CAPTURE_MAGIC {
+            return Err(io::Error::new(
+                ErrorKind::InvalidData,
+                "Not a bus capture file",
+            ));
+        }
+        Ok(CaptureReader { reader })
+    }
+
+    /// Returns the next record and its tick, `None` at the end of the capture.
+    pub fn next_record(&mut self) -> io::Result<Option<(u64, Transaction)>> {
+        let mut header = [0u8; RECORD_HEADER_LEN];
+        match self.reader.read_exact(&mut header) {
+            Ok(()) => {}
+            Err(err) if err.kind() == ErrorKind::UnexpectedEof => return Ok(None),
+            Err(err) => return Err(err),
+        }
+        let tick = u64::from_le_bytes(header[..8].try_into().unwrap());
+        let len = u32::from_le_bytes(header[9..].try_into().unwrap()) as usize;
+        let mut payload = vec![0u8; len];
+        self.reader.read_exact(&mut payload)?;
+        Ok(Some((tick, Transaction::decode(header[8], payload)?)))
+    }
+}
+
+/// Injects the transactions of a capture file at the ticks they were recorded at.
+pub struct BusReplay {
+    reader: CaptureReader<BufReader<File>>,
+    next: Option<(u64, Transaction)>,
+    channels: Vec<ReplayChannel>,
+    recorder: Option<Arc<BusRecorder>>,
+    i3c_tx: Option<Sender<I3cBusCommand>>,
+    i3c_responses: Option<Receiver<I3cBusResponse>>,
+    doe_tx: Option<Sender<Vec<u8>>>,
+    doe_responses: Option<Receiver<Vec<u8>>>,
+}
+
+impl BusReplay {
+    pub fn open(path: &Path) -> io::Result<Self> {
+        // Scan the capture once for the channels the replay needs
+        let mut scan = CaptureReader::new(BufReader::new(File::open(path)?))?;
+        let mut channels = vec![];
+        while let Some((_, transaction)) = scan.next_record()? {
+            if let Some(channel) = transaction.replay_channel() {
+                if !channels.contains(&channel) {
+                    channels.push(channel);
+                }
+            }
+        }
+
+        let mut reader = CaptureReader::new(BufReader::new(File::open(path)?))?;
+        let next = reader.next_record()?;
+        Ok(BusReplay {
+            reader,
+            next,
+            channels,
+            recorder: None,
+            i3c_tx: None,
+            i3c_responses: None,
+            doe_tx: None,
+            doe_responses: None,
+        })
+    }
+
+    /// Returns the channel ends to hand to the I3C controller.
+    pub fn i3c_channels(&mut self) -> (Receiver<I3cBusCommand>, Sender<I3cBusResponse>) {
+        let (command_tx, command_rx) = mpsc::channel();
+        let (response_tx, response_rx) = mpsc::channel();
+        self.i3c_tx = Some(command_tx);
+        self.i3c_responses = Some(response_rx);
+        (command_rx, response_tx)
+    }
+
+    /// Connects the replay to the channel ends returned by `DoeMboxFsm::start`.
+    pub fn connect_doe(&mut self, tx: Sender<Vec<u8>>, rx: Receiver<Vec<u8>>) {
+        self.doe_tx = Some(tx);
+        self.doe_responses = Some(rx);
+    }
+
+    /// Records the I3C commands and DOE requests as they are injected, to compare a replay
+    /// with its capture. The BMC events are recorded by the `BmcEventTap` of the BMC.
+    pub fn record_to(&mut self, recorder: Arc<BusRecorder>) {
+        self.recorder = Some(recorder);
+    }
+
+    /// Fails if the capture holds transactions that this emulator cannot inject, rather
+    /// than dropping traffic that the recorded firmware saw.
+    pub fn check_connected(&self, bmc: bool) -> io::Result<()> {
+        for channel in self.channels.iter() {
+            let connected = match channel {
+                ReplayChannel::I3c => self.i3c_tx.is_some(),
+                ReplayChannel::Doe => self.doe_tx.is_some(),
+                ReplayChannel::Bmc => bmc,
+            };
+            if !connected {
+                return Err(io::Error::new(
+                    ErrorKind::Unsupported,
+                    format!(
+                        "The bus capture has {:?} transactions, which this emulator cannot replay",
+                        channel
+                    ),
+                ));
+            }
+        }
+        Ok(())
+    }
+
+    /// Called by the emulator at every step, injects the transactions recorded up to `now`,
+    /// and stops the emulator after the last one.
+    pub fn step(&mut self, now: u64, bmc: Option<&mut Bmc>) {
+        if self.next.as_ref().is_some_and(|(tick, _)| *tick > now) {
+            return;
+        }
+        let mut bmc = bmc;
+        while let Some((_, transaction)) = self.next.take_if(|(tick, _)| *tick <= now) {
+            self.inject(transaction, bmc.as_deref_mut());
+            self.next = self.reader.next_record().unwrap_or_else(|err| {
+                println!("Failed to read bus capture: {}", err);
+                None
+            });
+        }
+        // The responses were checked when the capture was recorded
+        if let Some(rx) = self.i3c_responses.as_ref() {
+            while rx.try_recv().is_ok() {}
+        }
+        if let Some(rx) = self.doe_responses.as_ref() {
+            while rx.try_recv().is_ok() {}
+        }
+        if self.next.is_none() {
+            println!("Bus replay complete at tick {}", now);
+            EMULATOR_RUNNING.store(false, Ordering::Relaxed);
+        }
+    }
+
+    fn inject(&mut self, transaction: Transaction, bmc: Option<&mut Bmc>) {
+        if let Some(recorder) = self.recorder.as_ref() {
+            if matches!(
+                transaction.replay_channel(),
+                Some(ReplayChannel::I3c | ReplayChannel::Doe)
+            ) {
+                recorder.record(&transaction);
+            }
+        }
+        match transaction {
+            Transaction::I3cCommand { addr, cmd, data } => {
+                let cmd = match I3cTcriCommand::try_from([cmd as u32, (cmd >> 32) as u32]) {
+                    Ok(cmd) => cmd,
+                    Err(_) => {
+                        println!("Invalid I3C command in bus capture");
+                        return;
+                    }
+                };
+                if let Some(tx) = self.i3c_tx.as_ref() {
+                    let _ = tx.send(I3cBusCommand {
+                        addr: addr.into(),
+                        cmd: I3cTcriCommandXfer { cmd, data },
+                    });
+                }
+            }
+            Transaction::DoeRequest(request) => {
+                if let Some(tx) = self.doe_tx.as_ref() {
+                    let _ = tx.send(request);
+                }
+            }
+            Transaction::BmcRecoveryCtrl(payload) => {
+                if let Some(bmc) = bmc {
+                    bmc.send_recovery_ctrl(payload);
+                }
+            }
+            Transaction::BmcRecoveryImage(image_id) => {
+                if let Some(bmc) = bmc {
+                    bmc.send_recovery_image(image_id);
+                }
+            }
+            Transaction::I3cResponse { .. } => {}
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn test_capture_round_trip() {
+        let transactions = vec![
+            (
+                10,
+                Transaction::I3cCommand {
+                    addr: 8,
+                    cmd: 0x0004_0000_0000_0002,
+                    data: vec![1, 2, 3, 4],
+                },
+            ),
+            (2000, Transaction::DoeRequest(vec![5; 16])),
+            (3000, Transaction::BmcRecoveryCtrl(vec![0, 0, 0xf])),
+            (3000, Transaction::BmcRecoveryImage(2)),
+            (
+                4000,
+                Transaction::I3cResponse {
+                    addr: 8,
+                    ibi: Some(0xae),
+                    resp: 0x0004_0000,
+                    data: vec![6, 7, 8, 9],
+                },
+            ),
+            (
+                5000,
+                Transaction::I3cResponse {
+                    addr: 8,
+                    ibi: None,
+                    resp: 0,
+                    data: vec![],
+                },
+            ),
+        ];
+        let mut capture = CAPTURE_MAGIC.to_vec();
+        for (tick, transaction) in transactions.iter() {
+            capture.extend(transaction.encode(*tick));
+        }
+
+        let mut reader = CaptureReader::new(&capture[..]).unwrap();
+        for expected in transactions {
+            assert_eq!(reader.next_record().unwrap(), Some(expected));
+        }
+        assert_eq!(reader.next_record().unwrap(), None);
+        assert!(CaptureReader::new(&b"NOTACAPT"[..]).is_err());
+    }
+}
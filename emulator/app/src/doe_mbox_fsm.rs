@@ -1,10 +1,12 @@
 // Licensed under the Apache-2.0 license
 
-use crate::{sleep_emulator_ticks, wait_for_runtime_start, EMULATOR_RUNNING};
+use crate::bus_capture::{self, BusRecorder};
+use crate::{sleep_emulator_ticks, virtual_time, wait_for_runtime_start, EMULATOR_RUNNING};
 use emulator_periph::DoeMboxPeriph;
 use std::process::exit;
 use std::sync::atomic::Ordering;
 use std::sync::mpsc::{Receiver, Sender};
+use std::sync::Arc;
 use std::thread;
 use std::time::Duration;
 
@@ -19,11 +21,20 @@ enum DoeMboxState {
 
 pub struct DoeMboxFsm {
     doe_mbox: DoeMboxPeriph,
+    recorder: Option<Arc<BusRecorder>>,
 }
 
 impl DoeMboxFsm {
     pub fn new(doe_mbox: DoeMboxPeriph) -> Self {
-        Self { doe_mbox }
+        Self {
+            doe_mbox,
+            recorder: None,
+        }
+    }
+
+    /// Records the requests sent through the channel returned by `start`.
+    pub fn record_requests(&mut self, recorder: Arc<BusRecorder>) {
+        self.recorder = Some(recorder);
     }
 
     pub fn start(&mut self) -> (Receiver<Vec<u8>>, Sender<Vec<u8>>) {
@@ -31,7 +42,9 @@ impl DoeMboxFsm {
         let (fsm_to_test_tx, fsm_to_test_rx) = std::sync::mpsc::channel::<Vec<u8>>();
         let doe_mbox_clone = self.doe_mbox.clone();
 
+        let client = virtual_time::reserve();
         thread::spawn(move || {
+            let _client = client.attach();
             let mut fsm = DoeMboxStateMachine::new(doe_mbox_clone, fsm_to_test_tx);
 
             while EMULATOR_RUNNING.load(Ordering::Relaxed) {
@@ -47,6 +60,10 @@ impl DoeMboxFsm {
                 sleep_emulator_ticks(1000);
             }
         });
+        let test_to_fsm_tx = match self.recorder.clone() {
+            Some(recorder) => bus_capture::record_doe_requests(test_to_fsm_tx, recorder),
+            None => test_to_fsm_tx,
+        };
         (fsm_to_test_rx, test_to_fsm_tx)
     }
 }
@@ -242,7 +259,9 @@ pub(crate) fn run_doe_transport_tests(
     });
 
     // Spawn a thread to run the tests
+    let client = virtual_time::reserve();
     thread::spawn(move || {
+        let _client = client.attach();
         wait_for_runtime_start();
         if !EMULATOR_RUNNING.load(Ordering::Relaxed) {
             exit(-1);
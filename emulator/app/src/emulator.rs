@@ -12,14 +12,16 @@ Abstract:
 
 --*/
 
+use crate::bus_capture::{self, BmcEventTap, BusRecorder, BusReplay, Transaction};
 use crate::dis;
 use crate::doe_mbox_fsm;
 use crate::elf;
 use crate::i3c_socket;
 use crate::i3c_socket::start_i3c_socket;
 use crate::mctp_transport::MctpTransport;
+use crate::profiler::{Profiler, SymbolTable};
 use crate::tests;
-use crate::{EMULATOR_RUNNING, EMULATOR_TICKS, MCU_RUNTIME_STARTED, TICK_COND};
+use crate::{virtual_time, EMULATOR_RUNNING, EMULATOR_TICKS, MCU_RUNTIME_STARTED, TICK_COND};
 use caliptra_emu_bus::{Bus, Clock, Timer};
 use caliptra_emu_cpu::{Cpu, Pic, RvInstr, StepAction};
 use caliptra_emu_cpu::{Cpu as CaliptraMainCpu, StepAction as CaliptraMainStepAction};
@@ -27,12 +29,12 @@ use caliptra_emu_periph::CaliptraRootBus as CaliptraMainRootBus;
 use clap::{ArgAction, Parser};
 use clap_num::maybe_hex;
 use crossterm::event::{Event, KeyCode, KeyEvent};
-use emulator_bmc::Bmc;
+use emulator_bmc::{Bmc, RecoveryImage};
 use emulator_caliptra::{start_caliptra, StartCaliptraArgs};
 use emulator_consts::{DEFAULT_CPU_ARGS, RAM_ORG, ROM_SIZE};
 use emulator_periph::{
-    DoeMboxPeriph, DummyDoeMbox, DummyFlashCtrl, I3c, I3cController, LcCtrl, Mci, McuRootBus,
-    McuRootBusArgs, McuRootBusOffsets, Otp,
+    impair_i3c_link, DoeMboxPeriph, DummyDoeMbox, DummyFlashCtrl, FlashOpLog, I3c, I3cController,
+    I3cImpairment, LcCtrl, Mci, McuRootBus, McuRootBusArgs, McuRootBusOffsets, MilestoneLog, Otp,
 };
 use emulator_registers_generated::dma::DmaPeripheral;
 use emulator_registers_generated::root_bus::{AutoRootBus, AutoRootBusOffsets};
@@ -77,6 +79,30 @@ pub struct EmulatorArgs {
     #[arg(short, long, default_value_t = false)]
     pub trace_instr: bool,
 
+    /// Profile the MCU CPU, and write the cycles spent by PC and by function, and the
+    /// sampled call stacks, to this directory when the emulator exits.
+    #[arg(long)]
+    pub profile: Option<PathBuf>,
+
+    /// ELF files of the profiled firmware (ROM, kernel and apps), to attribute cycles to
+    /// functions. Call stacks are only complete for firmware built with frame pointers.
+    #[arg(long, requires = "profile")]
+    pub profile_elf: Vec<PathBuf>,
+
+    /// Cycles between two call stack samples of the profiler, 0 to disable sampling
+    #[arg(long, default_value_t = 1000)]
+    pub profile_sample_cycles: u64,
+
+    /// Write the firmware milestones, and the cycle count at which they were reached,
+    /// to this file when the emulator exits.
+    #[arg(long, env = "MCU_MILESTONES")]
+    pub milestones: Option<PathBuf>,
+
+    /// Log the page operations of the primary and secondary flash controllers to this
+    /// file, one `<flash> <operation> <page>` line per completed operation.
+    #[arg(long)]
+    pub flash_op_log: Option<PathBuf>,
+
     // These look backwards, but this is necessary so that the default is to capture stdin.
     /// Pass stdin to the MCU UART Rx.
     #[arg(long = "no-stdin-uart", action = ArgAction::SetFalse)]
@@ -100,6 +126,48 @@ pub struct EmulatorArgs {
     #[arg(long)]
     pub i3c_port: Option<u16>,
 
+    /// Latency in microseconds added to every I3C packet exchanged over the I3C port
+    #[arg(long, default_value_t = 0)]
+    pub i3c_latency_us: u64,
+
+    /// Maximum random jitter in microseconds added on top of the I3C latency
+    #[arg(long, default_value_t = 0)]
+    pub i3c_jitter_us: u64,
+
+    /// Bandwidth cap of the I3C link in bits per second
+    #[arg(long)]
+    pub i3c_bandwidth_bps: Option<u64>,
+
+    /// Probability (0.0 to 1.0) of an I3C packet being dropped
+    #[arg(long, default_value_t = 0.0)]
+    pub i3c_drop_rate: f64,
+
+    /// Probability (0.0 to 1.0) of an I3C private transfer having a corrupted PEC
+    #[arg(long, default_value_t = 0.0)]
+    pub i3c_pec_error_rate: f64,
+
+    /// Seed for the random I3C link impairments, to reproduce a run
+    #[arg(long, default_value_t = 1)]
+    pub i3c_impairment_seed: u64,
+
+    /// Run the in-process test clients in lockstep with the emulator, so that their
+    /// timeouts are counted in emulator ticks and runs are reproducible. The I3C link
+    /// impairments, the PLDM clients and the test watchdogs still run on wall-clock time.
+    #[arg(long, env = "MCU_LOCKSTEP", default_value_t = false)]
+    pub lockstep: bool,
+
+    /// Record the traffic injected into the I3C controller, the DOE mailbox and by the BMC
+    /// to this file, with the emulator tick of each transaction. In lockstep, the I3C
+    /// responses of the firmware are recorded too.
+    #[arg(long, env = "MCU_RECORD_BUS")]
+    pub record_bus: Option<PathBuf>,
+
+    /// Replay the traffic recorded with --record-bus from this file instead of running the
+    /// host-side clients, in lockstep, until the last recorded tick. The I3C socket is not
+    /// started. Recovery images are taken from the images given to this run.
+    #[arg(long, env = "MCU_REPLAY_BUS", conflicts_with = "streaming_boot")]
+    pub replay_bus: Option<PathBuf>,
+
     /// This is only needed if the IDevID CSR needed to be generated in the Caliptra Core.
     #[arg(long)]
     pub manufacturing_mode: bool,
@@ -243,6 +311,41 @@ pub struct Emulator {
     pub i3c_controller: I3cController,
     #[allow(dead_code)]
     pub doe_mbox_fsm: doe_mbox_fsm::DoeMboxFsm,
+    pub bmc_event_tap: Option<BmcEventTap>,
+    pub bus_replay: Option<BusReplay>,
+    pub bus_recorder: Option<Arc<BusRecorder>>,
+    pub profiler: Option<Rc<RefCell<Profiler>>>,
+    pub milestones: MilestoneLog,
+}
+
+/// Writes the firmware milestones to a file, one `<name> <cycles>` line per milestone.
+struct MilestoneExport {
+    path: PathBuf,
+    log: MilestoneLog,
+}
+
+impl MilestoneExport {
+    fn write(&self) {
+        let lines: String = self
+            .log
+            .get()
+            .iter()
+            .map(|(milestone, cycles)| format!("{} {}\n", milestone.name(), cycles))
+            .collect();
+        if let Err(err) = std::fs::write(&self.path, lines) {
+            println!(
+                "Failed to write the milestones to {}: {}",
+                self.path.display(),
+                err
+            );
+        }
+    }
+}
+
+impl Drop for MilestoneExport {
+    fn drop(&mut self) {
+        self.write();
+    }
 }
 
 impl Emulator {
@@ -255,6 +358,18 @@ impl Emulator {
             exit(-1);
         }
 
+        // A replay runs the I3C controller at quantum boundaries, as when it was recorded
+        if cli.lockstep || cli.replay_bus.is_some() {
+            virtual_time::enable_lockstep();
+        }
+
+        let bus_recorder = cli
+            .record_bus
+            .as_deref()
+            .map(BusRecorder::create)
+            .transpose()?;
+        let mut bus_replay = cli.replay_bus.as_deref().map(BusReplay::open).transpose()?;
+
         let device_lifecycle: Option<String> = if cli.manufacturing_mode {
             Some("manufacturing".into())
         } else {
@@ -296,7 +411,7 @@ impl Emulator {
             rom_buffer.len(),
         );
 
-        let mcu_firmware = read_binary(&cli.firmware, 0x4000_0000)?;
+        let mcu_firmware = read_recovery_image(&cli.firmware, 0x4000_0000)?;
 
         let clock = Rc::new(Clock::new());
 
@@ -427,17 +542,35 @@ impl Emulator {
             pic: pic.clone(),
             clock: clock.clone(),
         };
-        let root_bus = McuRootBus::new(bus_args).unwrap();
+        let mut root_bus = McuRootBus::new(bus_args).unwrap();
         let dma_ram = root_bus.ram.clone();
         let dma_rom_sram = root_bus.rom_sram.clone();
         let direct_read_flash = root_bus.direct_read_flash.clone();
 
         let i3c_irq = pic.register_irq(McuRootBus::I3C_IRQ);
 
-        println!("Starting I3C Socket, port {}", cli.i3c_port.unwrap_or(0));
-
-        let mut i3c_controller = if let Some(i3c_port) = cli.i3c_port {
+        let mut i3c_controller = if let Some(bus_replay) = bus_replay.as_mut() {
+            let (rx, tx) = bus_replay.i3c_channels();
+            I3cController::new(rx, tx)
+        } else if let Some(i3c_port) = cli.i3c_port {
+            println!("Starting I3C Socket, port {}", i3c_port);
             let (rx, tx) = start_i3c_socket(i3c_port);
+            let impairment = I3cImpairment {
+                latency: std::time::Duration::from_micros(cli.i3c_latency_us),
+                jitter: std::time::Duration::from_micros(cli.i3c_jitter_us),
+                bandwidth_bps: cli.i3c_bandwidth_bps,
+                drop_rate: cli.i3c_drop_rate,
+                pec_error_rate: cli.i3c_pec_error_rate,
+                seed: cli.i3c_impairment_seed,
+            };
+            if !impairment.is_ideal() {
+                println!("I3C link impairment: {:?}", impairment);
+            }
+            let (rx, tx) = impair_i3c_link(rx, tx, &impairment);
+            let rx = match bus_recorder.as_ref() {
+                Some(recorder) => bus_capture::record_i3c_commands(rx, recorder.clone()),
+                None => rx,
+            };
             I3cController::new(rx, tx)
         } else {
             I3cController::default()
@@ -454,13 +587,27 @@ impl Emulator {
         let doe_mbox_periph = DoeMboxPeriph::default();
 
         let mut doe_mbox_fsm = doe_mbox_fsm::DoeMboxFsm::new(doe_mbox_periph.clone());
+        if let Some(recorder) = bus_recorder.as_ref() {
+            // A replay records the transactions as it injects them, on the recorded ticks
+            match bus_replay.as_mut() {
+                Some(bus_replay) => bus_replay.record_to(recorder.clone()),
+                None => doe_mbox_fsm.record_requests(recorder.clone()),
+            }
+        }
 
         let doe_mbox = DummyDoeMbox::new(&clock.clone(), doe_event_irq, doe_mbox_periph);
 
         println!("Starting DOE mailbox transport thread");
 
         // Feature flag based test setup
-        if cfg!(feature = "test-doe-transport-loopback") {
+        if let Some(bus_replay) = bus_replay.as_mut() {
+            println!(
+                "Replaying bus traffic from {:?}",
+                cli.replay_bus.as_ref().unwrap()
+            );
+            let (test_rx, test_tx) = doe_mbox_fsm.start();
+            bus_replay.connect_doe(test_tx, test_rx);
+        } else if cfg!(feature = "test-doe-transport-loopback") {
             let (test_rx, test_tx) = doe_mbox_fsm.start();
             println!("Starting DOE transport loopback test thread");
             let tests = tests::doe_transport_loopback::generate_tests();
@@ -476,7 +623,7 @@ impl Emulator {
             let tests = tests::doe_user_loopback::generate_tests();
             doe_mbox_fsm::run_doe_transport_tests(test_tx, test_rx, tests);
         } else if cfg!(feature = "test-mctp-ctrl-cmds") {
-            i3c_controller.start();
+            start_i3c_controller(&mut i3c_controller);
             println!(
                 "Starting test-mctp-ctrl-cmds test thread for testing target {:?}",
                 i3c.get_dynamic_address().unwrap()
@@ -489,8 +636,22 @@ impl Emulator {
                 tests,
                 None,
             );
+        } else if cfg!(feature = "test-mctp-bridge") {
+            start_i3c_controller(&mut i3c_controller);
+            println!(
+                "Starting MCTP bridge test thread for testing target {:?}",
+                i3c.get_dynamic_address().unwrap()
+            );
+
+            let tests = tests::mctp_bridge::generate_tests();
+            i3c_socket::run_tests(
+                cli.i3c_port.unwrap(),
+                i3c.get_dynamic_address().unwrap(),
+                tests,
+                None,
+            );
         } else if cfg!(feature = "test-mctp-capsule-loopback") {
-            i3c_controller.start();
+            start_i3c_controller(&mut i3c_controller);
             println!(
                 "Starting loopback test thread for testing target {:?}",
                 i3c.get_dynamic_address().unwrap()
@@ -504,7 +665,7 @@ impl Emulator {
                 None,
             );
         } else if cfg!(feature = "test-mctp-user-loopback") {
-            i3c_controller.start();
+            start_i3c_controller(&mut i3c_controller);
             println!(
                 "Starting loopback test thread for testing target {:?}",
                 i3c.get_dynamic_address().unwrap()
@@ -525,7 +686,7 @@ impl Emulator {
                 println!("SPDM_VALIDATOR_DIR environment variable is not set. Skipping test");
                 exit(0);
             }
-            i3c_controller.start();
+            start_i3c_controller(&mut i3c_controller);
             crate::tests::spdm_responder_validator::mctp::run_mctp_spdm_conformance_test(
                 cli.i3c_port.unwrap(),
                 i3c.get_dynamic_address().unwrap(),
@@ -549,7 +710,7 @@ impl Emulator {
             feature = "test-pldm-discovery",
             feature = "test-pldm-fw-update",
         )) {
-            i3c_controller.start();
+            start_i3c_controller(&mut i3c_controller);
             let pldm_transport =
                 MctpTransport::new(cli.i3c_port.unwrap(), i3c.get_dynamic_address().unwrap());
             let pldm_socket = pldm_transport
@@ -559,7 +720,7 @@ impl Emulator {
         }
 
         if cfg!(feature = "test-pldm-fw-update-e2e") {
-            i3c_controller.start();
+            start_i3c_controller(&mut i3c_controller);
             let pldm_transport =
                 MctpTransport::new(cli.i3c_port.unwrap(), i3c.get_dynamic_address().unwrap());
             let pldm_socket = pldm_transport
@@ -568,6 +729,16 @@ impl Emulator {
             tests::pldm_fw_update_test::PldmFwUpdateTest::run(pldm_socket);
         }
 
+        if cfg!(feature = "test-pldm-fw-update-perf") {
+            start_i3c_controller(&mut i3c_controller);
+            let pldm_transport =
+                MctpTransport::new(cli.i3c_port.unwrap(), i3c.get_dynamic_address().unwrap());
+            let pldm_socket = pldm_transport
+                .create_socket(EndpointId(8), EndpointId(0))
+                .unwrap();
+            tests::pldm_fw_update_perf_test::PldmFwUpdatePerfTest::run(pldm_socket);
+        }
+
         let create_flash_controller =
             |default_path: &str,
              error_irq: u8,
@@ -626,7 +797,7 @@ impl Emulator {
             None
         };
 
-        let primary_flash_controller = create_flash_controller(
+        let mut primary_flash_controller = create_flash_controller(
             "primary_flash",
             McuRootBus::PRIMARY_FLASH_CTRL_ERROR_IRQ,
             McuRootBus::PRIMARY_FLASH_CTRL_EVENT_IRQ,
@@ -651,7 +822,7 @@ impl Emulator {
             None
         };
 
-        let secondary_flash_controller = create_flash_controller(
+        let mut secondary_flash_controller = create_flash_controller(
             "secondary_flash",
             McuRootBus::SECONDARY_FLASH_CTRL_ERROR_IRQ,
             McuRootBus::SECONDARY_FLASH_CTRL_EVENT_IRQ,
@@ -659,6 +830,12 @@ impl Emulator {
             None,
         );
 
+        if let Some(path) = cli.flash_op_log.as_ref() {
+            let flash_op_log = FlashOpLog::create(path)?;
+            primary_flash_controller.set_op_log("primary_flash", flash_op_log.clone());
+            secondary_flash_controller.set_op_log("secondary_flash", flash_op_log);
+        }
+
         let mut dma_ctrl = emulator_periph::DummyDmaCtrl::new(
             &clock.clone(),
             pic.register_irq(McuRootBus::DMA_ERROR_IRQ),
@@ -669,6 +846,50 @@ impl Emulator {
 
         emulator_periph::DummyDmaCtrl::set_dma_ram(&mut dma_ctrl, dma_ram.clone());
 
+        let profiler = match cli.profile {
+            Some(ref profile_dir) => {
+                let mut symbols = SymbolTable::default();
+                for path in cli.profile_elf.iter() {
+                    symbols.add_elf(path)?;
+                }
+                let profiler = Rc::new(RefCell::new(Profiler::new(
+                    profile_dir.clone(),
+                    symbols,
+                    &[
+                        mcu_root_bus_offsets.rom_offset
+                            ..mcu_root_bus_offsets.rom_offset + mcu_root_bus_offsets.rom_size,
+                        mcu_root_bus_offsets.ram_offset
+                            ..mcu_root_bus_offsets.ram_offset + mcu_root_bus_offsets.ram_size,
+                    ],
+                    vec![
+                        (mcu_root_bus_offsets.ram_offset, root_bus.ram.clone()),
+                        (
+                            mcu_root_bus_offsets.rom_dedicated_ram_offset,
+                            root_bus.rom_sram.clone(),
+                        ),
+                    ],
+                    cli.profile_sample_cycles,
+                )));
+                // The firmware exits the emulator without returning from the main loop
+                let exit_profiler = profiler.clone();
+                root_bus
+                    .ctrl
+                    .add_exit_hook(move |_| exit_profiler.borrow_mut().finish());
+                Some(profiler)
+            }
+            None => None,
+        };
+
+        let milestones = root_bus.ctrl.milestones();
+        if let Some(path) = cli.milestones {
+            let export = MilestoneExport {
+                path,
+                log: milestones.clone(),
+            };
+            // Also written when the emulator is dropped without the firmware exiting it
+            root_bus.ctrl.add_exit_hook(move |_| export.write());
+        }
+
         let delegates: Vec<Box<dyn Bus>> = vec![Box::new(root_bus), Box::new(soc_to_caliptra)];
 
         let vendor_pk_hash = cli.vendor_pk_hash.map(|hash| {
@@ -739,10 +960,12 @@ impl Emulator {
         cpu.register_events();
 
         let mut bmc;
+        let bmc_event_tap;
         #[cfg(feature = "test-flash-based-boot")]
         {
             println!("Emulator is using MCU recovery interface");
             bmc = None;
+            bmc_event_tap = None;
             let (caliptra_event_sender, caliptra_event_receiver) = caliptra_cpu.register_events();
             let (mcu_event_sender, mcu_event_receiver) = cpu.register_events();
             cpu.bus
@@ -761,6 +984,18 @@ impl Emulator {
         {
             let (caliptra_event_sender, caliptra_event_receiver) = caliptra_cpu.register_events();
             let (mcu_event_sender, mcu_event_reciever) = cpu.register_events();
+            // record the recovery events sent by the BMC on their way to Caliptra
+            let caliptra_event_sender = match bus_recorder.as_ref() {
+                Some(recorder) => {
+                    let (tap, sender) = BmcEventTap::new(caliptra_event_sender, recorder.clone());
+                    bmc_event_tap = Some(tap);
+                    sender
+                }
+                None => {
+                    bmc_event_tap = None;
+                    caliptra_event_sender
+                }
+            };
             // prepare the BMC recovery interface emulator
             bmc = Some(Bmc::new(
                 caliptra_event_sender,
@@ -770,13 +1005,20 @@ impl Emulator {
             ));
 
             // load the firmware images and SoC manifest into the recovery interface emulator
-            let caliptra_firmware = read_binary(&cli.caliptra_firmware, RAM_ORG).unwrap();
-            let soc_manifest = read_binary(&cli.soc_manifest, 0).unwrap();
+            let caliptra_firmware = read_recovery_image(&cli.caliptra_firmware, RAM_ORG).unwrap();
+            let soc_manifest = read_recovery_image(&cli.soc_manifest, 0).unwrap();
             let bmc = bmc.as_mut().unwrap();
             bmc.push_recovery_image(caliptra_firmware);
             bmc.push_recovery_image(soc_manifest);
             bmc.push_recovery_image(mcu_firmware);
             println!("Active mode enabled with 3 recovery images");
+            if bus_replay.is_some() {
+                bmc.disable_recovery();
+            }
+        }
+
+        if let Some(bus_replay) = bus_replay.as_ref() {
+            bus_replay.check_connected(bmc.is_some())?;
         }
 
         if cli.streaming_boot.is_some() {
@@ -800,12 +1042,26 @@ impl Emulator {
             }
 
             // Start the PLDM Daemon
-            i3c_controller.start();
+            start_i3c_controller(&mut i3c_controller);
             let pldm_transport = MctpTransport::new(cli.i3c_port.unwrap(), i3c_dynamic_address);
             let pldm_socket = pldm_transport
                 .create_socket(EndpointId(LOCAL_TEST_ENDPOINT_EID), EndpointId(1))
                 .unwrap();
-            if cfg!(feature = "test-pldm-streaming-boot") {
+            if cfg!(feature = "test-firmware-update-resume") {
+                // Interrupt the download once and expect the device to resume it
+                let _ = PldmDaemon::run(
+                    pldm_socket,
+                    pldm_ua::daemon::Options {
+                        pldm_fw_pkg: Some(pldm_fw_pkg.unwrap()),
+                        discovery_sm_actions: pldm_ua::discovery_sm::DefaultActions {},
+                        update_sm_actions:
+                            tests::pldm_fw_update_resume_test::ResumeTestActions::default(),
+                        fd_tid: 0x01,
+                    },
+                );
+            } else if cfg!(feature = "test-pldm-streaming-boot")
+                || cfg!(feature = "test-pldm-streaming-boot-perf")
+            {
                 // If we are running the PLDM daemon from an integration test,
                 // we need to set the update state machine to exit on error
                 let _ = PldmDaemon::run(
@@ -840,7 +1096,7 @@ impl Emulator {
             ..mcu_root_bus_offsets.ram_offset + mcu_root_bus_offsets.ram_size;
 
         // Create the emulator instance
-        Ok(Self::new(
+        let mut emulator = Self::new(
             cpu,
             caliptra_cpu,
             instr_trace,
@@ -852,7 +1108,13 @@ impl Emulator {
             uart_output,
             i3c_controller,
             doe_mbox_fsm,
-        ))
+        );
+        emulator.bmc_event_tap = bmc_event_tap;
+        emulator.bus_replay = bus_replay;
+        emulator.bus_recorder = bus_recorder;
+        emulator.profiler = profiler;
+        emulator.milestones = milestones;
+        Ok(emulator)
     }
 
     #[allow(clippy::too_many_arguments)]
@@ -889,6 +1151,11 @@ impl Emulator {
             uart_output,
             i3c_controller,
             doe_mbox_fsm,
+            bmc_event_tap: None,
+            bus_replay: None,
+            bus_recorder: None,
+            profiler: None,
+            milestones: MilestoneLog::default(),
         }
     }
 
@@ -902,6 +1169,20 @@ impl Emulator {
         if now % 1000 == 0 {
             TICK_COND.notify_all();
         }
+        let boundary = virtual_time::on_tick(now);
+        if let Some(bus_replay) = self.bus_replay.as_mut() {
+            bus_replay.step(now, self.bmc.as_mut());
+        }
+        if boundary {
+            // In lockstep the I3C controller is not run by its own thread: it forwards the
+            // commands of the clients, which just ran, and the responses of the targets here.
+            let responses = self.i3c_controller.run_pending();
+            if let Some(recorder) = self.bus_recorder.as_ref() {
+                for response in responses.iter() {
+                    recorder.record(&Transaction::from_i3c_response(response));
+                }
+            }
+        }
 
         if let Some(ref stdin_uart) = self.stdin_uart {
             if stdin_uart.lock().unwrap().is_some() {
@@ -909,6 +1190,7 @@ impl Emulator {
             }
         }
 
+        let pc = self.mcu_cpu.read_pc();
         let action = if let Some(ref mut trace_file) = self.trace_file {
             let trace_fn: &mut dyn FnMut(u32, RvInstr) = &mut |pc, instr| match instr {
                 RvInstr::Instr32(instr32) => {
@@ -925,6 +1207,10 @@ impl Emulator {
             self.mcu_cpu.step(None)
         };
 
+        if let Some(profiler) = self.profiler.as_ref() {
+            profiler.borrow_mut().step(&self.mcu_cpu, pc, now);
+        }
+
         if action != StepAction::Continue {
             return action;
         }
@@ -959,10 +1245,22 @@ impl Emulator {
             bmc.step();
         }
 
+        if let Some(bmc_event_tap) = self.bmc_event_tap.as_ref() {
+            bmc_event_tap.step();
+        }
+
         action
     }
 }
 
+/// Starts the thread of the I3C controller, except in lockstep where the emulator runs the
+/// controller at quantum boundaries (see `Emulator::step`).
+fn start_i3c_controller(i3c_controller: &mut I3cController) {
+    if !virtual_time::is_lockstep() {
+        i3c_controller.start();
+    }
+}
+
 fn disassemble(pc: u32, instr: u32) -> String {
     let mut out = vec![];
     // TODO: we should replace this with something more efficient.
@@ -1013,6 +1311,20 @@ fn read_console(stdin_uart: Option<Arc<Mutex<Option<u8>>>>) {
     }
 }
 
+/// Prepares an image to be served by the BMC recovery interface.
+///
+/// Raw binaries are left on disk and only read when they are requested, ELF executables
+/// are converted and kept in memory.
+fn read_recovery_image(path: &PathBuf, expect_load_addr: u32) -> io::Result<RecoveryImage> {
+    let mut magic = [0u8; 4];
+    let len = File::open(path)?.read(&mut magic)?;
+    if len == magic.len() && magic == [0x7f, 0x45, 0x4c, 0x46] {
+        Ok(read_binary(path, expect_load_addr)?.into())
+    } else {
+        Ok(path.clone().into())
+    }
+}
+
 fn read_binary(path: &PathBuf, expect_load_addr: u32) -> io::Result<Vec<u8>> {
     let mut file = File::open(path)?;
     let mut buffer = Vec::new();
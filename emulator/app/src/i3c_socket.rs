@@ -31,9 +31,13 @@ Abstract:
 
     If the ibi field is non-zero, then it should be interpreted as the MDB for the IBI.
 
+    In lockstep mode, the socket is polled once per emulator tick quantum, so that commands
+    are handed to the I3C controller on tick quantum boundaries.
+
 --*/
 
-use crate::{wait_for_runtime_start, EMULATOR_RUNNING};
+use crate::virtual_time::{self, TICK_QUANTUM};
+use crate::{sleep_emulator_ticks, wait_for_runtime_start, EMULATOR_RUNNING};
 use emulator_periph::{
     DynamicI3cAddress, I3cBusCommand, I3cBusResponse, I3cTcriCommand, I3cTcriCommandXfer,
     ReguDataTransferCommand, ResponseDescriptor,
@@ -56,7 +60,11 @@ pub(crate) fn start_i3c_socket(port: u16) -> (Receiver<I3cBusCommand>, Sender<I3
 
     let (bus_command_tx, bus_command_rx) = mpsc::channel::<I3cBusCommand>();
     let (bus_response_tx, bus_response_rx) = mpsc::channel::<I3cBusResponse>();
-    std::thread::spawn(move || handle_i3c_socket_loop(listener, bus_response_rx, bus_command_tx));
+    let client = virtual_time::reserve();
+    std::thread::spawn(move || {
+        let _client = client.attach();
+        handle_i3c_socket_loop(listener, bus_response_rx, bus_command_tx)
+    });
 
     (bus_command_rx, bus_response_tx)
 }
@@ -80,7 +88,11 @@ fn handle_i3c_socket_loop(
                 );
             }
             Err(ref e) if e.kind() == ErrorKind::WouldBlock => {
-                std::thread::sleep(std::time::Duration::from_millis(10));
+                if virtual_time::is_lockstep() {
+                    sleep_emulator_ticks(TICK_QUANTUM as u32);
+                } else {
+                    std::thread::sleep(std::time::Duration::from_millis(10));
+                }
             }
             Err(e) => panic!("Error accepting connection: {}", e),
         }
@@ -138,7 +150,12 @@ fn handle_i3c_socket_connection(
             }
             Err(e) => panic!("Error reading message from socket: {}", e),
         }
-        if let Ok(response) = bus_response_rx.recv_timeout(Duration::from_millis(10)) {
+        let response = if virtual_time::is_lockstep() {
+            virtual_time::recv_within_ticks(bus_response_rx, TICK_QUANTUM)
+        } else {
+            bus_response_rx.recv_timeout(Duration::from_millis(10))
+        };
+        if let Ok(response) = response {
             let data_len = response.resp.resp.data_length() as usize;
             if data_len > 255 {
                 panic!("Cannot write more than 255 bytes to socket");
@@ -180,7 +197,9 @@ pub(crate) fn run_tests(
         );
         exit(-1);
     });
+    let client = virtual_time::reserve();
     std::thread::spawn(move || {
+        let _client = client.attach();
         wait_for_runtime_start();
         if !EMULATOR_RUNNING.load(Ordering::Relaxed) {
             exit(-1);
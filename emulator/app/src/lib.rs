@@ -12,6 +12,7 @@ Abstract:
 
 --*/
 
+pub mod bus_capture;
 pub mod dis;
 pub mod dis_test;
 pub mod doe_mbox_fsm;
@@ -20,7 +21,9 @@ pub mod emulator;
 pub mod gdb;
 pub mod i3c_socket;
 pub mod mctp_transport;
+pub mod profiler;
 pub mod tests;
+pub mod virtual_time;
 
 pub use emulator::{Emulator, EmulatorArgs};
 
@@ -37,7 +40,7 @@ pub static TICK_COND: Condvar = Condvar::new();
 
 pub fn wait_for_runtime_start() {
     while EMULATOR_RUNNING.load(Ordering::Relaxed) && !MCU_RUNTIME_STARTED.load(Ordering::Relaxed) {
-        std::thread::sleep(Duration::from_millis(10));
+        sleep_emulator_ticks(TICK_NOTIFY_TICKS as u32);
     }
 }
 
@@ -45,7 +48,13 @@ pub fn wait_for_runtime_start() {
 /// This is deterministic and exact if ticks is a multiple of 1,000, unless
 /// the emulator is very slow (<1,000 ticks per second), in which case it
 /// the exact number of ticks slept may vary by up to 1,000.
+///
+/// Threads attached with [`virtual_time::Reservation::attach`] in lockstep mode always wake
+/// up on the same tick, however slow the emulator is.
 pub fn sleep_emulator_ticks(ticks: u32) {
+    if virtual_time::sleep_ticks(ticks as u64) {
+        return;
+    }
     let wait = ticks as u64;
     let start = EMULATOR_TICKS.load(Ordering::Relaxed);
     while EMULATOR_RUNNING.load(Ordering::Relaxed) {
@@ -0,0 +1,527 @@
+/*++
+
+Licensed under the Apache-2.0 license.
+
+File Name:
+
+    profiler.rs
+
+Abstract:
+
+    Cycle profiler of the MCU CPU.
+
+    The cycles of every instruction executed are counted by PC, and attributed to
+    functions with the symbols of the firmware ELF files (ROM, kernel and apps).
+
+    Call stacks are sampled at a fixed cycle interval by following the frame pointer
+    (s0) chain through SRAM and DCCM. This needs firmware built with frame pointers
+    (`-C force-frame-pointers=yes`), otherwise the callers of the sampled functions
+    are missing or wrong.
+
+    The reports are written to the output directory when the emulator exits:
+    - pc_cycles.txt: cycles spent at each PC, most expensive first
+    - functions.txt: cycles spent in each function, most expensive first
+    - <image>.folded: call stacks sampled in each ELF file (named after the file), in
+      the folded format read by flamegraph.pl and inferno-flamegraph
+
+--*/
+
+use caliptra_emu_bus::{Bus, Ram};
+use caliptra_emu_cpu::xreg_file::XReg;
+use caliptra_emu_cpu::Cpu;
+use elf::abi::{PF_X, PT_LOAD, STT_FUNC};
+use elf::endian::AnyEndian;
+use elf::ElfBytes;
+use std::cell::RefCell;
+use std::collections::{BTreeMap, HashMap};
+use std::fs::{self, File};
+use std::io::{self, BufWriter, Error, ErrorKind, Write};
+use std::ops::Range;
+use std::path::{Path, PathBuf};
+use std::rc::Rc;
+
+/// Maximum number of frames in a call stack sample
+const MAX_STACK_DEPTH: usize = 64;
+
+/// Name of the image of the PCs not found in any ELF file
+const UNKNOWN_IMAGE: &str = "unknown";
+
+struct Symbol {
+    addr: Range<u32>,
+    name: String,
+    image: usize,
+}
+
+/// ELF file loaded for profiling
+struct Image {
+    name: String,
+    /// Executable segments
+    code: Vec<Range<u32>>,
+}
+
+/// Function symbols of the profiled firmware.
+#[derive(Default)]
+pub struct SymbolTable {
+    images: Vec<Image>,
+    /// Sorted by address
+    symbols: Vec<Symbol>,
+}
+
+impl SymbolTable {
+    /// Adds the function symbols of an ELF file, as an image named after the file.
+    pub fn add_elf(&mut self, path: &Path) -> io::Result<()> {
+        let name = path
+            .file_stem()
+            .map_or(UNKNOWN_IMAGE.into(), |stem| stem.to_string_lossy().into());
+        self.add_elf_bytes(name, &fs::read(path)?)
+    }
+
+    fn add_elf_bytes(&mut self, name: String, elf_bytes: &[u8]) -> io::Result<()> {
+        let invalid = |e| {
+            Error::new(
+                ErrorKind::InvalidData,
+                format!("Failed to parse ELF file {}: {:?}", name, e),
+            )
+        };
+        let elf_file = ElfBytes::<AnyEndian>::minimal_parse(elf_bytes).map_err(invalid)?;
+        let image = self.images.len();
+
+        let code = elf_file
+            .segments()
+            .iter()
+            .flat_map(|segments| segments.iter())
+            .filter(|s| s.p_type == PT_LOAD && s.p_flags & PF_X != 0)
+            .map(|s| s.p_vaddr as u32..(s.p_vaddr + s.p_memsz) as u32)
+            .collect();
+
+        if let Some((symtab, strtab)) = elf_file.symbol_table().map_err(invalid)? {
+            for symbol in symtab.iter() {
+                if symbol.st_symtype() != STT_FUNC || symbol.st_value == 0 {
+                    continue;
+                }
+                let start = symbol.st_value as u32;
+                self.symbols.push(Symbol {
+                    addr: start..start + symbol.st_size as u32,
+                    name: demangle(strtab.get(symbol.st_name as usize).map_err(invalid)?),
+                    image,
+                });
+            }
+        }
+        self.images.push(Image { name, code });
+        self.sort();
+        Ok(())
+    }
+
+    fn sort(&mut self) {
+        self.symbols.sort_by_key(|symbol| symbol.addr.start);
+        // Symbols without a size (from assembly) extend to the next one
+        for i in 1..self.symbols.len() {
+            if self.symbols[i - 1].addr.is_empty() {
+                self.symbols[i - 1].addr.end = self.symbols[i].addr.start;
+            }
+        }
+    }
+
+    fn symbol(&self, pc: u32) -> Option<&Symbol> {
+        let end = self
+            .symbols
+            .partition_point(|symbol| symbol.addr.start <= pc);
+        self.symbols[..end]
+            .last()
+            .filter(|symbol| symbol.addr.contains(&pc))
+    }
+
+    /// Name of the image holding `pc`.
+    fn image(&self, pc: u32) -> &str {
+        match self.symbol(pc) {
+            Some(symbol) => &self.images[symbol.image].name,
+            None => self
+                .images
+                .iter()
+                .find(|image| image.code.iter().any(|code| code.contains(&pc)))
+                .map_or(UNKNOWN_IMAGE, |image| &image.name),
+        }
+    }
+
+    /// Name of the function holding `pc`, or the address itself.
+    fn function(&self, pc: u32) -> String {
+        self.symbol(pc)
+            .map_or_else(|| format!("{:#010x}", pc), |symbol| symbol.name.clone())
+    }
+}
+
+/// Demangles a legacy Rust symbol name (`_ZN...E`), without its hash.
+/// Other names are returned as is.
+fn demangle(name: &str) -> String {
+    let Some(mut rest) = name.strip_prefix("_ZN") else {
+        return name.into();
+    };
+    let mut parts = vec![];
+    while let Some(len_end) = rest.find(|c: char| !c.is_ascii_digit()).filter(|&i| i > 0) {
+        let Some(part) = rest[..len_end]
+            .parse::<usize>()
+            .ok()
+            .and_then(|len| rest.get(len_end..len_end + len))
+        else {
+            return name.into();
+        };
+        parts.push(part);
+        rest = &rest[len_end + part.len()..];
+    }
+    if rest != "E" || parts.is_empty() {
+        return name.into();
+    }
+    if parts.len() > 1
+        && parts.last().is_some_and(|hash| {
+            hash.len() == 17
+                && hash.starts_with('h')
+                && hash[1..].chars().all(|c| c.is_ascii_hexdigit())
+        })
+    {
+        parts.pop();
+    }
+
+    const ESCAPES: [(&str, &str); 15] = [
+        ("$SP$", "@"),
+        ("$BP$", "*"),
+        ("$RF$", "&"),
+        ("$LT$", "<"),
+        ("$GT$", ">"),
+        ("$LP$", "("),
+        ("$RP$", ")"),
+        ("$C$", ","),
+        ("$u20$", " "),
+        ("$u27$", "'"),
+        ("$u5b$", "["),
+        ("$u5d$", "]"),
+        ("$u7b$", "{"),
+        ("$u7d$", "}"),
+        ("$u7e$", "~"),
+    ];
+    let mut demangled = parts
+        .iter()
+        // A leading `_` is added to parts starting with an escape
+        .map(|part| {
+            part.strip_prefix('_')
+                .filter(|part| part.starts_with('$'))
+                .unwrap_or(part)
+        })
+        .collect::<Vec<_>>()
+        .join("::");
+    for (escape, c) in ESCAPES {
+        demangled = demangled.replace(escape, c);
+    }
+    demangled.replace("..", "::")
+}
+
+/// Call stack of the code at `pc`, outermost frame first, following the frame
+/// pointer chain from `fp`. The frame of each function is below its frame
+/// pointer, which is preceded by the return address and the frame pointer of the
+/// caller.
+fn walk_stack(pc: u32, mut fp: u32, read_word: impl Fn(u32) -> Option<u32>) -> Vec<u32> {
+    let mut stack = vec![pc];
+    while stack.len() < MAX_STACK_DEPTH {
+        let (Some(ra), Some(caller_fp)) =
+            (read_word(fp.wrapping_sub(4)), read_word(fp.wrapping_sub(8)))
+        else {
+            break;
+        };
+        if ra == 0 {
+            break;
+        }
+        // Attribute the frame to the call instruction, before the return address
+        stack.push(ra.wrapping_sub(2));
+        // Stacks grow down, the frame of the caller is above
+        if caller_fp <= fp {
+            break;
+        }
+        fp = caller_fp;
+    }
+    stack.reverse();
+    stack
+}
+
+/// Cycles spent at each PC of an address range
+struct PcHistogram {
+    base: u32,
+    /// Indexed by half-word, the smallest instruction size
+    cycles: Vec<u64>,
+}
+
+/// Counts the cycles of the MCU CPU by PC and samples its call stacks.
+pub struct Profiler {
+    output_dir: PathBuf,
+    symbols: SymbolTable,
+    histograms: Vec<PcHistogram>,
+    /// Cycles spent at PCs outside of `histograms`
+    other_pcs: HashMap<u32, u64>,
+    /// Memories holding the stacks, with their base address
+    stack_memories: Vec<(u32, Rc<RefCell<Ram>>)>,
+    sample_cycles: u64,
+    next_sample: u64,
+    /// Number of samples of each call stack
+    stacks: HashMap<Vec<u32>, u64>,
+    reports_written: bool,
+}
+
+impl Profiler {
+    /// Creates a profiler writing its reports to `output_dir`.
+    ///
+    /// # Arguments
+    ///
+    /// * `code_ranges` - Address ranges where most code runs, counted without hashing
+    /// * `stack_memories` - Memories the call stacks are read from, with their base address
+    /// * `sample_cycles` - Cycles between two call stack samples, 0 to disable sampling
+    pub fn new(
+        output_dir: PathBuf,
+        symbols: SymbolTable,
+        code_ranges: &[Range<u32>],
+        stack_memories: Vec<(u32, Rc<RefCell<Ram>>)>,
+        sample_cycles: u64,
+    ) -> Self {
+        Self {
+            output_dir,
+            symbols,
+            histograms: code_ranges
+                .iter()
+                .map(|range| PcHistogram {
+                    base: range.start,
+                    cycles: vec![0; range.len().div_ceil(2)],
+                })
+                .collect(),
+            other_pcs: HashMap::new(),
+            stack_memories,
+            sample_cycles,
+            next_sample: sample_cycles,
+            stacks: HashMap::new(),
+            reports_written: false,
+        }
+    }
+
+    /// Accounts for the instruction at `pc`, executed by `cpu` from cycle `start`,
+    /// and samples the call stack when it is due.
+    pub fn step<TBus: Bus>(&mut self, cpu: &Cpu<TBus>, pc: u32, start: u64) {
+        let now = cpu.clock.now();
+        self.count(pc, now.saturating_sub(start));
+
+        if self.sample_cycles != 0 && now >= self.next_sample {
+            self.next_sample = now + self.sample_cycles;
+            let fp = cpu.read_xreg(XReg::X8).unwrap_or_default();
+            let stack = walk_stack(cpu.read_pc(), fp, |addr| self.read_stack_word(addr));
+            *self.stacks.entry(stack).or_default() += 1;
+        }
+    }
+
+    fn count(&mut self, pc: u32, cycles: u64) {
+        for histogram in self.histograms.iter_mut() {
+            let offset = pc.wrapping_sub(histogram.base) as usize;
+            if let Some(count) = histogram.cycles.get_mut(offset / 2) {
+                *count += cycles;
+                return;
+            }
+        }
+        *self.other_pcs.entry(pc).or_default() += cycles;
+    }
+
+    fn read_stack_word(&self, addr: u32) -> Option<u32> {
+        if addr % 4 != 0 {
+            return None;
+        }
+        self.stack_memories.iter().find_map(|(base, ram)| {
+            let offset = addr.checked_sub(*base)? as usize;
+            let ram = ram.borrow();
+            let word = ram.data().get(offset..offset + 4)?;
+            Some(u32::from_le_bytes(word.try_into().unwrap()))
+        })
+    }
+
+    /// Writes the reports once, when the emulator exits.
+    pub fn finish(&mut self) {
+        if self.reports_written {
+            return;
+        }
+        self.reports_written = true;
+        match self.write_reports() {
+            Ok(()) => println!("Profile written to {}", self.output_dir.display()),
+            Err(e) => println!(
+                "Failed to write the profile to {}: {}",
+                self.output_dir.display(),
+                e
+            ),
+        }
+    }
+
+    fn write_reports(&self) -> io::Result<()> {
+        fs::create_dir_all(&self.output_dir)?;
+
+        let mut pcs: Vec<(u32, u64)> = self
+            .histograms
+            .iter()
+            .flat_map(|histogram| {
+                histogram
+                    .cycles
+                    .iter()
+                    .enumerate()
+                    .map(|(i, cycles)| (histogram.base + 2 * i as u32, *cycles))
+            })
+            .chain(self.other_pcs.iter().map(|(pc, cycles)| (*pc, *cycles)))
+            .filter(|(_, cycles)| *cycles != 0)
+            .collect();
+        pcs.sort_by(|a, b| b.1.cmp(&a.1).then(a.0.cmp(&b.0)));
+        let total_cycles: u64 = pcs.iter().map(|(_, cycles)| cycles).sum();
+        let percent = |cycles: u64| 100.0 * cycles as f64 / total_cycles.max(1) as f64;
+
+        let mut out = BufWriter::new(File::create(self.output_dir.join("pc_cycles.txt"))?);
+        writeln!(
+            out,
+            "# cycles, % of {} cycles, pc, image, function",
+            total_cycles
+        )?;
+        let mut functions = HashMap::<(&str, String), u64>::new();
+        for (pc, cycles) in pcs {
+            let (image, function) = (self.symbols.image(pc), self.symbols.function(pc));
+            writeln!(
+                out,
+                "{:>12} {:>6.2}% {:#010x} {} {}",
+                cycles,
+                percent(cycles),
+                pc,
+                image,
+                function
+            )?;
+            *functions.entry((image, function)).or_default() += cycles;
+        }
+        out.flush()?;
+
+        let mut functions: Vec<_> = functions.into_iter().collect();
+        functions.sort_by(|a, b| b.1.cmp(&a.1).then(a.0.cmp(&b.0)));
+        let mut out = BufWriter::new(File::create(self.output_dir.join("functions.txt"))?);
+        writeln!(
+            out,
+            "# cycles, % of {} cycles, image, function",
+            total_cycles
+        )?;
+        for ((image, function), cycles) in functions {
+            writeln!(
+                out,
+                "{:>12} {:>6.2}% {} {}",
+                cycles,
+                percent(cycles),
+                image,
+                function
+            )?;
+        }
+        out.flush()?;
+
+        // Stacks are split by the image of the code that was running
+        let mut folded = BTreeMap::<&str, BTreeMap<String, u64>>::new();
+        for (stack, samples) in self.stacks.iter() {
+            let frames: Vec<String> = stack
+                .iter()
+                .map(|pc| self.symbols.function(*pc).replace(';', ":"))
+                .collect();
+            let image = self.symbols.image(*stack.last().unwrap());
+            *folded
+                .entry(image)
+                .or_default()
+                .entry(frames.join(";"))
+                .or_default() += samples;
+        }
+        for (image, stacks) in folded {
+            let path = self.output_dir.join(format!("{}.folded", image));
+            let mut out = BufWriter::new(File::create(path)?);
+            for (stack, samples) in stacks {
+                writeln!(out, "{} {}", stack, samples)?;
+            }
+            out.flush()?;
+        }
+        Ok(())
+    }
+}
+
+impl Drop for Profiler {
+    fn drop(&mut self) {
+        self.finish();
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn symbol_table() -> SymbolTable {
+        let mut symbols = SymbolTable {
+            images: vec![
+                Image {
+                    name: "mcu-rom".into(),
+                    code: vec![0x8000_0000..0x8000_1000],
+                },
+                Image {
+                    name: "kernel".into(),
+                    code: vec![0x4000_0000..0x4000_1000],
+                },
+            ],
+            symbols: vec![],
+        };
+        for (start, end, name, image) in [
+            (0x4000_0100, 0x4000_0180, "main", 1),
+            (0x8000_0000, 0x8000_0000, "_start", 0),
+            (0x8000_0040, 0x8000_0100, "rom_main", 0),
+        ] {
+            symbols.symbols.push(Symbol {
+                addr: start..end,
+                name: name.into(),
+                image,
+            });
+        }
+        symbols.sort();
+        symbols
+    }
+
+    #[test]
+    fn test_symbol_lookup() {
+        let symbols = symbol_table();
+        assert_eq!(symbols.function(0x8000_0010), "_start");
+        assert_eq!(symbols.function(0x8000_0040), "rom_main");
+        assert_eq!(symbols.image(0x8000_0040), "mcu-rom");
+        assert_eq!(symbols.function(0x4000_017e), "main");
+        assert_eq!(symbols.function(0x4000_0180), "0x40000180");
+        assert_eq!(symbols.image(0x4000_0180), "kernel");
+        assert_eq!(symbols.image(0x2000_0000), UNKNOWN_IMAGE);
+    }
+
+    #[test]
+    fn test_demangle() {
+        assert_eq!(
+            demangle("_ZN4core3fmt5write17h0123456789abcdefE"),
+            "core::fmt::write"
+        );
+        assert_eq!(
+            demangle(
+                "_ZN49_$LT$mcu_rom..Foo$u20$as$u20$core..fmt..Debug$GT$3fmt17h0123456789abcdefE"
+            ),
+            "<mcu_rom::Foo as core::fmt::Debug>::fmt"
+        );
+        assert_eq!(demangle("memcpy"), "memcpy");
+        assert_eq!(demangle("_ZN3foo"), "_ZN3foo");
+    }
+
+    #[test]
+    fn test_walk_stack() {
+        // Frames of main -> process -> pec, pec being sampled at 0x4000_0300
+        let memory: HashMap<u32, u32> = [
+            (0x5000_0ffc, 0), // main: no caller
+            (0x5000_0ff8, 0),
+            (0x5000_0fdc, 0x4000_0106), // process: returns to main
+            (0x5000_0fd8, 0x5000_1000),
+            (0x5000_0fbc, 0x4000_0204), // pec: returns to process
+            (0x5000_0fb8, 0x5000_0fe0),
+        ]
+        .into();
+        let stack = walk_stack(0x4000_0300, 0x5000_0fc0, |addr| memory.get(&addr).copied());
+        assert_eq!(stack, vec![0x4000_0104, 0x4000_0202, 0x4000_0300]);
+
+        // A frame pointer outside of the stack memories ends the walk
+        assert_eq!(walk_stack(0x4000_0300, 0x10, |_| None), vec![0x4000_0300]);
+    }
+}
@@ -1,7 +1,7 @@
 // Licensed under the Apache-2.0 license
 
-use crate::{sleep_emulator_ticks, tests::doe_util::protocol::*};
-use std::sync::mpsc::{Receiver, RecvError, SendError, Sender};
+use crate::{tests::doe_util::protocol::*, virtual_time};
+use std::sync::mpsc::{Receiver, RecvError, RecvTimeoutError, SendError, Sender};
 use zerocopy::IntoBytes;
 
 pub struct DoeUtil;
@@ -82,25 +82,29 @@ impl DoeUtil {
     pub fn receive_raw_data_object(rx: &Receiver<Vec<u8>>) -> Result<Vec<u8>, DoeUtilError> {
         // TODO: this should not need to be so high.
         // Nothing should take >3,500,000 ticks to respond,
-        // but setting it to 35 will fail tests.
-        for _ in 0..50 {
-            match rx.try_recv() {
-                Ok(message) => {
-                    println!(
-                        "DOE_UTIL: Received raw data object with length: {}",
-                        message.len()
-                    );
-                    return Ok(message);
-                }
-                Err(std::sync::mpsc::TryRecvError::Empty) => {
-                    sleep_emulator_ticks(100_000);
-                }
-                Err(std::sync::mpsc::TryRecvError::Disconnected) => {
-                    println!("DOE_UTIL: Receiver has disconnected.");
-                    return Err(DoeUtilError::ReceiveError(RecvError));
-                }
+        // but setting it to 3,500,000 will fail tests.
+        Self::receive_raw_data_object_within(rx, 5_000_000)
+    }
+
+    /// Waits up to `ticks` emulator ticks for a data object, returns an empty one if none
+    /// was received. Returns as soon as the data object is received.
+    pub fn receive_raw_data_object_within(
+        rx: &Receiver<Vec<u8>>,
+        ticks: u64,
+    ) -> Result<Vec<u8>, DoeUtilError> {
+        match virtual_time::recv_within_ticks(rx, ticks) {
+            Ok(message) => {
+                println!(
+                    "DOE_UTIL: Received raw data object with length: {}",
+                    message.len()
+                );
+                Ok(message)
+            }
+            Err(RecvTimeoutError::Timeout) => Ok(Vec::new()),
+            Err(RecvTimeoutError::Disconnected) => {
+                println!("DOE_UTIL: Receiver has disconnected.");
+                Err(DoeUtilError::ReceiveError(RecvError))
             }
         }
-        Ok(Vec::new())
     }
 }
@@ -0,0 +1,250 @@
+// Licensed under the Apache-2.0 license
+
+// Test MCTP bridging by the MCU: the firmware (platforms/emulator/runtime/src/tests/mctp_bridge_test.rs)
+// adds downstream buses with simulated endpoints, and this test reaches them through the MCU.
+
+use crate::i3c_socket::{MctpTestState, MctpTransportTest};
+use crate::tests::mctp_util::base_protocol::{MCTPMsgHdr, MCTP_MSG_HDR_SIZE};
+use crate::tests::mctp_util::common::MctpUtil;
+use crate::tests::mctp_util::ctrl_protocol::*;
+use crate::EMULATOR_RUNNING;
+use std::net::TcpStream;
+use std::sync::atomic::Ordering;
+use zerocopy::{FromBytes, IntoBytes};
+
+const BRIDGE_EID: u8 = 0xA;
+const BROADCAST_EID: u8 = 0xFF;
+// Endpoints behind the bridge: (first EID, number of endpoints).
+// Must match `DOWNSTREAM_BUSES` in the firmware test.
+const DOWNSTREAM_ENDPOINTS: [(u8, u8); 2] = [(0x30, 2), (0x40, 1)];
+// Message type echoed back by the simulated endpoints
+const TEST_MSG_TYPE: u8 = 0x70;
+const TEST_MSG_LEN: usize = 150;
+
+/// Entries of the routing table of the bridge, as reported by Get Routing Table Entries.
+const ROUTING_TABLE_ENTRIES: [u8; 12] = [
+    2, 0x30, 0x61, 0xFF, 0, 0, // EID range on port 1
+    1, 0x40, 0x22, 0xFF, 0, 0, // single endpoint on port 2
+];
+
+fn ctrl_msg(rq: bool, cmd: MCTPCtrlCmd, data: &[u8]) -> Vec<u8> {
+    let mut msg = vec![0; MCTP_MSG_HDR_SIZE + MCTP_CTRL_MSG_HDR_SIZE];
+    MCTPMsgHdr::new()
+        .write_to(&mut msg[..MCTP_MSG_HDR_SIZE])
+        .expect("mctp common msg header write failed");
+    let mut ctrl_hdr = MCTPCtrlMsgHdr::new();
+    ctrl_hdr.set_rq(rq as u8);
+    ctrl_hdr.set_cmd(cmd as u8);
+    ctrl_hdr
+        .write_to(&mut msg[MCTP_MSG_HDR_SIZE..])
+        .expect("mctp ctrl msg header write failed");
+    msg.extend_from_slice(data);
+    msg
+}
+
+fn bridge_get_eid_resp_bytes() -> Vec<u8> {
+    let mut resp_bytes = get_eid_resp_bytes(CmdCompletionCode::Success, BRIDGE_EID);
+    let resp = GetEIDResp::<[u8; 4]>::mut_from_bytes(&mut resp_bytes[..]).unwrap();
+    resp.set_endpoint_type(EndpointType::BusOwnerBridge as u8);
+    resp_bytes
+}
+
+fn test_msg() -> Vec<u8> {
+    let mut msg = vec![TEST_MSG_TYPE];
+    msg.extend((1..TEST_MSG_LEN).map(|i| i as u8));
+    msg
+}
+
+pub fn generate_tests() -> Vec<Box<dyn MctpTransportTest + Send>> {
+    let mut tests = vec![
+        Test::new(
+            "BridgeSetEID",
+            0,
+            ctrl_msg(
+                true,
+                MCTPCtrlCmd::SetEID,
+                &set_eid_req_bytes(SetEIDOp::SetEID, BRIDGE_EID),
+            ),
+            ctrl_msg(
+                false,
+                MCTPCtrlCmd::SetEID,
+                &set_eid_resp_bytes(
+                    CmdCompletionCode::Success,
+                    SetEIDStatus::Accepted,
+                    SetEIDAllocStatus::NoEIDPool,
+                    BRIDGE_EID,
+                ),
+            ),
+        ),
+        Test::new(
+            "BridgeGetEID",
+            BRIDGE_EID,
+            ctrl_msg(true, MCTPCtrlCmd::GetEID, &[]),
+            ctrl_msg(false, MCTPCtrlCmd::GetEID, &bridge_get_eid_resp_bytes()),
+        ),
+        Test::new(
+            "BridgeGetRoutingTableEntries",
+            BRIDGE_EID,
+            ctrl_msg(true, MCTPCtrlCmd::GetRoutingTableEntries, &[0]),
+            ctrl_msg(
+                false,
+                MCTPCtrlCmd::GetRoutingTableEntries,
+                &[
+                    &[CmdCompletionCode::Success as u8, 0xFF, 2][..],
+                    &ROUTING_TABLE_ENTRIES[..],
+                ]
+                .concat(),
+            ),
+        ),
+    ];
+
+    for (first_eid, eid_count) in DOWNSTREAM_ENDPOINTS {
+        for eid in first_eid..first_eid + eid_count {
+            tests.push(Test::new(
+                "DownstreamGetEID",
+                eid,
+                ctrl_msg(true, MCTPCtrlCmd::GetEID, &[]),
+                ctrl_msg(
+                    false,
+                    MCTPCtrlCmd::GetEID,
+                    &get_eid_resp_bytes(CmdCompletionCode::Success, eid),
+                ),
+            ));
+        }
+        // Multi-packet messages are forwarded packet by packet
+        tests.push(Test::new(
+            "DownstreamEcho",
+            first_eid + eid_count - 1,
+            test_msg(),
+            test_msg(),
+        ));
+    }
+
+    tests.extend([
+        Test::new(
+            "BridgePrepareEndpointDiscovery",
+            BROADCAST_EID,
+            ctrl_msg(true, MCTPCtrlCmd::PrepareEndpointDiscovery, &[]),
+            ctrl_msg(
+                false,
+                MCTPCtrlCmd::PrepareEndpointDiscovery,
+                &[CmdCompletionCode::Success as u8],
+            ),
+        ),
+        Test::new(
+            "BridgeEndpointDiscovery",
+            BROADCAST_EID,
+            ctrl_msg(true, MCTPCtrlCmd::EndpointDiscovery, &[]),
+            ctrl_msg(
+                false,
+                MCTPCtrlCmd::EndpointDiscovery,
+                &[CmdCompletionCode::Success as u8],
+            ),
+        ),
+        Test::new(
+            "BridgeSetDiscoveredFlag",
+            BRIDGE_EID,
+            ctrl_msg(
+                true,
+                MCTPCtrlCmd::SetEID,
+                &set_eid_req_bytes(SetEIDOp::SetDiscoveredFlag, 0),
+            ),
+            ctrl_msg(
+                false,
+                MCTPCtrlCmd::SetEID,
+                &set_eid_resp_bytes(
+                    CmdCompletionCode::Success,
+                    SetEIDStatus::Accepted,
+                    SetEIDAllocStatus::NoEIDPool,
+                    BRIDGE_EID,
+                ),
+            ),
+        ),
+    ]);
+
+    tests
+        .into_iter()
+        .enumerate()
+        .map(|(i, mut test)| {
+            test.msg_tag = (i % 4) as u8;
+            Box::new(test) as Box<dyn MctpTransportTest + Send>
+        })
+        .collect()
+}
+
+#[derive(Debug, Clone)]
+struct Test {
+    name: String,
+    test_state: MctpTestState,
+    dest_eid: u8,
+    req_msg: Vec<u8>,
+    resp_msg: Vec<u8>,
+    msg_tag: u8,
+    mctp_util: MctpUtil,
+    passed: bool,
+}
+
+impl Test {
+    fn new(name: &str, dest_eid: u8, req_msg: Vec<u8>, resp_msg: Vec<u8>) -> Self {
+        Self {
+            name: name.to_string(),
+            test_state: MctpTestState::Start,
+            dest_eid,
+            req_msg,
+            resp_msg,
+            msg_tag: 0,
+            mctp_util: MctpUtil::new(),
+            passed: false,
+        }
+    }
+}
+
+impl MctpTransportTest for Test {
+    fn is_passed(&self) -> bool {
+        self.passed
+    }
+
+    fn run_test(&mut self, stream: &mut TcpStream, target_addr: u8) {
+        stream.set_nonblocking(true).unwrap();
+        while EMULATOR_RUNNING.load(Ordering::Relaxed) {
+            match self.test_state {
+                MctpTestState::Start => {
+                    println!("Starting test: {} (EID {:#x})", self.name, self.dest_eid);
+                    self.test_state = MctpTestState::SendReq;
+                }
+                MctpTestState::SendReq => {
+                    self.mctp_util.send_request_to_eid(
+                        self.dest_eid,
+                        self.msg_tag,
+                        self.req_msg.as_slice(),
+                        stream,
+                        target_addr,
+                    );
+                    self.test_state = MctpTestState::ReceiveResp;
+                }
+                MctpTestState::ReceiveResp => {
+                    let resp_msg = self
+                        .mctp_util
+                        .receive_response(stream, target_addr, Some(5));
+                    self.passed = resp_msg == self.resp_msg;
+                    if !self.passed {
+                        println!(
+                            "Test {}: expected {:x?}, received {:x?}",
+                            self.name, self.resp_msg, resp_msg
+                        );
+                    }
+                    self.test_state = MctpTestState::Finish;
+                }
+                MctpTestState::Finish => {
+                    println!(
+                        "Test {} : {}",
+                        self.name,
+                        if self.passed { "PASSED" } else { "FAILED" }
+                    );
+                    break;
+                }
+                _ => {}
+            }
+        }
+    }
+}
@@ -2,14 +2,25 @@
 
 use crate::i3c_socket::{receive_ibi, receive_private_read, send_private_write};
 use crate::tests::mctp_util::base_protocol::{MCTPHdr, LOCAL_TEST_ENDPOINT_EID, MCTP_HDR_SIZE};
-use crate::EMULATOR_RUNNING;
+use crate::{virtual_time, EMULATOR_RUNNING};
 use std::collections::VecDeque;
 use std::net::TcpStream;
 use std::sync::atomic::Ordering;
+use std::time::Duration;
 use zerocopy::{FromBytes, IntoBytes};
 
 // Default message tag generated by the initiator
 const DEFAULT_MSG_TAG: u8 = 0x08;
+// Longest wait for an IBI before counting a retry
+const IBI_POLL_INTERVAL: Duration = Duration::from_millis(200);
+// Wait for the responder to be ready before the first request
+const RESPONDER_START_DELAY: Duration = Duration::from_secs(10);
+// Wait for the response to a request before checking for its IBI
+const RESPONSE_DELAY: Duration = Duration::from_millis(500);
+// The same waits in emulator ticks, for lockstep clients (see `virtual_time`)
+const IBI_POLL_TICKS: u64 = 1_000_000;
+const RESPONDER_START_TICKS: u64 = 15_000_000;
+const RESPONSE_TICKS: u64 = 5_000_000;
 
 #[derive(Debug, Clone)]
 pub struct MctpUtil {
@@ -140,7 +151,7 @@ impl MctpUtil {
                 I3cControllerState::Start => {
                     // Add some delay before sending the first packet.
                     // The MCU might need some time to boot up and be ready to receive the request.
-                    std::thread::sleep(std::time::Duration::from_secs(10));
+                    virtual_time::sleep(RESPONDER_START_DELAY, RESPONDER_START_TICKS);
                     i3c_state = I3cControllerState::SendPrivateWrite;
                 }
 
@@ -148,7 +159,7 @@ impl MctpUtil {
                     let write_pkt = pkts.front().unwrap().clone();
                     if send_private_write(stream, target_addr, write_pkt) {
                         i3c_state = I3cControllerState::WaitForIbi;
-                        std::thread::sleep(std::time::Duration::from_millis(500));
+                        virtual_time::sleep(RESPONSE_DELAY, RESPONSE_TICKS);
                     }
                 }
                 I3cControllerState::WaitForIbi => {
@@ -177,6 +188,8 @@ impl MctpUtil {
                         }
 
                         i3c_state = I3cControllerState::Finish;
+                    } else {
+                        wait_readable(stream, IBI_POLL_INTERVAL, IBI_POLL_TICKS);
                     }
                 }
                 I3cControllerState::Finish => {
@@ -208,6 +221,30 @@ impl MctpUtil {
         self.send_packets(pkts, stream, target_addr);
     }
 
+    /// Send a request to the endpoint `dest_eid` through the target address
+    /// This function will block until the request message is sent
+    ///
+    /// # Arguments
+    /// * `dest_eid` - The EID of the endpoint the request is for
+    /// * `msg_tag` - The message tag to be used for the request
+    /// * `msg` - The message to be sent
+    /// * `stream` - The TCP stream to I3C socket
+    /// * `target_addr` - The target address of the I3C device
+    #[allow(dead_code)]
+    pub fn send_request_to_eid(
+        &mut self,
+        dest_eid: u8,
+        msg_tag: u8,
+        msg: &[u8],
+        stream: &mut TcpStream,
+        target_addr: u8,
+    ) {
+        self.new_req(msg_tag);
+        self.dest_eid = dest_eid;
+        let pkts = self.packetize(msg);
+        self.send_packets(pkts, stream, target_addr);
+    }
+
     /// Send a response to the target address
     /// This function will block until the response message is sent
     ///
@@ -314,13 +351,17 @@ impl MctpUtil {
                 I3cControllerState::WaitForIbi => {
                     if receive_ibi(stream, target_addr) {
                         i3c_state = I3cControllerState::ReceivePrivateRead;
-                    } else if retry > 0 {
-                        std::thread::sleep(std::time::Duration::from_millis(200));
-                        retry -= 1;
-                        if retry == 0 {
-                            println!("MCTP_UTIL: IBI not received. Exiting...");
-                            pkts.clear();
-                            break;
+                    } else {
+                        // Count every pass without an IBI, including those woken by other
+                        // data on the socket, so that the loop cannot spin forever
+                        wait_readable(stream, IBI_POLL_INTERVAL, IBI_POLL_TICKS);
+                        if retry > 0 {
+                            retry -= 1;
+                            if retry == 0 {
+                                println!("MCTP_UTIL: IBI not received. Exiting...");
+                                pkts.clear();
+                                break;
+                            }
                         }
                     }
                 }
@@ -331,6 +372,8 @@ impl MctpUtil {
                         } else {
                             i3c_state = I3cControllerState::WaitForIbi;
                         }
+                    } else {
+                        wait_readable(stream, IBI_POLL_INTERVAL, IBI_POLL_TICKS);
                     }
                 }
                 _ => {
@@ -508,3 +551,22 @@ mod tests {
         true
     }
 }
+
+/// Blocks until data can be read from `stream` or `timeout` elapses, so that an IBI is
+/// handled as soon as it arrives. Lockstep clients wait up to `ticks` emulator ticks instead.
+/// Returns whether data can be read.
+fn wait_readable(stream: &mut TcpStream, timeout: Duration, ticks: u64) -> bool {
+    if virtual_time::is_attached() {
+        stream.set_nonblocking(true).unwrap();
+        return virtual_time::poll_within_ticks(
+            ticks,
+            || matches!(stream.peek(&mut [0u8; 1]), Ok(n) if n > 0),
+        );
+    }
+    stream.set_nonblocking(false).unwrap();
+    stream.set_read_timeout(Some(timeout)).unwrap();
+    let readable = matches!(stream.peek(&mut [0u8; 1]), Ok(n) if n > 0);
+    stream.set_read_timeout(None).unwrap();
+    stream.set_nonblocking(true).unwrap();
+    readable
+}
@@ -66,6 +66,9 @@ pub enum MCTPCtrlCmd {
     SetEID = 1,
     GetEID = 2,
     GetMsgTypeSupport = 5,
+    GetRoutingTableEntries = 0x0A,
+    PrepareEndpointDiscovery = 0x0B,
+    EndpointDiscovery = 0x0C,
     Unsupported,
 }
 
@@ -75,6 +78,9 @@ impl From<u8> for MCTPCtrlCmd {
             1 => MCTPCtrlCmd::SetEID,
             2 => MCTPCtrlCmd::GetEID,
             5 => MCTPCtrlCmd::GetMsgTypeSupport,
+            0x0A => MCTPCtrlCmd::GetRoutingTableEntries,
+            0x0B => MCTPCtrlCmd::PrepareEndpointDiscovery,
+            0x0C => MCTPCtrlCmd::EndpointDiscovery,
             _ => MCTPCtrlCmd::Unsupported,
         }
     }
@@ -119,7 +125,7 @@ pub enum SetEIDOp {
     SetEID = 0,
     ForceEID = 1,
     // ResetEID = 2,
-    // SetDiscoveredFlag = 3,
+    SetDiscoveredFlag = 3,
 }
 
 // Set EID Response
@@ -170,7 +176,7 @@ bitfield! {
     pub completion_code, set_completion_code: 7, 0;
     pub eid, set_eid: 15, 8;
     rsvd1, _: 17, 16;
-    pub endpoint_type, _: 19, 18;
+    pub endpoint_type, set_endpoint_type: 19, 18;
     rsvd2, _: 21, 20;
     pub eid_type, set_eid_type: 23, 22;
     pub medium_spec_info, _: 31, 24;
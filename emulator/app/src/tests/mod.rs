@@ -6,9 +6,12 @@ pub mod doe_discovery;
 pub mod doe_transport_loopback;
 pub mod doe_user_loopback;
 pub mod doe_util;
+pub mod mctp_bridge;
 pub mod mctp_ctrl_cmd;
 pub mod mctp_loopback;
 pub mod mctp_user_loopback;
+pub mod pldm_fw_update_perf_test;
+pub mod pldm_fw_update_resume_test;
 pub mod pldm_fw_update_test;
 pub mod pldm_request_response_test;
 pub mod spdm_responder_validator;
@@ -0,0 +1,406 @@
+//! Licensed under the Apache-2.0 license
+
+//! Firmware update throughput and latency harness.
+//!
+//! Runs a full PLDM firmware update against the device and records how long each phase of the
+//! update takes, as seen by the Update Agent. The update is parameterized through environment
+//! variables so that the same emulator binary can be run over a matrix of configurations:
+//!
+//! * `PLDM_PERF_PACKAGE_SIZE`: total size in bytes of the component images (default 4096)
+//! * `PLDM_PERF_COMPONENTS`: number of components in the package, 1 to 4 (default 1)
+//! * `PLDM_PERF_TRANSFER_SIZE`: maximum transfer size offered by the UA (default 180)
+//! * `PLDM_PERF_LINK_LATENCY_US`: latency added to every message sent by the UA (default 0)
+//! * `PLDM_PERF_RESULTS`: file the JSON result line is appended to (default stdout)
+
+use crate::mctp_transport::MctpPldmSocket;
+use crate::{wait_for_runtime_start, EMULATOR_RUNNING};
+use chrono::{TimeZone, Utc};
+use log::{error, LevelFilter};
+use pldm_common::message::control as pldm_control;
+use pldm_common::message::firmware_update as pldm_packet;
+use pldm_common::protocol::firmware_update::ComponentClassification;
+use pldm_fw_pkg::{
+    manifest::{
+        ComponentImageInformation, Descriptor, DescriptorType, FirmwareDeviceIdRecord,
+        PackageHeaderInformation, StringType,
+    },
+    FirmwareManifest,
+};
+use pldm_ua::daemon::{Options, PldmDaemon};
+use pldm_ua::transport::{PldmSocket, PldmTransportError, RxPacket};
+use pldm_ua::{discovery_sm, update_sm};
+use simple_logger::SimpleLogger;
+use std::fs::OpenOptions;
+use std::io::Write;
+use std::process::exit;
+use std::sync::atomic::Ordering;
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+use uuid::Uuid;
+
+use super::pldm_fw_update_test::DEVICE_UUID;
+
+// Number of components advertised by the device built with test-pldm-fw-update-perf in
+// platforms/emulator/runtime/userspace/apps/user/src/image_loader/pldm_fdops_mock.rs
+const MAX_COMPONENTS: usize = 4;
+const UPDATE_TIMEOUT: Duration = Duration::from_secs(600);
+
+#[derive(Debug, Clone, Copy)]
+enum Phase {
+    Discovery,
+    RequestUpdate,
+    Download,
+    Verify,
+    Apply,
+    Activate,
+}
+
+const PHASES: [(Phase, &str); 6] = [
+    (Phase::Discovery, "discovery"),
+    (Phase::RequestUpdate, "request_update"),
+    (Phase::Download, "download"),
+    (Phase::Verify, "verify"),
+    (Phase::Apply, "apply"),
+    (Phase::Activate, "activate"),
+];
+
+/// Accumulated time spent in each phase. Phases that run once per component
+/// (download, verify and apply) are summed over all components.
+#[derive(Default)]
+struct PhaseTimings {
+    started: [Option<Instant>; PHASES.len()],
+    elapsed: [Duration; PHASES.len()],
+}
+
+impl PhaseTimings {
+    fn begin(&mut self, phase: Phase) {
+        self.started[phase as usize] = Some(Instant::now());
+    }
+
+    fn end(&mut self, phase: Phase) {
+        if let Some(started) = self.started[phase as usize].take() {
+            self.elapsed[phase as usize] += started.elapsed();
+        }
+    }
+}
+
+type SharedTimings = Arc<Mutex<PhaseTimings>>;
+
+#[derive(Debug, Clone)]
+struct PerfParams {
+    package_size: usize,
+    components: usize,
+    transfer_size: u32,
+    link_latency: Duration,
+}
+
+impl PerfParams {
+    fn from_env() -> Self {
+        fn var(name: &str, default: u64) -> u64 {
+            std::env::var(name)
+                .ok()
+                .and_then(|value| value.parse().ok())
+                .unwrap_or(default)
+        }
+        Self {
+            package_size: var("PLDM_PERF_PACKAGE_SIZE", 4096) as usize,
+            components: (var("PLDM_PERF_COMPONENTS", 1) as usize).clamp(1, MAX_COMPONENTS),
+            transfer_size: var("PLDM_PERF_TRANSFER_SIZE", 180) as u32,
+            link_latency: Duration::from_micros(var("PLDM_PERF_LINK_LATENCY_US", 0)),
+        }
+    }
+
+    /// Builds a package with `components` images sharing `package_size` bytes.
+    fn firmware_package(&self) -> FirmwareManifest {
+        let component_image_information = (0..self.components)
+            .map(|i| {
+                let size = self.package_size / self.components
+                    + if i == 0 {
+                        self.package_size % self.components
+                    } else {
+                        0
+                    };
+                let image_data: Vec<u8> = (0..size).map(|offset| (offset + i) as u8).collect();
+                ComponentImageInformation {
+                    // Must match the components advertised by the device
+                    classification: ComponentClassification::Firmware as u16,
+                    identifier: i as u16 + 1,
+                    comparison_stamp: Some(0x12345679),
+                    options: 0x0,
+                    requested_activation_method: 0x0002,
+                    version_string_type: StringType::Utf8,
+                    version_string: Some("soc-fw-1.2".to_string()),
+                    size: size as u32,
+                    image_data: Some(image_data.into()),
+                    ..Default::default()
+                }
+            })
+            .collect();
+
+        FirmwareManifest {
+            package_header_information: PackageHeaderInformation {
+                package_header_identifier: Uuid::parse_str("7B291C996DB64208801B02026E463C78")
+                    .unwrap(),
+                package_header_format_revision: 1,
+                package_release_date_time: Utc.with_ymd_and_hms(2025, 3, 1, 0, 0, 0).unwrap(),
+                package_version_string_type: StringType::Utf8,
+                package_version_string: Some("1.2.0-release".to_string()),
+                package_header_size: 0, // This will be computed during encoding
+            },
+            firmware_device_id_records: vec![FirmwareDeviceIdRecord {
+                firmware_device_package_data: None,
+                device_update_option_flags: 0x0,
+                component_image_set_version_string_type: StringType::Utf8,
+                component_image_set_version_string: Some("1.2.0".to_string()),
+                applicable_components: Some((0..self.components as u8).collect()),
+                initial_descriptor: Descriptor {
+                    descriptor_type: DescriptorType::Uuid,
+                    descriptor_data: DEVICE_UUID.to_vec(),
+                },
+                additional_descriptors: None,
+                reference_manifest_data: None,
+            }],
+            downstream_device_id_records: None,
+            component_image_information,
+        }
+    }
+
+    fn to_json(&self, timings: &PhaseTimings, total: Duration) -> String {
+        let phases = PHASES
+            .iter()
+            .map(|(phase, name)| {
+                format!(
+                    "\"{}\":{}",
+                    name,
+                    timings.elapsed[*phase as usize].as_micros()
+                )
+            })
+            .collect::<Vec<_>>()
+            .join(",");
+        format!(
+            "{{\"package_size\":{},\"components\":{},\"transfer_size\":{},\"link_latency_us\":{},\"phases_us\":{{{}}},\"total_us\":{}}}",
+            self.package_size,
+            self.components,
+            self.transfer_size,
+            self.link_latency.as_micros(),
+            phases,
+            total.as_micros()
+        )
+    }
+}
+
+/// Socket adding a fixed latency to every message sent to the device.
+struct DelayedSocket<S: PldmSocket> {
+    inner: S,
+    latency: Duration,
+}
+
+impl<S: PldmSocket> PldmSocket for DelayedSocket<S> {
+    fn send(&self, payload: &[u8]) -> Result<(), PldmTransportError> {
+        if !self.latency.is_zero() {
+            std::thread::sleep(self.latency);
+        }
+        self.inner.send(payload)
+    }
+
+    fn receive(&self, timeout: Option<Duration>) -> Result<RxPacket, PldmTransportError> {
+        self.inner.receive(timeout)
+    }
+
+    fn connect(&self) -> Result<(), PldmTransportError> {
+        self.inner.connect()
+    }
+
+    fn disconnect(&self) {
+        self.inner.disconnect()
+    }
+
+    fn clone(&self) -> Self {
+        Self {
+            inner: self.inner.clone(),
+            latency: self.latency,
+        }
+    }
+}
+
+struct TimedDiscoveryActions {
+    timings: SharedTimings,
+}
+
+impl discovery_sm::StateMachineActions for TimedDiscoveryActions {
+    fn on_start_discovery(
+        &self,
+        ctx: &mut discovery_sm::InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        self.timings.lock().unwrap().begin(Phase::Discovery);
+        discovery_sm::DefaultActions.on_start_discovery(ctx)
+    }
+
+    fn on_pldm_commands_response_type5(
+        &self,
+        ctx: &mut discovery_sm::InnerContext<impl PldmSocket + Send + 'static>,
+        response: pldm_control::GetPldmCommandsResponse,
+    ) -> Result<(), ()> {
+        self.timings.lock().unwrap().end(Phase::Discovery);
+        discovery_sm::DefaultActions.on_pldm_commands_response_type5(ctx, response)
+    }
+}
+
+struct TimedUpdateActions {
+    timings: SharedTimings,
+    transfer_size: u32,
+}
+
+impl update_sm::StateMachineActions for TimedUpdateActions {
+    fn max_transfer_size(&self) -> u32 {
+        self.transfer_size
+    }
+
+    fn on_start_update(
+        &mut self,
+        ctx: &mut update_sm::InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        self.timings.lock().unwrap().begin(Phase::RequestUpdate);
+        update_sm::DefaultActions.on_start_update(ctx)
+    }
+
+    fn on_request_update_response(
+        &mut self,
+        ctx: &mut update_sm::InnerContext<impl PldmSocket + Send + 'static>,
+        response: pldm_packet::request_update::RequestUpdateResponse,
+    ) -> Result<(), ()> {
+        self.timings.lock().unwrap().end(Phase::RequestUpdate);
+        update_sm::DefaultActions.on_request_update_response(ctx, response)
+    }
+
+    fn on_start_download(
+        &mut self,
+        ctx: &mut update_sm::InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        self.timings.lock().unwrap().begin(Phase::Download);
+        update_sm::DefaultActions.on_start_download(ctx)
+    }
+
+    fn on_transfer_success(
+        &mut self,
+        ctx: &mut update_sm::InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        let mut timings = self.timings.lock().unwrap();
+        timings.end(Phase::Download);
+        timings.begin(Phase::Verify);
+        drop(timings);
+        update_sm::DefaultActions.on_transfer_success(ctx)
+    }
+
+    fn on_verify_success(
+        &mut self,
+        ctx: &mut update_sm::InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        let mut timings = self.timings.lock().unwrap();
+        timings.end(Phase::Verify);
+        timings.begin(Phase::Apply);
+        drop(timings);
+        update_sm::DefaultActions.on_verify_success(ctx)
+    }
+
+    fn on_apply_success(
+        &mut self,
+        ctx: &mut update_sm::InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        self.timings.lock().unwrap().end(Phase::Apply);
+        update_sm::DefaultActions.on_apply_success(ctx)
+    }
+
+    fn on_activate_firmware(
+        &mut self,
+        ctx: &mut update_sm::InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        self.timings.lock().unwrap().begin(Phase::Activate);
+        update_sm::DefaultActions.on_activate_firmware(ctx)
+    }
+
+    fn on_stop_update(
+        &mut self,
+        ctx: &mut update_sm::InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        self.timings.lock().unwrap().end(Phase::Activate);
+        update_sm::DefaultActions.on_stop_update(ctx)
+    }
+
+    fn on_stop_update_error(
+        &mut self,
+        _ctx: &mut update_sm::InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        error!("Stopping update with error");
+        exit(1);
+    }
+}
+
+pub struct PldmFwUpdatePerfTest;
+
+impl PldmFwUpdatePerfTest {
+    fn test_fw_update_perf(socket: MctpPldmSocket) -> Result<(), ()> {
+        let _ = SimpleLogger::new().with_level(LevelFilter::Info).init();
+
+        let params = PerfParams::from_env();
+        let timings = SharedTimings::default();
+        let start = Instant::now();
+        let mut daemon = PldmDaemon::run(
+            DelayedSocket {
+                inner: socket,
+                latency: params.link_latency,
+            },
+            Options {
+                pldm_fw_pkg: Some(params.firmware_package()),
+                discovery_sm_actions: TimedDiscoveryActions {
+                    timings: timings.clone(),
+                },
+                update_sm_actions: TimedUpdateActions {
+                    timings: timings.clone(),
+                    transfer_size: params.transfer_size,
+                },
+                fd_tid: 0x01,
+            },
+        )?;
+
+        while daemon.get_update_sm_state() != update_sm::States::Done {
+            if start.elapsed() > UPDATE_TIMEOUT {
+                error!("Timed out waiting for the update to complete");
+                daemon.stop();
+                return Err(());
+            }
+            std::thread::sleep(Duration::from_millis(10));
+        }
+        let total = start.elapsed();
+        daemon.stop();
+
+        let result = params.to_json(&timings.lock().unwrap(), total);
+        match std::env::var("PLDM_PERF_RESULTS") {
+            Ok(path) => {
+                let mut file = OpenOptions::new()
+                    .create(true)
+                    .append(true)
+                    .open(path)
+                    .map_err(|_| ())?;
+                writeln!(file, "{}", result).map_err(|_| ())?;
+            }
+            Err(_) => println!("{}", result),
+        }
+        Ok(())
+    }
+
+    pub fn run(socket: MctpPldmSocket) {
+        std::thread::spawn(move || {
+            wait_for_runtime_start();
+            if !EMULATOR_RUNNING.load(Ordering::Relaxed) {
+                exit(-1);
+            }
+            println!("Emulator: Running PLDM Firmware Update Performance Test");
+            if Self::test_fw_update_perf(socket).is_err() {
+                println!("Failed");
+                exit(-1);
+            }
+            EMULATOR_RUNNING.store(false, Ordering::Relaxed);
+        });
+    }
+}
@@ -0,0 +1,68 @@
+//! Licensed under the Apache-2.0 license
+
+//! Update agent actions that interrupt a PLDM firmware download part way through and
+//! check that the firmware device resumes it from its last checkpoint.
+
+use log::{error, info};
+use pldm_common::message::firmware_update as pldm_packet;
+use pldm_ua::events::PldmEvents;
+use pldm_ua::transport::PldmSocket;
+use pldm_ua::update_sm::{self, Events, InnerContext, StateMachineActions};
+use std::process::exit;
+
+/// Offset of the firmware data request at which the download is aborted.
+/// This leaves room for several download checkpoints to be taken by the device.
+const INTERRUPT_OFFSET: u32 = 3 * 4096;
+
+#[derive(Default)]
+pub struct ResumeTestActions {
+    interrupted: bool,
+    resumed: bool,
+}
+
+impl StateMachineActions for ResumeTestActions {
+    fn on_request_firmware(
+        &mut self,
+        ctx: &mut InnerContext<impl PldmSocket + Send + 'static>,
+        request: pldm_packet::request_fw_data::RequestFirmwareDataRequest,
+    ) -> Result<(), ()> {
+        if !self.interrupted && request.offset >= INTERRUPT_OFFSET {
+            // Leave the request unanswered and cancel the whole update
+            info!("Interrupting download at offset {}", { request.offset });
+            self.interrupted = true;
+            return ctx
+                .event_queue
+                .send(PldmEvents::Update(Events::AbortUpdate))
+                .map_err(|_| ());
+        }
+        if self.interrupted && !self.resumed {
+            self.resumed = true;
+            if request.offset == 0 {
+                error!("Download restarted from offset 0 instead of resuming");
+                exit(1);
+            }
+            info!("Download resumed at offset {}", { request.offset });
+        }
+        update_sm::DefaultActions.on_request_firmware(ctx, request)
+    }
+
+    fn on_cancel_update_response(
+        &mut self,
+        ctx: &mut InnerContext<impl PldmSocket + Send + 'static>,
+        response: pldm_packet::request_cancel::CancelUpdateResponse,
+    ) -> Result<(), ()> {
+        update_sm::DefaultActions.on_cancel_update_response(ctx, response)?;
+        // Restart the update, the device should pick up where it left off
+        ctx.event_queue
+            .send(PldmEvents::Update(Events::StartUpdate))
+            .map_err(|_| ())
+    }
+
+    fn on_stop_update_error(
+        &mut self,
+        _ctx: &mut InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        error!("Stopping update with error");
+        exit(1);
+    }
+}
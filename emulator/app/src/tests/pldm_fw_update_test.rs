@@ -75,7 +75,7 @@ lazy_static! {
             image_data: {
                 let mut data = vec![0x55u8; 128];
                 data.extend(vec![0xAAu8; 128]);
-                Some(data)
+                Some(data.into())
             },
             ..Default::default()
 
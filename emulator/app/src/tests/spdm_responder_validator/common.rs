@@ -7,7 +7,8 @@ use std::io::{self, ErrorKind, Read, Write};
 use std::net::TcpStream;
 use std::path::Path;
 use std::process::{Child, Command, Stdio};
-use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::atomic::Ordering;
+use std::time::Instant;
 use zerocopy::{transmute, FromBytes, Immutable, IntoBytes};
 
 const RECEIVER_BUFFER_SIZE: usize = 4160;
@@ -16,8 +17,6 @@ pub const SOCKET_SPDM_COMMAND_STOP: u32 = 0xFFFE;
 pub const SOCKET_SPDM_COMMAND_TEST: u32 = 0xDEAD;
 pub const SOCKET_HEADER_LEN: usize = 12;
 
-pub(crate) static SERVER_LISTENING: AtomicBool = AtomicBool::new(false);
-
 #[derive(Debug, Copy, Clone, Default, FromBytes, IntoBytes, Immutable)]
 pub struct SpdmSocketHeader {
     pub command: u32,
@@ -57,6 +56,7 @@ impl SpdmValidatorRunner {
     }
 
     pub fn run_test(&mut self, stream: &mut TcpStream) {
+        let start = Instant::now();
         while EMULATOR_RUNNING.load(Ordering::Relaxed) {
             match self.state {
                 SpdmServerState::Start => {
@@ -93,6 +93,11 @@ impl SpdmValidatorRunner {
             self.test_name,
             if self.passed { "PASSED" } else { "FAILED" }
         );
+        println!(
+            "[{}]: Conformance suite took {:.2?}",
+            self.test_name,
+            start.elapsed()
+        );
     }
 
     pub fn is_passed(&self) -> bool {
@@ -245,15 +250,11 @@ impl SpdmValidatorRunner {
     }
 }
 
+/// Starts the validator, which connects to the SPDM listener. The listener must already be
+/// bound, the connection is then accepted whenever the runner is ready for it.
 pub fn execute_spdm_validator(transport: &'static str) {
     std::thread::spawn(move || {
-        println!(
-            "Starting spdm_device_validator_sample process. Waiting for SPDM listener to start..."
-        );
-        while !SERVER_LISTENING.load(Ordering::Relaxed) {
-            std::thread::sleep(std::time::Duration::from_millis(200));
-        }
-
+        println!("Starting spdm_device_validator_sample process...");
         match start_spdm_device_validator(transport) {
             Ok(mut child) => {
                 while EMULATOR_RUNNING.load(Ordering::Relaxed) {
@@ -1,11 +1,9 @@
 // Licensed under the Apache-2.0 license
 
 use crate::tests::doe_util::common::DoeUtil;
-use crate::tests::spdm_responder_validator::common::{
-    execute_spdm_validator, SpdmValidatorRunner, SERVER_LISTENING,
-};
+use crate::tests::spdm_responder_validator::common::{execute_spdm_validator, SpdmValidatorRunner};
 use crate::tests::spdm_responder_validator::transport::{Transport, SOCKET_TRANSPORT_TYPE_PCI_DOE};
-use crate::{sleep_emulator_ticks, wait_for_runtime_start, EMULATOR_RUNNING};
+use crate::{virtual_time, wait_for_runtime_start, EMULATOR_RUNNING};
 use std::net::TcpListener;
 use std::process::exit;
 use std::sync::atomic::Ordering;
@@ -14,9 +12,13 @@ use std::thread;
 use std::time::Duration;
 
 const TEST_NAME: &str = "DOE-SPDM-RESPONDER-VALIDATOR";
+/// Longest wait for the response to the first request, which is only handled once the
+/// responder has started.
+const RESPONDER_START_TICKS: u64 = 15_000_000;
+/// Longest wait for the response to any other request.
+const RESPONSE_TICKS: u64 = 5_000_000;
 
 enum TxRxState {
-    Start,
     SendReq,
     ReceiveResp,
     Finish,
@@ -34,7 +36,7 @@ impl DoeTransport {
         Self {
             tx,
             rx,
-            tx_rx_state: TxRxState::Start,
+            tx_rx_state: TxRxState::SendReq,
             retry_count,
         }
     }
@@ -42,22 +44,19 @@ impl DoeTransport {
 
 impl Transport for DoeTransport {
     fn target_send_and_receive(&mut self, req: &[u8], wait_for_responder: bool) -> Option<Vec<u8>> {
-        self.tx_rx_state = TxRxState::Start;
+        // The request can be sent right away: the DOE driver holds it until the responder asks
+        // for the next request, and its response tells that the responder is up.
+        self.tx_rx_state = TxRxState::SendReq;
+        let response_ticks = if wait_for_responder {
+            RESPONDER_START_TICKS
+        } else {
+            RESPONSE_TICKS
+        };
         let mut resp = None;
         let mut retry_count = 0;
 
         while EMULATOR_RUNNING.load(Ordering::Relaxed) {
             match self.tx_rx_state {
-                TxRxState::Start => {
-                    if wait_for_responder {
-                        sleep_emulator_ticks(5_000_000);
-                    } else {
-                        // This is to give some time for send_done upcall to be invoked by the kernel to the app.
-                        // Just a hack and may not be perfect solution.
-                        sleep_emulator_ticks(100_000);
-                    }
-                    self.tx_rx_state = TxRxState::SendReq;
-                }
                 TxRxState::SendReq => {
                     if DoeUtil::send_raw_data_object(req, &mut self.tx).is_ok() {
                         self.tx_rx_state = TxRxState::ReceiveResp;
@@ -66,32 +65,34 @@ impl Transport for DoeTransport {
                         self.tx_rx_state = TxRxState::Finish;
                     }
                 }
-                TxRxState::ReceiveResp => match DoeUtil::receive_raw_data_object(&self.rx) {
-                    Ok(response) if !response.is_empty() => {
-                        resp = Some(response.clone());
-                        self.tx_rx_state = TxRxState::Finish;
-                    }
-                    Ok(_) => {
-                        if retry_count < self.retry_count {
-                            retry_count += 1;
-                            println!(
-                                "[{}]: No response received, retrying... ({})",
-                                TEST_NAME, retry_count
-                            );
-                            self.tx_rx_state = TxRxState::SendReq;
-                        } else {
-                            println!(
-                                "[{}]: No response received after {} retries, failing test",
-                                TEST_NAME, self.retry_count
-                            );
+                TxRxState::ReceiveResp => {
+                    match DoeUtil::receive_raw_data_object_within(&self.rx, response_ticks) {
+                        Ok(response) if !response.is_empty() => {
+                            resp = Some(response.clone());
+                            self.tx_rx_state = TxRxState::Finish;
+                        }
+                        Ok(_) => {
+                            if retry_count < self.retry_count {
+                                retry_count += 1;
+                                println!(
+                                    "[{}]: No response received, retrying... ({})",
+                                    TEST_NAME, retry_count
+                                );
+                                self.tx_rx_state = TxRxState::SendReq;
+                            } else {
+                                println!(
+                                    "[{}]: No response received after {} retries, failing test",
+                                    TEST_NAME, self.retry_count
+                                );
+                                self.tx_rx_state = TxRxState::Finish;
+                            }
+                        }
+                        Err(e) => {
+                            println!("[{}]: Failed to receive response: {:?}", TEST_NAME, e);
                             self.tx_rx_state = TxRxState::Finish;
                         }
                     }
-                    Err(e) => {
-                        println!("[{}]: Failed to receive response: {:?}", TEST_NAME, e);
-                        self.tx_rx_state = TxRxState::Finish;
-                    }
-                },
+                }
                 TxRxState::Finish => {
                     break;
                 }
@@ -111,6 +112,9 @@ pub fn run_doe_spdm_conformance_test(
     test_timeout_seconds: Duration,
 ) {
     let transport = DoeTransport::new(tx, rx, 1);
+    let listener =
+        TcpListener::bind("127.0.0.1:2323").expect("Could not bind to the SPDM listerner port");
+    println!("[{}]: Spdm Server Listening on port 2323", TEST_NAME);
     // Spawn a thread to handle the timeout for the test
     thread::spawn(move || {
         thread::sleep(test_timeout_seconds);
@@ -123,20 +127,15 @@ pub fn run_doe_spdm_conformance_test(
     });
 
     // Spawn a thread to run the tests
+    let client = virtual_time::reserve();
     thread::spawn(move || {
+        let _client = client.attach();
         wait_for_runtime_start();
-        // give time for the app to be loaded and ready
-        sleep_emulator_ticks(1_000_000);
 
         if !EMULATOR_RUNNING.load(Ordering::Relaxed) {
             exit(-1);
         }
 
-        let listener =
-            TcpListener::bind("127.0.0.1:2323").expect("Could not bind to the SPDM listerner port");
-        println!("[{}]: Spdm Server Listening on port 2323", TEST_NAME);
-        SERVER_LISTENING.store(true, Ordering::Relaxed);
-
         if let Some(spdm_stream) = listener.incoming().next() {
             let mut spdm_stream = spdm_stream.expect("Failed to accept connection");
 
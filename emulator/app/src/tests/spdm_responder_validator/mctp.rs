@@ -1,9 +1,7 @@
 // Licensed under the Apache-2.0 license
 
 use crate::tests::mctp_util::common::MctpUtil;
-use crate::tests::spdm_responder_validator::common::{
-    execute_spdm_validator, SpdmValidatorRunner, SERVER_LISTENING,
-};
+use crate::tests::spdm_responder_validator::common::{execute_spdm_validator, SpdmValidatorRunner};
 use crate::tests::spdm_responder_validator::transport::{
     Transport, MAX_CMD_TIMEOUT_SECONDS, SOCKET_TRANSPORT_TYPE_MCTP,
 };
@@ -19,7 +17,6 @@ const TEST_NAME: &str = "MCTP-SPDM-RESPONDER-VALIDATOR";
 
 #[derive(Debug, Clone)]
 enum TxRxState {
-    Start,
     SendReq,
     ReceiveResp,
     Finish,
@@ -41,7 +38,7 @@ impl MctpTransport {
             mctp_util: MctpUtil::new(),
             target_addr,
             msg_tag: 0,
-            tx_rx_state: TxRxState::Start,
+            tx_rx_state: TxRxState::SendReq,
             retry_count,
         }
     }
@@ -49,18 +46,14 @@ impl MctpTransport {
     fn send_req_receive_resp(&mut self, req: &[u8]) -> Option<Vec<u8>> {
         self.stream.set_nonblocking(true).unwrap();
         println!("[{}]: Sending message to target ", TEST_NAME);
-        self.tx_rx_state = TxRxState::Start;
+        // The request can be sent right away: the target queues it, and the MCTP driver holds
+        // it until the responder asks for the next request.
+        self.tx_rx_state = TxRxState::SendReq;
         let mut resp = None;
         let mut cur_retry_count = 0;
 
         while EMULATOR_RUNNING.load(Ordering::Relaxed) {
             match self.tx_rx_state {
-                TxRxState::Start => {
-                    // This is to give some time for send_done upcall to be invoked by the kernel to the app.
-                    // Just a hack and may not be perfect solution.
-                    std::thread::sleep(std::time::Duration::from_millis(200));
-                    self.tx_rx_state = TxRxState::SendReq;
-                }
                 TxRxState::SendReq => {
                     self.mctp_util.send_request(
                         self.msg_tag,
@@ -106,13 +99,9 @@ impl MctpTransport {
         resp
     }
 
+    /// Sends the first request, whose response tells that the responder is up.
     fn wait_for_responder(&mut self, req: &[u8]) -> Option<Vec<u8>> {
-        let resp = self.mctp_util.wait_for_responder(
-            self.msg_tag,
-            req,
-            &mut self.stream,
-            self.target_addr,
-        );
+        let resp = self.send_req_receive_resp(req);
         if let Some(ref resp_msg) = resp {
             println!(
                 "[{}]: Received response from target {:X?}",
@@ -153,6 +142,9 @@ pub fn run_mctp_spdm_conformance_test(
     let addr = SocketAddr::from(([127, 0, 0, 1], port));
     let stream = TcpStream::connect(addr).unwrap();
     let transport = MctpTransport::new(stream, target_addr.into(), 1);
+    let listener =
+        TcpListener::bind("127.0.0.1:2323").expect("Could not bind to the SPDM listerner port");
+    println!("[{}]: Spdm Server Listening on port 2323", TEST_NAME);
 
     thread::spawn(move || {
         thread::sleep(test_timeout_seconds);
@@ -170,10 +162,6 @@ pub fn run_mctp_spdm_conformance_test(
         if !EMULATOR_RUNNING.load(Ordering::Relaxed) {
             exit(-1);
         }
-        let listener =
-            TcpListener::bind("127.0.0.1:2323").expect("Could not bind to the SPDM listerner port");
-        println!("[{}]: Spdm Server Listening on port 2323", TEST_NAME);
-        SERVER_LISTENING.store(true, Ordering::Relaxed);
 
         if let Some(spdm_stream) = listener.incoming().next() {
             let mut spdm_stream = spdm_stream.expect("Failed to accept connection");
@@ -0,0 +1,391 @@
+/*++
+
+Licensed under the Apache-2.0 license.
+
+File Name:
+
+    virtual_time.rs
+
+Abstract:
+
+    Lockstep virtual time for the emulator's test clients.
+
+    By default the emulator runs freely, and a test client waiting for a number of
+    emulator ticks is woken once the emulator has gone past them. How far the emulator
+    gets while the client is busy then depends on the speed of the host, which makes
+    wall-clock timeouts too short on slow machines and wasteful on fast ones.
+
+    In lockstep mode, a thread attached as a client holds the emulator at the next tick
+    quantum boundary until it waits again, and its waits are expressed in ticks. At each
+    boundary, the clients whose wait is over run one at a time, in the order their slots
+    were reserved, so that what one client sends another sees at the same boundary on
+    every run. Every client action then happens at the same tick on every run, and a run
+    is only bounded by the speed of the host. Threads that are not attached keep running
+    freely.
+
+--*/
+
+use crate::{EMULATOR_RUNNING, EMULATOR_TICKS, TICK_NOTIFY_TICKS};
+use std::cell::Cell;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::mpsc::{Receiver, RecvError, RecvTimeoutError, TryRecvError};
+use std::sync::{Condvar, Mutex, MutexGuard};
+use std::time::Duration;
+
+/// Granularity at which clients are woken and the emulator is held.
+pub const TICK_QUANTUM: u64 = TICK_NOTIFY_TICKS;
+/// How often blocked threads check that the emulator is still running.
+const RUNNING_POLL_INTERVAL: Duration = Duration::from_millis(100);
+
+static LOCKSTEP: AtomicBool = AtomicBool::new(false);
+static LAST_QUANTUM: AtomicU64 = AtomicU64::new(0);
+static STATE: Mutex<LockstepState> = Mutex::new(LockstepState {
+    busy: 0,
+    next_id: 0,
+    waiting: Vec::new(),
+});
+static STATE_COND: Condvar = Condvar::new();
+
+thread_local! {
+    static CLIENT_ID: Cell<Option<u64>> = const { Cell::new(None) };
+}
+
+struct LockstepState {
+    /// Number of reserved or attached clients that are not waiting
+    busy: usize,
+    next_id: u64,
+    /// Waiting clients and the tick they wait for
+    waiting: Vec<(u64, u64)>,
+}
+
+/// Runs attached clients in lockstep with the emulator. Must be called before the clients
+/// are started.
+pub fn enable_lockstep() {
+    LOCKSTEP.store(true, Ordering::Relaxed);
+}
+
+pub fn is_lockstep() -> bool {
+    LOCKSTEP.load(Ordering::Relaxed)
+}
+
+/// Client slot, reserved by the thread that spawns the client.
+pub struct Reservation {
+    id: Option<u64>,
+}
+
+/// Attached client, detached when dropped.
+pub struct LockstepClient {
+    id: Option<u64>,
+}
+
+/// Reserves a client slot, if lockstep mode is enabled.
+///
+/// Clients woken at the same boundary run in the order of their slots, so slots are
+/// reserved in a fixed order by the thread that spawns the clients, before they start.
+/// The client first runs at the next tick quantum boundary, and the emulator does not go
+/// past it until the client waits, or the reservation is dropped.
+pub fn reserve() -> Reservation {
+    if !is_lockstep() {
+        return Reservation { id: None };
+    }
+    let mut state = STATE.lock().unwrap();
+    let id = state.next_id;
+    state.next_id += 1;
+    state.waiting.push((id, 0));
+    Reservation { id: Some(id) }
+}
+
+impl Reservation {
+    /// Attaches the calling thread as the client of this slot, and waits for its first
+    /// boundary.
+    ///
+    /// The emulator does not go past a boundary until the thread waits again with
+    /// [`crate::sleep_emulator_ticks`], [`recv_within_ticks`], [`recv`] or
+    /// [`poll_within_ticks`], or is detached.
+    pub fn attach(mut self) -> LockstepClient {
+        let id = self.id.take();
+        if let Some(id) = id {
+            CLIENT_ID.with(|client_id| client_id.set(Some(id)));
+            wait_until_woken(STATE.lock().unwrap(), id);
+        }
+        LockstepClient { id }
+    }
+}
+
+impl Drop for Reservation {
+    fn drop(&mut self) {
+        if let Some(id) = self.id.take() {
+            let mut state = STATE.lock().unwrap();
+            let waiting = state.waiting.len();
+            state.waiting.retain(|(waiting_id, _)| *waiting_id != id);
+            if state.waiting.len() == waiting {
+                // Already woken
+                state.busy -= 1;
+            }
+            STATE_COND.notify_all();
+        }
+    }
+}
+
+impl Drop for LockstepClient {
+    fn drop(&mut self) {
+        if self.id.take().is_some() {
+            CLIENT_ID.with(|client_id| client_id.set(None));
+            STATE.lock().unwrap().busy -= 1;
+            STATE_COND.notify_all();
+        }
+    }
+}
+
+/// Whether the calling thread is an attached client.
+pub fn is_attached() -> bool {
+    CLIENT_ID.with(Cell::get).is_some()
+}
+
+/// Current time as seen by the calling thread. An attached client only runs while the
+/// emulator is held at a tick quantum boundary, so its time is that of the boundary.
+fn now() -> u64 {
+    if is_attached() {
+        LAST_QUANTUM.load(Ordering::Relaxed) * TICK_QUANTUM
+    } else {
+        EMULATOR_TICKS.load(Ordering::Relaxed)
+    }
+}
+
+/// Lets the emulator run for `ticks` ticks if the calling thread is an attached client,
+/// returns false otherwise.
+pub(crate) fn sleep_ticks(ticks: u64) -> bool {
+    let Some(id) = CLIENT_ID.with(Cell::get) else {
+        return false;
+    };
+    let deadline = now() + ticks;
+    let mut state = STATE.lock().unwrap();
+    state.waiting.push((id, deadline));
+    state.busy -= 1;
+    STATE_COND.notify_all();
+    wait_until_woken(state, id);
+    true
+}
+
+/// Blocks the client `id`, which is waiting, until it is woken or the emulator stops.
+fn wait_until_woken(mut state: MutexGuard<'static, LockstepState>, id: u64) {
+    while state
+        .waiting
+        .iter()
+        .any(|(waiting_id, _)| *waiting_id == id)
+    {
+        if !EMULATOR_RUNNING.load(Ordering::Relaxed) {
+            state.waiting.retain(|(waiting_id, _)| *waiting_id != id);
+            state.busy += 1;
+            break;
+        }
+        state = STATE_COND
+            .wait_timeout(state, RUNNING_POLL_INTERVAL)
+            .unwrap()
+            .0;
+    }
+}
+
+/// Sleeps for `ticks` emulator ticks if the calling thread is an attached client, and for
+/// `wall` otherwise.
+pub fn sleep(wall: Duration, ticks: u64) {
+    if !sleep_ticks(ticks) {
+        std::thread::sleep(wall);
+    }
+}
+
+/// Waits up to `ticks` emulator ticks for a message on `rx`.
+///
+/// Attached clients check for the message at every tick quantum, other threads are woken as
+/// soon as it is received.
+pub fn recv_within_ticks<T>(rx: &Receiver<T>, ticks: u64) -> Result<T, RecvTimeoutError> {
+    let deadline = now() + ticks;
+    let lockstep = is_attached();
+    while EMULATOR_RUNNING.load(Ordering::Relaxed)
+        && EMULATOR_TICKS.load(Ordering::Relaxed) < deadline
+    {
+        if lockstep {
+            match rx.try_recv() {
+                Ok(message) => return Ok(message),
+                Err(TryRecvError::Empty) => {
+                    sleep_ticks(TICK_QUANTUM);
+                }
+                Err(TryRecvError::Disconnected) => return Err(RecvTimeoutError::Disconnected),
+            }
+        } else {
+            match rx.recv_timeout(Duration::from_millis(10)) {
+                Ok(message) => return Ok(message),
+                Err(RecvTimeoutError::Timeout) => {}
+                Err(e) => return Err(e),
+            }
+        }
+    }
+    Err(RecvTimeoutError::Timeout)
+}
+
+/// Waits for a message on `rx`, until all its senders are dropped or the emulator stops.
+///
+/// Attached clients check for the message at every tick quantum, other threads are woken as
+/// soon as it is received.
+pub fn recv<T>(rx: &Receiver<T>) -> Result<T, RecvError> {
+    if !is_attached() {
+        return rx.recv();
+    }
+    loop {
+        match rx.try_recv() {
+            Ok(message) => return Ok(message),
+            Err(TryRecvError::Empty) if EMULATOR_RUNNING.load(Ordering::Relaxed) => {
+                sleep_ticks(TICK_QUANTUM);
+            }
+            Err(_) => return Err(RecvError),
+        }
+    }
+}
+
+/// Checks `ready` at every tick quantum for up to `ticks` ticks, and returns whether it
+/// became true. Only for attached clients, as other threads would not wait between checks.
+pub fn poll_within_ticks(ticks: u64, mut ready: impl FnMut() -> bool) -> bool {
+    debug_assert!(is_attached());
+    let deadline = now() + ticks;
+    loop {
+        if ready() {
+            return true;
+        }
+        if now() >= deadline || !EMULATOR_RUNNING.load(Ordering::Relaxed) {
+            return false;
+        }
+        sleep_ticks(TICK_QUANTUM);
+    }
+}
+
+/// Waits until no attached client is running.
+fn wait_idle(mut state: MutexGuard<'static, LockstepState>) -> MutexGuard<'static, LockstepState> {
+    while state.busy > 0 && EMULATOR_RUNNING.load(Ordering::Relaxed) {
+        state = STATE_COND
+            .wait_timeout(state, RUNNING_POLL_INTERVAL)
+            .unwrap()
+            .0;
+    }
+    state
+}
+
+/// Called by the emulator at every step. At each tick quantum boundary, runs the clients
+/// whose wait is over one at a time, in the order of their slots, and returns true once
+/// they all wait again.
+pub(crate) fn on_tick(now: u64) -> bool {
+    if !is_lockstep() {
+        return false;
+    }
+    let quantum = now / TICK_QUANTUM;
+    if quantum == LAST_QUANTUM.load(Ordering::Relaxed) {
+        return false;
+    }
+    LAST_QUANTUM.store(quantum, Ordering::Relaxed);
+
+    let mut state = STATE.lock().unwrap();
+    let mut woken: Vec<u64> = state
+        .waiting
+        .iter()
+        .filter(|(_, deadline)| *deadline <= now)
+        .map(|(id, _)| *id)
+        .collect();
+    woken.sort_unstable();
+    for id in woken {
+        state.waiting.retain(|(waiting_id, _)| *waiting_id != id);
+        state.busy += 1;
+        STATE_COND.notify_all();
+        state = wait_idle(state);
+    }
+    true
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::sync::{mpsc, Arc};
+    use std::thread;
+
+    /// Restores the global lockstep state and the emulator ticks when a test ends, even if
+    /// it fails, so that other tests of the crate see the emulator running freely.
+    struct ResetOnDrop;
+
+    impl Drop for ResetOnDrop {
+        fn drop(&mut self) {
+            LOCKSTEP.store(false, Ordering::Relaxed);
+            LAST_QUANTUM.store(0, Ordering::Relaxed);
+            EMULATOR_TICKS.store(0, Ordering::Relaxed);
+            let mut state = STATE.lock().unwrap_or_else(|err| err.into_inner());
+            state.busy = 0;
+            state.next_id = 0;
+            state.waiting.clear();
+        }
+    }
+
+    /// Emulates the emulator stepping one tick at a time until `done` returns a value.
+    fn step_until<T>(mut done: impl FnMut() -> Option<T>) -> T {
+        let mut now = 0;
+        loop {
+            now += 1;
+            EMULATOR_TICKS.store(now, Ordering::Relaxed);
+            on_tick(now);
+            if let Some(result) = done() {
+                return result;
+            }
+        }
+    }
+
+    #[test]
+    fn test_lockstep_clients() {
+        let _reset = ResetOnDrop;
+        enable_lockstep();
+
+        // A client sees the ticks it waited for
+        let (tx, rx) = mpsc::channel();
+        let reservation = reserve();
+        let client = thread::spawn(move || {
+            let _client = reservation.attach();
+            let mut observed = vec![];
+            for _ in 0..3 {
+                assert!(sleep_ticks(2 * TICK_QUANTUM));
+                observed.push(EMULATOR_TICKS.load(Ordering::Relaxed));
+            }
+            tx.send(observed).unwrap();
+        });
+        let observed = step_until(|| rx.try_recv().ok());
+        client.join().unwrap();
+        // The client first runs at the first boundary, and the emulator is held while it
+        // runs, so it always wakes on the same ticks
+        assert_eq!(
+            observed,
+            vec![3 * TICK_QUANTUM, 5 * TICK_QUANTUM, 7 * TICK_QUANTUM]
+        );
+
+        // Clients woken at the same boundary run one at a time, in the order of their slots
+        // and not in the order they were started
+        LAST_QUANTUM.store(0, Ordering::Relaxed);
+        let order = Arc::new(Mutex::new(vec![]));
+        let reservations = [reserve(), reserve()];
+        let clients: Vec<_> = reservations
+            .into_iter()
+            .enumerate()
+            .rev()
+            .map(|(slot, reservation)| {
+                let order = order.clone();
+                thread::spawn(move || {
+                    let _client = reservation.attach();
+                    for _ in 0..3 {
+                        sleep_ticks(TICK_QUANTUM);
+                        // Give the later slot time to run first, if it was not held
+                        thread::sleep(Duration::from_millis((1 - slot as u64) * 10));
+                        order.lock().unwrap().push(slot);
+                    }
+                })
+            })
+            .collect();
+        step_until(|| clients.iter().all(|c| c.is_finished()).then_some(()));
+        for client in clients {
+            client.join().unwrap();
+        }
+        assert_eq!(*order.lock().unwrap(), vec![0, 1, 0, 1, 0, 1]);
+    }
+}
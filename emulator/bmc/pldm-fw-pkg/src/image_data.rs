@@ -0,0 +1,185 @@
+/*++
+
+Licensed under the Apache-2.0 license.
+
+--*/
+
+//! Component image storage.
+//!
+//! Images decoded from a firmware package are not copied out of the file: the package is
+//! memory-mapped once and every component refers to its window of the mapping. Mappings are
+//! shared per package file, so decoding the same package for several update sessions keeps a
+//! single copy of the image data resident.
+
+use std::collections::HashMap;
+use std::fmt;
+use std::fs::File;
+use std::io;
+use std::ops::{Deref, Range};
+use std::os::unix::io::AsRawFd;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, LazyLock, Mutex, Weak};
+use std::time::SystemTime;
+
+/// A read-only memory mapping of a whole firmware package file.
+pub struct PackageMapping {
+    addr: *mut libc::c_void,
+    len: usize,
+    modified: Option<SystemTime>,
+}
+
+// The mapping is read-only and never changes after creation.
+unsafe impl Send for PackageMapping {}
+unsafe impl Sync for PackageMapping {}
+
+static MAPPINGS: LazyLock<Mutex<HashMap<PathBuf, Weak<PackageMapping>>>> =
+    LazyLock::new(|| Mutex::new(HashMap::new()));
+
+impl PackageMapping {
+    /// Maps the package file at `path`, reusing a live mapping of the same unmodified file.
+    pub fn open(path: &Path) -> io::Result<Arc<Self>> {
+        let file = File::open(path)?;
+        let metadata = file.metadata()?;
+        let len = metadata.len() as usize;
+        let modified = metadata.modified().ok();
+        let key = path.canonicalize()?;
+
+        let mut mappings = MAPPINGS.lock().unwrap();
+        mappings.retain(|_, mapping| mapping.strong_count() > 0);
+        if let Some(mapping) = mappings.get(&key).and_then(Weak::upgrade) {
+            if mapping.len == len && mapping.modified == modified {
+                return Ok(mapping);
+            }
+        }
+
+        let addr = if len == 0 {
+            std::ptr::null_mut()
+        } else {
+            // SAFETY: a fresh private read-only mapping of an open file descriptor
+            let addr = unsafe {
+                libc::mmap(
+                    std::ptr::null_mut(),
+                    len,
+                    libc::PROT_READ,
+                    libc::MAP_PRIVATE,
+                    file.as_raw_fd(),
+                    0,
+                )
+            };
+            if addr == libc::MAP_FAILED {
+                return Err(io::Error::last_os_error());
+            }
+            addr
+        };
+
+        let mapping = Arc::new(PackageMapping {
+            addr,
+            len,
+            modified,
+        });
+        mappings.insert(key, Arc::downgrade(&mapping));
+        Ok(mapping)
+    }
+
+    pub fn as_slice(&self) -> &[u8] {
+        if self.len == 0 {
+            return &[];
+        }
+        // SAFETY: addr points to `len` readable bytes for the lifetime of the mapping
+        unsafe { std::slice::from_raw_parts(self.addr as *const u8, self.len) }
+    }
+}
+
+impl Drop for PackageMapping {
+    fn drop(&mut self) {
+        if self.len != 0 {
+            // SAFETY: addr/len describe a mapping created by `open` and not yet unmapped
+            unsafe {
+                libc::munmap(self.addr, self.len);
+            }
+        }
+    }
+}
+
+/// The contents of a component image.
+///
+/// Cloning is cheap in both cases, so the image can be handed to several update sessions.
+#[derive(Clone)]
+pub enum ImageData {
+    /// Image data held in memory, e.g. provided when building a package
+    Owned(Arc<Vec<u8>>),
+    /// A window of a memory-mapped firmware package
+    Mapped {
+        mapping: Arc<PackageMapping>,
+        range: Range<usize>,
+    },
+}
+
+impl ImageData {
+    /// Returns the window `range` of `mapping`, or an error if it lies outside the mapping.
+    pub fn mapped(mapping: &Arc<PackageMapping>, range: Range<usize>) -> io::Result<Self> {
+        if range.start > range.end || range.end > mapping.len {
+            return Err(io::Error::new(
+                io::ErrorKind::UnexpectedEof,
+                "Component image exceeds the package size",
+            ));
+        }
+        Ok(ImageData::Mapped {
+            mapping: mapping.clone(),
+            range,
+        })
+    }
+}
+
+impl Deref for ImageData {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        match self {
+            ImageData::Owned(data) => data,
+            ImageData::Mapped { mapping, range } => &mapping.as_slice()[range.clone()],
+        }
+    }
+}
+
+impl From<Vec<u8>> for ImageData {
+    fn from(data: Vec<u8>) -> Self {
+        ImageData::Owned(Arc::new(data))
+    }
+}
+
+impl PartialEq for ImageData {
+    fn eq(&self, other: &Self) -> bool {
+        **self == **other
+    }
+}
+
+impl fmt::Debug for ImageData {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            ImageData::Owned(data) => write!(f, "ImageData::Owned({} bytes)", data.len()),
+            ImageData::Mapped { range, .. } => write!(f, "ImageData::Mapped({:?})", range),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::io::Write;
+
+    #[test]
+    fn test_mapping_is_shared() {
+        let mut file = tempfile::NamedTempFile::new().unwrap();
+        file.write_all(&[0x11, 0x22, 0x33, 0x44]).unwrap();
+
+        let first = PackageMapping::open(file.path()).unwrap();
+        let second = PackageMapping::open(file.path()).unwrap();
+        assert!(Arc::ptr_eq(&first, &second));
+
+        let image = ImageData::mapped(&first, 1..3).unwrap();
+        assert_eq!(&image[..], &[0x22, 0x33]);
+        assert_eq!(image, ImageData::from(vec![0x22, 0x33]));
+        assert!(ImageData::mapped(&first, 2..5).is_err());
+    }
+}
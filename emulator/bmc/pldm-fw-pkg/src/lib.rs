@@ -1,4 +1,5 @@
 // Licensed under the Apache-2.0 license
 
+pub mod image_data;
 pub mod manifest;
 pub use manifest::FirmwareManifest;
@@ -12,11 +12,14 @@ use serde::{Deserialize, Deserializer, Serialize, Serializer};
 use std::fmt;
 use std::fs;
 use std::fs::File;
-use std::io::{self, Read, Write};
-use std::io::{BufReader, BufWriter};
+use std::io::BufWriter;
+use std::io::{self, Cursor, Read, Write};
+use std::path::Path;
 use std::str::FromStr;
 use uuid::Uuid;
 
+use crate::image_data::{ImageData, PackageMapping};
+
 use crc::{Crc, CRC_32_ISO_HDLC};
 
 #[derive(Debug, Deserialize, Serialize, Default, Clone)]
@@ -78,7 +81,7 @@ pub struct ComponentImageInformation {
     #[serde(skip)]
     pub size: u32,    // Size of the image
     #[serde(skip)]
-    pub image_data: Option<Vec<u8>>, // Optional image data, to be filled when package is decoded
+    pub image_data: Option<ImageData>, // Optional image data, to be filled when package is decoded
 }
 
 #[derive(Debug, PartialEq)]
@@ -472,8 +475,7 @@ impl FirmwareManifest {
                 image_data.append(&mut data);
             } else if let Some(data) = &component.image_data {
                 // If image_data is provided, use it directly
-                let mut data = data.clone();
-                image_data.append(&mut data);
+                image_data.extend_from_slice(data);
             } else {
                 return Err(io::Error::new(
                     io::ErrorKind::InvalidData,
@@ -536,8 +538,9 @@ impl FirmwareManifest {
             }
         }
 
-        let bin_file = File::open(fw_package_file_path)?;
-        let mut reader = BufReader::new(bin_file);
+        // Component images are served straight from the mapping instead of being copied
+        let mapping = PackageMapping::open(Path::new(fw_package_file_path))?;
+        let mut reader = Cursor::new(mapping.as_slice());
 
         // Decode package_header_information
         let (package_header_information, component_bitmap_length) =
@@ -614,12 +617,10 @@ impl FirmwareManifest {
         }
 
         for (component_idx, component) in component_image_information.iter_mut().enumerate() {
-            // Get the size of the component
-            let size = component.size as usize;
-            // Allocate buffer for the firmwarGe image
-            let mut image_data = vec![0u8; size];
-            // Read the image data from the reader
-            reader.read_exact(&mut image_data)?;
+            // Get the window of the component within the package
+            let start = reader.position() as usize;
+            let image_data = ImageData::mapped(&mapping, start..start + component.size as usize)?;
+            reader.set_position((start + image_data.len()) as u64);
             if output_dir_path.is_some() {
                 // Write the image data to a file, the filename has a prefix of img_xx where xx is the component identifier
                 let file_path =
@@ -48,7 +48,7 @@ fn test_encode_decode_firmware_package() {
             opaque_data: Some(vec![0x77, 0x88, 0x99]),
             offset: 0, // Will be calculated in encoding
             size: 256,
-            image_data: Some(vec![0x55u8; 256]),
+            image_data: Some(vec![0x55u8; 256].into()),
         }],
     };
 
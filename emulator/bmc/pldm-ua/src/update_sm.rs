@@ -21,7 +21,7 @@ use pldm_common::protocol::firmware_update::{
 use pldm_fw_pkg::manifest::{ComponentImageInformation, FirmwareDeviceIdRecord};
 use pldm_fw_pkg::FirmwareManifest;
 use smlang::statemachine;
-use std::cmp::{max, min};
+use std::cmp::min;
 use std::sync::mpsc::Sender;
 use std::sync::{Arc, Mutex};
 use std::time::{Duration, Instant};
@@ -63,16 +63,21 @@ statemachine! {
         Download + TransferCompleteFail / on_transfer_fail = Idle,
         Download + TransferCompletePass / on_transfer_success = Verify,
         Download + CancelUpdate  / on_stop_update = Idle,
+        Download + AbortUpdate / on_abort_update = CancelUpdateSent,
 
         Verify + VerifyComplete(pldm_packet::verify_complete::VerifyCompleteRequest) / on_verify_complete_request = Verify,
         Verify + VerifyCompletePass / on_verify_success = Apply,
         Verify + VerifyCompleteFail / on_verify_fail = Idle,
         Verify + CancelUpdate  / on_stop_update = Idle,
+        Verify + AbortUpdate / on_abort_update = CancelUpdateSent,
 
         Apply + ApplyComplete(pldm_packet::apply_complete::ApplyCompleteRequest) / on_apply_complete_request = Apply,
         Apply + ApplyCompleteFail / on_apply_fail = Idle,
         Apply + ApplyCompletePass / on_apply_success = ReadyXfer,
         Apply + CancelUpdateComponent  / on_stop_update = Idle,
+        Apply + AbortUpdate / on_abort_update = CancelUpdateSent,
+
+        CancelUpdateSent + CancelUpdateResponse(pldm_packet::request_cancel::CancelUpdateResponse) / on_cancel_update_response = Idle,
 
         Activate + ActivateFirmwareResponse(pldm_packet::activate_fw::ActivateFirmwareResponse) / on_activate_firmware_response = Activate,
         Activate + GetStatus / on_get_status = Activate,
@@ -185,6 +190,12 @@ fn is_pkg_device_id_in_response(
     true
 }
 pub trait StateMachineActions {
+    // Parameters
+    /// Maximum transfer size offered to the firmware device in RequestUpdate
+    fn max_transfer_size(&self) -> u32 {
+        MAX_TRANSFER_SIZE
+    }
+
     // Guards
     fn are_all_components_passed(
         &self,
@@ -202,6 +213,12 @@ pub trait StateMachineActions {
         &mut self,
         ctx: &mut InnerContext<impl PldmSocket + Send + 'static>,
     ) -> Result<(), ()> {
+        // Forget any state left over from a previously aborted update
+        ctx.device_id = None;
+        ctx.components.clear();
+        ctx.component_response_codes.clear();
+        ctx.current_component_index = None;
+        ctx.transferred_bytes = 0;
         send_message_helper(
             ctx,
             &pldm_packet::query_devid::QueryDeviceIdentifiersRequest::new(
@@ -460,7 +477,7 @@ pub trait StateMachineActions {
                 &pldm_packet::request_update::RequestUpdateRequest::new(
                     ctx.instance_id,
                     PldmMsgType::Request,
-                    MAX_TRANSFER_SIZE,
+                    self.max_transfer_size(),
                     ctx.components.len() as u16,
                     MAX_OUTSTANDING_TRANSFER_REQ,
                     0, // pkg_data_len is optional, not supported
@@ -620,7 +637,7 @@ pub trait StateMachineActions {
         ctx: &mut InnerContext<impl PldmSocket + Send + 'static>,
         request: pldm_packet::request_fw_data::RequestFirmwareDataRequest,
     ) -> Result<(), ()> {
-        if request.length > MAX_TRANSFER_SIZE || request.length < BASELINE_TRANSFER_SIZE {
+        if request.length > self.max_transfer_size() || request.length < BASELINE_TRANSFER_SIZE {
             error!("RequestFirmwareDataRequest length is invalid");
             let response = pldm_packet::request_fw_data::RequestFirmwareDataResponse::new(
                 request.hdr.instance_id(),
@@ -631,7 +648,8 @@ pub trait StateMachineActions {
         }
 
         let component = &ctx.components[ctx.current_component_index.unwrap()];
-        if let Some(data) = &component.image_data {
+        // Cloning only takes a reference on the image, which may be shared with other sessions
+        if let Some(data) = component.image_data.clone() {
             if (request.offset + request.length) as usize
                 >= data.len() + BASELINE_TRANSFER_SIZE as usize
             {
@@ -643,31 +661,23 @@ pub trait StateMachineActions {
                 );
                 return send_message_helper(ctx, &response);
             }
-            let mut buffer = [0u8; MAX_TRANSFER_SIZE as usize];
-            let mut to_copy = min(
-                data.len() as i32 - request.offset as i32,
-                request.length as i32,
-            );
-            to_copy = max(to_copy, 0); // Ensure to_copy is not negative
-            let mut to_pad = min(
-                request.length as i32,
-                request.length as i32 - (data.len() as i32 - request.offset as i32),
-            );
-            to_pad = max(to_pad, 0); // Ensure to_pad is not negative
-
-            if to_copy > 0 {
-                buffer[..to_copy as usize].copy_from_slice(
-                    &data[request.offset as usize..(request.offset as usize + to_copy as usize)],
-                );
-            }
-            if to_pad > 0 {
-                buffer[to_copy as usize..(to_copy + to_pad) as usize].fill(0);
-            }
+            let start = min(request.offset as usize, data.len());
+            let end = min(start + request.length as usize, data.len());
+
+            // Requests within the image are served directly from the image,
+            // only a request past its end needs to be copied and zero-padded
+            let mut buffer = [0u8; MAX_PLDM_PAYLOAD_SIZE];
+            let payload = if end - start == request.length as usize {
+                &data[start..end]
+            } else {
+                buffer[..end - start].copy_from_slice(&data[start..end]);
+                &buffer[..request.length as usize]
+            };
 
             let response = pldm_packet::request_fw_data::RequestFirmwareDataResponse::new(
                 request.hdr.instance_id(),
                 PldmBaseCompletionCode::Success as u8,
-                &buffer[..request.length as usize],
+                payload,
             );
 
             ctx.transferred_bytes += request.length;
@@ -1019,6 +1029,34 @@ pub trait StateMachineActions {
         ctx.response_timer.cancel();
         Ok(())
     }
+    fn on_abort_update(
+        &mut self,
+        ctx: &mut InnerContext<impl PldmSocket + Send + 'static>,
+    ) -> Result<(), ()> {
+        info!("Aborting update");
+        let request = pldm_packet::request_cancel::CancelUpdateRequest::new(
+            ctx.instance_id,
+            PldmMsgType::Request,
+        );
+        send_message_helper(ctx, &request)
+    }
+
+    fn on_cancel_update_response(
+        &mut self,
+        ctx: &mut InnerContext<impl PldmSocket + Send + 'static>,
+        response: pldm_packet::request_cancel::CancelUpdateResponse,
+    ) -> Result<(), ()> {
+        ctx.instance_id += 1; // Response received, increment instance id
+        ctx.response_timer.cancel();
+        if response.completion_code == PldmBaseCompletionCode::Success as u8 {
+            info!("CancelUpdate response success");
+            Ok(())
+        } else {
+            error!("CancelUpdate response failed");
+            Err(())
+        }
+    }
+
     fn on_cancel_update_component_response(
         &mut self,
         ctx: &mut InnerContext<impl PldmSocket + Send + 'static>,
@@ -1107,6 +1145,9 @@ pub fn process_packet(packet: &RxPacket) -> Result<PldmEvents, ()> {
             FwUpdateCmd::CancelUpdateComponent => {
                 packet_to_event(&header, packet, true, Events::CancelUpdateComponentResponse)
             }
+            FwUpdateCmd::CancelUpdate => {
+                packet_to_event(&header, packet, true, Events::CancelUpdateResponse)
+            }
             _ => {
                 debug!("Unknown firmware update command");
                 Err(())
@@ -1236,6 +1277,8 @@ impl<T: StateMachineActions, S: PldmSocket + Send + 'static> StateMachineContext
         on_stop_update() -> Result<(),()>,
         on_stop_update_error() -> Result<(),()>,
         on_cancel_update_component_response(response: pldm_packet::request_cancel::CancelUpdateComponentResponse) -> Result<(),()>,
+        on_abort_update() -> Result<(),()>,
+        on_cancel_update_response(response: pldm_packet::request_cancel::CancelUpdateResponse) -> Result<(),()>,
         on_verify_success() -> Result<(),()>,
         on_verify_fail() -> Result<(),()>,
         on_apply_complete_request(request: pldm_packet::apply_complete::ApplyCompleteRequest) -> Result<(),()>,
@@ -182,7 +182,7 @@ fn test_download_size_divisible_by_transfer_size() {
             opaque_data: Some(vec![0x77, 0x88, 0x99]),
             offset: 0, // Will be calculated in encoding
             size: 256,
-            image_data: Some(vec![0x55u8; 256]),
+            image_data: Some(vec![0x55u8; 256].into()),
         }],
     };
 
@@ -296,7 +296,7 @@ fn test_download_size_not_divisible_by_transfer_size() {
             opaque_data: Some(vec![0x77, 0x88, 0x99]),
             offset: 0, // Will be calculated in encoding
             size: image_data.len() as u32,
-            image_data: Some(image_data),
+            image_data: Some(image_data.into()),
         }],
     };
 
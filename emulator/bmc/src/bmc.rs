@@ -1,5 +1,6 @@
 // Licensed under the Apache-2.0 license
 
+use crate::image_store::RecoveryImage;
 use crate::recovery;
 use caliptra_emu_bus::{Device, Event, EventData, RecoveryCommandCode};
 use std::sync::mpsc;
@@ -12,6 +13,8 @@ pub struct Bmc {
 
     /// Recovery state machine
     recovery_state_machine: recovery::StateMachine<recovery::Context>,
+    /// Whether the BMC drives the recovery flow, or recorded recovery events are replayed
+    recovery_enabled: bool,
 }
 
 impl Bmc {
@@ -28,10 +31,61 @@ impl Bmc {
             events_to_mcu,
             events_from_mcu,
             recovery_state_machine: recovery::StateMachine::new(recovery_context),
+            recovery_enabled: true,
         }
     }
 
-    pub fn push_recovery_image(&mut self, image: Vec<u8>) {
+    /// Stops the BMC from driving the recovery flow, so that recorded recovery events can be
+    /// replayed with [`Bmc::send_recovery_ctrl`] and [`Bmc::send_recovery_image`] instead.
+    /// Events between Caliptra and the MCU are still routed.
+    pub fn disable_recovery(&mut self) {
+        self.recovery_enabled = false;
+    }
+
+    /// Writes `payload` to the recovery control register of Caliptra.
+    pub fn send_recovery_ctrl(&mut self, payload: Vec<u8>) {
+        self.events_to_caliptra
+            .send(Event::new(
+                Device::BMC,
+                Device::CaliptraCore,
+                EventData::RecoveryBlockWrite {
+                    source_addr: 0,
+                    target_addr: 0,
+                    command_code: RecoveryCommandCode::RecoveryCtrl,
+                    payload,
+                },
+            ))
+            .unwrap();
+    }
+
+    /// Makes the recovery image at `image_id` available to Caliptra.
+    pub fn send_recovery_image(&mut self, image_id: u8) {
+        let image = match self
+            .recovery_state_machine
+            .context_mut()
+            .recovery_images
+            .read(image_id as usize)
+        {
+            Ok(image) => image,
+            Err(err) => {
+                println!(
+                    "[emulator bmc recovery] Cannot send recovery image {}: {}",
+                    image_id, err
+                );
+                return;
+            }
+        };
+        self.events_to_caliptra
+            .send(Event::new(
+                Device::BMC,
+                Device::CaliptraCore,
+                EventData::RecoveryImageAvailable { image_id, image },
+            ))
+            .unwrap();
+    }
+
+    /// Adds the next recovery image, either its contents or the path of a raw image file.
+    pub fn push_recovery_image(&mut self, image: impl Into<RecoveryImage>) {
         self.recovery_state_machine
             .context_mut()
             .recovery_images
@@ -78,7 +132,7 @@ impl Bmc {
     /// Take any actions for the recovery interface.
     fn recovery_step(&mut self) {
         let state = *self.recovery_state_machine.state();
-        if state == recovery::States::Done {
+        if !self.recovery_enabled || state == recovery::States::Done {
             return;
         }
 
@@ -93,6 +147,9 @@ impl Bmc {
 
     // translate from Caliptra events to state machine events
     pub fn incoming_caliptra_event(&mut self, event: Event) {
+        if !self.recovery_enabled {
+            return;
+        }
         match &event.event {
             EventData::RecoveryBlockReadResponse {
                 source_addr: _,
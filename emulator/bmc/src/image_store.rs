@@ -0,0 +1,96 @@
+// Licensed under the Apache-2.0 license
+
+//! Recovery images served by the BMC.
+//!
+//! Images backed by a file are only read when Caliptra requests them, so an emulator that
+//! never reaches recovery does not load them, and parallel emulator runs of the same image
+//! set share the file's pages in the page cache until then. Images that had to be
+//! converted when loaded (e.g. extracted from an ELF executable) are kept in memory.
+
+use std::io;
+use std::path::PathBuf;
+
+/// A recovery image, addressed by its index in the [`RecoveryImageStore`].
+#[derive(Debug)]
+pub enum RecoveryImage {
+    /// Image held in memory, copied every time it is requested
+    Memory(Vec<u8>),
+    /// Raw image file, read every time it is requested
+    File(PathBuf),
+}
+
+impl From<Vec<u8>> for RecoveryImage {
+    fn from(image: Vec<u8>) -> Self {
+        RecoveryImage::Memory(image)
+    }
+}
+
+impl From<PathBuf> for RecoveryImage {
+    fn from(path: PathBuf) -> Self {
+        RecoveryImage::File(path)
+    }
+}
+
+#[derive(Debug, Default)]
+pub struct RecoveryImageStore {
+    images: Vec<RecoveryImage>,
+}
+
+impl RecoveryImageStore {
+    pub fn push(&mut self, image: impl Into<RecoveryImage>) {
+        self.images.push(image.into());
+    }
+
+    pub fn len(&self) -> usize {
+        self.images.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.images.is_empty()
+    }
+
+    /// Returns the contents of the image at `index`, to be sent to Caliptra.
+    ///
+    /// Every image can be requested any number of times, e.g. when Caliptra restarts recovery.
+    pub fn read(&self, index: usize) -> io::Result<Vec<u8>> {
+        match self.images.get(index) {
+            Some(RecoveryImage::Memory(image)) => Ok(image.clone()),
+            Some(RecoveryImage::File(path)) => std::fs::read(path),
+            None => Err(io::Error::new(
+                io::ErrorKind::NotFound,
+                "Invalid recovery image index",
+            )),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_memory_image_read_on_request() {
+        let mut store = RecoveryImageStore::default();
+        store.push(vec![1, 2, 3]);
+        assert_eq!(store.read(0).unwrap(), vec![1, 2, 3]);
+        assert_eq!(store.read(0).unwrap(), vec![1, 2, 3]);
+        assert!(store.read(1).is_err());
+    }
+
+    #[test]
+    fn test_file_image_read_on_request() {
+        let dir = std::env::temp_dir().join(format!("bmc-image-store-{}", std::process::id()));
+        std::fs::create_dir_all(&dir).unwrap();
+        let path = dir.join("image.bin");
+
+        let mut store = RecoveryImageStore::default();
+        store.push(path.clone());
+        // the file is not needed until the image is requested
+        assert!(store.read(0).is_err());
+        std::fs::write(&path, [4, 5, 6]).unwrap();
+        assert_eq!(store.read(0).unwrap(), vec![4, 5, 6]);
+        assert_eq!(store.read(0).unwrap(), vec![4, 5, 6]);
+
+        std::fs::remove_dir_all(&dir).unwrap();
+    }
+}
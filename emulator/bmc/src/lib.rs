@@ -1,6 +1,8 @@
 // Licensed under the Apache-2.0 license
 
 mod bmc;
+mod image_store;
 mod recovery;
 
 pub use bmc::Bmc;
+pub use image_store::RecoveryImage;
@@ -1,5 +1,6 @@
 // Licensed under the Apache-2.0 license
 
+use crate::image_store::RecoveryImageStore;
 use caliptra_emu_bus::{Device, Event, EventData, ReadWriteRegister, RecoveryCommandCode};
 use caliptra_emu_periph::dma::recovery::RecoveryStatus;
 use smlang::statemachine;
@@ -118,14 +119,14 @@ type RecoveryStatusBlock = ReadWriteRegister<u32, RecoveryStatus::Register>;
 /// State machine extended variables.
 pub(crate) struct Context {
     events_to_caliptra: mpsc::Sender<Event>,
-    pub(crate) recovery_images: Vec<Vec<u8>>,
+    pub(crate) recovery_images: RecoveryImageStore,
 }
 
 impl Context {
     pub(crate) fn new(events_to_caliptra: mpsc::Sender<Event>) -> Context {
         Context {
             events_to_caliptra,
-            recovery_images: vec![],
+            recovery_images: RecoveryImageStore::default(),
         }
     }
 }
@@ -218,27 +219,28 @@ impl StateMachineContext for Context {
     fn start_recovery(&mut self, status: RecoveryStatusBlock) -> Result<(), ()> {
         let idx = status.reg.read(RecoveryStatus::RECOVERY_IMAGE_INDEX);
 
-        if idx as usize >= self.recovery_images.len() {
-            println!(
-                "[emulator bmc recovery] Invalid recovery image index {}",
-                idx
-            );
-            Err(())
-        } else {
-            let image = &self.recovery_images[idx as usize];
-            println!("[emulator bmc recovery] Sending recovery image {}", idx);
-            self.events_to_caliptra
-                .send(Event::new(
-                    Device::BMC,
-                    Device::CaliptraCore,
-                    EventData::RecoveryImageAvailable {
-                        image_id: idx as u8,
-                        image: image.clone(),
-                    },
-                ))
-                .unwrap();
-            Ok(())
-        }
+        let image = match self.recovery_images.read(idx as usize) {
+            Ok(image) => image,
+            Err(err) => {
+                println!(
+                    "[emulator bmc recovery] Cannot send recovery image {}: {}",
+                    idx, err
+                );
+                return Err(());
+            }
+        };
+        println!("[emulator bmc recovery] Sending recovery image {}", idx);
+        self.events_to_caliptra
+            .send(Event::new(
+                Device::BMC,
+                Device::CaliptraCore,
+                EventData::RecoveryImageAvailable {
+                    image_id: idx as u8,
+                    image,
+                },
+            ))
+            .unwrap();
+        Ok(())
     }
 }
 
@@ -255,4 +257,21 @@ mod tests {
         assert!(sm.process_event(Events::ProtCap(0u32.into())).is_ok());
         assert_eq!(*sm.state(), States::Done);
     }
+
+    #[test]
+    fn test_recovery_image_sent_once() {
+        let (tx, rx) = mpsc::channel();
+        let mut context = Context::new(tx);
+        context.recovery_images.push(vec![1, 2, 3]);
+        assert!(context.start_recovery(0u32.into()).is_ok());
+        match rx.try_recv().unwrap().event {
+            EventData::RecoveryImageAvailable { image_id, image } => {
+                assert_eq!(image_id, 0);
+                assert_eq!(image, vec![1, 2, 3]);
+            }
+            _ => panic!("Unexpected event"),
+        }
+        // the image has been handed over and cannot be sent again
+        assert!(context.start_recovery(0u32.into()).is_err());
+    }
 }
@@ -12,15 +12,19 @@ Abstract:
 
 --*/
 
-use caliptra_emu_bus::{Bus, Clock, Ram};
+use caliptra_emu_bus::{Bus, BusError, Clock, Ram};
 use caliptra_emu_cpu::{Cpu, Pic, StepAction};
-use caliptra_emu_types::RvSize;
+use caliptra_emu_types::{RvAddr, RvData, RvSize};
 use clap::{arg, value_parser};
 use emulator_consts::DEFAULT_CPU_ARGS;
 use fs::TempDir;
 use std::error::Error;
 use std::io::ErrorKind;
-use std::path::PathBuf;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Mutex;
+use std::thread;
+use std::time::{Duration, Instant};
 use std::{env::set_var, rc::Rc};
 use test_data::{get_binary_data, get_signature_data, run_riscof};
 
@@ -191,8 +195,76 @@ fn check_reference_data(expected_txt: &str, bus: &mut impl Bus) -> std::io::Resu
     Ok(())
 }
 
-fn is_test_complete(bus: &mut impl Bus) -> bool {
-    bus.read(RvSize::Word, 0x0).unwrap() != 0
+/// Address the tests write a non-zero value to when they are done.
+const TOHOST_ADDR: RvAddr = 0x0;
+
+/// RAM that watches the stores to the tohost word, so that the runner does not have to read
+/// it after every instruction.
+struct ToHostRam {
+    ram: Ram,
+    complete: bool,
+}
+
+impl ToHostRam {
+    fn new(data: Vec<u8>) -> Self {
+        Self {
+            ram: Ram::new(data),
+            complete: false,
+        }
+    }
+}
+
+impl Bus for ToHostRam {
+    fn read(&mut self, size: RvSize, addr: RvAddr) -> Result<RvData, BusError> {
+        self.ram.read(size, addr)
+    }
+
+    fn write(&mut self, size: RvSize, addr: RvAddr, val: RvData) -> Result<(), BusError> {
+        self.ram.write(size, addr, val)?;
+        if addr < TOHOST_ADDR + 4 && addr + usize::from(size) as RvAddr > TOHOST_ADDR {
+            self.complete = self.ram.read(RvSize::Word, TOHOST_ADDR)? != 0;
+        }
+        Ok(())
+    }
+}
+
+struct TestResult {
+    instructions: u64,
+    duration: Duration,
+}
+
+fn run_test(test: &TestInfo, work_dir: &Path) -> std::io::Result<TestResult> {
+    let binary = get_binary_data(test, work_dir.to_owned())?;
+    let reference_txt = get_signature_data(test, work_dir.to_owned())?;
+
+    let clock = Rc::new(Clock::new());
+    let pic = Rc::new(Pic::new());
+    let args = DEFAULT_CPU_ARGS;
+    let mut cpu = Cpu::new(ToHostRam::new(binary), clock, pic, args);
+    cpu.write_pc(0x3000);
+
+    let start = Instant::now();
+    let mut instructions = 0;
+    while !cpu.bus.complete {
+        instructions += 1;
+        match cpu.step(None) {
+            StepAction::Continue => continue,
+            _ => break,
+        }
+    }
+    let duration = start.elapsed();
+    if !cpu.bus.complete {
+        Err(std::io::Error::new(
+            ErrorKind::Other,
+            "test did not complete",
+        ))?;
+    }
+
+    check_reference_data(&reference_txt, &mut cpu.bus)?;
+    Ok(TestResult {
+        instructions,
+        duration,
+    })
 }
 
 fn main() -> Result<(), Box<dyn Error>> {
@@ -205,6 +277,7 @@ fn main() -> Result<(), Box<dyn Error>> {
         .arg(arg!(--riscof <FILE> "Path to riscof").required(false).default_value("riscof").value_parser(value_parser!(PathBuf)))
         .arg(arg!(--riscv_sim_rv32 <FILE> "Path to riscv_sim_RV32").required(false).default_value("riscv_sim_RV32").value_parser(value_parser!(PathBuf)))
         .arg(arg!(--spike <FILE> "Path to spike").required(false).default_value("spike").value_parser(value_parser!(PathBuf)))
+        .arg(arg!(--jobs <N> "Number of tests to run in parallel, defaults to the number of host cores").required(false).value_parser(value_parser!(usize)))
         .get_matches();
 
     set_var("RISCV_CC", args.get_one::<PathBuf>("compiler").unwrap());
@@ -224,37 +297,73 @@ fn main() -> Result<(), Box<dyn Error>> {
         temp_dir.path().to_owned(),
     )?;
 
-    for test in TESTS_TO_RUN.iter() {
-        println!("Running test {}/{}", test.extension, test.name);
-
-        let binary = get_binary_data(test, temp_dir.path().to_owned())?;
-        let reference_txt = get_signature_data(test, temp_dir.path().to_owned())?;
+    let jobs = args
+        .get_one::<usize>("jobs")
+        .copied()
+        .unwrap_or_else(|| thread::available_parallelism().map_or(1, |n| n.get()))
+        .max(1);
+    let next_test = AtomicUsize::new(0);
+    let results: Vec<_> = TESTS_TO_RUN.iter().map(|_| Mutex::new(None)).collect();
+    let start = Instant::now();
+    thread::scope(|scope| {
+        for _ in 0..jobs.min(TESTS_TO_RUN.len()) {
+            scope.spawn(|| loop {
+                let index = next_test.fetch_add(1, Ordering::Relaxed);
+                let Some(test) = TESTS_TO_RUN.get(index) else {
+                    break;
+                };
+                let result = run_test(test, temp_dir.path());
+                *results[index].lock().unwrap() = Some(result);
+            });
+        }
+    });
+    let wall_time = start.elapsed();
 
-        let clock = Rc::new(Clock::new());
-        let pic = Rc::new(Pic::new());
-        let args = DEFAULT_CPU_ARGS;
-        let mut cpu = Cpu::new(Ram::new(binary), clock, pic, args);
-        cpu.write_pc(0x3000);
-        while !is_test_complete(&mut cpu.bus) {
-            match cpu.step(None) {
-                StepAction::Continue => continue,
-                _ => break,
+    let mut failed = 0;
+    let mut total_instructions = 0;
+    let mut total_duration = Duration::ZERO;
+    for (test, result) in TESTS_TO_RUN.iter().zip(results) {
+        match result.into_inner().unwrap().unwrap() {
+            Ok(result) => {
+                println!(
+                    "PASSED {}/{}: {} instructions in {:.2?} ({:.2} MIPS)",
+                    test.extension,
+                    test.name,
+                    result.instructions,
+                    result.duration,
+                    mips(result.instructions, result.duration)
+                );
+                total_instructions += result.instructions;
+                total_duration += result.duration;
+            }
+            Err(err) => {
+                println!("FAILED {}/{}: {}", test.extension, test.name, err);
+                failed += 1;
             }
         }
-        if !is_test_complete(&mut cpu.bus) {
-            Err(std::io::Error::new(
-                ErrorKind::Other,
-                "test did not complete",
-            ))?;
-        }
-
-        check_reference_data(&reference_txt, &mut cpu.bus)?;
-        println!("PASSED");
-        drop(cpu);
+    }
+    println!(
+        "{} instructions in {:.2?} of CPU time ({:.2} MIPS), {:.2?} with {} jobs",
+        total_instructions,
+        total_duration,
+        mips(total_instructions, total_duration),
+        wall_time,
+        jobs
+    );
+    if failed > 0 {
+        Err(into_io_error(format!(
+            "{} of {} tests failed",
+            failed,
+            TESTS_TO_RUN.len()
+        )))?;
     }
     Ok(())
 }
 
+fn mips(instructions: u64, duration: Duration) -> f64 {
+    instructions as f64 / duration.as_secs_f64().max(f64::EPSILON) / 1e6
+}
+
 #[cfg(test)]
 mod tests {
     use std::rc::Rc;
@@ -286,4 +395,15 @@ mod tests {
             "At addr 0x1004, expected 0x07060502 but was 0x07060504"
         );
     }
+
+    #[test]
+    fn test_tohost_store_completes_test() {
+        let mut ram = ToHostRam::new(vec![0u8; 4096]);
+        ram.write(RvSize::Word, 0x8, 1).unwrap();
+        assert!(!ram.complete);
+        ram.write(RvSize::Byte, 0x2, 0).unwrap();
+        assert!(!ram.complete);
+        ram.write(RvSize::Byte, 0x3, 1).unwrap();
+        assert!(ram.complete);
+    }
 }
@@ -0,0 +1,279 @@
+/*++
+
+Licensed under the Apache-2.0 license.
+
+File Name:
+
+    deferred_log.rs
+
+Abstract:
+
+    Decoder of the log records sent by firmware built with the deferred-log feature of
+    romtime, which leaves the formatting of log messages to the host.
+
+    The record format is described in romtime/src/deferred_log.rs.
+
+--*/
+
+use std::collections::HashMap;
+
+const RECORD_MAGIC: u32 = 0xB1;
+const RECORD_DEFINE: u32 = 1;
+const RECORD_MESSAGE: u32 = 2;
+
+const ARG_U32: u32 = 1;
+const ARG_I32: u32 = 2;
+const ARG_U64: u32 = 3;
+const ARG_I64: u32 = 4;
+const ARG_BOOL: u32 = 5;
+const ARG_STR: u32 = 6;
+const ARG_HEX_BYTES: u32 = 7;
+const ARG_HEX_WORD: u32 = 8;
+
+#[derive(Debug, PartialEq)]
+enum LogArg {
+    Unsigned(u64),
+    /// Value and width in bits
+    Signed(i64, u32),
+    Bool(bool),
+    Str(String),
+    HexBytes(Vec<u8>),
+    HexWord(u32),
+}
+
+/// Rebuilds log lines from the words written by the firmware.
+#[derive(Default)]
+pub struct DeferredLogDecoder {
+    /// Format strings defined by the firmware, by address
+    formats: HashMap<u32, String>,
+    /// Words of the record being received, header included
+    record: Vec<u32>,
+}
+
+impl DeferredLogDecoder {
+    /// Adds the next word written by the firmware, returns the log line it completes.
+    pub fn push_word(&mut self, word: u32) -> Option<String> {
+        if self.record.is_empty() && word >> 24 != RECORD_MAGIC {
+            // Not a record header, wait for the next one
+            return None;
+        }
+        self.record.push(word);
+        let payload_words = (self.record[0] & 0xffff) as usize;
+        if self.record.len() <= payload_words {
+            return None;
+        }
+        let record = std::mem::take(&mut self.record);
+        let kind = (record[0] >> 16) & 0xff;
+        let payload = &record[1..];
+        match kind {
+            RECORD_DEFINE if payload.len() >= 2 => {
+                let len = payload[1] as usize;
+                let format = String::from_utf8_lossy(&unpack_bytes(&payload[2..], len)).into();
+                self.formats.insert(payload[0], format);
+                None
+            }
+            RECORD_MESSAGE if !payload.is_empty() => Some(self.format_message(payload)),
+            _ => Some(format!("<invalid log record {:#010x}>\n", record[0])),
+        }
+    }
+
+    fn format_message(&self, payload: &[u32]) -> String {
+        let Some(format) = self.formats.get(&payload[0]) else {
+            return format!("<undefined log message {:#010x}>\n", payload[0]);
+        };
+        match decode_args(&payload[1..]) {
+            Some(args) => format_line(format, &args),
+            None => format!("<invalid arguments for log message {:?}>\n", format),
+        }
+    }
+}
+
+fn unpack_bytes(words: &[u32], len: usize) -> Vec<u8> {
+    let mut bytes: Vec<u8> = words.iter().flat_map(|word| word.to_le_bytes()).collect();
+    bytes.truncate(len);
+    bytes
+}
+
+fn decode_args(mut words: &[u32]) -> Option<Vec<LogArg>> {
+    let mut args = vec![];
+    while let Some((&header, rest)) = words.split_first() {
+        let kind = header & 0xff;
+        let len = (header >> 8) as usize;
+        let data_words = len.div_ceil(4);
+        if rest.len() < data_words {
+            return None;
+        }
+        let (data, rest) = rest.split_at(data_words);
+        let double_word = || data[0] as u64 | (*data.get(1).unwrap_or(&0) as u64) << 32;
+        args.push(match kind {
+            ARG_U32 => LogArg::Unsigned(data[0] as u64),
+            ARG_I32 => LogArg::Signed(data[0] as i32 as i64, len.clamp(1, 4) as u32 * 8),
+            ARG_U64 => LogArg::Unsigned(double_word()),
+            ARG_I64 => LogArg::Signed(double_word() as i64, 64),
+            ARG_BOOL => LogArg::Bool(data[0] != 0),
+            ARG_STR => LogArg::Str(String::from_utf8_lossy(&unpack_bytes(data, len)).into()),
+            ARG_HEX_BYTES => LogArg::HexBytes(unpack_bytes(data, len)),
+            ARG_HEX_WORD => LogArg::HexWord(data[0]),
+            _ => return None,
+        });
+        words = rest;
+    }
+    Some(args)
+}
+
+/// Formats `args` as `format!` would with `format`, for the format specs used by firmware:
+/// an optional `#`, `0` and width, followed by `x`, `X`, `b` or `?`.
+fn format_line(format: &str, args: &[LogArg]) -> String {
+    let mut line = String::new();
+    let mut args = args.iter();
+    let mut chars = format.chars().peekable();
+    while let Some(c) = chars.next() {
+        match c {
+            '{' if chars.peek() == Some(&'{') => {
+                chars.next();
+                line.push('{');
+            }
+            '}' if chars.peek() == Some(&'}') => {
+                chars.next();
+                line.push('}');
+            }
+            '{' => {
+                let spec: String = chars.by_ref().take_while(|c| *c != '}').collect();
+                let spec = spec.split_once(':').map_or("", |(_, spec)| spec);
+                match args.next() {
+                    Some(arg) => line.push_str(&format_arg(arg, spec)),
+                    None => line.push_str("<missing argument>"),
+                }
+            }
+            c => line.push(c),
+        }
+    }
+    line.push('\n');
+    line
+}
+
+fn format_arg(arg: &LogArg, spec: &str) -> String {
+    let alternate = spec.starts_with('#');
+    let spec = spec.trim_start_matches('#');
+    let zero_pad = spec.starts_with('0');
+    let width_end = spec
+        .find(|c: char| !c.is_ascii_digit())
+        .unwrap_or(spec.len());
+    let width: usize = spec[..width_end].parse().unwrap_or(0);
+    let kind = &spec[width_end..];
+
+    let (prefix, digits) = match arg {
+        LogArg::Unsigned(value) => format_integer(*value, false, kind),
+        LogArg::Signed(value, _) if *value < 0 && kind.is_empty() => {
+            ("-", value.unsigned_abs().to_string())
+        }
+        // Like Rust, print the two's complement of negative values at the width of their type
+        LogArg::Signed(value, bits) if matches!(kind, "x" | "X" | "b") => {
+            format_integer(*value as u64 & u64::MAX >> (64 - bits), false, kind)
+        }
+        LogArg::Signed(value, _) => format_integer(*value as u64, true, kind),
+        LogArg::Bool(value) => ("", value.to_string()),
+        LogArg::Str(value) if kind == "?" => ("", format!("{:?}", value)),
+        LogArg::Str(value) => ("", value.clone()),
+        LogArg::HexBytes(bytes) => ("", bytes.iter().map(|b| format!("{:02X}", b)).collect()),
+        LogArg::HexWord(value) => ("", format!("{:08X}", value)),
+    };
+    let prefix = if alternate || prefix == "-" {
+        prefix
+    } else {
+        ""
+    };
+    let len = prefix.len() + digits.len();
+    if width <= len {
+        format!("{}{}", prefix, digits)
+    } else if zero_pad {
+        format!("{}{}{}", prefix, "0".repeat(width - len), digits)
+    } else if matches!(arg, LogArg::Str(_) | LogArg::Bool(_)) {
+        format!("{}{}", digits, " ".repeat(width - len))
+    } else {
+        format!("{}{}{}", " ".repeat(width - len), prefix, digits)
+    }
+}
+
+/// Returns the alternate-form prefix and the digits of `value` for the format `kind`.
+fn format_integer(value: u64, signed: bool, kind: &str) -> (&'static str, String) {
+    match kind {
+        "x" => ("0x", format!("{:x}", value)),
+        "X" => ("0x", format!("{:X}", value)),
+        "b" => ("0b", format!("{:b}", value)),
+        _ if signed => ("", (value as i64).to_string()),
+        _ => ("", value.to_string()),
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn header(kind: u32, payload_words: u32) -> u32 {
+        RECORD_MAGIC << 24 | kind << 16 | payload_words
+    }
+
+    #[test]
+    fn test_decode_messages() {
+        let mut decoder = DeferredLogDecoder::default();
+        let format = b"[mcu-rom] {} {:#010x} {} {}\0";
+        let mut words = vec![header(RECORD_DEFINE, 2 + 7), 0x8000_1000, 27];
+        words.extend(
+            format
+                .chunks(4)
+                .map(|chunk| u32::from_le_bytes(chunk.try_into().unwrap())),
+        );
+        for word in words {
+            assert_eq!(decoder.push_word(word), None);
+        }
+
+        let message = [
+            header(RECORD_MESSAGE, 9),
+            0x8000_1000,
+            ARG_I32 | 4 << 8,
+            -5i32 as u32,
+            ARG_U32 | 4 << 8,
+            0xabcd,
+            ARG_STR | 2 << 8,
+            u32::from_le_bytes(*b"ok\0\0"),
+            ARG_HEX_WORD | 4 << 8,
+            0x12,
+        ];
+        let lines: Vec<_> = message
+            .iter()
+            .filter_map(|word| decoder.push_word(*word))
+            .collect();
+        assert_eq!(lines, vec!["[mcu-rom] -5 0x0000abcd ok 00000012\n"]);
+
+        assert_eq!(
+            decoder.push_word(header(RECORD_MESSAGE, 1)),
+            None,
+            "waiting for the payload"
+        );
+        assert_eq!(
+            decoder.push_word(0x8000_2000),
+            Some("<undefined log message 0x80002000>\n".into())
+        );
+    }
+
+    #[test]
+    fn test_format_specs() {
+        assert_eq!(format_arg(&LogArg::Unsigned(255), "x"), "ff");
+        assert_eq!(format_arg(&LogArg::Unsigned(255), "#x"), "0xff");
+        assert_eq!(format_arg(&LogArg::Unsigned(255), "08X"), "000000FF");
+        assert_eq!(format_arg(&LogArg::Unsigned(7), "4"), "   7");
+        assert_eq!(format_arg(&LogArg::Bool(true), ""), "true");
+        assert_eq!(format_arg(&LogArg::HexBytes(vec![0xde, 0xad]), ""), "DEAD");
+        assert_eq!(format_line("{{}} {}", &[LogArg::Signed(-1, 32)]), "{} -1\n");
+        assert_eq!(
+            decode_args(&[ARG_I32 | 1 << 8, -1i32 as u32]),
+            Some(vec![LogArg::Signed(-1, 8)])
+        );
+        assert_eq!(format_arg(&LogArg::Signed(-1, 8), "x"), "ff");
+        assert_eq!(format_arg(&LogArg::Signed(-5, 32), "#x"), "0xfffffffb");
+        assert_eq!(format_arg(&LogArg::Signed(-2, 16), "b"), "1111111111111110");
+        assert_eq!(format_arg(&LogArg::Signed(-1, 64), "X"), "FFFFFFFFFFFFFFFF");
+        assert_eq!(format_arg(&LogArg::Signed(-7, 8), "4"), "  -7");
+    }
+}
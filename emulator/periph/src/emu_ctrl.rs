@@ -12,33 +12,68 @@ Abstract:
 
 --*/
 
-use caliptra_emu_bus::{Bus, BusError};
+use caliptra_emu_bus::{Bus, BusError, Clock, Timer};
 use caliptra_emu_types::{RvAddr, RvData, RvSize};
+use mcu_config::milestone::Milestone;
+use mcu_config_emulator::EMU_CTRL_MILESTONE;
+use std::cell::RefCell;
 use std::process::exit;
+use std::rc::Rc;
+
+/// Milestones reached by the firmware, with the cycle count at which they were reached.
+#[derive(Clone, Default)]
+pub struct MilestoneLog(Rc<RefCell<Vec<(Milestone, u64)>>>);
+
+impl MilestoneLog {
+    /// Returns the milestones recorded so far, in the order they were reached.
+    pub fn get(&self) -> Vec<(Milestone, u64)> {
+        self.0.borrow().clone()
+    }
+
+    fn record(&self, milestone: Milestone, cycles: u64) {
+        self.0.borrow_mut().push((milestone, cycles));
+    }
+}
 
 /// Emulation Control
-pub struct EmuCtrl {}
+pub struct EmuCtrl {
+    /// Called with the exit code before the emulator exits
+    exit_hooks: Vec<Box<dyn FnMut(u32)>>,
+    timer: Timer,
+    milestones: MilestoneLog,
+}
 
 impl EmuCtrl {
     // Exit emulator address
     const ADDR_EXIT: RvAddr = 0x0000_0000;
+    // Firmware milestone address
+    const ADDR_MILESTONE: RvAddr = EMU_CTRL_MILESTONE;
 
     /// Create an new instance of emulator control
     ///
     /// # Arguments
     ///
-    /// * `name` - Name of the device
-    pub fn new() -> Self {
-        Self {}
+    /// * `clock` - Clock used to timestamp the firmware milestones
+    pub fn new(clock: &Clock) -> Self {
+        Self {
+            exit_hooks: vec![],
+            timer: Timer::new(clock),
+            milestones: MilestoneLog::default(),
+        }
+    }
+
+    /// Returns the log of the milestones reached by the firmware.
+    pub fn milestones(&self) -> MilestoneLog {
+        self.milestones.clone()
+    }
+
+    /// Adds a function called with the exit code when the firmware exits the emulator.
+    pub fn add_exit_hook(&mut self, hook: impl FnMut(u32) + 'static) {
+        self.exit_hooks.push(Box::new(hook));
     }
     /// Memory map size.
     pub fn mmap_size(&self) -> RvAddr {
-        4
-    }
-}
-impl Default for EmuCtrl {
-    fn default() -> Self {
-        Self::new()
+        8
     }
 }
 
@@ -57,6 +92,7 @@ impl Bus for EmuCtrl {
     fn read(&mut self, size: RvSize, addr: RvAddr) -> Result<RvData, BusError> {
         match (size, addr) {
             (RvSize::Word, EmuCtrl::ADDR_EXIT) => Ok(0),
+            (RvSize::Word, EmuCtrl::ADDR_MILESTONE) => Ok(0),
             _ => Err(BusError::LoadAccessFault),
         }
     }
@@ -76,8 +112,15 @@ impl Bus for EmuCtrl {
     fn write(&mut self, _size: RvSize, addr: RvAddr, val: RvData) -> Result<(), BusError> {
         match addr {
             EmuCtrl::ADDR_EXIT => {
+                for hook in self.exit_hooks.iter_mut() {
+                    hook(val);
+                }
                 exit(val as i32);
             }
+            EmuCtrl::ADDR_MILESTONE => match Milestone::from_id(val) {
+                Some(milestone) => self.milestones.record(milestone, self.timer.now()),
+                None => println!("Unknown firmware milestone {}", val),
+            },
             _ => Err(BusError::StoreAccessFault)?,
         }
         Ok(())
@@ -26,7 +26,7 @@ use registers_generated::primary_flash_ctrl::bits::{
 use std::cell::RefCell;
 use std::fs::File;
 use std::io::{Read, Seek, Write};
-use std::path::PathBuf;
+use std::path::{Path, PathBuf};
 use std::rc::Rc;
 use tock_registers::interfaces::{ReadWriteable, Readable, Writeable};
 
@@ -71,6 +71,28 @@ pub enum FlashOpError {
     DmaRamAccessError = 4,
 }
 
+/// Log of the page operations completed by one or more flash controllers, one
+/// `<flash> <operation> <page>` line per operation. Lines are written as the operations
+/// complete, so the log is complete even if the emulator exits abruptly.
+#[derive(Clone)]
+pub struct FlashOpLog {
+    file: Rc<RefCell<File>>,
+}
+
+impl FlashOpLog {
+    pub fn create(path: &Path) -> std::io::Result<Self> {
+        Ok(Self {
+            file: Rc::new(RefCell::new(File::create(path)?)),
+        })
+    }
+
+    fn record(&self, flash: &str, op: &FlashOperation, page_num: u32) {
+        if let Err(err) = writeln!(self.file.borrow_mut(), "{} {:?} {}", flash, op, page_num) {
+            println!("Failed to write the flash operation log: {}", err);
+        }
+    }
+}
+
 /// A dummy flash controller peripheral for emulation purposes.
 pub struct DummyFlashCtrl {
     interrupt_state: ReadWriteRegister<u32, FlInterruptState::Register>,
@@ -90,6 +112,7 @@ pub struct DummyFlashCtrl {
     operation_start: Option<ActionHandle>,
     error_irq: Irq,
     event_irq: Irq,
+    op_log: Option<(&'static str, FlashOpLog)>,
 }
 
 impl DummyFlashCtrl {
@@ -180,9 +203,15 @@ impl DummyFlashCtrl {
             operation_start: None,
             error_irq,
             event_irq,
+            op_log: None,
         })
     }
 
+    /// Records the page operations of this controller to `log`, as the flash `name`.
+    pub fn set_op_log(&mut self, name: &'static str, log: FlashOpLog) {
+        self.op_log = Some((name, log));
+    }
+
     fn raise_interrupt(&mut self, interrupt_type: FlashCtrlIntType) {
         match interrupt_type {
             FlashCtrlIntType::Error => {
@@ -416,6 +445,9 @@ impl DummyFlashCtrl {
                     FlashOperation::WritePage => self.write_page(),
                     FlashOperation::ErasePage => self.erase_page(),
                 };
+                if let (Ok(()), Some((name, log))) = (&io_compl, &self.op_log) {
+                    log.record(name, &op, self.page_num.reg.get());
+                }
 
                 self.handle_io_completion(io_compl);
             }
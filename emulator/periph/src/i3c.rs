@@ -824,12 +824,12 @@ impl I3cPeripheral for I3c {
 
         let address: usize = address.try_into().unwrap();
         let range = address..(address + 4);
-        let data = &self.indirect_fifo_data.clone()[range];
+        let data = u32::from_be_bytes(self.indirect_fifo_data[range].try_into().unwrap());
         self.i3c_ec_sec_fw_recovery_if_indirect_fifo_status_2
             .reg
             .set(read_index + 1);
 
-        u32::from_be_bytes(data.try_into().unwrap())
+        data
     }
 
     fn read_i3c_ec_sec_fw_recovery_if_indirect_fifo_status_0(
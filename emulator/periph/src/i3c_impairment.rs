@@ -0,0 +1,272 @@
+/*++
+
+Licensed under the Apache-2.0 license.
+
+File Name:
+
+    i3c_impairment.rs
+
+Abstract:
+
+    Link impairment for the I3C bus command and response channels.
+
+    The I3C controller normally exchanges commands and responses with its clients
+    (the TCP socket bridge or in-process test code) with ideal delivery. To
+    reproduce the timing of real BMC links, the channels can be routed through a
+    relay that adds latency, jitter and a bandwidth cap, drops packets and corrupts
+    the PEC byte of private transfers. Packets are never reordered.
+
+--*/
+
+use crate::i3c_protocol::{I3cBusCommand, I3cBusResponse};
+use std::collections::VecDeque;
+use std::sync::mpsc::{self, Receiver, RecvTimeoutError, Sender};
+use std::thread;
+use std::time::{Duration, Instant};
+
+/// Size of the framing sent along with each command (address and descriptor).
+const COMMAND_HEADER_LEN: usize = 9;
+/// Size of the framing sent along with each response (IBI, address and descriptor).
+const RESPONSE_HEADER_LEN: usize = 6;
+const IDLE_POLL_INTERVAL: Duration = Duration::from_millis(10);
+
+/// Impairments applied to each direction of the I3C link.
+#[derive(Clone, Debug, Default)]
+pub struct I3cImpairment {
+    /// Fixed delay added to every packet
+    pub latency: Duration,
+    /// Upper bound of a uniformly distributed delay added on top of `latency`
+    pub jitter: Duration,
+    /// Link bandwidth in bits per second, unlimited if not set
+    pub bandwidth_bps: Option<u64>,
+    /// Probability in [0, 1] of a packet being dropped
+    pub drop_rate: f64,
+    /// Probability in [0, 1] of a private transfer having its PEC byte corrupted
+    pub pec_error_rate: f64,
+    /// Seed of the pseudo-random generator, so that a run can be reproduced
+    pub seed: u64,
+}
+
+impl I3cImpairment {
+    pub fn is_ideal(&self) -> bool {
+        self.latency.is_zero()
+            && self.jitter.is_zero()
+            && self.bandwidth_bps.is_none()
+            && self.drop_rate <= 0.0
+            && self.pec_error_rate <= 0.0
+    }
+
+    fn transmit_time(&self, len: usize) -> Duration {
+        match self.bandwidth_bps {
+            Some(bps) if bps > 0 => Duration::from_nanos(len as u64 * 8 * 1_000_000_000 / bps),
+            _ => Duration::ZERO,
+        }
+    }
+}
+
+/// Packets that can be carried over an impaired link.
+trait LinkPacket: Send + 'static {
+    fn wire_len(&self) -> usize;
+    /// Corrupts the trailing PEC byte, returns false if the packet does not carry one.
+    fn corrupt_pec(&mut self) -> bool;
+}
+
+impl LinkPacket for I3cBusCommand {
+    fn wire_len(&self) -> usize {
+        COMMAND_HEADER_LEN + self.cmd.data.len()
+    }
+
+    fn corrupt_pec(&mut self) -> bool {
+        self.cmd.data.last_mut().map(|pec| *pec ^= 0xff).is_some()
+    }
+}
+
+impl LinkPacket for I3cBusResponse {
+    fn wire_len(&self) -> usize {
+        RESPONSE_HEADER_LEN + self.resp.data.len()
+    }
+
+    fn corrupt_pec(&mut self) -> bool {
+        if self.ibi.is_some() {
+            return false;
+        }
+        self.resp.data.last_mut().map(|pec| *pec ^= 0xff).is_some()
+    }
+}
+
+/// Minimal xorshift generator, good enough to decide which packets to impair.
+struct XorShift64(u64);
+
+impl XorShift64 {
+    fn new(seed: u64) -> Self {
+        XorShift64(seed.max(1))
+    }
+
+    fn next_u64(&mut self) -> u64 {
+        self.0 ^= self.0 << 13;
+        self.0 ^= self.0 >> 7;
+        self.0 ^= self.0 << 17;
+        self.0
+    }
+
+    /// Returns a value uniformly distributed in [0, 1).
+    fn next_f64(&mut self) -> f64 {
+        (self.next_u64() >> 11) as f64 / (1u64 << 53) as f64
+    }
+}
+
+/// Routes the command and response channels of an I3C controller through an impaired link.
+///
+/// `rx` and `tx` are the channel ends normally given to `I3cController::new`, the returned
+/// ends should be given to it instead.
+pub fn impair_i3c_link(
+    rx: Receiver<I3cBusCommand>,
+    tx: Sender<I3cBusResponse>,
+    impairment: &I3cImpairment,
+) -> (Receiver<I3cBusCommand>, Sender<I3cBusResponse>) {
+    if impairment.is_ideal() {
+        return (rx, tx);
+    }
+    let (command_tx, command_rx) = mpsc::channel();
+    let (response_tx, response_rx) = mpsc::channel();
+    spawn_relay(rx, command_tx, impairment.clone(), impairment.seed);
+    // Use a different sequence for the other direction
+    spawn_relay(response_rx, tx, impairment.clone(), !impairment.seed);
+    (command_rx, response_tx)
+}
+
+fn spawn_relay<T: LinkPacket>(
+    input: Receiver<T>,
+    output: Sender<T>,
+    impairment: I3cImpairment,
+    seed: u64,
+) {
+    thread::spawn(move || {
+        let mut rng = XorShift64::new(seed);
+        let mut in_flight: VecDeque<(Instant, T)> = VecDeque::new();
+        // Time at which the link is done serializing the previous packet
+        let mut link_free_at = Instant::now();
+        let mut disconnected = false;
+
+        while !disconnected || !in_flight.is_empty() {
+            let now = Instant::now();
+            while in_flight.front().is_some_and(|(due, _)| *due <= now) {
+                let (_, packet) = in_flight.pop_front().unwrap();
+                if output.send(packet).is_err() {
+                    return;
+                }
+            }
+
+            let timeout = in_flight
+                .front()
+                .map(|(due, _)| due.saturating_duration_since(now))
+                .unwrap_or(IDLE_POLL_INTERVAL);
+            if disconnected {
+                thread::sleep(timeout);
+                continue;
+            }
+            let mut packet = match input.recv_timeout(timeout) {
+                Ok(packet) => packet,
+                Err(RecvTimeoutError::Timeout) => continue,
+                Err(RecvTimeoutError::Disconnected) => {
+                    disconnected = true;
+                    continue;
+                }
+            };
+
+            // The packet occupies the link even if it ends up being lost
+            let now = Instant::now();
+            link_free_at = link_free_at.max(now) + impairment.transmit_time(packet.wire_len());
+            if rng.next_f64() < impairment.drop_rate {
+                continue;
+            }
+            if rng.next_f64() < impairment.pec_error_rate {
+                packet.corrupt_pec();
+            }
+            let jitter = impairment.jitter.mul_f64(rng.next_f64());
+            let mut due = link_free_at + impairment.latency + jitter;
+            if let Some((last_due, _)) = in_flight.back() {
+                due = due.max(*last_due);
+            }
+            in_flight.push_back((due, packet));
+        }
+    });
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::i3c_protocol::{
+        I3cTcriCommand, I3cTcriCommandXfer, I3cTcriResponseXfer, ReguDataTransferCommand,
+    };
+    use zerocopy::FromBytes;
+
+    fn command(data: Vec<u8>) -> I3cBusCommand {
+        let mut cmd = ReguDataTransferCommand::read_from_bytes(&[0; 8]).unwrap();
+        cmd.set_data_length(data.len() as u16);
+        I3cBusCommand {
+            addr: 8.into(),
+            cmd: I3cTcriCommandXfer {
+                cmd: I3cTcriCommand::Regular(cmd),
+                data,
+            },
+        }
+    }
+
+    #[test]
+    fn test_latency_and_order() {
+        let (command_tx, command_rx) = mpsc::channel();
+        let (response_tx, _response_rx) = mpsc::channel::<I3cBusResponse>();
+        let impairment = I3cImpairment {
+            latency: Duration::from_millis(20),
+            jitter: Duration::from_millis(5),
+            ..Default::default()
+        };
+        let (rx, _tx) = impair_i3c_link(command_rx, response_tx, &impairment);
+
+        let start = Instant::now();
+        for i in 0..4 {
+            command_tx.send(command(vec![i, 0xaa])).unwrap();
+        }
+        for i in 0..4 {
+            let cmd = rx.recv_timeout(Duration::from_secs(1)).unwrap();
+            assert_eq!(cmd.cmd.data[0], i);
+        }
+        assert!(start.elapsed() >= impairment.latency);
+    }
+
+    #[test]
+    fn test_pec_corruption() {
+        let (_command_tx, command_rx) = mpsc::channel();
+        let (response_tx, response_rx) = mpsc::channel::<I3cBusResponse>();
+        let impairment = I3cImpairment {
+            pec_error_rate: 1.0,
+            ..Default::default()
+        };
+        let (_rx, tx) = impair_i3c_link(command_rx, response_tx, &impairment);
+        tx.send(I3cBusResponse {
+            ibi: None,
+            addr: 8.into(),
+            resp: I3cTcriResponseXfer {
+                resp: Default::default(),
+                data: vec![0x12, 0x34],
+            },
+        })
+        .unwrap();
+        let resp = response_rx.recv_timeout(Duration::from_secs(1)).unwrap();
+        assert_eq!(resp.resp.data, vec![0x12, 0x34 ^ 0xff]);
+    }
+
+    #[test]
+    fn test_drop() {
+        let (command_tx, command_rx) = mpsc::channel();
+        let (response_tx, _response_rx) = mpsc::channel::<I3cBusResponse>();
+        let impairment = I3cImpairment {
+            drop_rate: 1.0,
+            ..Default::default()
+        };
+        let (rx, _tx) = impair_i3c_link(command_rx, response_tx, &impairment);
+        command_tx.send(command(vec![1, 2])).unwrap();
+        assert!(rx.recv_timeout(Duration::from_millis(100)).is_err());
+    }
+}
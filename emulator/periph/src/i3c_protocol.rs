@@ -103,6 +103,22 @@ impl I3cController {
             });
     }
 
+    /// Processes every pending incoming command, then sends the responses of the targets,
+    /// without blocking. This lets the caller drive the controller at chosen points instead
+    /// of from a free-running thread. Returns the responses sent.
+    pub fn run_pending(&mut self) -> Vec<I3cBusResponse> {
+        while let Some(cmd) = self.rx.as_ref().and_then(|rx| rx.try_recv().ok()) {
+            I3cController::incoming(self.targets.clone(), self.incoming_counter.clone(), cmd);
+        }
+        let responses = I3cController::tcri_receive_all(self.targets.clone());
+        responses.iter().for_each(|resp| {
+            if let Some(tx) = self.tx.as_ref() {
+                tx.send(resp.clone()).unwrap();
+            }
+        });
+        responses
+    }
+
     /// Processes a single incoming command and relays it to the appropriate target device.
     fn incoming(
         targets: Arc<Mutex<Vec<I3cTarget>>>,
@@ -534,9 +550,15 @@ mod test {
             addr: DynamicI3cAddress::new(8).unwrap(),
             cmd: xfer,
         };
-        to_target.0.send(cmd).unwrap();
+        to_target.0.send(cmd.clone()).unwrap();
 
         controller.run_once();
         assert_eq!(1, controller.incoming_counter.load(Ordering::Relaxed));
+
+        // run_pending drains every queued command at once
+        to_target.0.send(cmd.clone()).unwrap();
+        to_target.0.send(cmd).unwrap();
+        controller.run_pending();
+        assert_eq!(3, controller.incoming_counter.load(Ordering::Relaxed));
     }
 }
@@ -11,11 +11,13 @@ Abstract:
     File contains exports for for Caliptra Emulator Peripheral library.
 
 --*/
+mod deferred_log;
 mod dma_ctrl;
 mod doe_mbox;
 mod emu_ctrl;
 mod flash_ctrl;
 mod i3c;
+mod i3c_impairment;
 pub(crate) mod i3c_protocol;
 mod lc_ctrl;
 mod mci;
@@ -27,11 +29,13 @@ mod spi_flash;
 mod spi_host;
 mod uart;
 
+pub use deferred_log::DeferredLogDecoder;
 pub use dma_ctrl::DummyDmaCtrl;
 pub use doe_mbox::{DoeMboxPeriph, DummyDoeMbox};
-pub use emu_ctrl::EmuCtrl;
-pub use flash_ctrl::DummyFlashCtrl;
+pub use emu_ctrl::{EmuCtrl, MilestoneLog};
+pub use flash_ctrl::{DummyFlashCtrl, FlashOpLog};
 pub use i3c::I3c;
+pub use i3c_impairment::{impair_i3c_link, I3cImpairment};
 pub use i3c_protocol::*;
 pub use lc_ctrl::LcCtrl;
 pub use mci::Mci;
@@ -21,6 +21,7 @@ use emulator_consts::{
     DIRECT_READ_FLASH_ORG, DIRECT_READ_FLASH_SIZE, EXTERNAL_TEST_SRAM_SIZE, RAM_SIZE,
     ROM_DEDICATED_RAM_ORG, ROM_DEDICATED_RAM_SIZE,
 };
+use mcu_config_emulator::{EMU_CTRL_OFFSET, EMU_UART_OFFSET};
 use std::{
     cell::RefCell,
     path::PathBuf,
@@ -54,10 +55,10 @@ impl Default for McuRootBusOffsets {
         Self {
             rom_offset: 0,
             rom_size: 0xc000,
-            uart_offset: 0x1000_1000,
+            uart_offset: EMU_UART_OFFSET,
             uart_size: 0x100,
-            ctrl_offset: 0x1000_2000,
-            ctrl_size: 0x4,
+            ctrl_offset: EMU_CTRL_OFFSET,
+            ctrl_size: 0x8,
             spi_offset: 0x2000_0000,
             spi_size: 0x40,
             ram_offset: 0x4000_0000,
@@ -129,7 +130,7 @@ impl McuRootBus {
             rom_sram: Rc::new(RefCell::new(rom_sram)),
             spi: SpiHost::new(&clock.clone()),
             uart: Uart::new(args.uart_output, args.uart_rx, uart_irq, &clock.clone()),
-            ctrl: EmuCtrl::new(),
+            ctrl: EmuCtrl::new(&clock),
             pic_regs: pic.mmio_regs(clock.clone()),
             event_sender: None,
             external_test_sram: Rc::new(RefCell::new(external_test_sram)),
@@ -318,11 +319,11 @@ impl Bus for McuRootBus {
         self.ram.borrow_mut().incoming_event(event.clone());
         self.pic_regs.incoming_event(event.clone());
 
-        if let (Device::MCU, EventData::MemoryRead { start_addr, len }) =
-            (event.dest, event.event.clone())
+        if let (Device::MCU, EventData::MemoryRead { start_addr, len }) = (event.dest, &event.event)
         {
+            let start_addr = *start_addr;
             let start = start_addr as usize;
-            let len = len as usize;
+            let len = *len as usize;
             if start >= RAM_SIZE as usize || start + len >= RAM_SIZE as usize {
                 println!(
                     "Ignoring invalid MCU RAM read from {}..{}",
@@ -350,9 +351,9 @@ impl Bus for McuRootBus {
         }
 
         if let (Device::MCU, EventData::MemoryWrite { start_addr, data }) =
-            (event.dest, event.event.clone())
+            (event.dest, &event.event)
         {
-            let start = start_addr as usize;
+            let start = *start_addr as usize;
             if start >= RAM_SIZE as usize || start + data.len() >= RAM_SIZE as usize {
                 println!(
                     "Ignoring invalid MCU RAM write to {}..{}",
@@ -368,10 +369,11 @@ impl Bus for McuRootBus {
         }
 
         if let (Device::ExternalTestSram, EventData::MemoryRead { start_addr, len }) =
-            (event.dest, event.event.clone())
+            (event.dest, &event.event)
         {
+            let start_addr = *start_addr;
             let start = start_addr as usize;
-            let len = len as usize;
+            let len = *len as usize;
             if start >= EXTERNAL_TEST_SRAM_SIZE as usize
                 || start + len >= EXTERNAL_TEST_SRAM_SIZE as usize
             {
@@ -12,9 +12,11 @@ Abstract:
 
 --*/
 
+use crate::deferred_log::DeferredLogDecoder;
 use caliptra_emu_bus::{Bus, BusError, Clock, Timer};
 use caliptra_emu_cpu::Irq;
 use caliptra_emu_types::{RvAddr, RvData, RvSize};
+use mcu_config_emulator::EMU_UART_LOG_DATA;
 use std::cell::{Cell, RefCell};
 use std::io::Write;
 use std::rc::Rc;
@@ -30,6 +32,7 @@ pub struct Uart {
     byte_last_irq_triggered: Cell<u64>,
     irq: Irq,
     timer: Timer,
+    deferred_log: DeferredLogDecoder,
 }
 
 impl Uart {
@@ -48,6 +51,9 @@ impl Uart {
     /// Transmit Data Register
     const ADDR_TX_DATA: RvAddr = 0x00000041;
 
+    /// Deferred Log Data Register, written with the log records of romtime's deferred-log
+    const ADDR_LOG_DATA: RvAddr = EMU_UART_LOG_DATA;
+
     pub fn new(
         output: Option<Rc<RefCell<Vec<u8>>>>,
         input: Option<Arc<Mutex<Option<u8>>>>,
@@ -64,6 +70,14 @@ impl Uart {
             bytes_read: Cell::new(0),
             byte_last_irq_triggered: Cell::new(u64::MAX),
             timer: Timer::new(clock),
+            deferred_log: DeferredLogDecoder::default(),
+        }
+    }
+
+    fn print(&self, s: &str) {
+        match &self.output {
+            Some(output) => write!(output.borrow_mut(), "{}", s).unwrap(),
+            None => eprint!("{}", s),
         }
     }
 
@@ -141,10 +155,14 @@ impl Bus for Uart {
             (RvSize::Byte, Uart::ADDR_BIT_RATE) => self.bit_rate = value as u8,
             (RvSize::Byte, Uart::ADDR_DATA_BITS) => self.data_bits = value as u8,
             (RvSize::Byte, Uart::ADDR_STOP_BITS) => self.stop_bits = value as u8,
-            (RvSize::Byte, Uart::ADDR_TX_DATA) => match &self.output {
-                Some(output) => write!(output.borrow_mut(), "{}", value as u8 as char).unwrap(),
-                None => eprint!("{}", value as u8 as char),
-            },
+            (RvSize::Byte, Uart::ADDR_TX_DATA) => {
+                self.print((value as u8 as char).encode_utf8(&mut [0; 4]))
+            }
+            (RvSize::Word, Uart::ADDR_LOG_DATA) => {
+                if let Some(line) = self.deferred_log.push_word(value) {
+                    self.print(&line);
+                }
+            }
             _ => Err(BusError::StoreAccessFault)?,
         }
         Ok(())
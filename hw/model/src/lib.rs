@@ -14,6 +14,7 @@ use caliptra_hw_model_types::{
 use caliptra_registers::soc_ifc::regs::{
     CptraItrngEntropyConfig0WriteVal, CptraItrngEntropyConfig1WriteVal,
 };
+pub use mcu_config::milestone::Milestone;
 pub use model_emulated::ModelEmulated;
 use output::ExitStatus;
 pub use output::Output;
@@ -250,6 +251,12 @@ pub trait McuHwModel {
 
     fn cycle_count(&mut self) -> u64;
 
+    /// Firmware milestones reached so far, with the cycle count at which they were
+    /// reached. Models that cannot observe them return no milestones.
+    fn milestones(&mut self) -> Vec<(Milestone, u64)> {
+        vec![]
+    }
+
     /// Any UART-ish output written by the microcontroller will be available here.
     fn output(&mut self) -> &mut Output;
 
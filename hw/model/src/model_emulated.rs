@@ -5,6 +5,7 @@ use crate::bus_logger::LogFile;
 use crate::trace_path_or_env;
 use crate::InitParams;
 use crate::McuHwModel;
+use crate::Milestone;
 use crate::Output;
 use anyhow::Result;
 use caliptra_emu_bus::{Clock, Event};
@@ -15,7 +16,7 @@ use caliptra_emu_periph::{
 use caliptra_hw_model::ModelError;
 use caliptra_hw_model_types::ErrorInjectionMode;
 use caliptra_image_types::IMAGE_MANIFEST_BYTE_SIZE;
-use emulator_periph::{I3c, I3cController, Mci, McuRootBus, McuRootBusArgs, Otp};
+use emulator_periph::{I3c, I3cController, Mci, McuRootBus, McuRootBusArgs, MilestoneLog, Otp};
 use emulator_registers_generated::root_bus::AutoRootBus;
 use semver::Version;
 use std::cell::Cell;
@@ -46,6 +47,7 @@ pub struct ModelEmulated {
     events_to_caliptra: mpsc::Sender<Event>,
     events_from_caliptra: mpsc::Receiver<Event>,
     collected_events_from_caliptra: Vec<Event>,
+    milestones: MilestoneLog,
 }
 
 fn hash_slice(slice: &[u8]) -> u64 {
@@ -141,6 +143,7 @@ impl McuHwModel for ModelEmulated {
             ..Default::default()
         };
         let mcu_root_bus = McuRootBus::new(bus_args).unwrap();
+        let milestones = mcu_root_bus.ctrl.milestones();
         let mut i3c_controller = I3cController::default();
         let i3c_irq = pic.register_irq(McuRootBus::I3C_IRQ);
         let i3c = I3c::new(
@@ -194,6 +197,7 @@ impl McuHwModel for ModelEmulated {
             events_to_caliptra,
             events_from_caliptra,
             collected_events_from_caliptra: vec![],
+            milestones,
         };
         // Turn tracing on if the trace path was set
         m.tracing_hint(true);
@@ -273,6 +277,10 @@ impl McuHwModel for ModelEmulated {
         self.cpu.clock.now()
     }
 
+    fn milestones(&mut self) -> Vec<(Milestone, u64)> {
+        self.milestones.get()
+    }
+
     fn save_otp_memory(&self, _path: &Path) -> Result<()> {
         unimplemented!()
     }
@@ -4,6 +4,8 @@
 
 #[cfg(target_arch = "riscv32")]
 pub mod pmp_config;
+#[cfg_attr(not(target_arch = "riscv32"), allow(dead_code))]
+mod pmp_layout;
 
 #[macro_export]
 macro_rules! read_volatile_at {
@@ -1,19 +1,13 @@
 // Licensed under the Apache-2.0 license
 
+pub use crate::pmp_layout::PlatformRegion;
+use crate::pmp_layout::{
+    choose_napot_memory_regions, coalesce_regions_in_place, optimize_mmio_napot,
+    region_overlaps_memory_area, regions_overlap,
+};
 use mcu_config::McuMemoryMap;
-use mcu_tock_veer::pmp::PMPRegionList;
-
-/// Input from platform: a memory region with its properties
-#[derive(Debug, Clone, Copy)]
-pub struct PlatformRegion {
-    pub start_addr: *const u8,
-    pub size: usize,
-    pub is_mmio: bool,
-    pub user_accessible: bool,
-    pub read: bool,
-    pub write: bool,
-    pub execute: bool,
-}
+use mcu_tock_veer::pmp::{PMPRegionList, RegionSpec};
+use rv32i::pmp::{NAPOTRegionSpec, TORRegionSpec};
 
 /// Input configuration from platform
 pub struct PlatformPMPConfig<'a> {
@@ -23,155 +17,18 @@ pub struct PlatformPMPConfig<'a> {
     pub memory_map: &'a McuMemoryMap,
 }
 
-/// Check if two regions overlap
-fn regions_overlap(region_a: &PlatformRegion, region_b: &PlatformRegion) -> bool {
-    let start_a = region_a.start_addr as usize;
-    let end_a = start_a + region_a.size;
-    let start_b = region_b.start_addr as usize;
-    let end_b = start_b + region_b.size;
-
-    // Regions overlap if: start_a < end_b && start_b < end_a
-    start_a < end_b && start_b < end_a
-}
-
-/// Check if a platform region overlaps with a memory area defined by offset/size
-fn region_overlaps_memory_area(region: PlatformRegion, mem_offset: u32, mem_size: u32) -> bool {
-    let region_start = region.start_addr as usize;
-    let region_end = region_start + region.size;
-    let mem_start = mem_offset as usize;
-    let mem_end = mem_start + (mem_size as usize);
-
-    // Regions overlap if: region_start < mem_end && mem_start < region_end
-    region_start < mem_end && mem_start < region_end
-}
-
-/// Try to upgrade an MMIO region to NAPOT format by expanding its size
-fn try_convert_to_napot(region: PlatformRegion) -> Result<PlatformRegion, PlatformRegion> {
-    if !region.is_mmio {
-        return Err(region); // Only convert MMIO regions
-    }
-
-    let start = region.start_addr as usize;
-    let original_size = region.size;
-
-    // Start address cannot be 0
-    if start == 0 {
-        return Err(region);
-    }
-
-    // Find the largest power-of-2 that start address is naturally aligned to
-    // This gives us the maximum possible NAPOT size for this start address
-    let max_alignment = start & (start.wrapping_neg()); // Extract lowest set bit (largest power-of-2 factor)
-
-    // Find the smallest power-of-2 size that is >= original_size
-    let mut napot_size = 1;
-    while napot_size < original_size {
-        napot_size <<= 1;
-    }
-
-    // NAPOT size cannot exceed the natural alignment of the start address
-    if napot_size > max_alignment {
-        return Err(region); // Cannot create a valid NAPOT region
-    }
-
-    // Create expanded NAPOT region
-    let napot_region = PlatformRegion {
-        start_addr: region.start_addr,
-        size: napot_size,
-        is_mmio: region.is_mmio,
-        user_accessible: region.user_accessible,
-        read: region.read,
-        write: region.write,
-        execute: region.execute,
-    };
-
-    Ok(napot_region)
-}
-
-/// Convert MMIO regions to NAPOT where possible (best effort)
-fn optimize_mmio_napot(regions: &mut [Option<PlatformRegion>; 32], region_count: usize) -> usize {
-    // Try to convert each MMIO region to NAPOT (best effort)
-    for i in 0..region_count {
-        if let Some(original_region) = regions[i] {
-            if original_region.is_mmio {
-                if let Ok(napot_region) = try_convert_to_napot(original_region) {
-                    // Temporarily set the NAPOT version
-                    regions[i] = Some(napot_region);
-
-                    // Check if this NAPOT version overlaps with any other MMIO region
-                    let mut has_overlap = false;
-                    for j in 0..region_count {
-                        if i != j {
-                            if let Some(other_region) = regions[j] {
-                                if other_region.is_mmio
-                                    && regions_overlap(&napot_region, &other_region)
-                                {
-                                    has_overlap = true;
-                                    break;
-                                }
-                            }
-                        }
-                    }
-
-                    if has_overlap {
-                        // Revert to original region if NAPOT causes overlap
-                        regions[i] = Some(original_region);
-                    }
-                    // Otherwise keep the NAPOT version
-                }
-                // If conversion fails, keep original region
-            }
-        }
-    }
-
-    region_count
-}
-
-/// Coalesce adjacent regions with identical properties in-place
-fn coalesce_regions_in_place(
-    regions: &mut [Option<PlatformRegion>; 32],
-    region_count: usize,
-) -> usize {
-    if region_count <= 1 {
-        return region_count;
-    }
-
-    let mut write_pos = 0;
-    let mut current_region = regions[0].unwrap();
-
-    for read_pos in 1..region_count {
-        let next_region = regions[read_pos].unwrap();
-
-        // Check if regions are adjacent and have same properties
-        let regions_adjacent =
-            unsafe { current_region.start_addr.add(current_region.size) == next_region.start_addr };
-        let same_properties = current_region.is_mmio == next_region.is_mmio
-            && current_region.user_accessible == next_region.user_accessible
-            && current_region.read == next_region.read
-            && current_region.write == next_region.write
-            && current_region.execute == next_region.execute;
-
-        if regions_adjacent && same_properties {
-            // Extend current region to include next region
-            current_region.size += next_region.size;
-        } else {
-            // Write current region and start new one
-            regions[write_pos] = Some(current_region);
-            write_pos += 1;
-            current_region = next_region;
+/// Address range of a non-MMIO region, as NAPOT or TOR.
+fn memory_region_spec(region: &PlatformRegion, napot: bool) -> Result<RegionSpec, ()> {
+    if napot {
+        if let Some(spec) = NAPOTRegionSpec::new(region.start_addr, region.size) {
+            return Ok(RegionSpec::NAPOT(spec));
         }
     }
-
-    // Don't forget the last region
-    regions[write_pos] = Some(current_region);
-    write_pos += 1;
-
-    // Clear any remaining slots
-    for i in write_pos..region_count {
-        regions[i] = None;
-    }
-
-    write_pos
+    TORRegionSpec::new(region.start_addr, unsafe {
+        region.start_addr.add(region.size)
+    })
+    .map(RegionSpec::TOR)
+    .ok_or(())
 }
 
 /// Convert processed platform regions to PMP regions and add them to the list
@@ -179,86 +36,58 @@ fn convert_platform_regions_to_pmp(
     pmp_list: &mut PMPRegionList,
     platform_regions: &[Option<PlatformRegion>],
 ) -> Result<(), ()> {
-    // Do the kernel text region first
-    for region_opt in platform_regions.iter() {
-        let platform_region = region_opt.as_ref().unwrap();
-
-        // Convert PlatformRegion to appropriate PMPRegion variant
-        match (
-            platform_region.is_mmio,
-            platform_region.user_accessible,
-            platform_region.read,
-            platform_region.write,
-            platform_region.execute,
-        ) {
-            // Non-MMIO regions: Read + Execute (KernelText)
-            (false, _, true, false, true) => {
-                // TODO: Consider trying NAPOT format first for code regions (more efficient - 1 PMP entry vs 2)
-                //       and fall back to TOR if alignment/size requirements aren't met
-                use mcu_tock_veer::pmp::KernelTextRegion;
-                use rv32i::pmp::TORRegionSpec;
-
-                let tor_spec = TORRegionSpec::new(platform_region.start_addr, unsafe {
-                    platform_region.start_addr.add(platform_region.size)
-                })
-                .ok_or(())?;
-
-                // Add the converted region to the list
-                pmp_list.add_region(mcu_tock_veer::pmp::PMPRegion::KernelText(
-                    KernelTextRegion(tor_spec),
-                ))?;
+    // Kernel text regions go first, then the other memories
+    let is_kernel_text =
+        |region: &PlatformRegion| !region.is_mmio && region.read && !region.write && region.execute;
+    let mut memory_regions = [PlatformRegion {
+        start_addr: core::ptr::null(),
+        size: 0,
+        is_mmio: false,
+        user_accessible: false,
+        read: false,
+        write: false,
+        execute: false,
+    }; 32];
+    let mut memory_count = 0;
+    for kernel_text in [true, false] {
+        for platform_region in platform_regions.iter().flatten() {
+            if !platform_region.is_mmio && is_kernel_text(platform_region) == kernel_text {
+                memory_regions[memory_count] = *platform_region;
+                memory_count += 1;
             }
-            _ => {}
-        };
+        }
     }
+    let memory_regions = &memory_regions[..memory_count];
+    let mut napot = [false; 32];
+    choose_napot_memory_regions(memory_regions, &mut napot);
 
-    // Next do memories.
-    for region_opt in platform_regions {
-        let platform_region = region_opt.unwrap();
+    for (platform_region, napot) in memory_regions.iter().zip(napot) {
+        let spec = memory_region_spec(platform_region, napot)?;
 
         // Convert PlatformRegion to appropriate PMPRegion variant
         let pmp_region = match (
-            platform_region.is_mmio,
-            platform_region.user_accessible,
             platform_region.read,
             platform_region.write,
             platform_region.execute,
         ) {
+            // Non-MMIO regions: Read + Execute (KernelText)
+            (true, false, true) => mcu_tock_veer::pmp::PMPRegion::KernelText(
+                mcu_tock_veer::pmp::KernelTextRegion(spec),
+            ),
             // Non-MMIO regions: Read + Write (Data)
-            (false, _, true, true, false) => {
-                use mcu_tock_veer::pmp::DataRegion;
-                use rv32i::pmp::TORRegionSpec;
-
-                let tor_spec = TORRegionSpec::new(platform_region.start_addr, unsafe {
-                    platform_region.start_addr.add(platform_region.size)
-                })
-                .ok_or(())?;
-
-                Some(mcu_tock_veer::pmp::PMPRegion::Data(DataRegion(tor_spec)))
+            (true, true, false) => {
+                mcu_tock_veer::pmp::PMPRegion::Data(mcu_tock_veer::pmp::DataRegion(spec))
             }
-
             // Non-MMIO regions: Read only (ReadOnly)
-            (false, _, true, false, false) => {
-                use mcu_tock_veer::pmp::ReadOnlyRegion;
-                use rv32i::pmp::TORRegionSpec;
-
-                let tor_spec = TORRegionSpec::new(platform_region.start_addr, unsafe {
-                    platform_region.start_addr.add(platform_region.size)
-                })
-                .ok_or(())?;
-
-                Some(mcu_tock_veer::pmp::PMPRegion::ReadOnly(ReadOnlyRegion(
-                    tor_spec,
-                )))
+            (true, false, false) => {
+                mcu_tock_veer::pmp::PMPRegion::ReadOnly(mcu_tock_veer::pmp::ReadOnlyRegion(spec))
             }
-
-            _ => None,
+            // Invalid combinations are reported with the MMIO regions
+            _ => continue,
         };
 
         // Add the converted region to the list
-        if let Some(pmp_region) = pmp_region {
-            pmp_list.add_region(pmp_region)?;
-        }
+        pmp_list.add_region(pmp_region)?;
     }
 
     // Finally do MMIO regions.
@@ -598,8 +427,14 @@ pub fn create_pmp_regions(config: PlatformPMPConfig<'_>) -> Result<PMPRegionList
     // Step 4: Coalesce adjacent regions with identical properties in-place
     let coalesced_count = coalesce_regions_in_place(&mut all_regions, region_count);
 
-    // Step 5: Optimize MMIO regions to NAPOT format where possible (best effort)
-    let final_count = optimize_mmio_napot(&mut all_regions, coalesced_count);
+    // Step 5: Optimize MMIO regions to NAPOT format where possible (best effort),
+    // without covering any memory
+    let memory_areas = [
+        (memory_map.rom_offset, memory_map.rom_size),
+        (memory_map.sram_offset, memory_map.sram_size),
+        (memory_map.dccm_offset, memory_map.dccm_size),
+    ];
+    let final_count = optimize_mmio_napot(&mut all_regions, coalesced_count, &memory_areas);
 
     // Step 6: Convert processed platform regions to PMP regions
     let mut pmp_list = PMPRegionList::new();
@@ -0,0 +1,736 @@
+// Licensed under the Apache-2.0 license
+
+//! Layout of the platform regions in the PMP: which regions are merged, and
+//! how each is encoded, independent of the PMP driver so it can be tested on
+//! the host.
+
+use mcu_tock_veer::pmp_layout::{self, EncodedRange, Encoding};
+
+/// Input from platform: a memory region with its properties
+#[derive(Debug, Clone, Copy)]
+pub struct PlatformRegion {
+    pub start_addr: *const u8,
+    pub size: usize,
+    pub is_mmio: bool,
+    pub user_accessible: bool,
+    pub read: bool,
+    pub write: bool,
+    pub execute: bool,
+}
+
+/// Check if two regions overlap
+pub(crate) fn regions_overlap(region_a: &PlatformRegion, region_b: &PlatformRegion) -> bool {
+    let start_a = region_a.start_addr as usize;
+    let end_a = start_a + region_a.size;
+    let start_b = region_b.start_addr as usize;
+    let end_b = start_b + region_b.size;
+
+    // Regions overlap if: start_a < end_b && start_b < end_a
+    start_a < end_b && start_b < end_a
+}
+
+/// Check if a platform region overlaps with a memory area defined by offset/size
+pub(crate) fn region_overlaps_memory_area(
+    region: PlatformRegion,
+    mem_offset: u32,
+    mem_size: u32,
+) -> bool {
+    let region_start = region.start_addr as usize;
+    let region_end = region_start + region.size;
+    let mem_start = mem_offset as usize;
+    let mem_end = mem_start + (mem_size as usize);
+
+    // Regions overlap if: region_start < mem_end && mem_start < region_end
+    region_start < mem_end && mem_start < region_end
+}
+
+/// Try to upgrade an MMIO region to NAPOT format by expanding its size
+fn try_convert_to_napot(region: PlatformRegion) -> Result<PlatformRegion, PlatformRegion> {
+    if !region.is_mmio {
+        return Err(region); // Only convert MMIO regions
+    }
+
+    let start = region.start_addr as usize;
+    let original_size = region.size;
+
+    // Start address cannot be 0
+    if start == 0 {
+        return Err(region);
+    }
+
+    // Find the largest power-of-2 that start address is naturally aligned to
+    // This gives us the maximum possible NAPOT size for this start address
+    let max_alignment = start & (start.wrapping_neg()); // Extract lowest set bit (largest power-of-2 factor)
+
+    // Find the smallest power-of-2 size that is >= original_size
+    let mut napot_size = 1;
+    while napot_size < original_size {
+        napot_size <<= 1;
+    }
+
+    // NAPOT size cannot exceed the natural alignment of the start address
+    if napot_size > max_alignment {
+        return Err(region); // Cannot create a valid NAPOT region
+    }
+
+    // Create expanded NAPOT region
+    let napot_region = PlatformRegion {
+        start_addr: region.start_addr,
+        size: napot_size,
+        is_mmio: region.is_mmio,
+        user_accessible: region.user_accessible,
+        read: region.read,
+        write: region.write,
+        execute: region.execute,
+    };
+
+    Ok(napot_region)
+}
+
+/// Check if two regions have the same type and permissions
+fn same_properties(region_a: &PlatformRegion, region_b: &PlatformRegion) -> bool {
+    region_a.is_mmio == region_b.is_mmio
+        && region_a.user_accessible == region_b.user_accessible
+        && region_a.read == region_b.read
+        && region_a.write == region_b.write
+        && region_a.execute == region_b.execute
+}
+
+/// Smallest NAPOT range (start, size) containing start..end
+fn napot_cover(start: usize, end: usize) -> Option<(usize, usize)> {
+    let mut size = (end - start).next_power_of_two().max(8);
+    loop {
+        let napot_start = start & !(size - 1);
+        if napot_start.checked_add(size)? >= end {
+            return Some((napot_start, size));
+        }
+        size = size.checked_mul(2)?;
+    }
+}
+
+/// Replace the MMIO regions at `sources` by `napot` if this gives no access to
+/// anything else: other MMIO regions must have the same properties and be
+/// contained in `napot`, and are then removed too. With `check_memory`, for a
+/// `napot` grown beyond its sources, `napot` must not overlap memory (non-MMIO
+/// regions or `memory_areas`) that the sources did not already overlap, and a
+/// user-accessible `napot` must be entirely made of the regions it replaces, so
+/// that user mode is not given access to unlisted addresses.
+fn try_replace_mmio(
+    regions: &mut [Option<PlatformRegion>; 32],
+    region_count: usize,
+    sources: &[usize],
+    napot: PlatformRegion,
+    memory_areas: &[(u32, u32)],
+    check_memory: bool,
+) -> bool {
+    let new_memory_overlap = |overlaps: &dyn Fn(&PlatformRegion) -> bool| {
+        check_memory
+            && overlaps(&napot)
+            && !sources
+                .iter()
+                .any(|&i| regions[i].as_ref().is_some_and(|region| overlaps(region)))
+    };
+    if memory_areas.iter().any(|&(offset, size)| {
+        new_memory_overlap(&|region: &PlatformRegion| {
+            region_overlaps_memory_area(*region, offset, size)
+        })
+    }) {
+        return false;
+    }
+
+    let mut absorbed = [false; 32];
+    for k in (0..region_count).filter(|k| !sources.contains(k)) {
+        let Some(other) = regions[k] else {
+            continue;
+        };
+        if !other.is_mmio {
+            if new_memory_overlap(&|region: &PlatformRegion| regions_overlap(region, &other)) {
+                return false;
+            }
+            continue;
+        }
+        if regions_overlap(&napot, &other) {
+            let contained = napot.start_addr <= other.start_addr
+                && other.start_addr as usize + other.size <= napot.start_addr as usize + napot.size;
+            if !contained || !same_properties(&napot, &other) {
+                return false;
+            }
+            absorbed[k] = true;
+        }
+    }
+
+    if check_memory && napot.user_accessible {
+        let replaced_size: usize = (0..region_count)
+            .filter(|&k| sources.contains(&k) || absorbed[k])
+            .filter_map(|k| regions[k].map(|region| region.size))
+            .sum();
+        // MMIO regions don't overlap, so this is only the size of `napot` when
+        // they fill it
+        if replaced_size != napot.size {
+            return false;
+        }
+    }
+
+    regions[sources[0]] = Some(napot);
+    for &i in &sources[1..] {
+        regions[i] = None;
+    }
+    for (region, absorbed) in regions.iter_mut().zip(absorbed) {
+        if absorbed {
+            *region = None;
+        }
+    }
+    true
+}
+
+/// Minimize the PMP entries used by MMIO regions (best effort). Every MMIO
+/// region is converted to NAPOT where possible, then MMIO regions with the same
+/// properties that touch each other are merged into one NAPOT region, as long
+/// as no other region or memory gets covered (see `try_replace_mmio`).
+/// Machine-only MMIO may be widened over unlisted addresses to get there,
+/// user-accessible MMIO is only merged when the regions tile the NAPOT range.
+///
+/// Returns the new region count, removed regions are compacted away.
+pub(crate) fn optimize_mmio_napot(
+    regions: &mut [Option<PlatformRegion>; 32],
+    region_count: usize,
+    memory_areas: &[(u32, u32)],
+) -> usize {
+    // Convert each MMIO region to NAPOT, keeping its start address if it is
+    // aligned enough, or covering it from a lower address otherwise
+    for i in 0..region_count {
+        let Some(original_region) = regions[i] else {
+            continue;
+        };
+        if !original_region.is_mmio {
+            continue;
+        }
+        if let Ok(napot_region) = try_convert_to_napot(original_region) {
+            if try_replace_mmio(
+                regions,
+                region_count,
+                &[i],
+                napot_region,
+                memory_areas,
+                false,
+            ) {
+                continue;
+            }
+        }
+        let start = original_region.start_addr as usize;
+        if let Some((napot_start, napot_size)) = napot_cover(start, start + original_region.size) {
+            if (napot_start, napot_size) != (start, original_region.size) {
+                let napot_region = PlatformRegion {
+                    start_addr: napot_start as *const u8,
+                    size: napot_size,
+                    ..original_region
+                };
+                try_replace_mmio(
+                    regions,
+                    region_count,
+                    &[i],
+                    napot_region,
+                    memory_areas,
+                    true,
+                );
+            }
+        }
+    }
+
+    // Merge touching MMIO regions with the same properties until none are left
+    let mut merged = true;
+    while merged {
+        merged = false;
+        for i in 0..region_count {
+            for j in (i + 1)..region_count {
+                let (Some(region_a), Some(region_b)) = (regions[i], regions[j]) else {
+                    continue;
+                };
+                let (start_a, start_b) =
+                    (region_a.start_addr as usize, region_b.start_addr as usize);
+                let (end_a, end_b) = (start_a + region_a.size, start_b + region_b.size);
+                if !region_a.is_mmio
+                    || !same_properties(&region_a, &region_b)
+                    || start_a > end_b
+                    || start_b > end_a
+                {
+                    continue;
+                }
+                let Some((napot_start, napot_size)) =
+                    napot_cover(start_a.min(start_b), end_a.max(end_b))
+                else {
+                    continue;
+                };
+                let napot_region = PlatformRegion {
+                    start_addr: napot_start as *const u8,
+                    size: napot_size,
+                    ..region_a
+                };
+                merged |= try_replace_mmio(
+                    regions,
+                    region_count,
+                    &[i, j],
+                    napot_region,
+                    memory_areas,
+                    true,
+                );
+            }
+        }
+    }
+
+    // Compact the remaining regions, keeping their order
+    let mut write_pos = 0;
+    for read_pos in 0..region_count {
+        if let Some(region) = regions[read_pos].take() {
+            regions[write_pos] = Some(region);
+            write_pos += 1;
+        }
+    }
+    write_pos
+}
+
+/// Choose NAPOT or TOR for each non-MMIO region, in the order they are added to
+/// the PMP, to use the fewest entries. A NAPOT region takes one entry. A TOR
+/// region takes two, or one when the previous region is a TOR region ending at
+/// its start. Regions that can't be NAPOT are TOR.
+pub(crate) fn choose_napot_memory_regions(regions: &[PlatformRegion], napot: &mut [bool]) {
+    const TOR: usize = 0;
+    const NAPOT: usize = 1;
+    let range = |region: &PlatformRegion, encoding: usize| EncodedRange {
+        start: region.start_addr as usize,
+        end: region.start_addr as usize + region.size,
+        encoding: if encoding == NAPOT {
+            Encoding::NAPOT
+        } else {
+            Encoding::TOR
+        },
+    };
+    // Fewest entries up to each region, by encoding of the region, and the
+    // encoding of the previous region giving it
+    let mut entries = [[usize::MAX; 2]; 32];
+    let mut prev_encoding = [[TOR; 2]; 32];
+
+    for (i, region) in regions.iter().enumerate() {
+        let napot_possible = pmp_layout::is_napot(region.start_addr as usize, region.size);
+        for encoding in [TOR, NAPOT] {
+            if encoding == NAPOT && !napot_possible {
+                continue;
+            }
+            if i == 0 {
+                entries[i][encoding] = pmp_layout::entries(&range(region, encoding), None);
+                continue;
+            }
+            for prev in [TOR, NAPOT] {
+                if entries[i - 1][prev] == usize::MAX {
+                    continue;
+                }
+                let cost = pmp_layout::entries(
+                    &range(region, encoding),
+                    Some(&range(&regions[i - 1], prev)),
+                );
+                if entries[i - 1][prev] + cost < entries[i][encoding] {
+                    entries[i][encoding] = entries[i - 1][prev] + cost;
+                    prev_encoding[i][encoding] = prev;
+                }
+            }
+        }
+    }
+
+    let Some(last) = regions.len().checked_sub(1) else {
+        return;
+    };
+    let mut encoding = if entries[last][NAPOT] < entries[last][TOR] {
+        NAPOT
+    } else {
+        TOR
+    };
+    for i in (0..=last).rev() {
+        napot[i] = encoding == NAPOT;
+        encoding = prev_encoding[i][encoding];
+    }
+}
+
+/// Coalesce adjacent non-MMIO regions with identical properties in-place
+pub(crate) fn coalesce_regions_in_place(
+    regions: &mut [Option<PlatformRegion>; 32],
+    region_count: usize,
+) -> usize {
+    if region_count <= 1 {
+        return region_count;
+    }
+
+    let mut write_pos = 0;
+    let mut current_region = regions[0].unwrap();
+
+    for read_pos in 1..region_count {
+        let next_region = regions[read_pos].unwrap();
+
+        // Check if regions are adjacent and have same properties
+        let regions_adjacent =
+            unsafe { current_region.start_addr.add(current_region.size) == next_region.start_addr };
+        // MMIO regions are merged by `optimize_mmio_napot`, only when they stay NAPOT
+        if regions_adjacent
+            && !current_region.is_mmio
+            && same_properties(&current_region, &next_region)
+        {
+            // Extend current region to include next region
+            current_region.size += next_region.size;
+        } else {
+            // Write current region and start new one
+            regions[write_pos] = Some(current_region);
+            write_pos += 1;
+            current_region = next_region;
+        }
+    }
+
+    // Don't forget the last region
+    regions[write_pos] = Some(current_region);
+    write_pos += 1;
+
+    // Clear any remaining slots
+    for i in write_pos..region_count {
+        regions[i] = None;
+    }
+
+    write_pos
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const SRAM: (u32, u32) = (0x4000_0000, 0x8_0000);
+    const DCCM: (u32, u32) = (0x5000_0000, 0x4000);
+    const ROM: (u32, u32) = (0x8000_0000, 0x8000);
+    const MEMORY_AREAS: [(u32, u32); 3] = [ROM, SRAM, DCCM];
+
+    fn mmio(start: usize, size: usize, user_accessible: bool) -> PlatformRegion {
+        PlatformRegion {
+            start_addr: start as *const u8,
+            size,
+            is_mmio: true,
+            user_accessible,
+            read: true,
+            write: true,
+            execute: false,
+        }
+    }
+
+    fn memory(start: usize, size: usize, write: bool, execute: bool) -> PlatformRegion {
+        PlatformRegion {
+            start_addr: start as *const u8,
+            size,
+            is_mmio: false,
+            user_accessible: false,
+            read: true,
+            write,
+            execute,
+        }
+    }
+
+    fn table(regions: &[PlatformRegion]) -> [Option<PlatformRegion>; 32] {
+        let mut table = [None; 32];
+        for (slot, region) in table.iter_mut().zip(regions) {
+            *slot = Some(*region);
+        }
+        table
+    }
+
+    fn range(region: &PlatformRegion) -> (usize, usize) {
+        (region.start_addr as usize, region.size)
+    }
+
+    fn contains(outer: &PlatformRegion, inner: &PlatformRegion) -> bool {
+        outer.start_addr <= inner.start_addr
+            && inner.start_addr as usize + inner.size <= outer.start_addr as usize + outer.size
+    }
+
+    /// Checks that the optimized MMIO regions give access to nothing the
+    /// original regions did not, except unlisted addresses for machine-only MMIO.
+    fn assert_no_new_access(original: &[PlatformRegion], optimized: &[PlatformRegion]) {
+        for region in optimized.iter().filter(|region| region.is_mmio) {
+            for &(offset, size) in &MEMORY_AREAS {
+                let was_overlapping = original.iter().any(|orig| {
+                    contains(region, orig) && region_overlaps_memory_area(*orig, offset, size)
+                });
+                assert!(
+                    was_overlapping || !region_overlaps_memory_area(*region, offset, size),
+                    "{:?} covers memory at {:#x}",
+                    region,
+                    offset
+                );
+            }
+            for other in original
+                .iter()
+                .filter(|other| regions_overlap(region, other))
+            {
+                assert!(
+                    other.is_mmio && same_properties(region, other),
+                    "{:?} covers {:?}",
+                    region,
+                    other
+                );
+            }
+            if region.user_accessible && range(region) != (0x1000_0000, 0x1000_0000) {
+                let listed: usize = original
+                    .iter()
+                    .filter(|orig| contains(region, orig))
+                    .map(|orig| orig.size)
+                    .sum();
+                assert_eq!(
+                    listed, region.size,
+                    "{:?} covers unlisted addresses",
+                    region
+                );
+            }
+        }
+        for orig in original {
+            assert!(
+                optimized
+                    .iter()
+                    .any(|region| contains(region, orig) && same_properties(region, orig)),
+                "{:?} lost",
+                orig
+            );
+        }
+    }
+
+    #[test]
+    fn test_napot_cover() {
+        assert_eq!(
+            napot_cover(0x2000_8000, 0x2000_9000),
+            Some((0x2000_8000, 0x1000))
+        );
+        assert_eq!(
+            napot_cover(0x2f00_0000, 0x2f10_1000),
+            Some((0x2f00_0000, 0x20_0000))
+        );
+        // Crossing a boundary of its own size doubles the size again
+        assert_eq!(
+            napot_cover(0x1000_1000, 0x1000_3000),
+            Some((0x1000_0000, 0x4000))
+        );
+        assert_eq!(napot_cover(0x100, 0x104), Some((0x100, 8)));
+        assert_eq!(napot_cover(usize::MAX - 0xf, usize::MAX), None);
+    }
+
+    #[test]
+    fn test_try_replace_mmio() {
+        let machine_a = mmio(0x3002_0000, 0x40, false);
+        let machine_b = mmio(0x3002_0040, 0x40, false);
+        let user = mmio(0x3002_0080, 0x80, true);
+        let napot = mmio(0x3002_0000, 0x80, false);
+
+        // Contained MMIO with the same properties is absorbed
+        let mut regions = table(&[machine_a, machine_b, user]);
+        assert!(try_replace_mmio(
+            &mut regions,
+            3,
+            &[0],
+            napot,
+            &MEMORY_AREAS,
+            true
+        ));
+        assert_eq!(regions[0].as_ref().map(range), Some((0x3002_0000, 0x80)));
+        assert!(regions[1].is_none());
+        assert!(regions[2].is_some());
+
+        // MMIO with other properties is not covered
+        let mut regions = table(&[machine_a, machine_b, user]);
+        let wide = mmio(0x3002_0000, 0x100, false);
+        assert!(!try_replace_mmio(
+            &mut regions,
+            3,
+            &[0, 1],
+            wide,
+            &MEMORY_AREAS,
+            true
+        ));
+        assert_eq!(regions[0].as_ref().map(range), Some(range(&machine_a)));
+        assert_eq!(regions[1].as_ref().map(range), Some(range(&machine_b)));
+
+        // Nor is MMIO partially inside the new region
+        let mut regions = table(&[machine_a, mmio(0x3002_0060, 0x40, false)]);
+        assert!(!try_replace_mmio(
+            &mut regions,
+            2,
+            &[0],
+            napot,
+            &MEMORY_AREAS,
+            true
+        ));
+
+        // Memory is only checked for regions grown beyond their sources
+        let below_sram = mmio(0x3ff8_0000, 0x8_0000, false);
+        let over_sram = mmio(0x3ff8_0000, 0x10_0000, false);
+        let mut regions = table(&[below_sram]);
+        assert!(!try_replace_mmio(
+            &mut regions,
+            1,
+            &[0],
+            over_sram,
+            &MEMORY_AREAS,
+            true
+        ));
+        let text = memory(0x3ff8_0000 + 0x8_0000, 0x1000, false, true);
+        let mut regions = table(&[below_sram, text]);
+        assert!(!try_replace_mmio(
+            &mut regions,
+            2,
+            &[0],
+            over_sram,
+            &[],
+            true
+        ));
+
+        // User MMIO must fill the new region
+        let user_a = mmio(0x1000_0000, 0x1000, true);
+        let user_b = mmio(0x1000_1000, 0x1000, true);
+        let mut regions = table(&[user_a]);
+        assert!(!try_replace_mmio(
+            &mut regions,
+            1,
+            &[0],
+            mmio(0x1000_0000, 0x2000, true),
+            &MEMORY_AREAS,
+            true
+        ));
+        let mut regions = table(&[user_a, user_b]);
+        assert!(try_replace_mmio(
+            &mut regions,
+            2,
+            &[0, 1],
+            mmio(0x1000_0000, 0x2000, true),
+            &MEMORY_AREAS,
+            true
+        ));
+        assert_eq!(regions[0].as_ref().map(range), Some((0x1000_0000, 0x2000)));
+        assert!(regions[1].is_none());
+    }
+
+    #[test]
+    fn test_optimize_mmio_napot() {
+        let original = [
+            memory(0x4000_0000, 0x3000, false, true),
+            memory(0x4000_3000, 0x7_d000, true, false),
+            // Touching machine-only MMIO merge into one NAPOT region
+            mmio(0x3002_0000, 0x28, false),
+            mmio(0x3002_0028, 0x18, false),
+            mmio(0x3002_0040, 0x40, false),
+            // Machine-only MMIO is widened to a NAPOT region from a lower address
+            mmio(0x2000_9000, 0x2000, false),
+            // but not over user MMIO
+            mmio(0x2000_d000, 0x2000, false),
+            mmio(0x2000_c000, 0x1000, true),
+            // nor over SRAM
+            mmio(0x400c_0000, 0x8_0000, false),
+            // User MMIO is not widened, and only merged when it fills the result
+            mmio(0x1000_1000, 0x2000, true),
+            mmio(0x1000_4000, 0x1000, true),
+            mmio(0x1000_5000, 0x1000, true),
+            mmio(0x1000_6000, 0x1000, true),
+            mmio(0x1000_7000, 0x1000, true),
+        ];
+        let mut regions = table(&original);
+        let count = optimize_mmio_napot(&mut regions, original.len(), &MEMORY_AREAS);
+        let optimized: Vec<PlatformRegion> = regions[..count].iter().flatten().copied().collect();
+        assert_eq!(optimized.len(), count);
+
+        let ranges: Vec<(usize, usize)> = optimized.iter().map(range).collect();
+        assert_eq!(
+            ranges,
+            [
+                (0x4000_0000, 0x3000),
+                (0x4000_3000, 0x7_d000),
+                (0x3002_0000, 0x80),
+                (0x2000_8000, 0x4000),
+                (0x2000_d000, 0x2000),
+                (0x2000_c000, 0x1000),
+                (0x400c_0000, 0x8_0000),
+                (0x1000_1000, 0x2000),
+                (0x1000_4000, 0x4000),
+            ]
+        );
+        assert_no_new_access(&original, &optimized);
+    }
+
+    #[test]
+    fn test_optimize_emulator_mmio() {
+        // MMIO of the emulator memory map and runtime board
+        let original = [
+            mmio(0x6000_0000, 0x1_0000, false),
+            mmio(0x2000_4000, 0x1000, false),
+            mmio(0x2100_0000, 0xe0_0000, false),
+            mmio(0x3002_0000, 0x28, false),
+            mmio(0x3003_0000, 0x5e0, false),
+            mmio(0x7000_0000, 0x140, false),
+            mmio(0x7000_0400, 0x8c, false),
+            memory(0x4000_0000, 0x1_0000, false, true),
+            memory(0x4001_0000, 0x7_0000, true, false),
+            mmio(0x1000_0000, 0x1000_0000, true),
+            mmio(0x2000_8000, 0x1000, false),
+            mmio(0x2f00_0000, 0x10_1000, false),
+        ];
+        let mut regions = table(&original);
+        let count = optimize_mmio_napot(&mut regions, original.len(), &MEMORY_AREAS);
+        let optimized: Vec<PlatformRegion> = regions[..count].iter().flatten().copied().collect();
+        assert_eq!(count, original.len());
+        for region in optimized.iter().filter(|region| region.is_mmio) {
+            assert!(
+                pmp_layout::is_napot(region.start_addr as usize, region.size),
+                "{:?}",
+                region
+            );
+        }
+        assert_no_new_access(&original, &optimized);
+    }
+
+    #[test]
+    fn test_choose_napot_memory_regions() {
+        fn chosen_entries(regions: &[PlatformRegion]) -> (Vec<bool>, usize) {
+            let mut napot = [false; 32];
+            choose_napot_memory_regions(regions, &mut napot);
+            let entries =
+                pmp_layout::total_entries(regions.iter().zip(napot).map(|(region, napot)| {
+                    EncodedRange {
+                        start: region.start_addr as usize,
+                        end: region.start_addr as usize + region.size,
+                        encoding: if napot {
+                            Encoding::NAPOT
+                        } else {
+                            Encoding::TOR
+                        },
+                    }
+                }));
+            (napot[..regions.len()].to_vec(), entries)
+        }
+
+        // Adjacent TOR regions share entries, DCCM is NAPOT
+        let regions = [
+            memory(0x4000_0000, 0x3000, false, true),
+            memory(0x4000_3000, 0x2000, false, false),
+            memory(0x4000_5000, 0x7_b000, true, false),
+            memory(0x5000_0000, 0x4000, true, false),
+        ];
+        assert_eq!(
+            chosen_entries(&regions),
+            (vec![false, false, false, true], 5)
+        );
+
+        // A region that could be NAPOT stays TOR between TOR regions
+        let regions = [
+            memory(0x4000_0000, 0x3000, false, true),
+            memory(0x4000_3000, 0x1000, false, false),
+            memory(0x4000_4000, 0x3000, true, false),
+        ];
+        assert_eq!(chosen_entries(&regions), (vec![false, false, false], 4));
+
+        // NAPOT when nothing is shared
+        let regions = [
+            memory(0x4000_0000, 0x1_0000, false, true),
+            memory(0x4002_0000, 0x2_0000, true, false),
+        ];
+        assert_eq!(chosen_entries(&regions), (vec![true, true], 2));
+        assert_eq!(chosen_entries(&[]), (vec![], 0));
+    }
+}
@@ -18,6 +18,25 @@ pub const PARTITION_TABLE: FlashPartition = FlashPartition {
     driver_num: 0x8000_0008,
 };
 
+// Offset of the firmware update download checkpoint within the partition table partition.
+// It sits past the partition table so that both can be updated independently.
+pub const FW_UPDATE_CHECKPOINT_OFFSET: usize = 0x1000;
+// The checkpoint has a flash page of its own, erased before every write.
+pub const FW_UPDATE_CHECKPOINT_SIZE: usize = 256;
+
+// Journal of boot configuration updates within the partition table partition. The
+// partition table at offset 0 holds the provisioned configuration, and every update
+// appends a `BootCfgRecord` to the journal instead of rewriting it. The journal has
+// two banks of one flash page each. When the active bank is full, the other bank is
+// erased and the update is written there, so the latest record of the full bank
+// survives an interrupted erase or write.
+pub const BOOT_CFG_JOURNAL_OFFSET: usize = 0x2000;
+pub const BOOT_CFG_JOURNAL_BANK_SIZE: usize = 256;
+pub const BOOT_CFG_JOURNAL_BANKS: usize = 2;
+pub const BOOT_CFG_JOURNAL_SIZE: usize = BOOT_CFG_JOURNAL_BANK_SIZE * BOOT_CFG_JOURNAL_BANKS;
+pub const BOOT_CFG_RECORDS_PER_BANK: usize =
+    BOOT_CFG_JOURNAL_BANK_SIZE / core::mem::size_of::<BootCfgRecord>();
+
 pub const IMAGE_A_PARTITION: FlashPartition = FlashPartition {
     name: "image_a",
     offset: BLOCK_SIZE,
@@ -60,7 +79,7 @@ pub struct FlashPartition {
     pub driver_num: u32,    // driver number for the partition
 }
 
-#[derive(Debug, Clone, FromBytes, IntoBytes, Immutable, PartialEq, Default)]
+#[derive(Debug, Clone, Copy, FromBytes, IntoBytes, Immutable, PartialEq, Default)]
 #[repr(C, packed)]
 pub struct PartitionTable {
     pub active_partition: u32,       // Valid values defined in PartitionId
@@ -159,6 +178,145 @@ impl PartitionTable {
     }
 }
 
+/// Boot configuration update stored in the journal. Records are ordered by sequence
+/// number, which starts at 1; erased (all ones) and zeroed slots are never valid.
+#[derive(Debug, Clone, Copy, FromBytes, IntoBytes, Immutable, PartialEq)]
+#[repr(C, packed)]
+pub struct BootCfgRecord {
+    pub sequence: u32,
+    pub partition_table: PartitionTable,
+    pub checksum: u32, // Covers the sequence number and the partition table
+}
+
+impl BootCfgRecord {
+    pub fn new<C: ChecksumCalculator>(
+        sequence: u32,
+        partition_table: PartitionTable,
+        calculator: &C,
+    ) -> Self {
+        let mut record = BootCfgRecord {
+            sequence,
+            partition_table,
+            checksum: 0,
+        };
+        record.checksum =
+            calculator.calc_checksum(&record.as_bytes()[..offset_of!(Self, checksum)]);
+        record
+    }
+
+    pub fn is_valid<C: ChecksumCalculator>(&self, calculator: &C) -> bool {
+        let sequence = self.sequence;
+        sequence != 0
+            && sequence != u32::MAX
+            && calculator.verify_checksum(
+                self.checksum,
+                &self.as_bytes()[..offset_of!(Self, checksum)],
+            )
+            && self.partition_table.verify_checksum(calculator)
+    }
+}
+
+/// Append of a record to the boot configuration journal.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct BootCfgWrite {
+    /// Offset of the bank to erase before writing the record, relative to the journal
+    pub erase_offset: Option<usize>,
+    /// Offset of the record, relative to the journal
+    pub offset: usize,
+    pub record: BootCfgRecord,
+}
+
+/// Latest boot configuration in the journal, and where the next update goes.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct BootCfgJournal {
+    latest: Option<BootCfgRecord>,
+    bank: usize,
+    next_slot: usize,
+}
+
+impl BootCfgJournal {
+    /// Finds the record with the highest sequence number in `journal`, the contents of
+    /// all the banks. Torn records are skipped, and never written over.
+    pub fn scan<C: ChecksumCalculator>(journal: &[u8], calculator: &C) -> Self {
+        let record_size = core::mem::size_of::<BootCfgRecord>();
+        let slot = |bank: usize, slot: usize| {
+            let offset = bank * BOOT_CFG_JOURNAL_BANK_SIZE + slot * record_size;
+            journal.get(offset..offset + record_size).unwrap_or(&[])
+        };
+
+        let mut latest: Option<(BootCfgRecord, usize)> = None;
+        for bank in 0..BOOT_CFG_JOURNAL_BANKS {
+            for i in 0..BOOT_CFG_RECORDS_PER_BANK {
+                let Ok(record) = BootCfgRecord::read_from_bytes(slot(bank, i)) else {
+                    continue;
+                };
+                if !record.is_valid(calculator) {
+                    continue;
+                }
+                let newer = match latest {
+                    Some((current, _)) => record.sequence > current.sequence,
+                    None => true,
+                };
+                if newer {
+                    latest = Some((record, bank));
+                }
+            }
+        }
+
+        let bank = latest.map_or(0, |(_, bank)| bank);
+        // Append past the last slot written in the bank, even if it holds a torn record
+        let next_slot = (0..BOOT_CFG_RECORDS_PER_BANK)
+            .rev()
+            .find(|i| slot(bank, *i).iter().any(|b| *b != 0xff))
+            .map_or(0, |i| i + 1);
+
+        BootCfgJournal {
+            latest: latest.map(|(record, _)| record),
+            bank,
+            next_slot,
+        }
+    }
+
+    /// The latest partition table in the journal, if any update was recorded.
+    pub fn partition_table(&self) -> Option<PartitionTable> {
+        self.latest.map(|record| record.partition_table)
+    }
+
+    /// Returns the write recording `partition_table` as the latest configuration.
+    pub fn next_write<C: ChecksumCalculator>(
+        &self,
+        partition_table: &PartitionTable,
+        calculator: &C,
+    ) -> BootCfgWrite {
+        let sequence = self.latest.map_or(1, |record| record.sequence + 1);
+        let record = BootCfgRecord::new(sequence, *partition_table, calculator);
+        let record_size = core::mem::size_of::<BootCfgRecord>();
+        if self.next_slot < BOOT_CFG_RECORDS_PER_BANK {
+            BootCfgWrite {
+                erase_offset: None,
+                offset: self.bank * BOOT_CFG_JOURNAL_BANK_SIZE + self.next_slot * record_size,
+                record,
+            }
+        } else {
+            let bank_offset =
+                ((self.bank + 1) % BOOT_CFG_JOURNAL_BANKS) * BOOT_CFG_JOURNAL_BANK_SIZE;
+            BootCfgWrite {
+                erase_offset: Some(bank_offset),
+                offset: bank_offset,
+                record,
+            }
+        }
+    }
+
+    /// Updates the journal after `write` completed.
+    pub fn commit(&mut self, write: &BootCfgWrite) {
+        let record_size = core::mem::size_of::<BootCfgRecord>();
+        self.latest = Some(write.record);
+        self.bank = write.offset / BOOT_CFG_JOURNAL_BANK_SIZE;
+        self.next_slot = (write.offset % BOOT_CFG_JOURNAL_BANK_SIZE) / record_size + 1;
+    }
+}
+
 pub trait ChecksumCalculator {
     fn calc_checksum(&self, data: &[u8]) -> u32 {
         let mut checksum = 0u32;
@@ -210,3 +368,84 @@ impl LoggingFlashConfig {
 }
 
 pub const LOGGING_FLASH_CONFIG: LoggingFlashConfig = LoggingFlashConfig::default();
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn table(boot_count: u16) -> PartitionTable {
+        let mut table = PartitionTable::new(
+            PartitionId::A,
+            boot_count,
+            PartitionStatus::Valid,
+            0,
+            PartitionStatus::Invalid,
+            RollbackEnable::Enabled,
+        );
+        table.populate_checksum(&StandAloneChecksumCalculator::new());
+        table
+    }
+
+    fn apply(flash: &mut [u8], write: &BootCfgWrite) {
+        if let Some(erase) = write.erase_offset {
+            flash[erase..erase + BOOT_CFG_JOURNAL_BANK_SIZE].fill(0xff);
+        }
+        flash[write.offset..write.offset + core::mem::size_of::<BootCfgRecord>()]
+            .copy_from_slice(write.record.as_bytes());
+    }
+
+    #[test]
+    fn test_boot_cfg_journal_append_and_compact() {
+        let calculator = StandAloneChecksumCalculator::new();
+        let mut flash = [0xffu8; BOOT_CFG_JOURNAL_SIZE];
+        let mut journal = BootCfgJournal::scan(&flash, &calculator);
+        assert_eq!(journal.partition_table(), None);
+
+        // Fill the first bank, then wrap to the second one
+        for i in 1..=BOOT_CFG_RECORDS_PER_BANK as u16 + 1 {
+            let write = journal.next_write(&table(i), &calculator);
+            let wraps = i as usize > BOOT_CFG_RECORDS_PER_BANK;
+            assert_eq!(write.erase_offset.is_some(), wraps);
+            apply(&mut flash, &write);
+            journal.commit(&write);
+            assert_eq!(journal, BootCfgJournal::scan(&flash, &calculator));
+            assert_eq!(journal.partition_table(), Some(table(i)));
+        }
+        assert_eq!(
+            journal.next_write(&table(0), &calculator).offset,
+            BOOT_CFG_JOURNAL_BANK_SIZE + core::mem::size_of::<BootCfgRecord>()
+        );
+    }
+
+    #[test]
+    fn test_boot_cfg_journal_torn_write() {
+        let calculator = StandAloneChecksumCalculator::new();
+        let mut flash = [0xffu8; BOOT_CFG_JOURNAL_SIZE];
+        let journal = BootCfgJournal::scan(&flash, &calculator);
+        let write = journal.next_write(&table(1), &calculator);
+        apply(&mut flash, &write);
+
+        // Interrupted write of the second record: the first one stays the latest, and
+        // the torn slot is skipped by the next update
+        let journal = BootCfgJournal::scan(&flash, &calculator);
+        let write = journal.next_write(&table(2), &calculator);
+        flash[write.offset..write.offset + 8].copy_from_slice(&write.record.as_bytes()[..8]);
+        let journal = BootCfgJournal::scan(&flash, &calculator);
+        assert_eq!(journal.partition_table(), Some(table(1)));
+        assert_eq!(
+            journal.next_write(&table(2), &calculator).offset,
+            2 * core::mem::size_of::<BootCfgRecord>()
+        );
+    }
+
+    #[test]
+    fn test_boot_cfg_journal_zeroed_flash() {
+        let calculator = StandAloneChecksumCalculator::new();
+        let flash = [0u8; BOOT_CFG_JOURNAL_SIZE];
+        let journal = BootCfgJournal::scan(&flash, &calculator);
+        assert_eq!(journal.partition_table(), None);
+        // Nothing is erased, so the first update erases the other bank
+        let write = journal.next_write(&table(1), &calculator);
+        assert_eq!(write.erase_offset, Some(BOOT_CFG_JOURNAL_BANK_SIZE));
+    }
+}
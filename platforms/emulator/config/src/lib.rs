@@ -49,3 +49,18 @@ pub const EMULATOR_MEMORY_MAP: McuMemoryMap = McuMemoryMap {
 };
 
 pub const EMULATOR_MCU_STRAPS: McuStraps = McuStraps::default();
+
+/// Base address of the emulator UART.
+pub const EMU_UART_OFFSET: u32 = 0x1000_1000;
+/// Offset of the UART register that decodes deferred log records (see `romtime::deferred_log`).
+pub const EMU_UART_LOG_DATA: u32 = 0x44;
+/// Address of the deferred log data register, for firmware.
+pub const EMU_UART_LOG_DATA_ADDR: u32 = EMU_UART_OFFSET + EMU_UART_LOG_DATA;
+
+/// Base address of the emulator control device.
+pub const EMU_CTRL_OFFSET: u32 = 0x1000_2000;
+/// Offset of the emulator control register that records the cycle count at which the
+/// firmware reached a `Milestone`, written as its id.
+pub const EMU_CTRL_MILESTONE: u32 = 0x4;
+/// Address of the milestone register, for firmware.
+pub const EMU_CTRL_MILESTONE_ADDR: u32 = EMU_CTRL_OFFSET + EMU_CTRL_MILESTONE;
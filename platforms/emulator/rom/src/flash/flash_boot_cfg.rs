@@ -1,19 +1,33 @@
 // Licensed under the Apache-2.0 license
 
+use core::cell::Cell;
 use mcu_config::boot::{BootConfig, BootConfigError, PartitionId, PartitionStatus, RollbackEnable};
-use mcu_config_emulator::flash::{PartitionTable, StandAloneChecksumCalculator};
+use mcu_config_emulator::flash::{
+    BootCfgJournal, PartitionTable, StandAloneChecksumCalculator, BOOT_CFG_JOURNAL_BANK_SIZE,
+    BOOT_CFG_JOURNAL_OFFSET, BOOT_CFG_JOURNAL_SIZE,
+};
 use mcu_rom_common::flash::flash_partition::FlashPartition;
 use zerocopy::{FromBytes, IntoBytes};
+
+/// Boot configuration stored in the partition table partition.
+///
+/// The configuration is read from flash once and then cached. Updates are appended to
+/// the boot configuration journal (see `BootCfgJournal`).
 pub struct FlashBootCfg<'a> {
     flash_driver: &'a mut FlashPartition<'a>,
+    cache: Cell<Option<(PartitionTable, BootCfgJournal)>>,
 }
 
 impl<'a> FlashBootCfg<'a> {
     #[allow(dead_code)]
     pub fn new(flash_driver: &'a mut FlashPartition<'a>) -> Self {
-        Self { flash_driver }
+        Self {
+            flash_driver,
+            cache: Cell::new(None),
+        }
     }
 
+    /// Reads the provisioned partition table, at the start of the partition.
     pub fn read_partition_table(&self) -> Result<PartitionTable, ()> {
         let mut partition_table_data: [u8; core::mem::size_of::<PartitionTable>()] =
             [0; core::mem::size_of::<PartitionTable>()];
@@ -30,59 +44,93 @@ impl<'a> FlashBootCfg<'a> {
         }
         Ok(partition_table)
     }
+
+    /// Returns the latest partition table, from the journal if it was updated.
+    fn load(&self) -> Result<(PartitionTable, BootCfgJournal), BootConfigError> {
+        if let Some(cached) = self.cache.get() {
+            return Ok(cached);
+        }
+
+        let mut journal_data = [0u8; BOOT_CFG_JOURNAL_SIZE];
+        self.flash_driver
+            .read(BOOT_CFG_JOURNAL_OFFSET, &mut journal_data)
+            .map_err(|_| BootConfigError::ReadFailed)?;
+        let journal = BootCfgJournal::scan(&journal_data, &StandAloneChecksumCalculator::new());
+        let partition_table = match journal.partition_table() {
+            Some(partition_table) => partition_table,
+            None => self
+                .read_partition_table()
+                .map_err(|_| BootConfigError::ReadFailed)?,
+        };
+        self.cache.set(Some((partition_table, journal)));
+        Ok((partition_table, journal))
+    }
+
+    /// Applies `update` to the partition table and appends the result to the journal.
+    fn update<T>(
+        &self,
+        update: impl FnOnce(&mut PartitionTable) -> Result<T, BootConfigError>,
+    ) -> Result<T, BootConfigError> {
+        let (current, mut journal) = self.load()?;
+        let mut partition_table = current;
+        let result = update(&mut partition_table)?;
+        let checksum_calculator = StandAloneChecksumCalculator::new();
+        partition_table.populate_checksum(&checksum_calculator);
+        if partition_table == current {
+            return Ok(result);
+        }
+
+        let write = journal.next_write(&partition_table, &checksum_calculator);
+        if let Some(erase_offset) = write.erase_offset {
+            self.flash_driver
+                .erase(
+                    BOOT_CFG_JOURNAL_OFFSET + erase_offset,
+                    BOOT_CFG_JOURNAL_BANK_SIZE,
+                )
+                .map_err(|_| BootConfigError::WriteFailed)?;
+        }
+        self.flash_driver
+            .write(
+                BOOT_CFG_JOURNAL_OFFSET + write.offset,
+                write.record.as_bytes(),
+            )
+            .map_err(|_| BootConfigError::WriteFailed)?;
+        journal.commit(&write);
+        self.cache.set(Some((partition_table, journal)));
+        Ok(result)
+    }
 }
 
 impl<'a> BootConfig for FlashBootCfg<'a> {
     fn get_active_partition(&self) -> Result<PartitionId, BootConfigError> {
-        let partition_table = self
-            .read_partition_table()
-            .map_err(|_| BootConfigError::ReadFailed)?;
-
+        let (partition_table, _) = self.load()?;
         let (active_partition, _) = partition_table.get_active_partition();
         Ok(active_partition)
     }
 
     fn set_active_partition(&mut self, partition_id: PartitionId) -> Result<(), BootConfigError> {
-        let mut partition_table = self
-            .read_partition_table()
-            .map_err(|_| BootConfigError::ReadFailed)?;
-        partition_table.set_active_partition(partition_id);
-        partition_table.populate_checksum(&StandAloneChecksumCalculator::new());
-        self.flash_driver
-            .write(0, partition_table.as_bytes())
-            .map_err(|_| BootConfigError::WriteFailed)?;
-        Ok(())
+        self.update(|partition_table| {
+            partition_table.set_active_partition(partition_id);
+            Ok(())
+        })
     }
 
     fn increment_boot_count(&self, partition_id: PartitionId) -> Result<u16, BootConfigError> {
-        let mut partition_table = self
-            .read_partition_table()
-            .map_err(|_| BootConfigError::ReadFailed)?;
-        let boot_count = match partition_id {
+        self.update(|partition_table| match partition_id {
             PartitionId::A => {
                 partition_table.partition_a_boot_count += 1;
-                partition_table.partition_a_boot_count
+                Ok(partition_table.partition_a_boot_count)
             }
             PartitionId::B => {
                 partition_table.partition_b_boot_count += 1;
-                partition_table.partition_b_boot_count
+                Ok(partition_table.partition_b_boot_count)
             }
-            _ => return Err(BootConfigError::InvalidPartition),
-        };
-        // Write the updated partition table back to flash
-        let checksum_calculator = StandAloneChecksumCalculator::new();
-        partition_table.populate_checksum(&checksum_calculator);
-
-        self.flash_driver
-            .write(0, partition_table.as_bytes())
-            .map_err(|_| BootConfigError::WriteFailed)?;
-        Ok(boot_count)
+            _ => Err(BootConfigError::InvalidPartition),
+        })
     }
 
     fn get_boot_count(&self, partition_id: PartitionId) -> Result<u16, BootConfigError> {
-        let partition_table = self
-            .read_partition_table()
-            .map_err(|_| BootConfigError::ReadFailed)?;
+        let (partition_table, _) = self.load()?;
         match partition_id {
             PartitionId::A => Ok(partition_table.partition_a_boot_count),
             PartitionId::B => Ok(partition_table.partition_b_boot_count),
@@ -91,19 +139,14 @@ impl<'a> BootConfig for FlashBootCfg<'a> {
     }
 
     fn set_rollback_enable(&mut self, enable: bool) -> Result<(), BootConfigError> {
-        let mut partition_table = self
-            .read_partition_table()
-            .map_err(|_| BootConfigError::ReadFailed)?;
-        partition_table.rollback_enable = if enable {
-            RollbackEnable::Enabled as u32
-        } else {
-            RollbackEnable::Disabled as u32
-        };
-        partition_table.populate_checksum(&StandAloneChecksumCalculator::new());
-        self.flash_driver
-            .write(0, partition_table.as_bytes())
-            .map_err(|_| BootConfigError::WriteFailed)?;
-        Ok(())
+        self.update(|partition_table| {
+            partition_table.rollback_enable = if enable {
+                RollbackEnable::Enabled as u32
+            } else {
+                RollbackEnable::Disabled as u32
+            };
+            Ok(())
+        })
     }
 
     fn set_partition_status(
@@ -111,31 +154,21 @@ impl<'a> BootConfig for FlashBootCfg<'a> {
         partition_id: mcu_config::boot::PartitionId,
         status: mcu_config::boot::PartitionStatus,
     ) -> Result<(), mcu_config::boot::BootConfigError> {
-        let mut partition_table = self
-            .read_partition_table()
-            .map_err(|_| BootConfigError::ReadFailed)?;
-        match partition_id {
-            PartitionId::A => partition_table.partition_a_status = status as u16,
-            PartitionId::B => partition_table.partition_b_status = status as u16,
-            _ => return Err(BootConfigError::InvalidPartition),
-        }
-        // Write the updated partition table back to flash
-        let checksum_calculator = StandAloneChecksumCalculator::new();
-        partition_table.populate_checksum(&checksum_calculator);
-
-        self.flash_driver
-            .write(0, partition_table.as_bytes())
-            .map_err(|_| BootConfigError::WriteFailed)?;
-        Ok(())
+        self.update(|partition_table| {
+            match partition_id {
+                PartitionId::A => partition_table.partition_a_status = status as u16,
+                PartitionId::B => partition_table.partition_b_status = status as u16,
+                _ => return Err(BootConfigError::InvalidPartition),
+            }
+            Ok(())
+        })
     }
 
     fn get_partition_status(
         &self,
         partition_id: mcu_config::boot::PartitionId,
     ) -> Result<mcu_config::boot::PartitionStatus, mcu_config::boot::BootConfigError> {
-        let partition_table = self
-            .read_partition_table()
-            .map_err(|_| BootConfigError::ReadFailed)?;
+        let (partition_table, _) = self.load()?;
         match partition_id {
             PartitionId::A => Ok(partition_table
                 .partition_a_status
@@ -150,9 +183,7 @@ impl<'a> BootConfig for FlashBootCfg<'a> {
     }
 
     fn is_rollback_enabled(&self) -> Result<bool, mcu_config::boot::BootConfigError> {
-        let partition_table = self
-            .read_partition_table()
-            .map_err(|_| BootConfigError::ReadFailed)?;
+        let (partition_table, _) = self.load()?;
         Ok(partition_table.rollback_enable == RollbackEnable::Enabled as u32)
     }
 }
@@ -4,6 +4,7 @@
 
 use core::fmt::Write;
 use core::ops::{Index, IndexMut};
+use mcu_config_emulator::EMULATOR_MEMORY_MAP;
 use mcu_rom_common::flash::hil::{FlashDrvError, FlashStorage};
 use registers_generated::primary_flash_ctrl::{
     self,
@@ -97,11 +98,15 @@ impl FlashStorage for EmulatedFlashCtrl {
             let page_offset = flash_offset % PAGE_SIZE;
             let to_read = core::cmp::min(PAGE_SIZE - page_offset, remaining);
 
-            // Read the page into page_buf
-            self.read_page(page_number, &mut page_buf)?;
-
-            buf[buf_offset..buf_offset + to_read]
-                .copy_from_slice(&page_buf.0[page_offset..page_offset + to_read]);
+            let dest = &mut buf[buf_offset..buf_offset + to_read];
+            if to_read == PAGE_SIZE && Self::is_dma_reachable(dest) {
+                // The controller transfers whole pages straight into the caller's buffer
+                self.read_page(page_number, dest)?;
+            } else {
+                // Read the page into page_buf and copy out the requested part
+                self.read_page(page_number, page_buf.as_mut())?;
+                dest.copy_from_slice(&page_buf.0[page_offset..page_offset + to_read]);
+            }
 
             remaining -= to_read;
             buf_offset += to_read;
@@ -126,7 +131,7 @@ impl FlashStorage for EmulatedFlashCtrl {
             // Read the page first if not writing the whole page
             let mut page_buf = if to_write != PAGE_SIZE {
                 let mut tmp = EmulatedFlashPage::default();
-                self.read_page(page_number, &mut tmp)?;
+                self.read_page(page_number, tmp.as_mut())?;
                 tmp
             } else {
                 EmulatedFlashPage::default()
@@ -182,15 +187,34 @@ impl EmulatedFlashCtrl {
         self.clear_event_interrupt();
     }
 
-    fn read_page(
-        &self,
-        page_number: usize,
-        buf: &mut EmulatedFlashPage,
-    ) -> Result<(), FlashDrvError> {
+    /// Returns true if the controller can write a page directly to `buf`, i.e. it lies in
+    /// MCU SRAM or in the ROM's DCCM. Other buffers are filled through a bounce page.
+    fn is_dma_reachable(buf: &[u8]) -> bool {
+        if cfg!(feature = "test-flash-recovery-cpu-copy") {
+            return false;
+        }
+        let start = buf.as_ptr() as usize;
+        let end = start + buf.len();
+        let contains = |offset: u32, size: u32| {
+            start >= offset as usize && end <= offset as usize + size as usize
+        };
+        contains(
+            EMULATOR_MEMORY_MAP.sram_offset,
+            EMULATOR_MEMORY_MAP.sram_size,
+        ) || contains(
+            EMULATOR_MEMORY_MAP.dccm_offset,
+            EMULATOR_MEMORY_MAP.dccm_size,
+        )
+    }
+
+    fn read_page(&self, page_number: usize, buf: &mut [u8]) -> Result<(), FlashDrvError> {
         // Check if the page number is valid
         if page_number >= FLASH_MAX_PAGES {
             return Err(FlashDrvError::INVAL);
         }
+        if buf.len() != PAGE_SIZE {
+            return Err(FlashDrvError::SIZE);
+        }
 
         // Check ctrl_regwen status before we commit
         if !self.registers.ctrl_regwen.is_set(CtrlRegwen::En) {
@@ -202,8 +226,8 @@ impl EmulatedFlashCtrl {
             .fl_control
             .modify(FlControl::Op::CLEAR + FlControl::Start::CLEAR);
 
-        let page_buf_addr = buf.as_mut().as_ptr() as u32;
-        let page_buf_len = buf.as_mut().len() as u32;
+        let page_buf_addr = buf.as_mut_ptr() as u32;
+        let page_buf_len = buf.len() as u32;
 
         // Program page_num, page_addr, page_size registers
         self.registers.page_num.set(page_number as u32);
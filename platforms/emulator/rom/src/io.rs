@@ -2,8 +2,10 @@
 
 use core::fmt::Write;
 
+use mcu_config_emulator::{EMU_CTRL_MILESTONE_ADDR, EMU_UART_LOG_DATA_ADDR};
 use mcu_rom_common::FatalErrorHandler;
-use romtime::{Exit, HexWord};
+use romtime::deferred_log::MmioLogWriter;
+use romtime::{Exit, HexWord, MmioMilestoneRecorder};
 
 pub(crate) struct EmulatorWriter {}
 pub(crate) static mut EMULATOR_WRITER: EmulatorWriter = EmulatorWriter {};
@@ -24,6 +26,9 @@ pub(crate) fn print_to_console(buf: &str) {
     }
 }
 
+// Deferred log records are decoded by the emulator UART
+pub(crate) static mut EMULATOR_LOG_WRITER: MmioLogWriter<EMU_UART_LOG_DATA_ADDR> = MmioLogWriter {};
+
 pub(crate) struct EmulatorFatalErrorHandler {}
 pub(crate) static mut FATAL_ERROR_HANDLER: EmulatorFatalErrorHandler = EmulatorFatalErrorHandler {};
 impl FatalErrorHandler for EmulatorFatalErrorHandler {
@@ -42,6 +47,9 @@ impl Exit for EmulatorExiter {
     }
 }
 
+pub(crate) static mut EMULATOR_MILESTONE_RECORDER: MmioMilestoneRecorder<EMU_CTRL_MILESTONE_ADDR> =
+    MmioMilestoneRecorder {};
+
 /// Exit the emulator
 pub fn exit_emulator(exit_code: u32) -> ! {
     // Safety: This is a safe memory address to write to for exiting the emulator.
@@ -14,7 +14,10 @@ Abstract:
 
 #![allow(unused_imports)]
 
-use crate::io::{EMULATOR_EXITER, EMULATOR_WRITER, FATAL_ERROR_HANDLER};
+use crate::io::{
+    EMULATOR_EXITER, EMULATOR_LOG_WRITER, EMULATOR_MILESTONE_RECORDER, EMULATOR_WRITER,
+    FATAL_ERROR_HANDLER,
+};
 use core::fmt::Write;
 
 #[cfg(target_arch = "riscv32")]
@@ -49,6 +52,10 @@ pub extern "C" fn rom_entry() -> ! {
         #[allow(static_mut_refs)]
         romtime::set_printer(&mut EMULATOR_WRITER);
     }
+    unsafe {
+        #[allow(static_mut_refs)]
+        romtime::deferred_log::set_deferred_log_writer(&mut EMULATOR_LOG_WRITER);
+    }
     unsafe {
         #[allow(static_mut_refs)]
         mcu_rom_common::set_fatal_error_handler(&mut FATAL_ERROR_HANDLER);
@@ -57,6 +64,11 @@ pub extern "C" fn rom_entry() -> ! {
         #[allow(static_mut_refs)]
         romtime::set_exiter(&mut EMULATOR_EXITER);
     }
+    unsafe {
+        #[allow(static_mut_refs)]
+        romtime::set_milestone_recorder(&mut EMULATOR_MILESTONE_RECORDER);
+    }
+    romtime::milestone(romtime::Milestone::RomStart);
 
     #[cfg(feature = "test-flash-based-boot")]
     {
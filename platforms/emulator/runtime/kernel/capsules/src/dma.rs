@@ -2,7 +2,8 @@
 
 //! This provides the dma syscall driver
 
-use kernel::grant::{AllowRoCount, AllowRwCount, Grant, UpcallCount};
+use core::ops::Range;
+use kernel::grant::{AllowRoCount, AllowRwCount, Grant, GrantKernelData, UpcallCount};
 use kernel::syscall::{CommandReturn, SyscallDriver};
 use kernel::utilities::cells::OptionalCell;
 use kernel::{ErrorCode, ProcessId};
@@ -15,6 +16,10 @@ pub const BUF_LEN: usize = 512;
 
 pub const BLOCK_SIZE: usize = 1; // Currently supported block size is 1 byte (byte transfer)
 
+/// Size of a scatter-gather descriptor: 64-bit source and destination addresses,
+/// a 32-bit byte count and 32 reserved bits, all little-endian.
+pub const DESCRIPTOR_SIZE: usize = 24;
+
 /// Subscription IDs for asynchronous notifications.
 mod dma_subscribe {
     pub const XFER_DONE: u32 = 0;
@@ -25,6 +30,15 @@ mod dma_cmd {
     pub const SET_SRC_ADDR: u32 = 1;
     pub const SET_DEST_ADDR: u32 = 2;
     pub const XFER_AXI_TO_AXI: u32 = 3;
+    pub const XFER_LIST: u32 = 5;
+}
+
+/// Ids for read-only allow buffers
+mod ro_allow {
+    /// Descriptor list of a scatter-gather transfer
+    pub const DESCRIPTORS: usize = 1;
+    /// The number of allow buffers the kernel stores for this grant
+    pub const COUNT: u8 = 2;
 }
 
 #[derive(Default)]
@@ -32,20 +46,24 @@ pub struct App {
     pub source_address: Option<u64>,
     pub dest_address: Option<u64>,
     pub length: usize,
+    /// Number of descriptors of the scatter-gather transfer in progress, 0 if none
+    pub list_len: usize,
+    /// Index of the descriptor being transferred
+    pub list_index: usize,
 }
 
 pub struct Dma<'a> {
     // The underlying dma storage driver.
     driver: &'a dyn dma_driver::hil::DMA,
     // Per-app state.
-    apps: Grant<App, UpcallCount<1>, AllowRoCount<0>, AllowRwCount<0>>,
+    apps: Grant<App, UpcallCount<1>, AllowRoCount<{ ro_allow::COUNT }>, AllowRwCount<0>>,
     current_app: OptionalCell<ProcessId>,
 }
 
 impl<'a> Dma<'a> {
     pub fn new(
         driver: &'a dyn dma_driver::hil::DMA,
-        grant: Grant<App, UpcallCount<1>, AllowRoCount<0>, AllowRwCount<0>>,
+        grant: Grant<App, UpcallCount<1>, AllowRoCount<{ ro_allow::COUNT }>, AllowRwCount<0>>,
     ) -> Dma<'a> {
         Dma {
             driver,
@@ -123,15 +141,118 @@ impl<'a> Dma<'a> {
                 .unwrap_or_else(|err| Err(err.into()))
         })
     }
+
+    /// Starts a scatter-gather transfer of the first `count` descriptors of the allowed
+    /// descriptor list. The app gets a single upcall once all of them are done.
+    fn start_list_transfer(&self, count: usize, processid: ProcessId) -> Result<(), ErrorCode> {
+        if count == 0 {
+            return Err(ErrorCode::INVAL);
+        }
+        if self.current_app.is_some() {
+            return Err(ErrorCode::BUSY);
+        }
+        self.current_app.set(processid);
+        let result = self
+            .apps
+            .enter(processid, |app, kernel_data| {
+                let list_len = kernel_data
+                    .get_readonly_processbuffer(ro_allow::DESCRIPTORS)
+                    .map_or(0, |descriptors| descriptors.len());
+                if list_len < count * DESCRIPTOR_SIZE {
+                    return Err(ErrorCode::SIZE);
+                }
+                app.list_len = count;
+                app.list_index = 0;
+                self.start_descriptor(app, kernel_data)
+            })
+            .unwrap_or_else(|err| Err(err.into()));
+        if result.is_err() {
+            self.current_app.clear();
+        }
+        result
+    }
+
+    /// Programs the controller with the descriptor at `app.list_index` and starts it.
+    fn start_descriptor(
+        &self,
+        app: &mut App,
+        kernel_data: &GrantKernelData,
+    ) -> Result<(), ErrorCode> {
+        let mut descriptor = [0u8; DESCRIPTOR_SIZE];
+        let offset = app.list_index * DESCRIPTOR_SIZE;
+        kernel_data
+            .get_readonly_processbuffer(ro_allow::DESCRIPTORS)
+            .and_then(|descriptors| {
+                descriptors.enter(|data| {
+                    if data.len() < offset + DESCRIPTOR_SIZE {
+                        return Err(ErrorCode::SIZE);
+                    }
+                    data[offset..offset + DESCRIPTOR_SIZE].copy_to_slice(&mut descriptor);
+                    Ok(())
+                })
+            })
+            .unwrap_or(Err(ErrorCode::RESERVE))?;
+
+        let field = |range: Range<usize>| {
+            descriptor[range]
+                .iter()
+                .rev()
+                .fold(0u64, |acc, &byte| acc << 8 | byte as u64)
+        };
+        app.source_address = Some(field(0..8));
+        app.dest_address = Some(field(8..16));
+        app.length = field(16..20) as usize;
+
+        self.driver.configure_transfer(
+            app.length,
+            BLOCK_SIZE,
+            app.source_address,
+            app.dest_address,
+        )?;
+        self.driver.start_transfer(
+            dma_driver::hil::DmaRoute::AxiToAxi,
+            dma_driver::hil::DmaRoute::AxiToAxi,
+            false,
+        )
+    }
 }
 
 impl dma_driver::hil::DMAClient for Dma<'_> {
     fn transfer_complete(&self, status: dma_driver::hil::DMAStatus) {
         if let Some(processid) = self.current_app.take() {
-            let _ = self.apps.enter(processid, move |_, kernel_data| {
+            let _ = self.apps.enter(processid, move |app, kernel_data| {
+                // Chain the next descriptor of a scatter-gather transfer without waking the app
+                if app.list_index + 1 < app.list_len {
+                    app.list_index += 1;
+                    match self.start_descriptor(app, kernel_data) {
+                        Ok(()) => {
+                            self.current_app.set(processid);
+                            return;
+                        }
+                        Err(_) => {
+                            app.list_len = 0;
+                            kernel_data
+                                .schedule_upcall(
+                                    dma_subscribe::XFER_DONE as usize,
+                                    (
+                                        dma_driver::hil::DMAError::CommandError as usize,
+                                        app.list_index,
+                                        0,
+                                    ),
+                                )
+                                .ok();
+                            return;
+                        }
+                    }
+                }
+                let completed = if app.list_len > 0 { app.list_len } else { 1 };
+                app.list_len = 0;
                 // Signal the app.
                 kernel_data
-                    .schedule_upcall(dma_subscribe::XFER_DONE as usize, (status as usize, 0, 0))
+                    .schedule_upcall(
+                        dma_subscribe::XFER_DONE as usize,
+                        (status as usize, completed, 0),
+                    )
                     .ok();
             });
         };
@@ -139,10 +260,16 @@ impl dma_driver::hil::DMAClient for Dma<'_> {
 
     fn transfer_error(&self, error: dma_driver::hil::DMAError) {
         if let Some(processid) = self.current_app.take() {
-            let _ = self.apps.enter(processid, move |_, kernel_data| {
+            let _ = self.apps.enter(processid, move |app, kernel_data| {
+                // The descriptors transferred before the failing one are reported as completed
+                let completed = if app.list_len > 0 { app.list_index } else { 0 };
+                app.list_len = 0;
                 // Signal the app.
                 kernel_data
-                    .schedule_upcall(dma_subscribe::XFER_DONE as usize, (error as usize, 0, 0))
+                    .schedule_upcall(
+                        dma_subscribe::XFER_DONE as usize,
+                        (error as usize, completed, 0),
+                    )
                     .ok();
             });
         };
@@ -184,6 +311,10 @@ impl SyscallDriver for Dma<'_> {
                     Err(e) => CommandReturn::failure(e),
                 }
             }
+            dma_cmd::XFER_LIST => match self.start_list_transfer(r2, processid) {
+                Ok(()) => CommandReturn::success(),
+                Err(e) => CommandReturn::failure(e),
+            },
 
             _ => CommandReturn::failure(ErrorCode::NOSUPPORT),
         }
@@ -6,3 +6,4 @@
 pub mod dma;
 pub mod flash_partition;
 pub mod logging;
+pub mod ping_pong;
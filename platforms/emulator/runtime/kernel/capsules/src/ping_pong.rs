@@ -0,0 +1,108 @@
+// Licensed under the Apache-2.0 license
+
+//! This provides a syscall driver that passes a turn between processes, so that the
+//! cost of switching processes can be measured from userspace.
+//!
+//! A process registers, then passes the turn: the driver schedules an upcall to every
+//! other registered process. Two processes that wait for their turn right after passing
+//! it make the kernel switch from one to the other on every pass.
+
+use kernel::grant::{AllowRoCount, AllowRwCount, Grant, UpcallCount};
+use kernel::syscall::{CommandReturn, SyscallDriver};
+use kernel::{ErrorCode, ProcessId};
+
+pub const PING_PONG_DRIVER_NUM: usize = 0x9002_0000;
+
+/// Subscription IDs for asynchronous notifications.
+mod ping_pong_subscribe {
+    /// Another process passed the turn
+    pub const TURN: u32 = 0;
+}
+
+mod ping_pong_cmd {
+    /// Registers the process, returns the number of processes registered before it
+    pub const REGISTER: u32 = 1;
+    /// Returns the number of registered processes
+    pub const REGISTERED: u32 = 2;
+    /// Passes the turn to the other registered processes, returns their number
+    pub const PASS: u32 = 3;
+}
+
+#[derive(Default)]
+pub struct App {
+    registered: bool,
+}
+
+pub struct PingPong {
+    // Per-app state.
+    apps: Grant<App, UpcallCount<1>, AllowRoCount<0>, AllowRwCount<0>>,
+}
+
+impl PingPong {
+    pub fn new(grant: Grant<App, UpcallCount<1>, AllowRoCount<0>, AllowRwCount<0>>) -> PingPong {
+        PingPong { apps: grant }
+    }
+
+    fn registered(&self) -> u32 {
+        let mut registered = 0;
+        self.apps.each(|_, app, _| {
+            if app.registered {
+                registered += 1;
+            }
+        });
+        registered
+    }
+
+    fn register(&self, processid: ProcessId) -> Result<u32, ErrorCode> {
+        let registered = self.registered();
+        self.apps
+            .enter(processid, |app, _| {
+                if app.registered {
+                    return Err(ErrorCode::ALREADY);
+                }
+                app.registered = true;
+                Ok(registered)
+            })
+            .unwrap_or_else(|err| Err(err.into()))
+    }
+
+    fn pass(&self, processid: ProcessId) -> u32 {
+        let mut passed = 0;
+        self.apps.each(|id, app, kernel_data| {
+            if id != processid && app.registered {
+                kernel_data
+                    .schedule_upcall(ping_pong_subscribe::TURN as usize, (0, 0, 0))
+                    .ok();
+                passed += 1;
+            }
+        });
+        passed
+    }
+}
+
+/// Provide an interface for userland.
+impl SyscallDriver for PingPong {
+    fn command(
+        &self,
+        command_num: usize,
+        _r2: usize,
+        _r3: usize,
+        processid: ProcessId,
+    ) -> CommandReturn {
+        match command_num as u32 {
+            0 => CommandReturn::success(),
+            ping_pong_cmd::REGISTER => match self.register(processid) {
+                Ok(registered) => CommandReturn::success_u32(registered),
+                Err(e) => CommandReturn::failure(e),
+            },
+            ping_pong_cmd::REGISTERED => CommandReturn::success_u32(self.registered()),
+            ping_pong_cmd::PASS => CommandReturn::success_u32(self.pass(processid)),
+
+            _ => CommandReturn::failure(ErrorCode::NOSUPPORT),
+        }
+    }
+
+    fn allocate_grant(&self, processid: ProcessId) -> Result<(), kernel::process::Error> {
+        self.apps.enter(processid, |_, _| {})
+    }
+}
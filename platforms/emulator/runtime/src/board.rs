@@ -164,6 +164,8 @@ struct VeeR {
     >,
     dma: &'static capsules_emulator::dma::Dma<'static>,
     logging_flash: &'static capsules_emulator::logging::driver::LoggingFlashDriver<'static>,
+    #[cfg(feature = "test-syscall-perf")]
+    ping_pong: &'static capsules_emulator::ping_pong::PingPong,
 }
 
 /// Mapping of integer syscalls to objects that implement syscalls.
@@ -199,6 +201,8 @@ impl SyscallDriverLookup for VeeR {
             capsules_emulator::logging::driver::LOGGING_FLASH_DRIVER_NUM => {
                 f(Some(self.logging_flash))
             }
+            #[cfg(feature = "test-syscall-perf")]
+            capsules_emulator::ping_pong::PING_PONG_DRIVER_NUM => f(Some(self.ping_pong)),
 
             _ => f(None),
         }
@@ -272,6 +276,11 @@ pub(crate) fn print_to_console(buf: &str) {
     }
 }
 
+// Deferred log records are decoded by the emulator UART
+pub(crate) static mut EMULATOR_LOG_WRITER: romtime::deferred_log::MmioLogWriter<
+    { mcu_config_emulator::EMU_UART_LOG_DATA_ADDR },
+> = romtime::deferred_log::MmioLogWriter {};
+
 pub(crate) struct EmulatorExiter {}
 pub(crate) static mut EMULATOR_EXITER: EmulatorExiter = EmulatorExiter {};
 impl romtime::Exit for EmulatorExiter {
@@ -280,6 +289,10 @@ impl romtime::Exit for EmulatorExiter {
     }
 }
 
+pub(crate) static mut EMULATOR_MILESTONE_RECORDER: romtime::MmioMilestoneRecorder<
+    { mcu_config_emulator::EMU_CTRL_MILESTONE_ADDR },
+> = romtime::MmioMilestoneRecorder {};
+
 /// Main function called after RAM initialized.
 ///
 /// # Safety
@@ -293,7 +306,12 @@ pub unsafe fn main() {
     #[allow(static_mut_refs)]
     romtime::set_printer(&mut EMULATOR_WRITER);
     #[allow(static_mut_refs)]
+    romtime::deferred_log::set_deferred_log_writer(&mut EMULATOR_LOG_WRITER);
+    #[allow(static_mut_refs)]
     romtime::set_exiter(&mut EMULATOR_EXITER);
+    #[allow(static_mut_refs)]
+    romtime::set_milestone_recorder(&mut EMULATOR_MILESTONE_RECORDER);
+    romtime::milestone(romtime::Milestone::RuntimeStart);
 
     // Set up memory protection immediately after setting the trap handler, to
     // ensure that much of the board initialization routine runs with ePMP
@@ -536,7 +554,7 @@ pub unsafe fn main() {
         mux_mctp,
         MessageType::Spdm,
     )
-    .finalize(mctp_driver_component_static!(InternalTimers));
+    .finalize(mctp_driver_component_static!(InternalTimers, held_request));
 
     let mctp_secure_spdm = mcu_components::mctp_driver::MCTPDriverComponent::new(
         board_kernel,
@@ -632,6 +650,16 @@ pub unsafe fn main() {
     )
     .finalize(kernel::static_buf!(capsules_emulator::dma::Dma<'static>));
 
+    // Lets the syscall perf test switch between its two processes
+    #[cfg(feature = "test-syscall-perf")]
+    let ping_pong = static_init!(
+        capsules_emulator::ping_pong::PingPong,
+        capsules_emulator::ping_pong::PingPong::new(board_kernel.create_grant(
+            capsules_emulator::ping_pong::PING_PONG_DRIVER_NUM,
+            &memory_allocation_cap
+        ))
+    );
+
     // Need to enable all interrupts for Tock Kernel
     chip.enable_pic_interrupts();
     chip.enable_timer_interrupts();
@@ -671,6 +699,8 @@ pub unsafe fn main() {
             mailbox,
             dma,
             logging_flash,
+            #[cfg(feature = "test-syscall-perf")]
+            ping_pong,
         }
     );
 
@@ -755,6 +785,12 @@ pub unsafe fn main() {
         None
     };
 
+    #[cfg(feature = "test-mctp-bridge")]
+    {
+        debug!("Executing test-mctp-bridge");
+        crate::tests::mctp_bridge_test::test_mctp_bridge(mux_mctp);
+    }
+
     #[cfg(feature = "test-mctp-capsule-loopback")]
     {
         debug!("Executing test-mctp-capsule-loopback");
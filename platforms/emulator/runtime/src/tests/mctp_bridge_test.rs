@@ -0,0 +1,227 @@
+// Licensed under the Apache-2.0 license
+
+// Test MCTP bridging: downstream buses with simulated endpoints are added to the
+// MCTP mux, and the emulator test sends them requests through the bridge.
+// Each simulated endpoint answers Get Endpoint ID, and echoes any other
+// request packet back with its EIDs swapped, so multi-packet messages are only
+// reassembled by the bus owner.
+
+use capsules_core::virtualizers::virtual_alarm::VirtualMuxAlarm;
+use capsules_runtime::mctp::base_protocol::{MCTPHeader, MessageType, MCTP_HDR_SIZE};
+use capsules_runtime::mctp::bridge::{MCTPRoute, MCTP_BINDING_TYPE_VENDOR};
+use capsules_runtime::mctp::mux::MuxMCTPDriver;
+use capsules_runtime::mctp::transport_binding::{
+    MCTPI3CBinding, MCTPTransportBinding, TransportRxClient, TransportTxClient, MCTP_I3C_MAXMTU,
+};
+use core::cell::Cell;
+use core::fmt::Write;
+use kernel::component::Component;
+use kernel::deferred_call::{DeferredCall, DeferredCallClient};
+use kernel::static_init;
+use kernel::utilities::cells::{OptionalCell, TakeCell};
+use kernel::ErrorCode;
+use mcu_components::mctp_bridge::MCTPBridgePortComponent;
+use mcu_components::mctp_bridge_port_component_static;
+use mcu_tock_veer::timers::InternalTimers;
+use romtime::println;
+use zerocopy::{FromBytes, IntoBytes};
+
+/// Downstream buses: (port, first EID, number of endpoints).
+/// Must match `emulator/app/src/tests/mctp_bridge.rs`.
+const DOWNSTREAM_BUSES: [(u8, u8, u8); 2] = [(1, 0x30, 2), (2, 0x40, 1)];
+
+const MCTP_CTRL_CMD_GET_EID: u8 = 0x02;
+const MCTP_CTRL_RQ_BIT: u8 = 0x80;
+
+/// Transport binding of a bus with simulated endpoints.
+struct SimulatedEndpointBus<'a> {
+    first_eid: u8,
+    eid_count: u8,
+    tx_client: OptionalCell<&'a dyn TransportTxClient>,
+    rx_client: OptionalCell<&'a dyn TransportRxClient>,
+    /// Packet transmitted to the endpoints, held until it is answered
+    tx_buffer: TakeCell<'static, [u8]>,
+    tx_len: Cell<usize>,
+    rx_buffer: TakeCell<'static, [u8]>,
+    deferred_call: DeferredCall,
+}
+
+impl SimulatedEndpointBus<'_> {
+    fn new(first_eid: u8, eid_count: u8) -> Self {
+        Self {
+            first_eid,
+            eid_count,
+            tx_client: OptionalCell::empty(),
+            rx_client: OptionalCell::empty(),
+            tx_buffer: TakeCell::empty(),
+            tx_len: Cell::new(0),
+            rx_buffer: TakeCell::empty(),
+            deferred_call: DeferredCall::new(),
+        }
+    }
+
+    /// Writes the answer of the endpoints to `packet` in `resp`, returns its length.
+    fn respond(&self, packet: &[u8], resp: &mut [u8]) -> Option<usize> {
+        if packet.len() < MCTP_HDR_SIZE || resp.len() < packet.len() {
+            return None;
+        }
+        let mctp_hdr = MCTPHeader::read_from_bytes(&packet[..MCTP_HDR_SIZE]).ok()?;
+        let eid = mctp_hdr.dest_eid();
+        if eid < self.first_eid || eid - self.first_eid >= self.eid_count {
+            println!("MCTP bridge test: no endpoint with EID {}", eid);
+            return None;
+        }
+        if mctp_hdr.tag_owner() == 0 {
+            // Only requests are answered
+            return None;
+        }
+
+        let mut resp_hdr = mctp_hdr.clone();
+        resp_hdr.set_dest_eid(mctp_hdr.src_eid());
+        resp_hdr.set_src_eid(eid);
+        resp_hdr.set_tag_owner(0);
+        resp[..MCTP_HDR_SIZE].copy_from_slice(resp_hdr.as_bytes());
+
+        let payload = &packet[MCTP_HDR_SIZE..];
+        let resp_payload = &mut resp[MCTP_HDR_SIZE..];
+        if mctp_hdr.som() == 1
+            && mctp_hdr.eom() == 1
+            && payload.len() >= 3
+            && payload[0] & 0x7F == MessageType::MctpControl as u8
+            && payload[1] & MCTP_CTRL_RQ_BIT != 0
+            && payload[2] == MCTP_CTRL_CMD_GET_EID
+        {
+            // Control message header, then completion code, EID, EID type and medium info
+            let get_eid_resp = [
+                payload[0],
+                payload[1] & !MCTP_CTRL_RQ_BIT,
+                payload[2],
+                0,
+                eid,
+                0,
+                0,
+            ];
+            resp_payload[..get_eid_resp.len()].copy_from_slice(&get_eid_resp);
+            Some(MCTP_HDR_SIZE + get_eid_resp.len())
+        } else {
+            resp_payload[..payload.len()].copy_from_slice(payload);
+            Some(packet.len())
+        }
+    }
+}
+
+impl<'a> MCTPTransportBinding<'a> for SimulatedEndpointBus<'a> {
+    fn set_tx_client(&self, client: &'a dyn TransportTxClient) {
+        self.tx_client.set(client);
+    }
+
+    fn set_rx_client(&self, client: &'a dyn TransportRxClient) {
+        self.rx_client.set(client);
+    }
+
+    fn set_rx_buffer(&self, rx_buf: &'static mut [u8]) {
+        self.rx_buffer.replace(rx_buf);
+        if self.tx_buffer.is_some() {
+            self.deferred_call.set();
+        }
+    }
+
+    fn transmit(
+        &self,
+        tx_buffer: &'static mut [u8],
+        len: usize,
+    ) -> Result<(), (ErrorCode, &'static mut [u8])> {
+        if self.tx_buffer.is_some() {
+            return Err((ErrorCode::BUSY, tx_buffer));
+        }
+        self.tx_buffer.replace(tx_buffer);
+        self.tx_len.set(len);
+        self.deferred_call.set();
+        Ok(())
+    }
+
+    fn enable(&self) {}
+
+    fn disable(&self) {}
+
+    fn get_mtu_size(&self) -> usize {
+        MCTP_I3C_MAXMTU
+    }
+
+    fn get_hdr_size(&self) -> usize {
+        0
+    }
+}
+
+impl DeferredCallClient for SimulatedEndpointBus<'_> {
+    fn handle_deferred_call(&self) {
+        // The answer waits until the bridge gives the receive buffer back
+        let Some(rx_buffer) = self.rx_buffer.take() else {
+            return;
+        };
+        let Some(tx_buffer) = self.tx_buffer.take() else {
+            self.rx_buffer.replace(rx_buffer);
+            return;
+        };
+
+        let resp_len = self.respond(&tx_buffer[..self.tx_len.get()], rx_buffer);
+        self.tx_client
+            .map(|client| client.send_done(tx_buffer, Ok(())));
+        match (resp_len, self.rx_client.get()) {
+            (Some(resp_len), Some(client)) => client.receive(rx_buffer, resp_len),
+            _ => {
+                self.rx_buffer.replace(rx_buffer);
+            }
+        }
+    }
+
+    fn register(&'static self) {
+        self.deferred_call.register(self);
+    }
+}
+
+pub fn test_mctp_bridge(
+    mux_mctp: &'static MuxMCTPDriver<
+        'static,
+        VirtualMuxAlarm<'static, InternalTimers>,
+        MCTPI3CBinding<'static>,
+    >,
+) -> Option<u32> {
+    let buses: [&'static SimulatedEndpointBus<'static>; 2] = unsafe {
+        [
+            static_init!(
+                SimulatedEndpointBus<'static>,
+                SimulatedEndpointBus::new(DOWNSTREAM_BUSES[0].1, DOWNSTREAM_BUSES[0].2)
+            ),
+            static_init!(
+                SimulatedEndpointBus<'static>,
+                SimulatedEndpointBus::new(DOWNSTREAM_BUSES[1].1, DOWNSTREAM_BUSES[1].2)
+            ),
+        ]
+    };
+    for bus in buses {
+        bus.register();
+    }
+
+    let ports = unsafe {
+        [
+            MCTPBridgePortComponent::new(mux_mctp, DOWNSTREAM_BUSES[0].0, buses[0])
+                .finalize(mctp_bridge_port_component_static!()),
+            MCTPBridgePortComponent::new(mux_mctp, DOWNSTREAM_BUSES[1].0, buses[1])
+                .finalize(mctp_bridge_port_component_static!()),
+        ]
+    };
+    for (port, (_, first_eid, eid_count)) in ports.iter().zip(DOWNSTREAM_BUSES) {
+        mux_mctp
+            .add_route(MCTPRoute::new(
+                first_eid,
+                eid_count,
+                port.port(),
+                MCTP_BINDING_TYPE_VENDOR,
+            ))
+            .expect("Failed to add MCTP route");
+    }
+    println!("MCTP bridge test: downstream endpoints ready");
+    // The emulator test ends the run
+    None
+}
@@ -6,5 +6,7 @@ pub(crate) mod flash_ctrl_test;
 pub(crate) mod flash_storage_test;
 pub(crate) mod i3c_target_test;
 pub(crate) mod linear_log_test;
+#[cfg(feature = "test-mctp-bridge")]
+pub(crate) mod mctp_bridge_test;
 #[cfg(feature = "test-mctp-capsule-loopback")]
 pub(crate) mod mctp_test;
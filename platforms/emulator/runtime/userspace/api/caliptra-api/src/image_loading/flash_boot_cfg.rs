@@ -1,5 +1,6 @@
 // Licensed under the Apache-2.0 license
 
+use core::cell::Cell;
 use libsyscall_caliptra::flash::SpiFlash;
 use libsyscall_caliptra::DefaultSyscalls;
 use libtock_platform::ErrorCode;
@@ -7,13 +8,20 @@ use mcu_config::boot::{
     BootConfigAsync, BootConfigError, PartitionId, PartitionStatus, RollbackEnable,
 };
 use mcu_config_emulator::flash::{
-    FlashPartition, PartitionTable, StandAloneChecksumCalculator, IMAGE_A_PARTITION,
+    BootCfgJournal, FlashPartition, PartitionTable, StandAloneChecksumCalculator,
+    BOOT_CFG_JOURNAL_BANK_SIZE, BOOT_CFG_JOURNAL_OFFSET, BOOT_CFG_JOURNAL_SIZE, IMAGE_A_PARTITION,
     IMAGE_B_PARTITION, PARTITION_TABLE,
 };
 use zerocopy::{FromBytes, IntoBytes};
 
+/// Boot configuration stored in the partition table partition.
+///
+/// The configuration is read from flash once and then cached. Updates are appended to
+/// the boot configuration journal (see `BootCfgJournal`), and updates that do not change
+/// the configuration are not written.
 pub struct FlashBootConfig {
     flash_partition_syscall: SpiFlash<DefaultSyscalls>,
+    cache: Cell<Option<(PartitionTable, BootCfgJournal)>>,
 }
 
 impl Default for FlashBootConfig {
@@ -26,9 +34,11 @@ impl FlashBootConfig {
     pub fn new() -> Self {
         FlashBootConfig {
             flash_partition_syscall: SpiFlash::<DefaultSyscalls>::new(PARTITION_TABLE.driver_num),
+            cache: Cell::new(None),
         }
     }
 
+    /// Reads the provisioned partition table, at the start of the partition.
     pub async fn read_partition_table(&self) -> Result<PartitionTable, ErrorCode> {
         let mut partition_table_data: [u8; core::mem::size_of::<PartitionTable>()] =
             [0; core::mem::size_of::<PartitionTable>()];
@@ -49,6 +59,70 @@ impl FlashBootConfig {
         Ok(partition_table)
     }
 
+    /// Returns the latest partition table, from the journal if it was updated.
+    async fn load(&self) -> Result<(PartitionTable, BootCfgJournal), BootConfigError> {
+        if let Some(cached) = self.cache.get() {
+            return Ok(cached);
+        }
+
+        let mut journal_data = [0u8; BOOT_CFG_JOURNAL_SIZE];
+        self.flash_partition_syscall
+            .read(
+                BOOT_CFG_JOURNAL_OFFSET,
+                BOOT_CFG_JOURNAL_SIZE,
+                &mut journal_data,
+            )
+            .await
+            .map_err(|_| BootConfigError::ReadFailed)?;
+        let journal = BootCfgJournal::scan(&journal_data, &StandAloneChecksumCalculator::new());
+        let partition_table = match journal.partition_table() {
+            Some(partition_table) => partition_table,
+            None => self
+                .read_partition_table()
+                .await
+                .map_err(|_| BootConfigError::ReadFailed)?,
+        };
+        self.cache.set(Some((partition_table, journal)));
+        Ok((partition_table, journal))
+    }
+
+    /// Applies `update` to the partition table and appends the result to the journal.
+    async fn update<T>(
+        &self,
+        update: impl FnOnce(&mut PartitionTable) -> Result<T, BootConfigError>,
+    ) -> Result<T, BootConfigError> {
+        let (current, mut journal) = self.load().await?;
+        let mut partition_table = current;
+        let result = update(&mut partition_table)?;
+        let checksum_calculator = StandAloneChecksumCalculator::new();
+        partition_table.populate_checksum(&checksum_calculator);
+        if partition_table == current {
+            return Ok(result);
+        }
+
+        let write = journal.next_write(&partition_table, &checksum_calculator);
+        if let Some(erase_offset) = write.erase_offset {
+            self.flash_partition_syscall
+                .erase(
+                    BOOT_CFG_JOURNAL_OFFSET + erase_offset,
+                    BOOT_CFG_JOURNAL_BANK_SIZE,
+                )
+                .await
+                .map_err(|_| BootConfigError::WriteFailed)?;
+        }
+        self.flash_partition_syscall
+            .write(
+                BOOT_CFG_JOURNAL_OFFSET + write.offset,
+                write.record.as_bytes().len(),
+                write.record.as_bytes(),
+            )
+            .await
+            .map_err(|_| BootConfigError::WriteFailed)?;
+        journal.commit(&write);
+        self.cache.set(Some((partition_table, journal)));
+        Ok(result)
+    }
+
     pub fn get_partition_from_id(
         &self,
         partition_id: PartitionId,
@@ -66,10 +140,7 @@ impl BootConfigAsync for FlashBootConfig {
         &self,
         partition_id: PartitionId,
     ) -> Result<PartitionStatus, BootConfigError> {
-        let partition_table = self
-            .read_partition_table()
-            .await
-            .map_err(|_| BootConfigError::ReadFailed)?;
+        let (partition_table, _) = self.load().await?;
         match partition_id {
             PartitionId::A => Ok(partition_table
                 .partition_a_status
@@ -88,43 +159,24 @@ impl BootConfigAsync for FlashBootConfig {
         partition_id: PartitionId,
         status: PartitionStatus,
     ) -> Result<(), BootConfigError> {
-        let mut partition_table = self
-            .read_partition_table()
-            .await
-            .map_err(|_| BootConfigError::ReadFailed)?;
-        match partition_id {
-            PartitionId::A => partition_table.partition_a_status = status as u16,
-            PartitionId::B => partition_table.partition_b_status = status as u16,
-            _ => return Err(BootConfigError::InvalidPartition),
-        }
-        // Write the updated partition table back to flash
-        let checksum_calculator = StandAloneChecksumCalculator::new();
-        partition_table.populate_checksum(&checksum_calculator);
-
-        self.flash_partition_syscall
-            .write(
-                0,
-                core::mem::size_of::<PartitionTable>(),
-                partition_table.as_bytes(),
-            )
-            .await
-            .map_err(|_| BootConfigError::WriteFailed)?;
-        Ok(())
+        self.update(|partition_table| {
+            match partition_id {
+                PartitionId::A => partition_table.partition_a_status = status as u16,
+                PartitionId::B => partition_table.partition_b_status = status as u16,
+                _ => return Err(BootConfigError::InvalidPartition),
+            }
+            Ok(())
+        })
+        .await
     }
 
     async fn is_rollback_enabled(&self) -> Result<bool, BootConfigError> {
-        let partition_table = self
-            .read_partition_table()
-            .await
-            .map_err(|_| BootConfigError::ReadFailed)?;
+        let (partition_table, _) = self.load().await?;
         Ok(partition_table.rollback_enable == RollbackEnable::Enabled as u32)
     }
 
     async fn get_active_partition(&self) -> Result<PartitionId, BootConfigError> {
-        let partition_table = self
-            .read_partition_table()
-            .await
-            .map_err(|_| BootConfigError::ReadFailed)?;
+        let (partition_table, _) = self.load().await?;
         let (active_partition, _) = partition_table.get_active_partition();
         Ok(active_partition)
     }
@@ -133,62 +185,33 @@ impl BootConfigAsync for FlashBootConfig {
         &mut self,
         partition_id: PartitionId,
     ) -> Result<(), BootConfigError> {
-        let mut partition_table = self
-            .read_partition_table()
-            .await
-            .map_err(|_| BootConfigError::ReadFailed)?;
-        partition_table.set_active_partition(partition_id);
-        partition_table.populate_checksum(&StandAloneChecksumCalculator::new());
-        self.flash_partition_syscall
-            .write(
-                0,
-                core::mem::size_of::<PartitionTable>(),
-                partition_table.as_bytes(),
-            )
-            .await
-            .map_err(|_| BootConfigError::WriteFailed)?;
-        Ok(())
+        self.update(|partition_table| {
+            partition_table.set_active_partition(partition_id);
+            Ok(())
+        })
+        .await
     }
 
     async fn increment_boot_count(
         &self,
         partition_id: PartitionId,
     ) -> Result<u16, BootConfigError> {
-        let mut partition_table = self
-            .read_partition_table()
-            .await
-            .map_err(|_| BootConfigError::ReadFailed)?;
-        let boot_count = match partition_id {
+        self.update(|partition_table| match partition_id {
             PartitionId::A => {
                 partition_table.partition_a_boot_count += 1;
-                partition_table.partition_a_boot_count
+                Ok(partition_table.partition_a_boot_count)
             }
             PartitionId::B => {
                 partition_table.partition_b_boot_count += 1;
-                partition_table.partition_b_boot_count
+                Ok(partition_table.partition_b_boot_count)
             }
-            _ => return Err(BootConfigError::InvalidPartition),
-        };
-        // Write the updated partition table back to flash
-        let checksum_calculator = StandAloneChecksumCalculator::new();
-        partition_table.populate_checksum(&checksum_calculator);
-
-        self.flash_partition_syscall
-            .write(
-                0,
-                core::mem::size_of::<PartitionTable>(),
-                partition_table.as_bytes(),
-            )
-            .await
-            .map_err(|_| BootConfigError::WriteFailed)?;
-        Ok(boot_count)
+            _ => Err(BootConfigError::InvalidPartition),
+        })
+        .await
     }
 
     async fn get_boot_count(&self, partition_id: PartitionId) -> Result<u16, BootConfigError> {
-        let partition_table = self
-            .read_partition_table()
-            .await
-            .map_err(|_| BootConfigError::ReadFailed)?;
+        let (partition_table, _) = self.load().await?;
         match partition_id {
             PartitionId::A => Ok(partition_table.partition_a_boot_count),
             PartitionId::B => Ok(partition_table.partition_b_boot_count),
@@ -197,24 +220,14 @@ impl BootConfigAsync for FlashBootConfig {
     }
 
     async fn set_rollback_enable(&mut self, enable: bool) -> Result<(), BootConfigError> {
-        let mut partition_table = self
-            .read_partition_table()
-            .await
-            .map_err(|_| BootConfigError::ReadFailed)?;
-        partition_table.rollback_enable = if enable {
-            RollbackEnable::Enabled as u32
-        } else {
-            RollbackEnable::Disabled as u32
-        };
-        partition_table.populate_checksum(&StandAloneChecksumCalculator::new());
-        self.flash_partition_syscall
-            .write(
-                0,
-                core::mem::size_of::<PartitionTable>(),
-                partition_table.as_bytes(),
-            )
-            .await
-            .map_err(|_| BootConfigError::WriteFailed)?;
-        Ok(())
+        self.update(|partition_table| {
+            partition_table.rollback_enable = if enable {
+                RollbackEnable::Enabled as u32
+            } else {
+                RollbackEnable::Disabled as u32
+            };
+            Ok(())
+        })
+        .await
     }
 }
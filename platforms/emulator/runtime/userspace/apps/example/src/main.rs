@@ -36,6 +36,9 @@ mod test_caliptra_certs;
 #[cfg(feature = "test-log-flash-usermode")]
 mod test_logging_flash;
 
+#[cfg(feature = "test-syscall-perf")]
+mod test_syscall_perf;
+
 #[cfg(target_arch = "riscv32")]
 mod riscv;
 
@@ -211,6 +214,7 @@ pub(crate) async fn async_main<S: Syscalls>() {
     {
         test_dma::test_dma_xfer_local_to_local().await;
         test_dma::test_dma_xfer_local_to_external().await;
+        test_dma::test_dma_xfer_list().await;
         romtime::test_exit(0);
     }
 
@@ -222,6 +226,12 @@ pub(crate) async fn async_main<S: Syscalls>() {
         romtime::test_exit(0);
     }
 
+    #[cfg(feature = "test-syscall-perf")]
+    {
+        test_syscall_perf::test_syscall_perf();
+        romtime::test_exit(0);
+    }
+
     writeln!(console_writer, "app finished").unwrap();
 }
 
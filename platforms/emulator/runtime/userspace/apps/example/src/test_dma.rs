@@ -1,12 +1,19 @@
 // Licensed under the Apache-2.0 license
 
 use core::fmt::Write;
-use libsyscall_caliptra::dma::{DMASource, DMATransaction, DMA as DMASyscall};
+use libsyscall_caliptra::dma::{DMADescriptor, DMASource, DMATransaction, DMA as DMASyscall};
+use libsyscall_caliptra::DefaultSyscalls;
+use libtock_alarm::Alarm;
 use romtime::{println, test_exit};
 
 const MCU_SRAM_HI_OFFSET: u64 = 0x1000_0000;
 const EXTERNAL_SRAM_HI_OFFSET: u64 = 0x2000_0000;
 const TEST_EXTERNAL_SRAM_DEST_ADDRESS: u32 = 0x0000_0000;
+const TEST_EXTERNAL_SRAM_LIST_ADDRESS: u32 = 0x0001_0000;
+const LIST_SEGMENT_COUNT: usize = 16;
+const LIST_SEGMENT_SIZE: usize = 64;
+// Segments are scattered in external SRAM with gaps between them
+const LIST_SEGMENT_STRIDE: u32 = 256;
 
 fn local_ram_to_axi_address(addr: u32) -> u64 {
     // Convert a local address to an AXI address
@@ -80,3 +87,83 @@ pub(crate) async fn test_dma_xfer_local_to_external() {
         test_exit(1);
     }
 }
+
+#[allow(unused)]
+pub(crate) async fn test_dma_xfer_list() {
+    println!("Starting test_dma_xfer_list");
+
+    let dma_syscall: DMASyscall = DMASyscall::new();
+
+    let mut source_buffer = [0u8; LIST_SEGMENT_COUNT * LIST_SEGMENT_SIZE];
+    for (i, byte) in source_buffer.iter_mut().enumerate() {
+        *byte = i as u8;
+    }
+    let mut single_buffer = [0u8; LIST_SEGMENT_COUNT * LIST_SEGMENT_SIZE];
+    let mut list_buffer = [0u8; LIST_SEGMENT_COUNT * LIST_SEGMENT_SIZE];
+    let source_address = local_ram_to_axi_address(source_buffer.as_ptr() as u32);
+
+    // Scatter the source into external SRAM and gather it back, one transfer per segment
+    let start = Alarm::<DefaultSyscalls>::get_ticks().unwrap_or_default();
+    for i in 0..LIST_SEGMENT_COUNT {
+        let segment = (i * LIST_SEGMENT_SIZE) as u64;
+        let external = external_ram_to_axi_address(
+            TEST_EXTERNAL_SRAM_LIST_ADDRESS + i as u32 * LIST_SEGMENT_STRIDE,
+        );
+        let scatter = DMATransaction {
+            byte_count: LIST_SEGMENT_SIZE,
+            source: DMASource::Address(source_address + segment),
+            dest_addr: external,
+        };
+        dma_syscall.xfer(&scatter).await.unwrap();
+        let gather = DMATransaction {
+            byte_count: LIST_SEGMENT_SIZE,
+            source: DMASource::Address(external),
+            dest_addr: local_ram_to_axi_address(single_buffer.as_mut_ptr() as u32) + segment,
+        };
+        dma_syscall.xfer(&gather).await.unwrap();
+    }
+    let single_ticks = Alarm::<DefaultSyscalls>::get_ticks()
+        .unwrap_or_default()
+        .wrapping_sub(start);
+
+    // Same transfers with one descriptor list in each direction
+    let mut scatter_list = [DMADescriptor::default(); LIST_SEGMENT_COUNT];
+    let mut gather_list = [DMADescriptor::default(); LIST_SEGMENT_COUNT];
+    for (i, (scatter, gather)) in scatter_list
+        .iter_mut()
+        .zip(gather_list.iter_mut())
+        .enumerate()
+    {
+        let segment = (i * LIST_SEGMENT_SIZE) as u64;
+        let external = external_ram_to_axi_address(
+            TEST_EXTERNAL_SRAM_LIST_ADDRESS + i as u32 * LIST_SEGMENT_STRIDE,
+        );
+        *scatter = DMADescriptor::new(source_address + segment, external, LIST_SEGMENT_SIZE as u32);
+        *gather = DMADescriptor::new(
+            external,
+            local_ram_to_axi_address(list_buffer.as_mut_ptr() as u32) + segment,
+            LIST_SEGMENT_SIZE as u32,
+        );
+    }
+    let start = Alarm::<DefaultSyscalls>::get_ticks().unwrap_or_default();
+    dma_syscall.xfer_list(&scatter_list).await.unwrap();
+    dma_syscall.xfer_list(&gather_list).await.unwrap();
+    let list_ticks = Alarm::<DefaultSyscalls>::get_ticks()
+        .unwrap_or_default()
+        .wrapping_sub(start);
+
+    println!(
+        "DMA_XFER_LIST_PERF segments={} segment_size={} single_ticks={} list_ticks={}",
+        2 * LIST_SEGMENT_COUNT,
+        LIST_SEGMENT_SIZE,
+        single_ticks,
+        list_ticks
+    );
+
+    if source_buffer == single_buffer && source_buffer == list_buffer {
+        println!("Test test_dma_xfer_list passed");
+    } else {
+        println!("Test test_dma_xfer_list failed");
+        test_exit(1);
+    }
+}
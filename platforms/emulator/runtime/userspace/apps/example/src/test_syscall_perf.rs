@@ -0,0 +1,136 @@
+// Licensed under the Apache-2.0 license
+
+// Measures the user/kernel round trip of syscalls. Every syscall disables the
+// user PMP regions on entry to the kernel and enables them again on return.
+//
+// The builder loads a second instance of this app for this test, with a
+// different RAM size, so the two processes have different PMP regions. The
+// instance that registers first with the ping-pong driver leads: it measures
+// single-process syscalls, then passes the turn back and forth with the other
+// instance, so that the kernel switches processes, and loads the regions of
+// the other process, twice per round. The other instance only answers.
+
+use core::cell::Cell;
+use libsyscall_caliptra::DefaultSyscalls;
+use libtock_alarm::{Alarm, Milliseconds};
+use libtock_platform::{share, DefaultConfig, ErrorCode, Syscalls};
+use romtime::{println, test_exit};
+
+const ITERATIONS: u32 = 1000;
+
+// The test-only ping-pong driver of the emulator board
+const PING_PONG_DRIVER_NUM: u32 = 0x9002_0000;
+const PING_PONG_TURN: u32 = 0;
+const PING_PONG_REGISTER: u32 = 1;
+const PING_PONG_REGISTERED: u32 = 2;
+const PING_PONG_PASS: u32 = 3;
+
+// How long the leader waits for the other instance to register
+const REGISTER_TIMEOUT_MS: u32 = 1000;
+
+fn ping_pong_command(command_num: u32) -> Result<u32, ErrorCode> {
+    DefaultSyscalls::command(PING_PONG_DRIVER_NUM, command_num, 0, 0).to_result()
+}
+
+fn fail(reason: &str) -> ! {
+    println!("Test test_syscall_perf failed: {}", reason);
+    test_exit(1)
+}
+
+#[allow(unused)]
+pub(crate) fn test_syscall_perf() {
+    let turn: Cell<bool> = Cell::new(false);
+    share::scope(|subscribe| {
+        if DefaultSyscalls::subscribe::<_, _, DefaultConfig, PING_PONG_DRIVER_NUM, PING_PONG_TURN>(
+            subscribe, &turn,
+        )
+        .is_err()
+        {
+            fail("cannot subscribe to the ping-pong driver");
+        }
+        match ping_pong_command(PING_PONG_REGISTER) {
+            Ok(0) => lead(&turn),
+            Ok(_) => answer(&turn),
+            Err(_) => fail("cannot register with the ping-pong driver"),
+        }
+    });
+}
+
+/// Waits until the other instance passes the turn.
+fn wait_turn(turn: &Cell<bool>) {
+    while !turn.get() {
+        DefaultSyscalls::yield_wait();
+    }
+    turn.set(false);
+}
+
+/// Passes the turn back whenever the other instance passes it, until the leader exits
+/// the emulator.
+fn answer(turn: &Cell<bool>) -> ! {
+    loop {
+        wait_turn(turn);
+        if ping_pong_command(PING_PONG_PASS).is_err() {
+            fail("cannot pass the turn");
+        }
+    }
+}
+
+fn lead(turn: &Cell<bool>) {
+    println!("Starting test_syscall_perf");
+
+    // The other instance has to wait for its turn before the switches are measured
+    let mut waited = 0;
+    while ping_pong_command(PING_PONG_REGISTERED).unwrap_or_default() < 2 {
+        if waited == REGISTER_TIMEOUT_MS {
+            fail("the other instance did not register");
+        }
+        Alarm::<DefaultSyscalls>::sleep_for(Milliseconds(1)).ok();
+        waited += 1;
+    }
+
+    // Command syscalls, reading the alarm ticks
+    let start = Alarm::<DefaultSyscalls>::get_ticks().unwrap_or_default();
+    for _ in 0..ITERATIONS {
+        if Alarm::<DefaultSyscalls>::get_ticks().is_err() {
+            fail("cannot read the alarm ticks");
+        }
+    }
+    let command_ticks = Alarm::<DefaultSyscalls>::get_ticks()
+        .unwrap_or_default()
+        .wrapping_sub(start);
+
+    // Yield syscalls with no upcall pending
+    let start = Alarm::<DefaultSyscalls>::get_ticks().unwrap_or_default();
+    for _ in 0..ITERATIONS {
+        DefaultSyscalls::yield_no_wait();
+    }
+    let yield_ticks = Alarm::<DefaultSyscalls>::get_ticks()
+        .unwrap_or_default()
+        .wrapping_sub(start);
+
+    // Rounds of two process switches: to the other instance and back
+    let start = Alarm::<DefaultSyscalls>::get_ticks().unwrap_or_default();
+    for _ in 0..ITERATIONS {
+        if ping_pong_command(PING_PONG_PASS).unwrap_or_default() == 0 {
+            fail("no other instance to pass the turn to");
+        }
+        wait_turn(turn);
+    }
+    let switch_ticks = Alarm::<DefaultSyscalls>::get_ticks()
+        .unwrap_or_default()
+        .wrapping_sub(start);
+
+    if command_ticks == 0 || yield_ticks == 0 || switch_ticks == 0 {
+        println!(
+            "Test test_syscall_perf failed: the alarm did not advance (command_ticks={} yield_ticks={} switch_ticks={})",
+            command_ticks, yield_ticks, switch_ticks
+        );
+        test_exit(1);
+    }
+
+    println!(
+        "SYSCALL_PERF iterations={} command_ticks={} yield_ticks={} switch_ticks={}",
+        ITERATIONS, command_ticks, yield_ticks, switch_ticks
+    );
+    println!("Test test_syscall_perf passed");
+}
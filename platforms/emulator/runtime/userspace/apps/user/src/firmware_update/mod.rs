@@ -12,10 +12,14 @@ use libtock_console::Console;
 use alloc::boxed::Box;
 use async_trait::async_trait;
 use core::fmt::Debug;
-use libapi_caliptra::firmware_update::StagingMemory;
+use libapi_caliptra::firmware_update::{CheckpointStorage, StagingMemory};
 use libsyscall_caliptra::dma::{DMASource, DMATransaction, DMA as DMASyscall};
+use libsyscall_caliptra::flash::SpiFlash;
 use libtock_platform::ErrorCode;
 use mcu_config_emulator::dma::mcu_sram_to_axi_address;
+use mcu_config_emulator::flash::{
+    FW_UPDATE_CHECKPOINT_OFFSET, FW_UPDATE_CHECKPOINT_SIZE, PARTITION_TABLE,
+};
 
 const DMA_TRANSFER_SIZE: usize = 512;
 const DEVICE_EXTERNAL_SRAM_BASE: u64 = 0x2000_0000_0000_0000;
@@ -23,7 +27,10 @@ const DEVICE_EXTERNAL_SRAM_BASE: u64 = 0x2000_0000_0000_0000;
 #[embassy_executor::task]
 pub async fn firmware_update_task() {
     match firmware_update().await {
-        Ok(_) => romtime::test_exit(0),
+        Ok(_) => {
+            romtime::milestone(romtime::Milestone::UpdateComplete);
+            romtime::test_exit(0)
+        }
         Err(_) => romtime::test_exit(1),
     }
 }
@@ -36,8 +43,12 @@ async fn firmware_update() -> Result<(), ErrorCode> {
         descriptors: &config::fw_update_consts::DESCRIPTOR.get()[..],
         fw_params: config::fw_update_consts::FIRMWARE_PARAMS.get(),
     };
-    let mut updater: FirmwareUpdater =
-        FirmwareUpdater::new(STAGING_MEMORY.get(), &fw_params, EXECUTOR.get().spawner());
+    let mut updater: FirmwareUpdater = FirmwareUpdater::new(
+        STAGING_MEMORY.get(),
+        Some(CHECKPOINT_STORAGE.get()),
+        &fw_params,
+        EXECUTOR.get().spawner(),
+    );
     updater.start().await?;
 
     Ok(())
@@ -98,3 +109,47 @@ impl Debug for ExternalRAM {
         Ok(())
     }
 }
+
+pub static CHECKPOINT_STORAGE: embassy_sync::lazy_lock::LazyLock<FlashCheckpointStorage> =
+    embassy_sync::lazy_lock::LazyLock::new(|| FlashCheckpointStorage::new());
+
+/// Keeps the firmware download checkpoint in the partition table flash partition.
+pub struct FlashCheckpointStorage {
+    flash_syscall: SpiFlash<DefaultSyscalls>,
+}
+
+impl FlashCheckpointStorage {
+    pub fn new() -> Self {
+        FlashCheckpointStorage {
+            flash_syscall: SpiFlash::new(PARTITION_TABLE.driver_num),
+        }
+    }
+}
+
+#[async_trait]
+impl CheckpointStorage for FlashCheckpointStorage {
+    async fn read(&self, data: &mut [u8]) -> Result<(), ErrorCode> {
+        self.flash_syscall
+            .read(FW_UPDATE_CHECKPOINT_OFFSET, data.len(), data)
+            .await
+    }
+
+    async fn write(&self, data: &[u8]) -> Result<(), ErrorCode> {
+        if data.len() > FW_UPDATE_CHECKPOINT_SIZE {
+            return Err(ErrorCode::Size);
+        }
+        // Flash writes can only clear bits
+        self.flash_syscall
+            .erase(FW_UPDATE_CHECKPOINT_OFFSET, FW_UPDATE_CHECKPOINT_SIZE)
+            .await?;
+        self.flash_syscall
+            .write(FW_UPDATE_CHECKPOINT_OFFSET, data.len(), data)
+            .await
+    }
+}
+
+impl Debug for FlashCheckpointStorage {
+    fn fmt(&self, _f: &mut core::fmt::Formatter<'_>) -> core::fmt::Result {
+        Ok(())
+    }
+}
@@ -2,7 +2,10 @@
 
 #![cfg(any(
     feature = "test-pldm-streaming-boot",
-    feature = "test-flash-based-boot"
+    feature = "test-pldm-streaming-boot-perf",
+    feature = "test-flash-based-boot",
+    feature = "test-flash-based-boot-perf",
+    feature = "test-flash-based-boot-warm-reset"
 ))]
 pub mod streaming_boot_consts {
     use embassy_sync::lazy_lock::LazyLock;
@@ -59,4 +62,19 @@ pub mod streaming_boot_consts {
     pub const IMAGE_ID1: u32 = 4096;
     #[allow(unused)]
     pub const IMAGE_ID2: u32 = 4097;
+
+    // Images loaded by the boot performance tests, with consecutive IDs starting at
+    // IMAGE_ID1. The SoC manifest and the PLDM package must contain all of them.
+    #[allow(unused)]
+    pub const PERF_IMAGE_COUNT: usize = 16;
+    #[allow(unused)]
+    pub const PERF_IMAGE_IDS: [u32; PERF_IMAGE_COUNT] = {
+        let mut ids = [0; PERF_IMAGE_COUNT];
+        let mut i = 0;
+        while i < PERF_IMAGE_COUNT {
+            ids[i] = IMAGE_ID1 + i as u32;
+            i += 1;
+        }
+        ids
+    };
 }
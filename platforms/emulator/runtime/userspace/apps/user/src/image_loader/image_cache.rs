@@ -0,0 +1,55 @@
+// Licensed under the Apache-2.0 license
+
+extern crate alloc;
+
+use alloc::boxed::Box;
+use async_trait::async_trait;
+use libapi_caliptra::image_loading::ImageCacheStorage;
+use libsyscall_caliptra::dma::{DMASource, DMATransaction, DMA as DMASyscall};
+use libtock_platform::ErrorCode;
+use mcu_config_emulator::dma::mcu_sram_to_axi_address;
+
+const DMA_TRANSFER_SIZE: usize = 512;
+/// The last 4 KiB of the 1 MiB external SRAM, which SoC images are not loaded to. Like the
+/// images, it keeps its contents across a warm reset of the MCU.
+const IMAGE_CACHE_ADDRESS: u64 = 0x2000_0000_0000_0000 + 0x000F_F000;
+
+/// Keeps the image cache record in the external SRAM.
+pub struct ExternalRamImageCache {
+    dma_syscall: DMASyscall,
+}
+
+impl ExternalRamImageCache {
+    pub fn new() -> Self {
+        ExternalRamImageCache {
+            dma_syscall: DMASyscall::new(),
+        }
+    }
+}
+
+#[async_trait(?Send)]
+impl ImageCacheStorage for ExternalRamImageCache {
+    async fn read(&self, data: &mut [u8]) -> Result<(), ErrorCode> {
+        for (i, chunk) in data.chunks_mut(DMA_TRANSFER_SIZE).enumerate() {
+            let transaction = DMATransaction {
+                byte_count: chunk.len(),
+                source: DMASource::Address(IMAGE_CACHE_ADDRESS + (i * DMA_TRANSFER_SIZE) as u64),
+                dest_addr: mcu_sram_to_axi_address(chunk.as_mut_ptr() as u32),
+            };
+            self.dma_syscall.xfer(&transaction).await?;
+        }
+        Ok(())
+    }
+
+    async fn write(&self, data: &[u8]) -> Result<(), ErrorCode> {
+        for (i, chunk) in data.chunks(DMA_TRANSFER_SIZE).enumerate() {
+            let transaction = DMATransaction {
+                byte_count: chunk.len(),
+                source: DMASource::Address(mcu_sram_to_axi_address(chunk.as_ptr() as u32)),
+                dest_addr: IMAGE_CACHE_ADDRESS + (i * DMA_TRANSFER_SIZE) as u64,
+            };
+            self.dma_syscall.xfer(&transaction).await?;
+        }
+        Ok(())
+    }
+}
@@ -3,11 +3,14 @@
 #[cfg(any(
     feature = "test-pldm-discovery",
     feature = "test-pldm-fw-update",
-    feature = "test-pldm-fw-update-e2e"
+    feature = "test-pldm-fw-update-e2e",
+    feature = "test-pldm-fw-update-perf"
 ))]
 mod pldm_fdops_mock;
 
 mod config;
+#[cfg(feature = "test-flash-based-boot-warm-reset")]
+mod image_cache;
 
 use core::fmt::Write;
 #[allow(unused)]
@@ -27,6 +30,8 @@ use mcu_config_emulator::flash::{
 };
 #[allow(unused)]
 use pldm_lib::daemon::PldmService;
+#[allow(unused)]
+use pldm_lib::timer::AsyncAlarm;
 
 #[allow(unused)]
 use crate::EXECUTOR;
@@ -36,7 +41,7 @@ use embassy_sync::blocking_mutex::raw::CriticalSectionRawMutex;
 use embassy_sync::{lazy_lock::LazyLock, signal::Signal};
 #[allow(unused)]
 use libapi_caliptra::image_loading::{
-    FlashImageLoader, ImageLoader, PldmFirmwareDeviceParams, PldmImageLoader,
+    FlashImageLoader, ImageLoader, PldmFirmwareDeviceParams, PldmImageLoader, ReauthorizePolicy,
 };
 use libsyscall_caliptra::DefaultSyscalls;
 #[allow(unused)]
@@ -46,10 +51,14 @@ use zerocopy::{FromBytes, IntoBytes};
 pub async fn image_loading_task() {
     #[cfg(any(
         feature = "test-pldm-streaming-boot",
+        feature = "test-pldm-streaming-boot-perf",
         feature = "test-flash-based-boot",
+        feature = "test-flash-based-boot-perf",
+        feature = "test-flash-based-boot-warm-reset",
         feature = "test-pldm-discovery",
         feature = "test-pldm-fw-update",
         feature = "test-pldm-fw-update-e2e",
+        feature = "test-pldm-fw-update-perf",
     ))]
     {
         match image_loading().await {
@@ -72,11 +81,33 @@ async fn image_loading() -> Result<(), ErrorCode> {
         let pldm_image_loader: PldmImageLoader =
             PldmImageLoader::new(&fw_params, EXECUTOR.get().spawner());
         pldm_image_loader
-            .load_and_authorize(config::streaming_boot_consts::IMAGE_ID1)
+            .load_and_authorize_all(&[
+                config::streaming_boot_consts::IMAGE_ID1,
+                config::streaming_boot_consts::IMAGE_ID2,
+            ])
             .await?;
+        pldm_image_loader.finalize().await?;
+    }
+    #[cfg(feature = "test-pldm-streaming-boot-perf")]
+    {
+        let fw_params = PldmFirmwareDeviceParams {
+            descriptors: &config::streaming_boot_consts::DESCRIPTOR.get()[..],
+            fw_params: config::streaming_boot_consts::STREAMING_BOOT_FIRMWARE_PARAMS.get(),
+        };
+        let pldm_image_loader: PldmImageLoader =
+            PldmImageLoader::new(&fw_params, EXECUTOR.get().spawner());
+        let start = AsyncAlarm::<DefaultSyscalls>::get_milliseconds()?;
         pldm_image_loader
-            .load_and_authorize(config::streaming_boot_consts::IMAGE_ID2)
+            .load_and_authorize_all(&config::streaming_boot_consts::PERF_IMAGE_IDS)
             .await?;
+        let elapsed = AsyncAlarm::<DefaultSyscalls>::get_milliseconds()? - start;
+        writeln!(
+            console_writer,
+            "STREAMING_BOOT_PERF: images={} total_ms={}",
+            config::streaming_boot_consts::PERF_IMAGE_COUNT,
+            elapsed
+        )
+        .unwrap();
         pldm_image_loader.finalize().await?;
     }
     #[cfg(feature = "test-flash-based-boot")]
@@ -92,11 +123,87 @@ async fn image_loading() -> Result<(), ErrorCode> {
         let flash_syscall = SpiFlash::new(active_partition.driver_num);
         let flash_image_loader: FlashImageLoader = FlashImageLoader::new(flash_syscall);
         flash_image_loader
-            .load_and_authorize(config::streaming_boot_consts::IMAGE_ID1)
+            .load_and_authorize_all(&[
+                config::streaming_boot_consts::IMAGE_ID1,
+                config::streaming_boot_consts::IMAGE_ID2,
+            ])
             .await?;
+        boot_config
+            .set_partition_status(active_partition_id, PartitionStatus::BootSuccessful)
+            .await
+            .map_err(|_| ErrorCode::Fail)?;
+
+        // Each boot appends its boot count to the boot configuration journal, so that
+        // repeated boots fill the journal and wrap it into its other bank
+        let boot_count = boot_config
+            .increment_boot_count(active_partition_id)
+            .await
+            .map_err(|_| ErrorCode::Fail)?;
+        writeln!(console_writer, "Boot count {}", boot_count).unwrap();
+    }
+    #[cfg(feature = "test-flash-based-boot-perf")]
+    {
+        let mut boot_config = FlashBootConfig::new();
+        let active_partition_id = boot_config
+            .get_active_partition()
+            .await
+            .map_err(|_| ErrorCode::Fail)?;
+        let active_partition = boot_config
+            .get_partition_from_id(active_partition_id)
+            .map_err(|_| ErrorCode::Fail)?;
+        let flash_syscall = SpiFlash::new(active_partition.driver_num);
+        let flash_image_loader: FlashImageLoader = FlashImageLoader::new(flash_syscall);
+        let start = AsyncAlarm::<DefaultSyscalls>::get_milliseconds()?;
         flash_image_loader
-            .load_and_authorize(config::streaming_boot_consts::IMAGE_ID2)
+            .load_and_authorize_all(&config::streaming_boot_consts::PERF_IMAGE_IDS)
             .await?;
+        let elapsed = AsyncAlarm::<DefaultSyscalls>::get_milliseconds()? - start;
+        writeln!(
+            console_writer,
+            "FLASH_BOOT_PERF: images={} total_ms={}",
+            config::streaming_boot_consts::PERF_IMAGE_COUNT,
+            elapsed
+        )
+        .unwrap();
+        boot_config
+            .set_partition_status(active_partition_id, PartitionStatus::BootSuccessful)
+            .await
+            .map_err(|_| ErrorCode::Fail)?;
+    }
+    #[cfg(feature = "test-flash-based-boot-warm-reset")]
+    {
+        // The images and the image cache are left in place between the two boots, as they
+        // are by a warm reset of the MCU.
+        let mut boot_config = FlashBootConfig::new();
+        let active_partition_id = boot_config
+            .get_active_partition()
+            .await
+            .map_err(|_| ErrorCode::Fail)?;
+        let active_partition = boot_config
+            .get_partition_from_id(active_partition_id)
+            .map_err(|_| ErrorCode::Fail)?;
+        let image_cache = image_cache::ExternalRamImageCache::new();
+        let mut elapsed = [0; 2];
+        for boot_ms in elapsed.iter_mut() {
+            let flash_image_loader = FlashImageLoader::with_image_cache(
+                SpiFlash::new(active_partition.driver_num),
+                &image_cache,
+                ReauthorizePolicy::CachedDigest,
+            );
+            let start = AsyncAlarm::<DefaultSyscalls>::get_milliseconds()?;
+            flash_image_loader
+                .load_and_authorize_all(&config::streaming_boot_consts::PERF_IMAGE_IDS)
+                .await?;
+            *boot_ms = AsyncAlarm::<DefaultSyscalls>::get_milliseconds()? - start;
+        }
+        writeln!(
+            console_writer,
+            "WARM_RESET_PERF: images={} cold_ms={} warm_ms={}",
+            config::streaming_boot_consts::PERF_IMAGE_COUNT,
+            elapsed[0],
+            elapsed[1]
+        )
+        .unwrap();
         boot_config
             .set_partition_status(active_partition_id, PartitionStatus::BootSuccessful)
             .await
@@ -106,7 +213,8 @@ async fn image_loading() -> Result<(), ErrorCode> {
     #[cfg(any(
         feature = "test-pldm-discovery",
         feature = "test-pldm-fw-update",
-        feature = "test-pldm-fw-update-e2e"
+        feature = "test-pldm-fw-update-e2e",
+        feature = "test-pldm-fw-update-perf"
     ))]
     {
         let fdops = pldm_fdops_mock::FdOpsObject::new();
@@ -21,7 +21,18 @@ use pldm_common::util::fw_component::FirmwareComponent;
 use pldm_lib::firmware_device::fd_ops::{ComponentOperation, FdOps, FdOpsError};
 
 const FD_DESCRIPTORS_COUNT: usize = 1;
+#[cfg(not(feature = "test-pldm-fw-update-perf"))]
 const FD_FW_COMPONENTS_COUNT: usize = 1;
+// Maximum length of the firmware data requested at once
+#[cfg(not(feature = "test-pldm-fw-update-perf"))]
+const FD_REQUEST_SIZE: usize = 64;
+
+// The update perf test sends packages of up to 4 components, with identifiers 1 to 4, and
+// leaves the chunk size to the transfer size offered by the UA.
+#[cfg(feature = "test-pldm-fw-update-perf")]
+const FD_FW_COMPONENTS_COUNT: usize = 4;
+#[cfg(feature = "test-pldm-fw-update-perf")]
+const FD_REQUEST_SIZE: usize = pldm_lib::config::FD_MAX_XFER_SIZE;
 
 // This is a dummy UUID for development. The actual UUID is assigned by the vendor.
 const UUID: [u8; 16] = [
@@ -42,21 +53,24 @@ static FIRMWARE_PARAMS: LazyLock<FirmwareParameters> = LazyLock::new(|| {
         PldmFirmwareVersion::new(0x87654321, &pending_firmware_string, Some("20250213"));
     let comp_activation_methods = ComponentActivationMethods(0x0001);
     let capabilities_during_update = FirmwareDeviceCapability(0x0010);
-    let component_parameter_entry = ComponentParameterEntry::new(
-        ComponentClassification::Firmware,
-        0x0001,
-        0,
-        &active_firmware_version,
-        &pending_firmware_version,
-        comp_activation_methods,
-        capabilities_during_update,
-    );
+    let component_parameter_entries: [ComponentParameterEntry; FD_FW_COMPONENTS_COUNT] =
+        core::array::from_fn(|i| {
+            ComponentParameterEntry::new(
+                ComponentClassification::Firmware,
+                i as u16 + 1,
+                0,
+                &active_firmware_version,
+                &pending_firmware_version,
+                comp_activation_methods,
+                capabilities_during_update,
+            )
+        });
     FirmwareParameters::new(
         capabilities_during_update,
         FD_FW_COMPONENTS_COUNT as u16,
         &active_firmware_string,
         &pending_firmware_string,
-        &[component_parameter_entry],
+        &component_parameter_entries,
     )
 });
 
@@ -148,7 +162,7 @@ impl FdOps for FdOpsObject {
         match component.comp_image_size {
             Some(image_size) => {
                 let offset = download_ctx.offset;
-                let length = (image_size as usize - offset).min(64);
+                let length = (image_size as usize - offset).min(FD_REQUEST_SIZE);
                 Ok((offset, length))
             }
             None => Err(FdOpsError::ComponentError),
@@ -10,7 +10,10 @@ use embassy_sync::blocking_mutex::raw::CriticalSectionRawMutex;
 #[allow(unused)]
 use embassy_sync::{lazy_lock::LazyLock, signal::Signal};
 use libtockasync::TockExecutor;
-#[cfg(feature = "test-firmware-update")]
+#[cfg(any(
+    feature = "test-firmware-update",
+    feature = "test-firmware-update-resume"
+))]
 mod firmware_update;
 mod image_loader;
 mod spdm;
@@ -30,6 +33,10 @@ impl romtime::Exit for EmulatorExiter {
     }
 }
 
+pub(crate) static mut EMULATOR_MILESTONE_RECORDER: romtime::MmioMilestoneRecorder<
+    { mcu_config_emulator::EMU_CTRL_MILESTONE_ADDR },
+> = romtime::MmioMilestoneRecorder {};
+
 pub static EXECUTOR: LazyLock<TockExecutor> = LazyLock::new(TockExecutor::new);
 
 #[cfg(not(target_arch = "riscv32"))]
@@ -54,6 +61,8 @@ async fn start() {
     unsafe {
         #[allow(static_mut_refs)]
         romtime::set_exiter(&mut EMULATOR_EXITER);
+        #[allow(static_mut_refs)]
+        romtime::set_milestone_recorder(&mut EMULATOR_MILESTONE_RECORDER);
     }
     async_main().await;
 }
@@ -71,7 +80,10 @@ pub(crate) async fn async_main() {
         .spawn(image_loader::image_loading_task())
         .unwrap();
 
-    #[cfg(feature = "test-firmware-update")]
+    #[cfg(any(
+        feature = "test-firmware-update",
+        feature = "test-firmware-update-resume"
+    ))]
     EXECUTOR
         .get()
         .spawner()
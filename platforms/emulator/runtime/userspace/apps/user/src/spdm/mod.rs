@@ -5,6 +5,7 @@ mod device_cert_store;
 mod endorsement_certs;
 
 use core::fmt::Write;
+use core::sync::atomic::{AtomicBool, Ordering};
 use device_cert_store::{initialize_cert_store, SharedCertStore};
 use embassy_executor::Spawner;
 use libsyscall_caliptra::doe;
@@ -27,6 +28,17 @@ const SPDM_VERSIONS: &[SpdmVersion] = &[SpdmVersion::V12, SpdmVersion::V13];
 // Calitra Crypto timeout exponent (2^20 us)
 const CALIPTRA_SPDM_CT_EXPONENT: u8 = 20;
 
+static FIRST_RESPONSE_SENT: AtomicBool = AtomicBool::new(false);
+
+// Records the first SPDM response sent over any transport
+fn first_response_sent() {
+    // The responders run on a single-threaded executor, so a load and a store suffice.
+    if !FIRST_RESPONSE_SENT.load(Ordering::Relaxed) {
+        FIRST_RESPONSE_SENT.store(true, Ordering::Relaxed);
+        romtime::milestone(romtime::Milestone::FirstSpdmResponse);
+    }
+}
+
 #[embassy_executor::task]
 pub(crate) async fn spdm_task(spawner: Spawner) {
     let mut console_writer = Console::<DefaultSyscalls>::writer();
@@ -103,6 +115,7 @@ async fn spdm_mctp_responder() {
         let result = ctx.process_message(&mut msg_buffer).await;
         match result {
             Ok(_) => {
+                first_response_sent();
                 writeln!(cw, "SPDM_MCTP_RESPONDER: Process message successfully").unwrap();
             }
             Err(e) => {
@@ -153,6 +166,7 @@ async fn spdm_doe_responder() {
         let result = ctx.process_message(&mut msg_buffer).await;
         match result {
             Ok(_) => {
+                first_response_sent();
                 writeln!(cw, "SPDM_DOE_RESPONDER: Process message successfully").unwrap();
             }
             Err(e) => {
@@ -485,7 +485,7 @@ pub unsafe fn main() {
         mux_mctp,
         MessageType::Spdm,
     )
-    .finalize(mctp_driver_component_static!(InternalTimers));
+    .finalize(mctp_driver_component_static!(InternalTimers, held_request));
     romtime::println!("[mcu-runtime] MCTP SPDM driver component initialized");
 
     let mctp_secure_spdm = mcu_components::mctp_driver::MCTPDriverComponent::new(
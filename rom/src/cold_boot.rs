@@ -20,7 +20,7 @@ use caliptra_api::CaliptraApiError;
 use caliptra_api::SocManager;
 use core::fmt::Write;
 use registers_generated::fuses::Fuses;
-use romtime::{CaliptraSoC, HexWord};
+use romtime::{CaliptraSoC, HexWord, Milestone};
 use zerocopy::{transmute, IntoBytes};
 
 pub struct ColdBoot {}
@@ -32,7 +32,7 @@ impl ColdBoot {
             .enumerate()
             .filter(|(_, partition)| **partition)
         {
-            romtime::println!(
+            romtime::logln!(
                 "[mcu-rom] Executing FE_PROG command for partition {}",
                 partition
             );
@@ -56,13 +56,13 @@ impl ColdBoot {
             ) {
                 match err {
                     CaliptraApiError::MailboxCmdFailed(code) => {
-                        romtime::println!(
+                        romtime::logln!(
                             "[mcu-rom] Error sending mailbox command: {}",
                             HexWord(code)
                         );
                     }
                     _ => {
-                        romtime::println!("[mcu-rom] Error sending mailbox command");
+                        romtime::logln!("[mcu-rom] Error sending mailbox command");
                     }
                 }
                 fatal_error(6);
@@ -70,13 +70,13 @@ impl ColdBoot {
             if let Err(err) = soc_manager.finish_mailbox_resp(8, 8) {
                 match err {
                     CaliptraApiError::MailboxCmdFailed(code) => {
-                        romtime::println!(
+                        romtime::logln!(
                             "[mcu-rom] Error finishing mailbox command: {}",
                             HexWord(code)
                         );
                     }
                     _ => {
-                        romtime::println!("[mcu-rom] Error finishing mailbox command");
+                        romtime::logln!("[mcu-rom] Error finishing mailbox command");
                     }
                 }
                 fatal_error(7);
@@ -87,7 +87,7 @@ impl ColdBoot {
 
 impl BootFlow for ColdBoot {
     fn run(env: &mut RomEnv, params: RomParameters) -> ! {
-        romtime::println!("[mcu-rom] Starting cold boot flow");
+        romtime::logln!("[mcu-rom] Starting cold boot flow");
 
         // Create local references to minimize code changes
         let mci = &env.mci;
@@ -99,7 +99,7 @@ impl BootFlow for ColdBoot {
         let soc_manager = &mut env.soc_manager;
         let straps = &env.straps;
 
-        romtime::println!("[mcu-rom] Setting Caliptra boot go");
+        romtime::logln!("[mcu-rom] Setting Caliptra boot go");
         mci.caliptra_boot_go();
 
         lc.init().unwrap();
@@ -109,22 +109,22 @@ impl BootFlow for ColdBoot {
                 romtime::println!("[mcu-rom] Error transitioning lifecycle: {:?}", err);
                 fatal_error(err.into());
             }
-            romtime::println!("Lifecycle transition successful; halting");
+            romtime::logln!("Lifecycle transition successful; halting");
             loop {}
         }
 
         // FPGA has problems with the integrity check, so we disable it
         if let Err(err) = otp.init() {
-            romtime::println!("[mcu-rom] Error initializing OTP: {}", HexWord(err as u32));
+            romtime::logln!("[mcu-rom] Error initializing OTP: {}", HexWord(err as u32));
             fatal_error(err as u32);
         }
 
         if let Some(tokens) = params.burn_lifecycle_tokens.as_ref() {
-            romtime::println!("[mcu-rom] Burning lifecycle tokens");
+            romtime::logln!("[mcu-rom] Burning lifecycle tokens");
             if otp.check_error().is_some() {
-                romtime::println!("[mcu-rom] OTP error: {}", HexWord(otp.status()));
+                romtime::logln!("[mcu-rom] OTP error: {}", HexWord(otp.status()));
                 otp.print_errors();
-                romtime::println!("[mcu-rom] Halting");
+                romtime::logln!("[mcu-rom] Halting");
                 romtime::test_exit(1);
             }
 
@@ -135,10 +135,10 @@ impl BootFlow for ColdBoot {
                     HexWord(otp.status())
                 );
                 otp.print_errors();
-                romtime::println!("[mcu-rom] Halting");
+                romtime::logln!("[mcu-rom] Halting");
                 romtime::test_exit(1);
             }
-            romtime::println!("[mcu-rom] Lifecycle token burning successful; halting");
+            romtime::logln!("[mcu-rom] Lifecycle token burning successful; halting");
             loop {}
         }
 
@@ -147,7 +147,7 @@ impl BootFlow for ColdBoot {
             match otp.read_fuses() {
                 Ok(fuses) => fuses,
                 Err(e) => {
-                    romtime::println!("Error reading fuses: {}", HexWord(e as u32));
+                    romtime::logln!("Error reading fuses: {}", HexWord(e as u32));
                     fatal_error(1);
                 }
             }
@@ -177,6 +177,7 @@ impl BootFlow for ColdBoot {
                 ..Default::default()
             }
         };
+        romtime::milestone(Milestone::FusesRead);
 
         // TODO: Handle flash image loading with the watchdog enabled
         if params.flash_partition_driver.is_none() {
@@ -187,61 +188,62 @@ impl BootFlow for ColdBoot {
             mci.configure_wdt(straps.mcu_wdt_cfg0, straps.mcu_wdt_cfg1);
         }
 
-        romtime::println!("[mcu-rom] Initializing I3C");
+        romtime::logln!("[mcu-rom] Initializing I3C");
         i3c.configure(straps.i3c_static_addr, true);
 
-        romtime::println!(
+        romtime::logln!(
             "[mcu-rom] Waiting for Caliptra to be ready for fuses: {}",
             soc.ready_for_fuses()
         );
         while !soc.ready_for_fuses() {}
 
-        romtime::println!("[mcu-rom] Writing fuses to Caliptra");
-        romtime::println!(
+        romtime::logln!("[mcu-rom] Writing fuses to Caliptra");
+        romtime::logln!(
             "[mcu-rom] Setting Caliptra mailbox user 0 to {}",
             HexWord(straps.axi_user)
         );
 
         soc.set_cptra_mbox_valid_axi_user(0, straps.axi_user);
-        romtime::println!("[mcu-rom] Locking Caliptra mailbox user 0");
+        romtime::logln!("[mcu-rom] Locking Caliptra mailbox user 0");
         soc.set_cptra_mbox_axi_user_lock(0, 1);
 
-        romtime::println!("[mcu-rom] Setting fuse user");
+        romtime::logln!("[mcu-rom] Setting fuse user");
         soc.set_cptra_fuse_valid_axi_user(straps.axi_user);
-        romtime::println!("[mcu-rom] Locking fuse user");
+        romtime::logln!("[mcu-rom] Locking fuse user");
         soc.set_cptra_fuse_axi_user_lock(1);
-        romtime::println!("[mcu-rom] Setting TRNG user");
+        romtime::logln!("[mcu-rom] Setting TRNG user");
         soc.set_cptra_trng_valid_axi_user(straps.axi_user);
-        romtime::println!("[mcu-rom] Locking TRNG user");
+        romtime::logln!("[mcu-rom] Locking TRNG user");
         soc.set_cptra_trng_axi_user_lock(1);
-        romtime::println!("[mcu-rom] Setting DMA user");
+        romtime::logln!("[mcu-rom] Setting DMA user");
         soc.set_ss_caliptra_dma_axi_user(straps.axi_user);
 
         soc.populate_fuses(&fuses, params.program_field_entropy.iter().any(|x| *x));
-        romtime::println!("[mcu-rom] Setting Caliptra fuse write done");
+        romtime::logln!("[mcu-rom] Setting Caliptra fuse write done");
         soc.fuse_write_done();
         while soc.ready_for_fuses() {}
 
-        romtime::println!("[mcu-rom] Waiting for Caliptra to be ready for mbox",);
+        romtime::logln!("[mcu-rom] Waiting for Caliptra to be ready for mbox",);
         while !soc.ready_for_mbox() {}
-        romtime::println!("[mcu-rom] Caliptra is ready for mailbox commands",);
+        romtime::logln!("[mcu-rom] Caliptra is ready for mailbox commands",);
+        romtime::milestone(Milestone::CaliptraReady);
 
         // tell Caliptra to download firmware from the recovery interface
-        romtime::println!("[mcu-rom] Sending RI_DOWNLOAD_FIRMWARE command",);
+        romtime::logln!("[mcu-rom] Sending RI_DOWNLOAD_FIRMWARE command",);
         if let Err(err) =
             soc_manager.start_mailbox_req(CommandId::RI_DOWNLOAD_FIRMWARE.into(), 0, [].into_iter())
         {
             match err {
                 CaliptraApiError::MailboxCmdFailed(code) => {
-                    romtime::println!("[mcu-rom] Error sending mailbox command: {}", HexWord(code));
+                    romtime::logln!("[mcu-rom] Error sending mailbox command: {}", HexWord(code));
                 }
                 _ => {
-                    romtime::println!("[mcu-rom] Error sending mailbox command");
+                    romtime::logln!("[mcu-rom] Error sending mailbox command");
                 }
             }
             fatal_error(4);
         }
-        romtime::println!(
+        romtime::logln!(
             "[mcu-rom] Done sending RI_DOWNLOAD_FIRMWARE command: status {}",
             HexWord(u32::from(
                 soc_manager.soc_mbox().status().read().mbox_fsm_ps()
@@ -250,13 +252,13 @@ impl BootFlow for ColdBoot {
         if let Err(err) = soc_manager.finish_mailbox_resp(8, 8) {
             match err {
                 CaliptraApiError::MailboxCmdFailed(code) => {
-                    romtime::println!(
+                    romtime::logln!(
                         "[mcu-rom] Error finishing mailbox command: {}",
                         HexWord(code)
                     );
                 }
                 _ => {
-                    romtime::println!("[mcu-rom] Error finishing mailbox command");
+                    romtime::logln!("[mcu-rom] Error finishing mailbox command");
                 }
             }
             fatal_error(5);
@@ -265,46 +267,48 @@ impl BootFlow for ColdBoot {
         // Loading flash into the recovery flow is only possible in 2.1+.
         if cfg!(feature = "hw-2-1") {
             if let Some(flash_driver) = params.flash_partition_driver {
-                romtime::println!("[mcu-rom] Starting Flash recovery flow");
+                romtime::logln!("[mcu-rom] Starting Flash recovery flow");
+                romtime::milestone(Milestone::FlashRecoveryStart);
 
                 crate::recovery::load_flash_image_to_recovery(i3c_base, flash_driver)
                     .map_err(|_| fatal_error(1))
                     .unwrap();
 
-                romtime::println!("[mcu-rom] Flash Recovery flow complete");
+                romtime::milestone(Milestone::FlashRecoveryComplete);
+                romtime::logln!("[mcu-rom] Flash Recovery flow complete");
             }
         }
 
-        romtime::println!("[mcu-rom] Waiting for firmware to be ready");
+        romtime::logln!("[mcu-rom] Waiting for firmware to be ready");
         while !soc.fw_ready() {}
-        romtime::println!("[mcu-rom] Firmware is ready");
+        romtime::logln!("[mcu-rom] Firmware is ready");
 
         // Check that the firmware was actually loaded before jumping to it
         let firmware_ptr = unsafe { MCU_MEMORY_MAP.sram_offset as *const u32 };
         // Safety: this address is valid
         if unsafe { core::ptr::read_volatile(firmware_ptr) } == 0 {
-            romtime::println!("Invalid firmware detected; halting");
+            romtime::logln!("Invalid firmware detected; halting");
             fatal_error(1);
         }
-        romtime::println!("[mcu-rom] Firmware load detected");
+        romtime::logln!("[mcu-rom] Firmware load detected");
 
         // wait for the Caliptra RT to be ready
         // this is a busy loop, but it should be very short
-        romtime::println!(
+        romtime::logln!(
             "[mcu-rom] Waiting for Caliptra RT to be ready for runtime mailbox commands"
         );
         while !soc.ready_for_runtime() {}
 
-        romtime::println!("[mcu-rom] Finished common initialization");
+        romtime::logln!("[mcu-rom] Finished common initialization");
 
         // program field entropy if requested
         if params.program_field_entropy.iter().any(|x| *x) {
-            romtime::println!("[mcu-rom] Programming field entropy");
+            romtime::logln!("[mcu-rom] Programming field entropy");
             Self::program_field_entropy(&params.program_field_entropy, soc_manager);
         }
 
         // Jump to firmware
-        romtime::println!("[mcu-rom] Jumping to firmware");
+        romtime::logln!("[mcu-rom] Jumping to firmware");
 
         #[cfg(target_arch = "riscv32")]
         unsafe {
@@ -67,7 +67,7 @@ impl<'a> FlashPartition<'a> {
     ///
     /// Returns `Ok(())` if the read operation is successful.
     /// Returns `Err(FlashDrvError::SIZE)` if the requested range exceeds the partition size, or propagates errors from the underlying flash controller.
-    pub fn read(&self, partition_offset: usize, buf: &'a mut [u8]) -> Result<(), FlashDrvError> {
+    pub fn read(&self, partition_offset: usize, buf: &mut [u8]) -> Result<(), FlashDrvError> {
         if partition_offset + buf.len() > self.length {
             return Err(FlashDrvError::SIZE);
         }
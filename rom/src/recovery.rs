@@ -13,6 +13,9 @@ use zerocopy::FromBytes;
 const ACTIVATE_RECOVERY_IMAGE_CMD: u32 = 0xF;
 const BYPASS_CFG_USE_I3C: u32 = 0x0;
 const BYPASS_CFG_AXI_DIRECT: u32 = 0x1;
+/// Image data is read from flash in chunks of this many bytes before being pushed to the
+/// recovery FIFO, so that the flash driver can transfer whole pages at once.
+const TRANSFER_CHUNK_SIZE: usize = 1024;
 
 statemachine! {
     derive_states: [Clone, Copy, Debug],
@@ -341,17 +344,23 @@ pub fn load_flash_image_to_recovery(
                     // If the transfer is complete, we can move to the next state
                     let _ = state_machine.process_event(Events::TransferComplete);
                 } else {
-                    let mut data = [0u8; 4];
+                    let context = state_machine.context_mut();
+                    let remaining = (context.image_size - context.transfer_offset) as usize;
+                    // The FIFO is written in words, round the tail up to a whole word
+                    let len = TRANSFER_CHUNK_SIZE.min((remaining + 3) & !3);
+                    let mut chunk = [0u8; TRANSFER_CHUNK_SIZE];
                     flash_driver
                         .read(
-                            (state_machine.context().flash_offset
-                                + state_machine.context().transfer_offset)
-                                as usize,
-                            &mut data,
+                            (context.flash_offset + context.transfer_offset) as usize,
+                            &mut chunk[..len],
                         )
                         .map_err(|_| ())?;
-                    i3c_periph.tti_tx_data_port.set(u32::from_be_bytes(data));
-                    state_machine.context_mut().transfer_offset += 4; // Simulate writing 4 bytes
+                    for word in chunk[..len].chunks_exact(4) {
+                        i3c_periph
+                            .tti_tx_data_port
+                            .set(u32::from_be_bytes([word[0], word[1], word[2], word[3]]));
+                    }
+                    context.transfer_offset += len as u32;
                 }
             }
 
@@ -0,0 +1,206 @@
+// Licensed under the Apache-2.0 license
+
+//! Deferred formatting of log messages.
+//!
+//! With the `deferred-log` feature, [`crate::logln`] does not format its message on the MCU.
+//! It sends the address of its format string and its arguments as words to a
+//! [`DeferredLogWriter`], and the host formats the message. The format string itself is only
+//! sent the first time the message is logged, and the host keeps it for the next times.
+//!
+//! Without the feature, [`crate::logln`] is the same as [`crate::println`].
+//!
+//! A record is a header word followed by the number of payload words given in the header:
+//! - definition: format string address, string length in bytes, string bytes
+//! - message: format string address, then for each argument a header word (kind in the
+//!   low byte, length in bytes above it) and the argument bytes. The length of an
+//!   integer that fits a word is the size of its type, so that the host formats signed
+//!   values in hexadecimal or binary at their own width.
+//!
+//! Strings and byte arrays are packed into little-endian words and padded with zeros.
+//! The emulator UART decodes these records, see `emulator/periph/src/deferred_log.rs`.
+
+use core::sync::atomic::{AtomicBool, Ordering};
+
+pub const RECORD_MAGIC: u32 = 0xB1;
+pub const RECORD_DEFINE: u32 = 1;
+pub const RECORD_MESSAGE: u32 = 2;
+
+pub const ARG_U32: u32 = 1;
+pub const ARG_I32: u32 = 2;
+pub const ARG_U64: u32 = 3;
+pub const ARG_I64: u32 = 4;
+pub const ARG_BOOL: u32 = 5;
+pub const ARG_STR: u32 = 6;
+pub const ARG_HEX_BYTES: u32 = 7;
+pub const ARG_HEX_WORD: u32 = 8;
+
+pub trait DeferredLogWriter {
+    fn write_word(&mut self, word: u32);
+}
+
+/// Writes deferred log words to a memory-mapped data register at `ADDR`.
+pub struct MmioLogWriter<const ADDR: u32> {}
+
+impl<const ADDR: u32> DeferredLogWriter for MmioLogWriter<ADDR> {
+    fn write_word(&mut self, word: u32) {
+        // Safety: ADDR is the deferred log data register of the platform.
+        unsafe {
+            core::ptr::write_volatile(ADDR as *mut u32, word);
+        }
+    }
+}
+
+pub static mut DEFERRED_LOG_WRITER: Option<&'static mut dyn DeferredLogWriter> = None;
+
+/// Sets the backing writer for `logln` with the `deferred-log` feature.
+pub fn set_deferred_log_writer(writer: &'static mut dyn DeferredLogWriter) {
+    unsafe {
+        DEFERRED_LOG_WRITER = Some(writer);
+    }
+}
+
+/// Argument of a deferred log message.
+pub trait LogArg {
+    /// Number of words following the argument header.
+    fn data_words(&self) -> usize;
+    fn write(&self, writer: &mut dyn DeferredLogWriter);
+}
+
+fn arg_header(kind: u32, len: usize) -> u32 {
+    kind | (len as u32) << 8
+}
+
+fn write_bytes(writer: &mut dyn DeferredLogWriter, bytes: &[u8]) {
+    for chunk in bytes.chunks(4) {
+        let mut word = [0u8; 4];
+        word[..chunk.len()].copy_from_slice(chunk);
+        writer.write_word(u32::from_le_bytes(word));
+    }
+}
+
+macro_rules! impl_word_arg {
+    ($kind:expr, $($ty:ty),*) => {
+        $(
+            impl LogArg for $ty {
+                fn data_words(&self) -> usize {
+                    1
+                }
+                fn write(&self, writer: &mut dyn DeferredLogWriter) {
+                    writer.write_word(arg_header($kind, core::mem::size_of::<$ty>().min(4)));
+                    writer.write_word(*self as u32);
+                }
+            }
+        )*
+    };
+}
+impl_word_arg!(ARG_U32, u8, u16, u32, usize);
+impl_word_arg!(ARG_I32, i8, i16, i32, isize);
+
+macro_rules! impl_double_word_arg {
+    ($kind:expr, $ty:ty) => {
+        impl LogArg for $ty {
+            fn data_words(&self) -> usize {
+                2
+            }
+            fn write(&self, writer: &mut dyn DeferredLogWriter) {
+                writer.write_word(arg_header($kind, 8));
+                writer.write_word(*self as u32);
+                writer.write_word((*self as u64 >> 32) as u32);
+            }
+        }
+    };
+}
+impl_double_word_arg!(ARG_U64, u64);
+impl_double_word_arg!(ARG_I64, i64);
+
+impl LogArg for bool {
+    fn data_words(&self) -> usize {
+        1
+    }
+    fn write(&self, writer: &mut dyn DeferredLogWriter) {
+        writer.write_word(arg_header(ARG_BOOL, 4));
+        writer.write_word(*self as u32);
+    }
+}
+
+impl LogArg for &str {
+    fn data_words(&self) -> usize {
+        self.len().div_ceil(4)
+    }
+    fn write(&self, writer: &mut dyn DeferredLogWriter) {
+        writer.write_word(arg_header(ARG_STR, self.len()));
+        write_bytes(writer, self.as_bytes());
+    }
+}
+
+impl LogArg for crate::HexBytes<'_> {
+    fn data_words(&self) -> usize {
+        self.0.len().div_ceil(4)
+    }
+    fn write(&self, writer: &mut dyn DeferredLogWriter) {
+        writer.write_word(arg_header(ARG_HEX_BYTES, self.0.len()));
+        write_bytes(writer, self.0);
+    }
+}
+
+impl LogArg for crate::HexWord {
+    fn data_words(&self) -> usize {
+        1
+    }
+    fn write(&self, writer: &mut dyn DeferredLogWriter) {
+        writer.write_word(arg_header(ARG_HEX_WORD, 4));
+        writer.write_word(self.0);
+    }
+}
+
+fn record_header(kind: u32, payload_words: usize) -> u32 {
+    RECORD_MAGIC << 24 | kind << 16 | payload_words as u32
+}
+
+/// Sends the message of `fmt` with `args`, preceded by the definition of `fmt` unless
+/// `defined` says it was already sent. Called by `logln`.
+pub fn write_record(fmt: &'static str, defined: &AtomicBool, args: &[&dyn LogArg]) {
+    let Some(writer) = (unsafe { DEFERRED_LOG_WRITER.as_mut() }) else {
+        return;
+    };
+    let writer: &mut dyn DeferredLogWriter = &mut **writer;
+    let id = fmt.as_ptr() as u32;
+    if !defined.load(Ordering::Relaxed) {
+        writer.write_word(record_header(RECORD_DEFINE, 2 + fmt.len().div_ceil(4)));
+        writer.write_word(id);
+        writer.write_word(fmt.len() as u32);
+        write_bytes(writer, fmt.as_bytes());
+        defined.store(true, Ordering::Relaxed);
+    }
+    let payload_words = 1 + args.iter().map(|arg| 1 + arg.data_words()).sum::<usize>();
+    writer.write_word(record_header(RECORD_MESSAGE, payload_words));
+    writer.write_word(id);
+    for arg in args {
+        arg.write(writer);
+    }
+}
+
+/// Logs a line. With the `deferred-log` feature, the message is formatted by the host, and
+/// the arguments must implement [`LogArg`] and be given positionally.
+#[cfg(feature = "deferred-log")]
+#[macro_export]
+macro_rules! logln {
+    ($fmt:literal $(, $arg:expr)* $(,)?) => {{
+        static DEFINED: core::sync::atomic::AtomicBool = core::sync::atomic::AtomicBool::new(false);
+        $crate::deferred_log::write_record(
+            $fmt,
+            &DEFINED,
+            &[$(&$arg as &dyn $crate::deferred_log::LogArg),*],
+        );
+    }};
+}
+
+/// Logs a line. With the `deferred-log` feature, the message is formatted by the host, and
+/// the arguments must implement [`LogArg`] and be given positionally.
+#[cfg(not(feature = "deferred-log"))]
+#[macro_export]
+macro_rules! logln {
+    ($($arg:tt)*) => {
+        $crate::println!($($arg)*)
+    };
+}
@@ -4,6 +4,7 @@
 #![allow(static_mut_refs)]
 #![cfg_attr(target_arch = "riscv32", feature(riscv_ext_intrinsics))]
 
+pub mod deferred_log;
 mod error;
 pub use error::*;
 mod mci;
@@ -19,6 +20,7 @@ use core::fmt::{Display, Write};
 
 pub static mut WRITER: Option<&'static mut dyn Write> = None;
 pub static mut EXITER: Option<&'static mut dyn Exit> = None;
+pub static mut MILESTONE_RECORDER: Option<&'static mut dyn MilestoneRecorder> = None;
 
 /// Sets the global backing writer for `print` and `println` macros.
 pub fn set_printer(writer: &'static mut dyn Write) {
@@ -96,6 +98,42 @@ pub fn test_exit(code: u32) -> ! {
     loop {}
 }
 
+pub use mcu_config::milestone::Milestone;
+
+/// Reports firmware milestones, e.g. to the emulator so that tests can measure
+/// the cycles spent between them.
+pub trait MilestoneRecorder {
+    fn record(&mut self, milestone: Milestone);
+}
+
+/// Records milestones by writing their id to a memory-mapped register at `ADDR`.
+pub struct MmioMilestoneRecorder<const ADDR: u32> {}
+
+impl<const ADDR: u32> MilestoneRecorder for MmioMilestoneRecorder<ADDR> {
+    fn record(&mut self, milestone: Milestone) {
+        // Safety: ADDR is the milestone register of the platform.
+        unsafe {
+            core::ptr::write_volatile(ADDR as *mut u32, milestone as u32);
+        }
+    }
+}
+
+pub fn set_milestone_recorder(recorder: &'static mut dyn MilestoneRecorder) {
+    unsafe {
+        MILESTONE_RECORDER = Some(recorder);
+    }
+}
+
+/// Records that the firmware reached `milestone`. Does nothing on platforms
+/// without a recorder.
+pub fn milestone(milestone: Milestone) {
+    unsafe {
+        if let Some(recorder) = MILESTONE_RECORDER.as_mut() {
+            recorder.record(milestone);
+        }
+    }
+}
+
 #[cfg(not(target_arch = "riscv32"))]
 pub fn crc8(crc: u8, data: u8) -> u8 {
     // CRC-8 with last 8 bits of polynomial x^8 + x^2 + x^1 + 1.
@@ -6,7 +6,7 @@ use doe_transport::hil::{DoeTransport, DoeTransportRxClient, DoeTransportTxClien
 use kernel::grant::{AllowRoCount, AllowRwCount, Grant, GrantKernelData, UpcallCount};
 use kernel::processbuffer::{ReadableProcessBuffer, ReadableProcessSlice, WriteableProcessBuffer};
 use kernel::syscall::{CommandReturn, SyscallDriver};
-use kernel::utilities::cells::OptionalCell;
+use kernel::utilities::cells::{OptionalCell, TakeCell};
 use kernel::{ErrorCode, ProcessId};
 use romtime::println;
 
@@ -57,6 +57,11 @@ pub struct DoeDriver<'a, T: DoeTransport<'a>> {
         AllowRwCount<{ rw_allow::COUNT }>,
     >,
     current_app: OptionalCell<ProcessId>,
+    /// SPDM Data Object received while no application was waiting for one, and its length.
+    /// The transport gets its buffer back once the Data Object is delivered, so it does not
+    /// accept another one meanwhile.
+    held_rx_buf: TakeCell<'static, [u32]>,
+    held_rx_len_dw: Cell<usize>,
 }
 
 impl<'a, T: DoeTransport<'a>> DoeDriver<'a, T> {
@@ -73,6 +78,8 @@ impl<'a, T: DoeTransport<'a>> DoeDriver<'a, T> {
             doe_transport,
             apps: grant,
             current_app: OptionalCell::empty(),
+            held_rx_buf: TakeCell::empty(),
+            held_rx_len_dw: Cell::new(0),
         }
     }
 
@@ -169,6 +176,16 @@ impl<'a, T: DoeTransport<'a>> DoeDriver<'a, T> {
 
     fn handle_spdm_upcall(&self, rx_buf: &'static mut [u32], len_dw: usize) {
         // Handle SPDM Data Object
+        let mut waiting_rx = false;
+        self.apps
+            .each(|_, app, _| waiting_rx |= app.waiting_rx.get());
+        if !waiting_rx {
+            // The application has not asked for the next Data Object yet, hold it until it does
+            self.held_rx_buf.replace(rx_buf);
+            self.held_rx_len_dw.set(len_dw);
+            return;
+        }
+
         self.apps.each(|_, app, kernel_data| {
             if app.waiting_rx.get() {
                 app.waiting_rx.set(false);
@@ -232,7 +249,8 @@ impl<'a, T: DoeTransport<'a>> SyscallDriver for DoeDriver<'a, T> {
     ///
     /// - `0`: Driver check.
     ///
-    /// - `1`: Receive message. Issues upcall when driver receives a SPDM/Secure SPDM Data object type
+    /// - `1`: Receive message. Issues upcall when driver receives a SPDM/Secure SPDM Data object type.
+    ///   A Data Object received before this command is held and delivered when it is issued.
     /// - `2`: Send message. Sends the received message to the DOE transport layer. Schedules an upcall
     ///   when the message is sent.
     /// - `3`: Max message size. Returns the maximum message size supported by the DOE transport layer.
@@ -253,7 +271,12 @@ impl<'a, T: DoeTransport<'a>> SyscallDriver for DoeDriver<'a, T> {
                 });
 
                 match res {
-                    Ok(_) => CommandReturn::success(),
+                    Ok(_) => {
+                        if let Some(rx_buf) = self.held_rx_buf.take() {
+                            self.handle_spdm_upcall(rx_buf, self.held_rx_len_dw.get());
+                        }
+                        CommandReturn::success()
+                    }
                     Err(err) => CommandReturn::failure(err.into()),
                 }
             }
@@ -0,0 +1,349 @@
+// Licensed under the Apache-2.0 license
+
+//! MCTP bridging support for the MCTP mux.
+//!
+//! A bridge connects the bus owner, reached through the transport binding of the
+//! mux (port 0), to downstream buses. Each downstream bus is an [`MCTPBridgePort`]
+//! with its own transport binding. The routing table of the mux maps ranges of
+//! downstream EIDs to ports. Packets addressed to a routed EID are forwarded
+//! one at a time, without reassembling the message. Packets received on a
+//! downstream port for an unknown EID are forwarded to the bus owner.
+
+use crate::mctp::base_protocol::{MCTPHeader, MCTP_HDR_SIZE};
+use crate::mctp::transport_binding::{MCTPTransportBinding, TransportRxClient, TransportTxClient};
+use core::cell::Cell;
+use core::fmt::Write;
+use kernel::collections::list::{ListLink, ListNode};
+use kernel::utilities::cells::{OptionalCell, TakeCell};
+use kernel::ErrorCode;
+use romtime::println;
+use zerocopy::FromBytes;
+
+/// Port of the bus owner, served by the transport binding of the mux.
+pub const MCTP_UPSTREAM_PORT: u8 = 0;
+/// Maximum number of entries in the routing table.
+pub const MCTP_MAX_ROUTES: usize = 8;
+/// Physical transport binding identifier of MCTP over I3C (DSP0239).
+pub const MCTP_BINDING_TYPE_I3C: u8 = 0x06;
+/// Physical transport binding identifier for vendor defined bindings (DSP0239).
+pub const MCTP_BINDING_TYPE_VENDOR: u8 = 0xFF;
+
+/// Range of EIDs reached through a downstream port.
+#[derive(Clone, Copy, Debug, Default, PartialEq)]
+pub struct MCTPRoute {
+    pub first_eid: u8,
+    pub eid_count: u8,
+    pub port: u8,
+    /// Physical transport binding identifier reported in the routing table entries
+    pub binding_type: u8,
+}
+
+impl MCTPRoute {
+    pub fn new(first_eid: u8, eid_count: u8, port: u8, binding_type: u8) -> Self {
+        MCTPRoute {
+            first_eid,
+            eid_count,
+            port,
+            binding_type,
+        }
+    }
+
+    pub fn contains(&self, eid: u8) -> bool {
+        eid >= self.first_eid && ((eid - self.first_eid) as usize) < self.eid_count as usize
+    }
+
+    fn overlaps(&self, other: &MCTPRoute) -> bool {
+        let end = self.first_eid as usize + self.eid_count as usize;
+        let other_end = other.first_eid as usize + other.eid_count as usize;
+        (self.first_eid as usize) < other_end && (other.first_eid as usize) < end
+    }
+}
+
+/// Static routing table of the mux.
+pub struct MCTPRoutingTable {
+    routes: Cell<[MCTPRoute; MCTP_MAX_ROUTES]>,
+    len: Cell<usize>,
+}
+
+impl Default for MCTPRoutingTable {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl MCTPRoutingTable {
+    pub fn new() -> Self {
+        MCTPRoutingTable {
+            routes: Cell::new([MCTPRoute::default(); MCTP_MAX_ROUTES]),
+            len: Cell::new(0),
+        }
+    }
+
+    /// Adds a route to a downstream port.
+    ///
+    /// Returns `INVAL` if the route is empty, targets the upstream port or overlaps
+    /// an existing route, and `NOMEM` if the table is full.
+    pub fn add(&self, route: MCTPRoute) -> Result<(), ErrorCode> {
+        let mut routes = self.routes.get();
+        let len = self.len.get();
+        if route.eid_count == 0
+            || route.port == MCTP_UPSTREAM_PORT
+            || routes[..len].iter().any(|r| r.overlaps(&route))
+        {
+            Err(ErrorCode::INVAL)?;
+        }
+        if len == MCTP_MAX_ROUTES {
+            Err(ErrorCode::NOMEM)?;
+        }
+        routes[len] = route;
+        self.routes.set(routes);
+        self.len.set(len + 1);
+        Ok(())
+    }
+
+    pub fn lookup(&self, eid: u8) -> Option<MCTPRoute> {
+        let routes = self.routes.get();
+        routes[..self.len.get()]
+            .iter()
+            .find(|route| route.contains(eid))
+            .copied()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len.get() == 0
+    }
+
+    /// Returns a copy of the table and the number of routes in it.
+    pub fn routes(&self) -> ([MCTPRoute; MCTP_MAX_ROUTES], usize) {
+        (self.routes.get(), self.len.get())
+    }
+}
+
+/// Implemented by the mux to route the packets received on the downstream ports.
+pub trait MCTPPacketRouter {
+    /// Routes a packet received on `port`. The packet starts with the MCTP header.
+    ///
+    /// Returns `BUSY` if the packet could not be forwarded yet. The port then keeps
+    /// the packet and offers it again when `retry_pending` is called.
+    fn route_packet(&self, port: u8, packet: &[u8]) -> Result<(), ErrorCode>;
+}
+
+/// A downstream bus of the bridge.
+///
+/// The port holds one transmit buffer, so it forwards one packet at a time. A
+/// packet received while the router is busy stays in the receive buffer, which
+/// is only given back to the binding once the packet has been forwarded.
+pub struct MCTPBridgePort<'a> {
+    port: u8,
+    binding: &'a dyn MCTPTransportBinding<'a>,
+    router: OptionalCell<&'a dyn MCTPPacketRouter>,
+    tx_buffer: TakeCell<'static, [u8]>,
+    rx_buffer: TakeCell<'static, [u8]>,
+    /// Length of the received packet waiting in `rx_buffer`, 0 if none
+    pending_len: Cell<usize>,
+    next: ListLink<'a, MCTPBridgePort<'a>>,
+}
+
+impl<'a> ListNode<'a, MCTPBridgePort<'a>> for MCTPBridgePort<'a> {
+    fn next(&'a self) -> &'a ListLink<'a, MCTPBridgePort<'a>> {
+        &self.next
+    }
+}
+
+impl<'a> MCTPBridgePort<'a> {
+    pub fn new(
+        port: u8,
+        binding: &'a dyn MCTPTransportBinding<'a>,
+        tx_buffer: &'static mut [u8],
+        rx_buffer: &'static mut [u8],
+    ) -> MCTPBridgePort<'a> {
+        MCTPBridgePort {
+            port,
+            binding,
+            router: OptionalCell::empty(),
+            tx_buffer: TakeCell::new(tx_buffer),
+            rx_buffer: TakeCell::new(rx_buffer),
+            pending_len: Cell::new(0),
+            next: ListLink::empty(),
+        }
+    }
+
+    pub fn set_router(&self, router: &'a dyn MCTPPacketRouter) {
+        self.router.set(router);
+    }
+
+    pub fn port(&self) -> u8 {
+        self.port
+    }
+
+    /// Gives the receive buffer to the binding and enables it.
+    pub fn enable(&self) {
+        if let Some(rx_buffer) = self.rx_buffer.take() {
+            self.binding.set_rx_buffer(rx_buffer);
+        }
+        self.binding.enable();
+    }
+
+    /// Transmits a packet, starting with the MCTP header, on the downstream bus.
+    pub fn forward(&self, packet: &[u8]) -> Result<(), ErrorCode> {
+        let hdr_offset = self.binding.get_hdr_size();
+        if packet.len() < MCTP_HDR_SIZE || packet.len() > self.binding.get_mtu_size() {
+            Err(ErrorCode::SIZE)?;
+        }
+        let tx_buffer = self.tx_buffer.take().ok_or(ErrorCode::BUSY)?;
+        if tx_buffer.len() < hdr_offset + packet.len() {
+            self.tx_buffer.replace(tx_buffer);
+            Err(ErrorCode::SIZE)?;
+        }
+        tx_buffer[hdr_offset..hdr_offset + packet.len()].copy_from_slice(packet);
+        self.binding
+            .transmit(tx_buffer, hdr_offset + packet.len())
+            .map_err(|(err, tx_buffer)| {
+                self.tx_buffer.replace(tx_buffer);
+                err
+            })
+    }
+
+    pub fn has_pending(&self) -> bool {
+        self.pending_len.get() > 0
+    }
+
+    /// Offers the packet held back by a busy router again.
+    pub fn retry_pending(&self) {
+        let len = self.pending_len.get();
+        if let Some(rx_buffer) = self.rx_buffer.take() {
+            if len > 0 {
+                self.route(rx_buffer, len);
+            } else {
+                self.rx_buffer.replace(rx_buffer);
+            }
+        }
+    }
+
+    fn route(&self, rx_buffer: &'static mut [u8], len: usize) {
+        let result = self.router.map_or(Err(ErrorCode::OFF), |router| {
+            router.route_packet(self.port, &rx_buffer[..len])
+        });
+        if result == Err(ErrorCode::BUSY) {
+            self.pending_len.set(len);
+            self.rx_buffer.replace(rx_buffer);
+            return;
+        }
+        if let Err(err) = result {
+            println!(
+                "MCTPBridgePort: Dropping packet from port {}: {:?}",
+                self.port, err
+            );
+        }
+        self.pending_len.set(0);
+        self.binding.set_rx_buffer(rx_buffer);
+    }
+}
+
+impl TransportTxClient for MCTPBridgePort<'_> {
+    fn send_done(&self, tx_buffer: &'static mut [u8], result: Result<(), ErrorCode>) {
+        if let Err(err) = result {
+            println!(
+                "MCTPBridgePort: Failed to forward packet to port {}: {:?}",
+                self.port, err
+            );
+        }
+        self.tx_buffer.replace(tx_buffer);
+    }
+}
+
+impl TransportRxClient for MCTPBridgePort<'_> {
+    fn receive(&self, rx_buffer: &'static mut [u8], len: usize) {
+        if len < MCTP_HDR_SIZE
+            || len > rx_buffer.len()
+            || MCTPHeader::<[u8; MCTP_HDR_SIZE]>::read_from_bytes(&rx_buffer[..MCTP_HDR_SIZE])
+                .is_ok_and(|hdr| hdr.hdr_version() != 1)
+        {
+            println!("MCTPBridgePort: Invalid packet. Dropping packet.");
+            self.binding.set_rx_buffer(rx_buffer);
+            return;
+        }
+        self.route(rx_buffer, len);
+    }
+
+    fn write_expected(&self) {
+        if !self.has_pending() {
+            if let Some(rx_buffer) = self.rx_buffer.take() {
+                self.binding.set_rx_buffer(rx_buffer);
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_route_contains() {
+        let route = MCTPRoute::new(0x30, 4, 1, MCTP_BINDING_TYPE_I3C);
+        assert!(!route.contains(0x2F));
+        assert!(route.contains(0x30));
+        assert!(route.contains(0x33));
+        assert!(!route.contains(0x34));
+
+        let route = MCTPRoute::new(0xF0, 0x10, 1, MCTP_BINDING_TYPE_I3C);
+        assert!(route.contains(0xFF));
+    }
+
+    #[test]
+    fn test_routing_table() {
+        let table = MCTPRoutingTable::new();
+        assert!(table.is_empty());
+        table
+            .add(MCTPRoute::new(0x30, 2, 1, MCTP_BINDING_TYPE_I3C))
+            .unwrap();
+        table
+            .add(MCTPRoute::new(0x40, 1, 2, MCTP_BINDING_TYPE_VENDOR))
+            .unwrap();
+
+        assert_eq!(table.lookup(0x31).map(|route| route.port), Some(1));
+        assert_eq!(table.lookup(0x40).map(|route| route.port), Some(2));
+        assert_eq!(table.lookup(0x32), None);
+
+        // Overlapping, empty and upstream routes are rejected
+        assert_eq!(
+            table.add(MCTPRoute::new(0x2F, 2, 3, MCTP_BINDING_TYPE_I3C)),
+            Err(ErrorCode::INVAL)
+        );
+        assert_eq!(
+            table.add(MCTPRoute::new(0x50, 0, 3, MCTP_BINDING_TYPE_I3C)),
+            Err(ErrorCode::INVAL)
+        );
+        assert_eq!(
+            table.add(MCTPRoute::new(
+                0x50,
+                1,
+                MCTP_UPSTREAM_PORT,
+                MCTP_BINDING_TYPE_I3C
+            )),
+            Err(ErrorCode::INVAL)
+        );
+
+        let (routes, len) = table.routes();
+        assert_eq!(len, 2);
+        assert_eq!(
+            routes[1],
+            MCTPRoute::new(0x40, 1, 2, MCTP_BINDING_TYPE_VENDOR)
+        );
+    }
+
+    #[test]
+    fn test_routing_table_full() {
+        let table = MCTPRoutingTable::new();
+        for i in 0..MCTP_MAX_ROUTES as u8 {
+            table
+                .add(MCTPRoute::new(0x10 + i, 1, 1, MCTP_BINDING_TYPE_I3C))
+                .unwrap();
+        }
+        assert_eq!(
+            table.add(MCTPRoute::new(0x80, 1, 1, MCTP_BINDING_TYPE_I3C)),
+            Err(ErrorCode::NOMEM)
+        );
+    }
+}
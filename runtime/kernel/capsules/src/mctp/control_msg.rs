@@ -1,6 +1,7 @@
 // Licensed under the Apache-2.0 license
 
 use crate::mctp::base_protocol::valid_eid;
+use crate::mctp::bridge::{MCTPRoute, MCTP_MAX_ROUTES};
 use bitfield::bitfield;
 use kernel::ErrorCode;
 use zerocopy::{FromBytes, Immutable, IntoBytes};
@@ -46,6 +47,9 @@ pub enum MCTPCtrlCmd {
     GetEID,
     GetMsgTypeSupport,
     GetVersionSupport,
+    GetRoutingTableEntries,
+    PrepareEndpointDiscovery,
+    EndpointDiscovery,
     Unsupported,
 }
 
@@ -55,6 +59,9 @@ impl From<u8> for MCTPCtrlCmd {
             1 => MCTPCtrlCmd::SetEID,
             2 => MCTPCtrlCmd::GetEID,
             5 => MCTPCtrlCmd::GetMsgTypeSupport,
+            0x0A => MCTPCtrlCmd::GetRoutingTableEntries,
+            0x0B => MCTPCtrlCmd::PrepareEndpointDiscovery,
+            0x0C => MCTPCtrlCmd::EndpointDiscovery,
             _ => MCTPCtrlCmd::Unsupported,
         }
     }
@@ -67,6 +74,9 @@ impl MCTPCtrlCmd {
             MCTPCtrlCmd::GetEID => 0,
             MCTPCtrlCmd::GetVersionSupport => 0,
             MCTPCtrlCmd::GetMsgTypeSupport => 0,
+            MCTPCtrlCmd::GetRoutingTableEntries => 0x0A,
+            MCTPCtrlCmd::PrepareEndpointDiscovery => 0x0B,
+            MCTPCtrlCmd::EndpointDiscovery => 0x0C,
             MCTPCtrlCmd::Unsupported => 0xFF,
         }
     }
@@ -77,6 +87,9 @@ impl MCTPCtrlCmd {
             MCTPCtrlCmd::GetEID => 0,
             MCTPCtrlCmd::GetVersionSupport => 1,
             MCTPCtrlCmd::GetMsgTypeSupport => 5,
+            MCTPCtrlCmd::GetRoutingTableEntries => 1,
+            MCTPCtrlCmd::PrepareEndpointDiscovery => 0,
+            MCTPCtrlCmd::EndpointDiscovery => 0,
             MCTPCtrlCmd::Unsupported => 0,
         }
     }
@@ -87,6 +100,12 @@ impl MCTPCtrlCmd {
             MCTPCtrlCmd::GetEID => 4,
             MCTPCtrlCmd::GetVersionSupport => 18, // 2 bytes header + 4 entries * 4 bytes each
             MCTPCtrlCmd::GetMsgTypeSupport => 1,
+            // 3 bytes header + up to MCTP_MAX_ROUTES entries
+            MCTPCtrlCmd::GetRoutingTableEntries => {
+                ROUTING_TABLE_RESP_HDR_LEN + MCTP_MAX_ROUTES * ROUTING_TABLE_ENTRY_LEN
+            }
+            MCTPCtrlCmd::PrepareEndpointDiscovery => 1,
+            MCTPCtrlCmd::EndpointDiscovery => 1,
             MCTPCtrlCmd::Unsupported => 0,
         }
     }
@@ -138,9 +157,41 @@ impl MCTPCtrlCmd {
         }
     }
 
+    /// Returns the operation requested by a Set Endpoint ID request.
+    pub fn set_endpoint_id_op(&self, req: &[u8]) -> Result<SetEIDOp, ErrorCode> {
+        if req.len() < self.req_data_len() {
+            return Err(ErrorCode::NOMEM);
+        }
+        let req: SetEIDReq<[u8; 2]> =
+            SetEIDReq::read_from_bytes(&req[..self.req_data_len()]).map_err(|_| ErrorCode::FAIL)?;
+        Ok(req.op().into())
+    }
+
+    /// Responds to a Set Endpoint ID request with the Set Discovered Flag operation.
+    /// The EID is left unchanged and reported in the response.
+    pub fn process_set_discovered_flag(
+        &self,
+        local_eid: u8,
+        rsp_buf: &mut [u8],
+    ) -> Result<(), ErrorCode> {
+        if rsp_buf.len() < self.resp_data_len() {
+            return Err(ErrorCode::NOMEM);
+        }
+        let mut resp = SetEIDResp::new();
+        resp.set_completion_code(CmdCompletionCode::Success as u8);
+        resp.set_eid_assign_status(SetEIDStatus::Accepted as u8);
+        resp.set_eid_alloc_status(SetEIDAllocStatus::NoEIDPool as u8);
+        resp.set_assigned_eid(local_eid);
+        resp.set_eid_pool_size(0);
+
+        resp.write_to(&mut rsp_buf[..self.resp_data_len()])
+            .map_err(|_| ErrorCode::FAIL)
+    }
+
     pub fn process_get_endpoint_id(
         &self,
         local_eid: u8,
+        endpoint_type: EndpointType,
         rsp_buf: &mut [u8],
     ) -> Result<(), ErrorCode> {
         if rsp_buf.len() < self.resp_data_len() {
@@ -150,12 +201,67 @@ impl MCTPCtrlCmd {
 
         resp.set_completion_code(CmdCompletionCode::Success as u8);
         resp.set_eid(local_eid);
+        resp.set_endpoint_type(endpoint_type as u8);
         resp.set_eid_type(EIDType::DynamicOnly as u8);
 
         resp.write_to(&mut rsp_buf[..self.resp_data_len()])
             .map_err(|_| ErrorCode::FAIL)
     }
 
+    /// Fills the routing table entries starting at the entry handle of the request.
+    /// Returns the length of the response data.
+    pub fn process_get_routing_table_entries(
+        &self,
+        req: &[u8],
+        routes: &[MCTPRoute],
+        rsp_buf: &mut [u8],
+    ) -> Result<usize, ErrorCode> {
+        if req.len() < self.req_data_len() || rsp_buf.len() < ROUTING_TABLE_RESP_HDR_LEN {
+            return Err(ErrorCode::NOMEM);
+        }
+
+        let entry_handle = req[0] as usize;
+        let mut resp = GetRoutingTableEntriesResp::new();
+        if entry_handle >= routes.len().max(1) {
+            resp.completion_code = CmdCompletionCode::ErrorInvalidData as u8;
+            resp.next_entry_handle = ROUTING_TABLE_LAST_ENTRY_HANDLE;
+            resp.write_to(&mut rsp_buf[..ROUTING_TABLE_RESP_HDR_LEN])
+                .map_err(|_| ErrorCode::FAIL)?;
+            return Ok(ROUTING_TABLE_RESP_HDR_LEN);
+        }
+
+        let max_entries = (rsp_buf.len() - ROUTING_TABLE_RESP_HDR_LEN) / ROUTING_TABLE_ENTRY_LEN;
+        let entries = &routes[entry_handle..];
+        let count = entries.len().min(max_entries);
+        for (i, route) in entries[..count].iter().enumerate() {
+            let start = ROUTING_TABLE_RESP_HDR_LEN + i * ROUTING_TABLE_ENTRY_LEN;
+            RoutingTableEntry::from(route)
+                .write_to(&mut rsp_buf[start..start + ROUTING_TABLE_ENTRY_LEN])
+                .map_err(|_| ErrorCode::FAIL)?;
+        }
+
+        resp.completion_code = CmdCompletionCode::Success as u8;
+        resp.next_entry_handle = if count == entries.len() {
+            ROUTING_TABLE_LAST_ENTRY_HANDLE
+        } else {
+            (entry_handle + count) as u8
+        };
+        resp.num_entries = count as u8;
+        resp.write_to(&mut rsp_buf[..ROUTING_TABLE_RESP_HDR_LEN])
+            .map_err(|_| ErrorCode::FAIL)?;
+        Ok(ROUTING_TABLE_RESP_HDR_LEN + count * ROUTING_TABLE_ENTRY_LEN)
+    }
+
+    /// Fills the response to Prepare for Endpoint Discovery and Endpoint Discovery,
+    /// which only carries the completion code.
+    pub fn process_endpoint_discovery(&self, rsp_buf: &mut [u8]) -> Result<(), ErrorCode> {
+        if rsp_buf.len() < self.resp_data_len() {
+            return Err(ErrorCode::NOMEM);
+        }
+        rsp_buf[0] = CmdCompletionCode::Success as u8;
+        Ok(())
+    }
+
     pub fn process_get_version_support(
         &self,
         req: &[u8],
@@ -336,7 +442,7 @@ bitfield! {
     pub completion_code, set_completion_code: 7, 0;
     pub eid, set_eid: 15, 8;
     rsvd1, _: 17, 16;
-    pub endpoint_type, _: 19, 18;
+    pub endpoint_type, set_endpoint_type: 19, 18;
     rsvd2, _: 21, 20;
     pub eid_type, set_eid_type: 23, 22;
     pub medium_spec_info, _: 31, 24;
@@ -388,6 +494,64 @@ impl From<u8> for EIDType {
     }
 }
 
+// Get Routing Table Entries Response
+pub const ROUTING_TABLE_RESP_HDR_LEN: usize = 3;
+pub const ROUTING_TABLE_ENTRY_LEN: usize = 6;
+pub const ROUTING_TABLE_LAST_ENTRY_HANDLE: u8 = 0xFF;
+
+#[repr(C)]
+#[derive(Clone, Debug, Default, FromBytes, IntoBytes, Immutable)]
+pub struct GetRoutingTableEntriesResp {
+    pub completion_code: u8,
+    pub next_entry_handle: u8,
+    pub num_entries: u8,
+}
+
+impl GetRoutingTableEntriesResp {
+    pub fn new() -> Self {
+        Self::default()
+    }
+}
+
+pub enum RoutingEntryType {
+    SingleEndpoint,
+    BridgeAndEndpoints,
+    BridgeOnly,
+    AdditionalBridgeRange,
+}
+
+/// Routing table entry without a physical address.
+#[repr(C)]
+#[derive(Clone, Debug, Default, FromBytes, IntoBytes, Immutable)]
+pub struct RoutingTableEntry {
+    pub eid_range_size: u8,
+    pub first_eid: u8,
+    /// Entry type in bits 7:6, static EID flag in bit 5 and port number in bits 4:0
+    pub entry_type_port: u8,
+    pub binding_type: u8,
+    pub media_type: u8,
+    pub phys_addr_size: u8,
+}
+
+impl From<&MCTPRoute> for RoutingTableEntry {
+    fn from(route: &MCTPRoute) -> Self {
+        let entry_type = if route.eid_count == 1 {
+            RoutingEntryType::SingleEndpoint
+        } else {
+            RoutingEntryType::BridgeAndEndpoints
+        };
+        RoutingTableEntry {
+            eid_range_size: route.eid_count,
+            first_eid: route.first_eid,
+            // Routes are configured by the platform, so the EIDs are static
+            entry_type_port: (entry_type as u8) << 6 | 1 << 5 | (route.port & 0x1F),
+            binding_type: route.binding_type,
+            media_type: 0,
+            phys_addr_size: 0,
+        }
+    }
+}
+
 // Get Version Support Request
 enum VersionSupportType {
     BaseSpec,
@@ -540,15 +704,92 @@ mod tests {
     fn test_get_endpoint_id() {
         let rsp_buf = &mut [0; 4];
         MCTPCtrlCmd::GetEID
-            .process_get_endpoint_id(0x0A, rsp_buf)
+            .process_get_endpoint_id(0x0A, EndpointType::Simple, rsp_buf)
             .unwrap();
 
         let rsp: GetEIDResp<[u8; 4]> = GetEIDResp::read_from_bytes(rsp_buf).unwrap();
         assert_eq!(rsp.completion_code(), CmdCompletionCode::Success as u8);
         assert_eq!(rsp.eid(), 0x0A);
+        assert_eq!(rsp.endpoint_type(), EndpointType::Simple as u8);
         assert_eq!(rsp.eid_type(), EIDType::DynamicOnly as u8);
     }
 
+    #[test]
+    fn test_get_bridge_endpoint_id() {
+        let rsp_buf = &mut [0; 4];
+        MCTPCtrlCmd::GetEID
+            .process_get_endpoint_id(0x0A, EndpointType::BusOwnerBridge, rsp_buf)
+            .unwrap();
+
+        let rsp: GetEIDResp<[u8; 4]> = GetEIDResp::read_from_bytes(rsp_buf).unwrap();
+        assert_eq!(rsp.eid(), 0x0A);
+        assert_eq!(rsp.endpoint_type(), EndpointType::BusOwnerBridge as u8);
+    }
+
+    #[test]
+    fn test_set_discovered_flag() {
+        // op = SetDiscoveredFlag, EID ignored
+        let msg_req = [0x03, 0x00];
+        let op = MCTPCtrlCmd::SetEID.set_endpoint_id_op(&msg_req).unwrap();
+        assert!(matches!(op, SetEIDOp::SetDiscoveredFlag));
+
+        let rsp_buf = &mut [0; 4];
+        MCTPCtrlCmd::SetEID
+            .process_set_discovered_flag(0x0A, rsp_buf)
+            .unwrap();
+        let rsp: SetEIDResp<[u8; 4]> = SetEIDResp::read_from_bytes(rsp_buf).unwrap();
+        assert_eq!(rsp.completion_code(), CmdCompletionCode::Success as u8);
+        assert_eq!(rsp.eid_assign_status(), SetEIDStatus::Accepted as u8);
+        assert_eq!(rsp.assigned_eid(), 0x0A);
+    }
+
+    #[test]
+    fn test_get_routing_table_entries() {
+        let routes = [
+            MCTPRoute::new(0x30, 2, 1, 0x06),
+            MCTPRoute::new(0x40, 1, 2, 0xFF),
+        ];
+        let rsp_buf = &mut [0; ROUTING_TABLE_RESP_HDR_LEN + 2 * ROUTING_TABLE_ENTRY_LEN];
+        let cmd = MCTPCtrlCmd::GetRoutingTableEntries;
+
+        let len = cmd
+            .process_get_routing_table_entries(&[0], &routes, rsp_buf)
+            .unwrap();
+        assert_eq!(len, rsp_buf.len());
+        assert_eq!(rsp_buf[..3], [0x00, ROUTING_TABLE_LAST_ENTRY_HANDLE, 2]);
+        assert_eq!(rsp_buf[3..9], [2, 0x30, 0x40 | 0x20 | 1, 0x06, 0, 0]);
+        assert_eq!(rsp_buf[9..15], [1, 0x40, 0x20 | 2, 0xFF, 0, 0]);
+
+        // A response that can't hold every entry points at the next one
+        let len = cmd
+            .process_get_routing_table_entries(&[0], &routes, &mut rsp_buf[..9])
+            .unwrap();
+        assert_eq!(len, 9);
+        assert_eq!(rsp_buf[..3], [0x00, 1, 1]);
+
+        let len = cmd
+            .process_get_routing_table_entries(&[1], &routes, rsp_buf)
+            .unwrap();
+        assert_eq!(len, 9);
+        assert_eq!(rsp_buf[..4], [0x00, ROUTING_TABLE_LAST_ENTRY_HANDLE, 1, 1]);
+
+        let len = cmd
+            .process_get_routing_table_entries(&[2], &routes, rsp_buf)
+            .unwrap();
+        assert_eq!(len, ROUTING_TABLE_RESP_HDR_LEN);
+        assert_eq!(rsp_buf[0], CmdCompletionCode::ErrorInvalidData as u8);
+    }
+
+    #[test]
+    fn test_get_empty_routing_table() {
+        let rsp_buf = &mut [0xAA; ROUTING_TABLE_RESP_HDR_LEN];
+        let len = MCTPCtrlCmd::GetRoutingTableEntries
+            .process_get_routing_table_entries(&[0], &[], rsp_buf)
+            .unwrap();
+        assert_eq!(len, ROUTING_TABLE_RESP_HDR_LEN);
+        assert_eq!(rsp_buf[..], [0x00, ROUTING_TABLE_LAST_ENTRY_HANDLE, 0]);
+    }
+
     #[test]
     fn test_get_version_support() {
         let req = [0xff]; // BaseSpec version type
@@ -10,7 +10,7 @@ use core::fmt::Write;
 use kernel::grant::{AllowRoCount, AllowRwCount, Grant, GrantKernelData, UpcallCount};
 use kernel::processbuffer::{ReadableProcessBuffer, WriteableProcessBuffer};
 use kernel::syscall::{CommandReturn, SyscallDriver};
-use kernel::utilities::cells::MapCell;
+use kernel::utilities::cells::{MapCell, TakeCell};
 use kernel::utilities::leasable_buffer::SubSliceMut;
 use kernel::{ErrorCode, ProcessId};
 use romtime::println;
@@ -98,6 +98,15 @@ impl OpContext {
     }
 }
 
+/// Request received while no application was waiting for one, held until an application
+/// issues a receive request command.
+struct HeldRequest {
+    src_eid: u8,
+    msg_tag: u8,
+    msg_len: usize,
+    recv_time: u32,
+}
+
 #[derive(Default)]
 pub struct App {
     pending_rx_request: Option<OpContext>,
@@ -117,6 +126,8 @@ pub struct MCTPDriver<'a> {
     msg_type: MessageType,
     max_msg_size: usize,
     kernel_msg_buf: MapCell<SubSliceMut<'static, u8>>,
+    held_request: MapCell<HeldRequest>,
+    held_request_buf: TakeCell<'static, [u8]>,
 }
 
 impl<'a> MCTPDriver<'a> {
@@ -131,6 +142,7 @@ impl<'a> MCTPDriver<'a> {
         msg_type: MessageType,
         max_msg_size: usize,
         msg_buf: SubSliceMut<'static, u8>,
+        held_request_buf: Option<&'static mut [u8]>,
     ) -> MCTPDriver<'a> {
         MCTPDriver {
             sender,
@@ -139,6 +151,11 @@ impl<'a> MCTPDriver<'a> {
             msg_type,
             max_msg_size,
             kernel_msg_buf: MapCell::new(msg_buf),
+            held_request: MapCell::empty(),
+            held_request_buf: match held_request_buf {
+                Some(buf) => TakeCell::new(buf),
+                None => TakeCell::empty(),
+            },
         }
     }
 
@@ -270,6 +287,113 @@ impl<'a> MCTPDriver<'a> {
         true
     }
 
+    /// Copies a received message to the process buffer `rw_buffer` and schedules the
+    /// `upcall_num` upcall.
+    #[allow(clippy::too_many_arguments)]
+    fn deliver_msg(
+        &self,
+        kernel_data: &GrantKernelData,
+        rw_buffer: usize,
+        upcall_num: usize,
+        src_eid: u8,
+        msg_tag: u8,
+        msg_payload: &[u8],
+        msg_len: usize,
+        recv_time: u32,
+    ) -> Result<(), ErrorCode> {
+        kernel_data
+            .get_readwrite_processbuffer(rw_buffer)
+            .and_then(|read| {
+                read.mut_enter(|rmsg_payload| {
+                    if rmsg_payload.len() < msg_len {
+                        Err(ErrorCode::SIZE)
+                    } else {
+                        rmsg_payload[..msg_len].copy_from_slice(&msg_payload[..msg_len]);
+                        Ok(())
+                    }
+                })
+            })
+            .unwrap_or(Err(ErrorCode::NOMEM))?;
+
+        let msg_info =
+            (src_eid as usize) << 16 | (self.msg_type as u8 as usize) << 8 | (msg_tag as usize);
+        if let Err(e) =
+            kernel_data.schedule_upcall(upcall_num, (msg_len, recv_time as usize, msg_info))
+        {
+            panic!("MCTPDriver::receive upcall schedule failed: {:?}", e);
+        }
+        Ok(())
+    }
+
+    /// Keeps a request that no application was waiting for, so that it is not lost if it
+    /// arrives before the application is done with the previous one. Only one request is
+    /// held, a newer one is dropped. Requests are dropped if the driver has no buffer to
+    /// hold them.
+    fn hold_request(
+        &self,
+        src_eid: u8,
+        msg_tag: u8,
+        msg_payload: &[u8],
+        msg_len: usize,
+        recv_time: u32,
+    ) {
+        if self.held_request.is_some() {
+            println!("MCTPDriver::receive request already held, dropping request");
+            return;
+        }
+        self.held_request_buf.map(|buf| {
+            if msg_len > buf.len() {
+                println!("MCTPDriver::receive request too large to hold");
+                return;
+            }
+            buf[..msg_len].copy_from_slice(&msg_payload[..msg_len]);
+            self.held_request.replace(HeldRequest {
+                src_eid,
+                msg_tag,
+                msg_len,
+                recv_time,
+            });
+        });
+    }
+
+    /// Delivers the held request, if any, to an application that is now waiting for one
+    /// that matches it. Otherwise the request stays held.
+    fn deliver_held_request(&self, app: &mut App, kernel_data: &GrantKernelData) {
+        let Some((msg_tag, src_eid)) = self.held_request.map(|held| (held.msg_tag, held.src_eid))
+        else {
+            return;
+        };
+        if !self.pending_rx_request(app, msg_tag, src_eid) {
+            return;
+        }
+        let Some(held) = self.held_request.take() else {
+            return;
+        };
+        let res = self
+            .held_request_buf
+            .map(|buf| {
+                self.deliver_msg(
+                    kernel_data,
+                    rw_allow::READ_REQUEST as usize,
+                    upcall::RECEIVED_REQUEST,
+                    held.src_eid,
+                    held.msg_tag,
+                    buf,
+                    held.msg_len,
+                    held.recv_time,
+                )
+            })
+            .unwrap_or(Err(ErrorCode::NOMEM));
+        match res {
+            Ok(()) => app.pending_rx_request = None,
+            Err(ErrorCode::SIZE) => println!("MCTPDriver: held request larger than app buffer"),
+            // Keep the request until the application allows a buffer
+            Err(_) => {
+                self.held_request.replace(held);
+            }
+        }
+    }
+
     fn tx_pending(&self, app: &mut App, msg_tag: u8, dest_eid: u8) -> bool {
         let op_ctx = match app.pending_tx.as_ref() {
             Some(op_ctx) => op_ctx,
@@ -299,6 +423,8 @@ impl SyscallDriver for MCTPDriver<'_> {
     ///   Otherwise, replaces the pending rx operation context with the new one.
     ///   When a new message is received from peer EID, the metadata is compared with the pending rx operation context.
     ///   If the metadata matches, the message is copied to the process buffer and the upcall is scheduled.
+    ///   A request received while no receive request was pending is held and delivered on the next
+    ///   receive request command, so the peer does not have to wait for the application to be ready.
     ///
     ///
     /// - `3`: Send Request Message.
@@ -332,12 +458,13 @@ impl SyscallDriver for MCTPDriver<'_> {
 
                 if command_num == 1 {
                     self.apps
-                        .enter(process_id, |app, _| {
+                        .enter(process_id, |app, kernel_data| {
                             app.pending_rx_request = Some(OpContext {
                                 msg_tag,
                                 peer_eid,
                                 op_type: OpType::Rx,
                             });
+                            self.deliver_held_request(app, kernel_data);
                             CommandReturn::success()
                         })
                         .unwrap_or_else(|err| CommandReturn::failure(err.into()))
@@ -460,59 +587,46 @@ impl MCTPRxClient for MCTPDriver<'_> {
             );
         }
 
+        let mut delivered = false;
         self.apps.each(|_, app, kernel_data| {
-            let is_pending_rx_request: Option<bool>;
-            let rw_buffer: Option<usize>;
             // Check if the received message matches the pending rx operation
-            if self.pending_rx_request(app, msg_tag, src_eid) {
-                is_pending_rx_request = Some(true);
-                rw_buffer = Some(rw_allow::READ_REQUEST as usize);
+            let (rw_buffer, subscribe_num) = if self.pending_rx_request(app, msg_tag, src_eid) {
+                (rw_allow::READ_REQUEST as usize, upcall::RECEIVED_REQUEST)
             } else if self.pending_rx_response(app, msg_tag, src_eid) {
-                is_pending_rx_request = Some(false);
-                rw_buffer = Some(rw_allow::READ_RESPONSE as usize);
+                (rw_allow::READ_RESPONSE as usize, upcall::RECEIVED_RESPONSE)
             } else {
-                println!("MCTPDriver::receive no pending rx operation");
                 return;
-            }
-
-            // Copy the message payload to the process buffer
-            let res = kernel_data
-                .get_readwrite_processbuffer(rw_buffer.unwrap())
-                .and_then(|read| {
-                    read.mut_enter(|rmsg_payload| {
-                        if rmsg_payload.len() < msg_len {
-                            Err(ErrorCode::SIZE)
-                        } else {
-                            rmsg_payload[..msg_len].copy_from_slice(&msg_payload[..msg_len]);
-                            Ok(())
-                        }
-                    })
-                })
-                .unwrap_or(Err(ErrorCode::NOMEM));
-
-            // Schedule the upcall if the message payload is copied successfully
-            if res.is_ok() {
-                let mut subscribe_num: Option<usize> = None;
-                match is_pending_rx_request {
-                    Some(true) => {
-                        app.pending_rx_request = None;
-                        subscribe_num = Some(upcall::RECEIVED_REQUEST);
-                    }
-                    Some(false) => {
-                        app.pending_rx_response = None;
-                        subscribe_num = Some(upcall::RECEIVED_RESPONSE);
-                    }
-                    None => {}
-                }
-                let msg_info =
-                    (src_eid as usize) << 16 | (msg_type as usize) << 8 | (msg_tag as usize);
-                if let Err(e) = kernel_data.schedule_upcall(
-                    subscribe_num.unwrap(),
-                    (msg_len, recv_time as usize, msg_info),
-                ) {
-                    panic!("MCTPDriver::receive upcall schedule failed: {:?}", e);
+            };
+
+            // Copy the message payload to the process buffer and schedule the upcall
+            if self
+                .deliver_msg(
+                    kernel_data,
+                    rw_buffer,
+                    subscribe_num,
+                    src_eid,
+                    msg_tag,
+                    msg_payload,
+                    msg_len,
+                    recv_time,
+                )
+                .is_ok()
+            {
+                if subscribe_num == upcall::RECEIVED_REQUEST {
+                    app.pending_rx_request = None;
+                } else {
+                    app.pending_rx_response = None;
                 }
+                delivered = true;
             }
         });
+
+        if !delivered {
+            if msg_tag & MCTP_TAG_OWNER != 0 {
+                self.hold_request(src_eid, msg_tag, msg_payload, msg_len, recv_time);
+            } else {
+                println!("MCTPDriver::receive no pending rx operation");
+            }
+        }
     }
 }
@@ -1,6 +1,7 @@
 // Licensed under the Apache-2.0 license
 
 pub mod base_protocol;
+pub mod bridge;
 pub mod control_msg;
 pub mod driver;
 pub mod mux;
@@ -1,10 +1,13 @@
 // Licensed under the Apache-2.0 license
 
 use crate::mctp::base_protocol::{
-    MCTPHeader, MessageType, MCTP_BASELINE_TRANSMISSION_UNIT, MCTP_HDR_SIZE,
+    MCTPHeader, MessageType, MCTP_BASELINE_TRANSMISSION_UNIT, MCTP_BROADCAST_EID, MCTP_HDR_SIZE,
 };
-use crate::mctp::control_msg::{MCTPCtrlCmd, MCTPCtrlMsgHdr, MCTP_CTRL_MSG_HEADER_LEN};
-use crate::mctp::recv::MCTPRxState;
+use crate::mctp::bridge::{MCTPBridgePort, MCTPPacketRouter, MCTPRoute, MCTPRoutingTable};
+use crate::mctp::control_msg::{
+    EndpointType, MCTPCtrlCmd, MCTPCtrlMsgHdr, SetEIDOp, MCTP_CTRL_MSG_HEADER_LEN,
+};
+use crate::mctp::recv::{MCTPRxState, MCTPRxTable};
 use crate::mctp::send::MCTPTxState;
 use crate::mctp::transport_binding::{MCTPTransportBinding, TransportRxClient, TransportTxClient};
 use core::cell::Cell;
@@ -23,8 +26,12 @@ use zerocopy::{FromBytes, IntoBytes};
 /// transmitted and received request states.
 /// The virtualized upper layer ensures that only
 /// one message is transmitted per driver instance at a time.
-/// Receive is event based. The received packet in the rx buffer is
-/// matched against the pending receive requests.
+/// Receive is event based. The receiver of a packet in the rx buffer is
+/// looked up by message type, or by the message it continues.
+///
+/// When bridge ports and routes are added, packets for the EIDs of the
+/// routing table are forwarded to the downstream ports instead, and packets
+/// from the downstream ports are forwarded to the bus owner. See `bridge.rs`.
 pub struct MuxMCTPDriver<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> {
     mctp_device: &'a dyn MCTPTransportBinding<'a>,
     next_msg_tag: Cell<u8>, //global msg tag. increment by 1 for next tag upto 7 and wrap around.
@@ -32,10 +39,28 @@ pub struct MuxMCTPDriver<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> {
     mtu: Cell<usize>,
     // List of outstanding send requests
     sender_list: List<'a, MCTPTxState<'a, A, M>>,
-    receiver_list: List<'a, MCTPRxState<'a>>,
+    receivers: MCTPRxTable<'a>,
     tx_pkt_buffer: TakeCell<'static, [u8]>, // Static buffer for tx packet.
     rx_pkt_buffer: TakeCell<'static, [u8]>, //Static buffer for rx packet
     clock: &'a A,
+    // Packet being transmitted to the bus owner
+    upstream_tx: Cell<UpstreamTx>,
+    // Downstream ports and the routes to them
+    bridge_ports: List<'a, MCTPBridgePort<'a>>,
+    routes: MCTPRoutingTable,
+    // Buffer for a packet forwarded to the bus owner, and its length if it is waiting
+    fwd_pkt_buffer: TakeCell<'static, [u8]>,
+    fwd_pkt_len: Cell<usize>,
+    // Cleared by Prepare for Endpoint Discovery, set when the EID is assigned
+    discovered: Cell<bool>,
+}
+
+#[derive(Clone, Copy, PartialEq)]
+enum UpstreamTx {
+    Idle,
+    Sender,
+    Control,
+    Forward,
 }
 
 impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
@@ -53,10 +78,16 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
             local_eid: Cell::new(local_eid),
             mtu: Cell::new(mtu),
             sender_list: List::new(),
-            receiver_list: List::new(),
+            receivers: MCTPRxTable::new(),
             tx_pkt_buffer: TakeCell::new(tx_pkt_buf),
             rx_pkt_buffer: TakeCell::new(rx_pkt_buf),
             clock,
+            upstream_tx: Cell::new(UpstreamTx::Idle),
+            bridge_ports: List::new(),
+            routes: MCTPRoutingTable::new(),
+            fwd_pkt_buffer: TakeCell::empty(),
+            fwd_pkt_len: Cell::new(0),
+            discovered: Cell::new(false),
         }
     }
 
@@ -65,13 +96,49 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
 
         self.sender_list.push_tail(sender);
 
-        if list_empty {
+        // Otherwise the sender is started when the current transmission is done
+        if list_empty && self.upstream_tx.get() == UpstreamTx::Idle {
             self.send_next_packet(sender);
         }
     }
 
+    /// Adds a downstream port. Packets are only forwarded to it once a route
+    /// to the port is added. `fwd_pkt_buf` holds the packets forwarded to the
+    /// bus owner, only the buffer given with the first port is used.
+    pub fn add_bridge_port(&self, port: &'a MCTPBridgePort<'a>, fwd_pkt_buf: &'static mut [u8]) {
+        if self.fwd_pkt_buffer.is_none() && self.upstream_tx.get() != UpstreamTx::Forward {
+            self.fwd_pkt_buffer.replace(fwd_pkt_buf);
+        }
+        self.bridge_ports.push_tail(port);
+    }
+
+    pub fn add_route(&self, route: MCTPRoute) -> Result<(), ErrorCode> {
+        if !self
+            .bridge_ports
+            .iter()
+            .any(|port| port.port() == route.port)
+        {
+            Err(ErrorCode::INVAL)?;
+        }
+        self.routes.add(route)
+    }
+
+    fn endpoint_type(&self) -> EndpointType {
+        if self.routes.is_empty() {
+            EndpointType::Simple
+        } else {
+            EndpointType::BusOwnerBridge
+        }
+    }
+
     pub fn add_receiver(&self, receiver: &'a MCTPRxState<'a>) {
-        self.receiver_list.push_tail(receiver);
+        if let Err(err) = self.receivers.add(receiver) {
+            println!(
+                "MuxMCTPDriver: Failed to add receiver for {:?}: {:?}",
+                receiver.msg_type(),
+                err
+            );
+        }
     }
 
     pub fn set_local_eid(&self, local_eid: u8) {
@@ -179,10 +246,21 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
             return Err(ErrorCode::INVAL);
         }
 
+        if self.upstream_tx.get() != UpstreamTx::Idle {
+            println!("MuxMCTPDriver: Busy. Dropping MCTP Control message.");
+            return Err(ErrorCode::BUSY);
+        }
+
+        // Requests to the broadcast EID are answered from the local EID
+        let resp_src_eid = if mctp_hdr.dest_eid() == MCTP_BROADCAST_EID {
+            self.get_local_eid()
+        } else {
+            mctp_hdr.dest_eid()
+        };
         let mut mctp_hdr_resp = MCTPHeader::new();
         mctp_hdr_resp.prepare_header(
             mctp_hdr.src_eid(),
-            mctp_hdr.dest_eid(),
+            resp_src_eid,
             1,
             1,
             0,
@@ -204,7 +282,6 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
 
         let req_buf = &msg_buf[MCTP_CTRL_MSG_HEADER_LEN..];
         let mctp_ctrl_cmd: MCTPCtrlCmd = mctp_ctrl_msg_hdr.cmd().into();
-        let resp_len = MCTP_CTRL_MSG_HEADER_LEN + MCTP_HDR_SIZE + mctp_ctrl_cmd.resp_data_len();
 
         if req_buf.len() < mctp_ctrl_cmd.req_data_len() {
             println!(
@@ -218,29 +295,69 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
         self.tx_pkt_buffer
             .take()
             .map_or(Err(ErrorCode::NOMEM), |resp_buf| {
+                let resp_data_len = mctp_ctrl_cmd.resp_data_len();
+                let resp_data = &mut resp_buf[msg_payload_start..];
                 let result = match mctp_ctrl_cmd {
-                    MCTPCtrlCmd::SetEID => mctp_ctrl_cmd
-                        .process_set_endpoint_id(req_buf, &mut resp_buf[msg_payload_start..])
-                        .map(|eid| {
-                            if let Some(eid) = eid {
-                                self.set_local_eid(eid);
-                            }
-                        }),
-
-                    MCTPCtrlCmd::GetEID => mctp_ctrl_cmd.process_get_endpoint_id(
-                        self.get_local_eid(),
-                        &mut resp_buf[msg_payload_start..],
-                    ),
+                    MCTPCtrlCmd::SetEID => match mctp_ctrl_cmd.set_endpoint_id_op(req_buf) {
+                        Ok(SetEIDOp::SetDiscoveredFlag) => mctp_ctrl_cmd
+                            .process_set_discovered_flag(self.get_local_eid(), resp_data),
+                        _ => mctp_ctrl_cmd
+                            .process_set_endpoint_id(req_buf, resp_data)
+                            .map(|eid| {
+                                if let Some(eid) = eid {
+                                    self.set_local_eid(eid);
+                                }
+                            }),
+                    }
+                    .map(|_| {
+                        self.discovered.set(true);
+                        resp_data_len
+                    }),
+
+                    MCTPCtrlCmd::GetEID => mctp_ctrl_cmd
+                        .process_get_endpoint_id(
+                            self.get_local_eid(),
+                            self.endpoint_type(),
+                            resp_data,
+                        )
+                        .map(|_| resp_data_len),
 
                     MCTPCtrlCmd::GetVersionSupport => mctp_ctrl_cmd
-                        .process_get_version_support(req_buf, &mut resp_buf[msg_payload_start..]),
+                        .process_get_version_support(req_buf, resp_data)
+                        .map(|_| resp_data_len),
+
+                    MCTPCtrlCmd::GetRoutingTableEntries => {
+                        let (routes, num_routes) = self.routes.routes();
+                        let max_len = self.get_mtu().min(resp_buf.len()) - msg_payload_start;
+                        mctp_ctrl_cmd.process_get_routing_table_entries(
+                            req_buf,
+                            &routes[..num_routes],
+                            &mut resp_buf[msg_payload_start..msg_payload_start + max_len],
+                        )
+                    }
+
+                    MCTPCtrlCmd::PrepareEndpointDiscovery => {
+                        self.discovered.set(false);
+                        mctp_ctrl_cmd
+                            .process_endpoint_discovery(resp_data)
+                            .map(|_| resp_data_len)
+                    }
+
+                    // Only endpoints that have not been discovered respond
+                    MCTPCtrlCmd::EndpointDiscovery if self.discovered.get() => {
+                        Err(ErrorCode::ALREADY)
+                    }
+                    MCTPCtrlCmd::EndpointDiscovery => mctp_ctrl_cmd
+                        .process_endpoint_discovery(resp_data)
+                        .map(|_| resp_data_len),
 
-                    MCTPCtrlCmd::GetMsgTypeSupport => return Err(ErrorCode::NOSUPPORT),
-                    _ => return Err(ErrorCode::NOSUPPORT),
+                    MCTPCtrlCmd::GetMsgTypeSupport => Err(ErrorCode::NOSUPPORT),
+                    _ => Err(ErrorCode::NOSUPPORT),
                 };
 
                 match result {
-                    Ok(_) => {
+                    Ok(resp_data_len) => {
+                        let resp_len = MCTP_CTRL_MSG_HEADER_LEN + MCTP_HDR_SIZE + resp_data_len;
                         let res = self
                             .fill_mctp_ctrl_hdr_resp(
                                 mctp_ctrl_msg_hdr_resp,
@@ -255,8 +372,14 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
                             });
 
                         match res {
-                            Ok(_) => match self.mctp_device.transmit(resp_buf, resp_len) {
-                                Ok(_) => Ok(()),
+                            Ok(_) => match self
+                                .mctp_device
+                                .transmit(resp_buf, mctp_hdr_start + resp_len)
+                            {
+                                Ok(_) => {
+                                    self.upstream_tx.set(UpstreamTx::Control);
+                                    Ok(())
+                                }
                                 Err((err, tx_buf)) => {
                                     self.tx_pkt_buffer.replace(tx_buf);
                                     Err(err)
@@ -277,7 +400,10 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
     }
 
     fn send_next_packet(&self, cur_sender: &'a MCTPTxState<'a, A, M>) {
-        let mut tx_pkt = SubSliceMut::new(self.tx_pkt_buffer.take().unwrap());
+        let Some(tx_pkt_buffer) = self.tx_pkt_buffer.take() else {
+            return;
+        };
+        let mut tx_pkt = SubSliceMut::new(tx_pkt_buffer);
         let mctp_hdr_offset = self.mctp_hdr_offset();
         let pkt_end_offset = self.get_mtu();
 
@@ -291,7 +417,7 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
                     .mctp_device
                     .transmit(tx_pkt.take(), len + mctp_hdr_offset)
                 {
-                    Ok(_) => (),
+                    Ok(_) => self.upstream_tx.set(UpstreamTx::Sender),
                     Err((err, buf)) => {
                         println!("MuxMCTPDriver: Failed to transmit {:?}", err);
                         self.tx_pkt_buffer.replace(buf);
@@ -320,12 +446,7 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
             return;
         }
 
-        let rx_state = self
-            .receiver_list
-            .iter()
-            .find(|rx_state| rx_state.is_receive_expected(msg_type));
-
-        if let Some(rx_state) = rx_state {
+        if let Some(rx_state) = self.receivers.first_packet(&mctp_hdr, msg_type) {
             let recv_time = self.clock.now().into_u32();
             rx_state.start_receive(mctp_hdr, msg_type, pkt_payload, recv_time);
         } else {
@@ -344,12 +465,7 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
             return;
         }
 
-        let rx_state = self
-            .receiver_list
-            .iter()
-            .find(|rx_state| rx_state.is_next_packet(&mctp_hdr, pkt_payload.len()));
-
-        match rx_state {
+        match self.receivers.next_packet(&mctp_hdr, pkt_payload.len()) {
             Some(rx_state) => {
                 let recv_time = self.clock.now().into_u32();
                 rx_state.receive_next(mctp_hdr, pkt_payload, recv_time);
@@ -363,24 +479,136 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MuxMCTPDriver<'a, A, M> {
     fn mctp_hdr_offset(&self) -> usize {
         self.mctp_device.get_hdr_size()
     }
+
+    /// Forwards a packet received from the bus owner if its destination is
+    /// in the routing table. Returns false if the packet is for this endpoint.
+    fn forward_downstream(
+        &self,
+        mctp_hdr: &MCTPHeader<[u8; MCTP_HDR_SIZE]>,
+        packet: &[u8],
+    ) -> bool {
+        let dest_eid = mctp_hdr.dest_eid();
+        if dest_eid == self.get_local_eid() || dest_eid == MCTP_BROADCAST_EID {
+            return false;
+        }
+        let Some(route) = self.routes.lookup(dest_eid) else {
+            return false;
+        };
+
+        let result = self
+            .bridge_ports
+            .iter()
+            .find(|port| port.port() == route.port)
+            .map_or(Err(ErrorCode::NODEVICE), |port| port.forward(packet));
+        if let Err(err) = result {
+            println!(
+                "MuxMCTPDriver: Failed to forward packet to EID {}: {:?}. Dropping packet.",
+                dest_eid, err
+            );
+        }
+        true
+    }
+
+    /// Transmits the packet waiting in the forward buffer to the bus owner.
+    fn send_forwarded_packet(&self) {
+        let len = self.fwd_pkt_len.take();
+        if let Some(fwd_pkt) = self.fwd_pkt_buffer.take() {
+            match self.mctp_device.transmit(fwd_pkt, len) {
+                Ok(_) => self.upstream_tx.set(UpstreamTx::Forward),
+                Err((err, buf)) => {
+                    println!("MuxMCTPDriver: Failed to forward packet {:?}", err);
+                    self.fwd_pkt_buffer.replace(buf);
+                }
+            }
+        }
+    }
+}
+
+impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> MCTPPacketRouter for MuxMCTPDriver<'a, A, M> {
+    fn route_packet(&self, port: u8, packet: &[u8]) -> Result<(), ErrorCode> {
+        let mctp_hdr =
+            MCTPHeader::read_from_bytes(&packet[0..MCTP_HDR_SIZE]).map_err(|_| ErrorCode::INVAL)?;
+        let dest_eid = mctp_hdr.dest_eid();
+
+        if let Some(route) = self.routes.lookup(dest_eid) {
+            if route.port == port {
+                Err(ErrorCode::INVAL)?;
+            }
+            return self
+                .bridge_ports
+                .iter()
+                .find(|bridge_port| bridge_port.port() == route.port)
+                .map_or(Err(ErrorCode::NODEVICE), |bridge_port| {
+                    bridge_port.forward(packet)
+                });
+        }
+
+        // Messages from the downstream endpoints are only bridged, the local
+        // endpoint only talks to the bus owner.
+        if dest_eid == self.get_local_eid() {
+            Err(ErrorCode::NOSUPPORT)?;
+        }
+
+        // Everything else goes to the bus owner
+        let hdr_offset = self.mctp_hdr_offset();
+        if self.fwd_pkt_len.get() > 0 {
+            Err(ErrorCode::BUSY)?;
+        }
+        let fwd_pkt = self.fwd_pkt_buffer.take().ok_or(ErrorCode::BUSY)?;
+        if fwd_pkt.len() < hdr_offset + packet.len() || hdr_offset + packet.len() > self.get_mtu() {
+            self.fwd_pkt_buffer.replace(fwd_pkt);
+            Err(ErrorCode::SIZE)?;
+        }
+        fwd_pkt[hdr_offset..hdr_offset + packet.len()].copy_from_slice(packet);
+        self.fwd_pkt_buffer.replace(fwd_pkt);
+        self.fwd_pkt_len.set(hdr_offset + packet.len());
+
+        if self.upstream_tx.get() == UpstreamTx::Idle {
+            self.send_forwarded_packet();
+        }
+        Ok(())
+    }
 }
 
 impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> TransportTxClient for MuxMCTPDriver<'a, A, M> {
     fn send_done(&self, tx_buffer: &'static mut [u8], result: Result<(), ErrorCode>) {
-        self.tx_pkt_buffer.replace(tx_buffer);
-
         let mut cur_sender = self.sender_list.head();
-        if let Some(sender) = cur_sender {
-            if sender.is_eom() || result.is_err() {
-                sender.send_done(result);
-                self.sender_list.pop_head();
-                cur_sender = self.sender_list.head();
+        let done = self.upstream_tx.replace(UpstreamTx::Idle);
+        match done {
+            UpstreamTx::Forward => {
+                self.fwd_pkt_buffer.replace(tx_buffer);
+            }
+            UpstreamTx::Sender => {
+                self.tx_pkt_buffer.replace(tx_buffer);
+                if let Some(sender) = cur_sender {
+                    if sender.is_eom() || result.is_err() {
+                        sender.send_done(result);
+                        self.sender_list.pop_head();
+                        cur_sender = self.sender_list.head();
+                    }
+                }
+            }
+            UpstreamTx::Control | UpstreamTx::Idle => {
+                self.tx_pkt_buffer.replace(tx_buffer);
             }
         }
 
-        if let Some(cur_sender) = cur_sender {
-            self.send_next_packet(cur_sender);
-        };
+        // Forwarded packets take turns with the packets of local messages
+        let forward_pending = self.fwd_pkt_len.get() > 0;
+        match cur_sender {
+            Some(cur_sender) if !forward_pending || done == UpstreamTx::Forward => {
+                self.send_next_packet(cur_sender)
+            }
+            _ if forward_pending => self.send_forwarded_packet(),
+            _ => {}
+        }
+
+        // Take the next packet held back by a downstream port
+        if self.fwd_pkt_len.get() == 0 {
+            if let Some(port) = self.bridge_ports.iter().find(|port| port.has_pending()) {
+                port.retry_pending();
+            }
+        }
     }
 }
 
@@ -393,6 +621,11 @@ impl<'a, A: Alarm<'a>, M: MCTPTransportBinding<'a>> TransportRxClient for MuxMCT
         }
 
         let (mctp_header, msg_type, payload_offset) = self.interpret_packet(&rx_buffer[0..len]);
+        if payload_offset > 0 && self.forward_downstream(&mctp_header, &rx_buffer[0..len]) {
+            self.rx_pkt_buffer.replace(rx_buffer);
+            return;
+        }
+
         if let Some(msg_type) = msg_type {
             match msg_type {
                 MessageType::MctpControl => {
@@ -3,11 +3,17 @@
 use crate::mctp::base_protocol::{
     MCTPHeader, MessageType, MCTP_HDR_SIZE, MCTP_TAG_MASK, MCTP_TAG_OWNER,
 };
+use core::cell::Cell;
 use core::fmt::Write;
-use kernel::collections::list::{ListLink, ListNode};
 use kernel::utilities::cells::{MapCell, OptionalCell, TakeCell};
+use kernel::ErrorCode;
 use romtime::println;
 
+/// Number of message types that can have a receiver, see `rx_slot`.
+pub const MCTP_RX_MSG_TYPES: usize = 5;
+/// Number of (tag owner, message tag) pairs.
+const MCTP_RX_TAGS: usize = 16;
+
 /// This trait is implemented to get notified of the messages received
 /// on corresponding msg_type.
 pub trait MCTPRxClient {
@@ -32,14 +38,6 @@ pub struct MCTPRxState<'a> {
     client: OptionalCell<&'a dyn MCTPRxClient>,
     /// Message buffer
     msg_payload: TakeCell<'static, [u8]>,
-    /// next MCTPRxState node
-    next: ListLink<'a, MCTPRxState<'a>>,
-}
-
-impl<'a> ListNode<'a, MCTPRxState<'a>> for MCTPRxState<'a> {
-    fn next(&'a self) -> &'a ListLink<'a, MCTPRxState<'a>> {
-        &self.next
-    }
 }
 
 #[derive(Debug)]
@@ -60,7 +58,6 @@ impl<'a> MCTPRxState<'a> {
             msg_type,
             client: OptionalCell::empty(),
             msg_payload: TakeCell::new(rx_msg_buf),
-            next: ListLink::empty(),
         }
     }
 
@@ -68,6 +65,10 @@ impl<'a> MCTPRxState<'a> {
         self.client.set(client);
     }
 
+    pub fn msg_type(&self) -> MessageType {
+        self.msg_type
+    }
+
     /// Checks if a message of the given type is expected to be received.
     ///
     /// # Arguments
@@ -239,3 +240,351 @@ impl<'a> MCTPRxState<'a> {
         }
     }
 }
+
+/// Slot of the receiver of `msg_type` in `MCTPRxTable`.
+fn rx_slot(msg_type: MessageType) -> Option<usize> {
+    match msg_type {
+        MessageType::Pldm => Some(0),
+        MessageType::Spdm => Some(1),
+        MessageType::SecureSpdm => Some(2),
+        MessageType::Caliptra => Some(3),
+        MessageType::TestMsgType => Some(4),
+        _ => None,
+    }
+}
+
+/// Index of the (tag owner, message tag) of a packet in `MCTPRxTable`.
+fn tag_key(mctp_hdr: &MCTPHeader<[u8; MCTP_HDR_SIZE]>) -> usize {
+    ((mctp_hdr.tag_owner() << 3) | (mctp_hdr.msg_tag() & MCTP_TAG_MASK)) as usize
+}
+
+/// Receivers by message type, and the receivers assembling a message by
+/// (tag owner, message tag), so that the receiver of a packet is found
+/// without walking the receivers.
+///
+/// Each receiver assembles one message at a time, identified by its source
+/// EID, tag owner and tag. Messages of different types may share a tag, e.g.
+/// from different endpoints, and are assembled side by side: a packet goes to
+/// the receiver, among those assembling a message with its tag, whose message
+/// it continues (see `MCTPRxState::is_next_packet`). A packet that continues
+/// no message is rejected before any receiver state changes.
+pub struct MCTPRxTable<'a> {
+    receivers: [OptionalCell<&'a MCTPRxState<'a>>; MCTP_RX_MSG_TYPES],
+    /// Receiver slots assembling a message, as a bit mask, by (tag owner, tag)
+    assembling: [Cell<u8>; MCTP_RX_TAGS],
+    /// Tag key of the message each receiver is assembling
+    assemblies: [Cell<Option<u8>>; MCTP_RX_MSG_TYPES],
+}
+
+impl Default for MCTPRxTable<'_> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<'a> MCTPRxTable<'a> {
+    pub fn new() -> Self {
+        MCTPRxTable {
+            receivers: core::array::from_fn(|_| OptionalCell::empty()),
+            assembling: core::array::from_fn(|_| Cell::new(0)),
+            assemblies: core::array::from_fn(|_| Cell::new(None)),
+        }
+    }
+
+    /// Adds the receiver of the messages of its message type.
+    ///
+    /// # Returns
+    /// INVAL if the message type can't be received, ALREADY if it already has a receiver.
+    pub fn add(&self, receiver: &'a MCTPRxState<'a>) -> Result<(), ErrorCode> {
+        let slot = rx_slot(receiver.msg_type()).ok_or(ErrorCode::INVAL)?;
+        if self.receivers[slot].is_some() {
+            Err(ErrorCode::ALREADY)?;
+        }
+        self.receivers[slot].set(receiver);
+        Ok(())
+    }
+
+    fn end_assembly(&self, slot: usize) {
+        if let Some(key) = self.assemblies[slot].take() {
+            let assembling = &self.assembling[key as usize];
+            assembling.set(assembling.get() & !(1 << slot));
+        }
+    }
+
+    /// Returns the receiver of the first packet of a message, and records
+    /// the message as being assembled by it if more packets follow. The
+    /// message the receiver was assembling is dropped.
+    pub fn first_packet(
+        &self,
+        mctp_hdr: &MCTPHeader<[u8; MCTP_HDR_SIZE]>,
+        msg_type: MessageType,
+    ) -> Option<&'a MCTPRxState<'a>> {
+        let slot = rx_slot(msg_type)?;
+        let receiver = self.receivers[slot].get()?;
+
+        self.end_assembly(slot);
+        if mctp_hdr.eom() == 0 {
+            let key = tag_key(mctp_hdr);
+            self.assemblies[slot].set(Some(key as u8));
+            let assembling = &self.assembling[key];
+            assembling.set(assembling.get() | 1 << slot);
+        }
+        Some(receiver)
+    }
+
+    /// Returns the receiver assembling the message of a middle or last packet,
+    /// if the packet is the next one of that message (see
+    /// `MCTPRxState::is_next_packet`). The message is no longer tracked once
+    /// its last packet is accepted.
+    pub fn next_packet(
+        &self,
+        mctp_hdr: &MCTPHeader<[u8; MCTP_HDR_SIZE]>,
+        pkt_payload_len: usize,
+    ) -> Option<&'a MCTPRxState<'a>> {
+        let mut slots = self.assembling[tag_key(mctp_hdr)].get();
+        while slots != 0 {
+            let slot = slots.trailing_zeros() as usize;
+            slots &= slots - 1;
+            let receiver = self.receivers[slot]
+                .get()
+                .filter(|receiver| receiver.is_next_packet(mctp_hdr, pkt_payload_len));
+            if let Some(receiver) = receiver {
+                if mctp_hdr.eom() == 1 {
+                    self.end_assembly(slot);
+                }
+                return Some(receiver);
+            }
+        }
+        None
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::Instant;
+
+    struct CountingClient {
+        messages: Cell<usize>,
+        bytes: Cell<usize>,
+    }
+
+    impl MCTPRxClient for CountingClient {
+        fn receive(
+            &self,
+            _dst_eid: u8,
+            _msg_type: u8,
+            _msg_tag: u8,
+            _msg_payload: &[u8],
+            msg_len: usize,
+            _recv_time: u32,
+        ) {
+            self.messages.set(self.messages.get() + 1);
+            self.bytes.set(self.bytes.get() + msg_len);
+        }
+    }
+
+    const MSG_TYPES: [MessageType; MCTP_RX_MSG_TYPES] = [
+        MessageType::Pldm,
+        MessageType::Spdm,
+        MessageType::SecureSpdm,
+        MessageType::Caliptra,
+        MessageType::TestMsgType,
+    ];
+
+    fn header(src_eid: u8, som: u8, eom: u8, pkt_seq: u8, msg_tag: u8) -> MCTPHeader<[u8; 4]> {
+        let mut mctp_hdr = MCTPHeader::new();
+        mctp_hdr.prepare_header(0x0A, src_eid, som, eom, pkt_seq, 1, msg_tag);
+        mctp_hdr
+    }
+
+    fn new_receivers() -> &'static [MCTPRxState<'static>] {
+        MSG_TYPES
+            .iter()
+            .map(|msg_type| MCTPRxState::new(Box::leak(Box::new([0u8; 1024])), *msg_type))
+            .collect::<Vec<_>>()
+            .leak()
+    }
+
+    /// Receivers of all the message types, delivering to a counting client.
+    fn new_table() -> (MCTPRxTable<'static>, &'static CountingClient) {
+        let client: &'static CountingClient = Box::leak(Box::new(CountingClient {
+            messages: Cell::new(0),
+            bytes: Cell::new(0),
+        }));
+        let table = MCTPRxTable::new();
+        for receiver in new_receivers() {
+            receiver.set_client(client);
+            table.add(receiver).unwrap();
+        }
+        (table, client)
+    }
+
+    /// Dispatches a packet the way the mux does.
+    fn dispatch(
+        table: &MCTPRxTable<'static>,
+        mctp_hdr: MCTPHeader<[u8; 4]>,
+        msg_type: Option<MessageType>,
+        payload: &[u8],
+    ) -> bool {
+        match msg_type {
+            Some(msg_type) => table.first_packet(&mctp_hdr, msg_type).map(|rx_state| {
+                rx_state.start_receive(mctp_hdr, msg_type, payload, 0);
+            }),
+            None => table
+                .next_packet(&mctp_hdr, payload.len())
+                .map(|rx_state| rx_state.receive_next(mctp_hdr, payload, 0)),
+        }
+        .is_some()
+    }
+
+    #[test]
+    fn test_rx_table_add() {
+        let receivers = new_receivers();
+        let table = MCTPRxTable::new();
+        for receiver in receivers.iter() {
+            assert_eq!(table.add(receiver), Ok(()));
+        }
+        assert_eq!(table.add(&receivers[0]), Err(ErrorCode::ALREADY));
+        let ctrl: &'static MCTPRxState<'static> = Box::leak(Box::new(MCTPRxState::new(
+            Box::leak(Box::new([0u8; 8])),
+            MessageType::MctpControl,
+        )));
+        assert_eq!(table.add(ctrl), Err(ErrorCode::INVAL));
+    }
+
+    #[test]
+    fn test_rx_table_stray_packets() {
+        let (table, client) = new_table();
+        let payload = [0u8; 64];
+
+        // Middle packet without a first packet
+        assert!(!dispatch(&table, header(0x08, 0, 0, 1, 2), None, &payload));
+        // First packet of a message type without a receiver
+        assert!(!dispatch(
+            &table,
+            header(0x08, 1, 0, 0, 2),
+            Some(MessageType::MctpControl),
+            &payload
+        ));
+
+        assert!(dispatch(
+            &table,
+            header(0x08, 1, 0, 0, 2),
+            Some(MessageType::Spdm),
+            &payload
+        ));
+        // Same tag from another endpoint
+        assert!(!dispatch(&table, header(0x09, 0, 1, 1, 2), None, &payload));
+        // Wrong sequence number
+        assert!(!dispatch(&table, header(0x08, 0, 0, 2, 2), None, &payload));
+        assert!(dispatch(
+            &table,
+            header(0x08, 0, 1, 1, 2),
+            None,
+            &payload[..10]
+        ));
+        assert_eq!(client.messages.get(), 1);
+        assert_eq!(client.bytes.get(), 74);
+        // The message is complete
+        assert!(!dispatch(&table, header(0x08, 0, 1, 2, 2), None, &payload));
+    }
+
+    #[test]
+    fn test_rx_table_interleaved_tags() {
+        let (table, client) = new_table();
+        let payload = [0u8; 64];
+
+        // SPDM from EID 8 and PLDM from EID 9, both with tag 0
+        assert!(dispatch(
+            &table,
+            header(0x08, 1, 0, 0, 0),
+            Some(MessageType::Spdm),
+            &payload
+        ));
+        assert!(dispatch(
+            &table,
+            header(0x09, 1, 0, 0, 0),
+            Some(MessageType::Pldm),
+            &payload
+        ));
+        assert!(dispatch(&table, header(0x08, 0, 0, 1, 0), None, &payload));
+        assert!(dispatch(
+            &table,
+            header(0x09, 0, 1, 1, 0),
+            None,
+            &payload[..8]
+        ));
+        assert_eq!(client.messages.get(), 1);
+        assert!(dispatch(
+            &table,
+            header(0x08, 0, 1, 2, 0),
+            None,
+            &payload[..16]
+        ));
+        assert_eq!(client.messages.get(), 2);
+        assert_eq!(client.bytes.get(), 64 + 8 + 2 * 64 + 16);
+    }
+
+    #[test]
+    fn test_rx_table_rejected_last_packet() {
+        let (table, client) = new_table();
+        let payload = [0u8; 64];
+
+        assert!(dispatch(
+            &table,
+            header(0x08, 1, 0, 0, 3),
+            Some(MessageType::Spdm),
+            &payload
+        ));
+        // A last packet out of sequence does not end the message
+        assert!(!dispatch(
+            &table,
+            header(0x08, 0, 1, 2, 3),
+            None,
+            &payload[..4]
+        ));
+        assert_eq!(client.messages.get(), 0);
+        assert!(dispatch(
+            &table,
+            header(0x08, 0, 1, 1, 3),
+            None,
+            &payload[..4]
+        ));
+        assert_eq!(client.messages.get(), 1);
+        assert_eq!(client.bytes.get(), 68);
+    }
+
+    #[test]
+    fn test_rx_table_throughput() {
+        const MESSAGES: usize = 200_000;
+        const PKTS_PER_MSG: usize = 4;
+
+        let (table, client) = new_table();
+        let payload = [0x5Au8; 64];
+
+        let start = Instant::now();
+        for i in 0..MESSAGES {
+            let msg_type = MSG_TYPES[i % MSG_TYPES.len()];
+            let msg_tag = (i % 8) as u8;
+            for pkt in 0..PKTS_PER_MSG {
+                let som = (pkt == 0) as u8;
+                let eom = (pkt == PKTS_PER_MSG - 1) as u8;
+                let mctp_hdr = header(0x08, som, eom, (pkt % 4) as u8, msg_tag);
+                let first = (som == 1).then_some(msg_type);
+                assert!(dispatch(&table, mctp_hdr, first, &payload));
+            }
+        }
+        let elapsed = start.elapsed();
+
+        let packets = MESSAGES * PKTS_PER_MSG;
+        assert_eq!(client.messages.get(), MESSAGES);
+        assert_eq!(client.bytes.get(), packets * payload.len());
+        std::println!(
+            "MCTP rx dispatch: {} packets in {:?}, {:.0} packets/s",
+            packets,
+            elapsed,
+            packets as f64 / elapsed.as_secs_f64()
+        );
+    }
+}
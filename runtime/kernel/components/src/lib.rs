@@ -4,6 +4,7 @@
 
 pub mod doe;
 pub mod mailbox;
+pub mod mctp_bridge;
 pub mod mctp_driver;
 pub mod mock_mctp;
 pub mod mux_mctp;
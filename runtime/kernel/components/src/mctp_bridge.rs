@@ -0,0 +1,95 @@
+// Licensed under the Apache-2.0 license
+
+//! Component for adding a downstream port to the MCTP mux.
+//!
+//! Usage
+//! -----
+//! ```ignore
+//! use mcu_components::mctp_bridge_port_component_static;
+//! use kernel::component::Component;
+//! let port = mcu_components::mctp_bridge::MCTPBridgePortComponent::new(
+//!    mux_mctp,
+//!    1,
+//!    downstream_binding)
+//! .finalize(mctp_bridge_port_component_static!());
+//! mux_mctp.add_route(MCTPRoute::new(0x30, 2, port.port(), MCTP_BINDING_TYPE_I3C));
+//! ```
+//!
+
+use capsules_core::virtualizers::virtual_alarm::VirtualMuxAlarm;
+use capsules_runtime::mctp::bridge::MCTPBridgePort;
+use capsules_runtime::mctp::mux::MuxMCTPDriver;
+use capsules_runtime::mctp::transport_binding::{MCTPI3CBinding, MCTPTransportBinding};
+use core::mem::MaybeUninit;
+use i3c_driver::core::MAX_READ_WRITE_SIZE;
+use kernel::component::Component;
+use kernel::hil::time::Alarm;
+
+// Setup static space for the objects.
+#[macro_export]
+macro_rules! mctp_bridge_port_component_static {
+    ($(,)?) => {{
+        use capsules_runtime::mctp::bridge::MCTPBridgePort;
+        use i3c_driver::core::MAX_READ_WRITE_SIZE;
+
+        let tx_buffer = kernel::static_buf!([u8; MAX_READ_WRITE_SIZE]);
+        let rx_buffer = kernel::static_buf!([u8; MAX_READ_WRITE_SIZE]);
+        let fwd_buffer = kernel::static_buf!([u8; MAX_READ_WRITE_SIZE]);
+        let bridge_port = kernel::static_buf!(MCTPBridgePort<'static>);
+        (tx_buffer, rx_buffer, fwd_buffer, bridge_port)
+    }};
+}
+
+pub struct MCTPBridgePortComponent<A: Alarm<'static> + 'static> {
+    mux_mctp: &'static MuxMCTPDriver<'static, VirtualMuxAlarm<'static, A>, MCTPI3CBinding<'static>>,
+    port: u8,
+    binding: &'static dyn MCTPTransportBinding<'static>,
+}
+
+impl<A: Alarm<'static>> MCTPBridgePortComponent<A> {
+    pub fn new(
+        mux_mctp: &'static MuxMCTPDriver<
+            'static,
+            VirtualMuxAlarm<'static, A>,
+            MCTPI3CBinding<'static>,
+        >,
+        port: u8,
+        binding: &'static dyn MCTPTransportBinding<'static>,
+    ) -> Self {
+        Self {
+            mux_mctp,
+            port,
+            binding,
+        }
+    }
+}
+
+impl<A: Alarm<'static>> Component for MCTPBridgePortComponent<A> {
+    type StaticInput = (
+        &'static mut MaybeUninit<[u8; MAX_READ_WRITE_SIZE]>,
+        &'static mut MaybeUninit<[u8; MAX_READ_WRITE_SIZE]>,
+        &'static mut MaybeUninit<[u8; MAX_READ_WRITE_SIZE]>,
+        &'static mut MaybeUninit<MCTPBridgePort<'static>>,
+    );
+    type Output = &'static MCTPBridgePort<'static>;
+
+    fn finalize(self, static_buffer: Self::StaticInput) -> Self::Output {
+        let tx_buffer = static_buffer.0.write([0; MAX_READ_WRITE_SIZE]);
+        let rx_buffer = static_buffer.1.write([0; MAX_READ_WRITE_SIZE]);
+        let fwd_buffer = static_buffer.2.write([0; MAX_READ_WRITE_SIZE]);
+
+        let bridge_port = static_buffer.3.write(MCTPBridgePort::new(
+            self.port,
+            self.binding,
+            tx_buffer,
+            rx_buffer,
+        ));
+        self.binding.set_tx_client(bridge_port);
+        self.binding.set_rx_client(bridge_port);
+        bridge_port.set_router(self.mux_mctp);
+        self.mux_mctp.add_bridge_port(bridge_port, fwd_buffer);
+        bridge_port.enable();
+
+        bridge_port
+    }
+}
@@ -20,8 +20,12 @@
 //!     capsules_runtime::mctp::driver::MCTP_SPDM_DRIVER_NUM,
 //!     mux_mctp,
 //!     mctp_spdm_msg_types)
-//!     .finalize(mctp_driver_component_static!(InternalTimers));
+//!     .finalize(mctp_driver_component_static!(InternalTimers, held_request));
 //! ```
+//!
+//! `held_request` allocates a buffer to hold a request that arrives while no application
+//! is waiting for one, for drivers whose peers do not retry, like SPDM. Without it, such
+//! a request is dropped.
 
 use capsules_core::virtualizers::virtual_alarm::VirtualMuxAlarm;
 use capsules_runtime::mctp::base_protocol::MessageType;
@@ -40,7 +44,7 @@ use kernel::utilities::leasable_buffer::SubSliceMut;
 // Setup static space for the objects.
 #[macro_export]
 macro_rules! mctp_driver_component_static {
-    ($A:ty  $(,)?) => {{
+    (@buffers $A:ty, $held_request_buf:expr) => {{
         use capsules_core::virtualizers::virtual_alarm::VirtualMuxAlarm;
         use capsules_runtime::mctp::driver::MCTPDriver;
         use capsules_runtime::mctp::driver::MCTP_MAX_MESSAGE_SIZE;
@@ -54,8 +58,27 @@ macro_rules! mctp_driver_component_static {
         let rx_state = kernel::static_buf!(MCTPRxState<'static>);
         let rx_msg_buf = kernel::static_buf!([u8; MCTP_MAX_MESSAGE_SIZE]);
         let tx_msg_buf = kernel::static_buf!([u8; MCTP_MAX_MESSAGE_SIZE]);
+        let held_request_buf = $held_request_buf;
         let mctp_driver = kernel::static_buf!(MCTPDriver<'static>);
-        (tx_state, rx_state, rx_msg_buf, tx_msg_buf, mctp_driver)
+        (
+            tx_state,
+            rx_state,
+            rx_msg_buf,
+            tx_msg_buf,
+            held_request_buf,
+            mctp_driver,
+        )
+    }};
+    ($A:ty $(,)?) => {{
+        $crate::mctp_driver_component_static!(@buffers $A, None)
+    }};
+    ($A:ty, held_request $(,)?) => {{
+        use capsules_runtime::mctp::driver::MCTP_MAX_MESSAGE_SIZE;
+
+        $crate::mctp_driver_component_static!(
+            @buffers $A,
+            Some(kernel::static_buf!([u8; MCTP_MAX_MESSAGE_SIZE]))
+        )
     }};
 }
 
@@ -94,6 +117,7 @@ impl<A: Alarm<'static>> Component for MCTPDriverComponent<A> {
         &'static mut MaybeUninit<MCTPRxState<'static>>,
         &'static mut MaybeUninit<[u8; MCTP_MAX_MESSAGE_SIZE]>,
         &'static mut MaybeUninit<[u8; MCTP_MAX_MESSAGE_SIZE]>,
+        Option<&'static mut MaybeUninit<[u8; MCTP_MAX_MESSAGE_SIZE]>>,
         &'static mut MaybeUninit<MCTPDriver<'static>>,
     );
     type Output = &'static MCTPDriver<'static>;
@@ -103,6 +127,9 @@ impl<A: Alarm<'static>> Component for MCTPDriverComponent<A> {
 
         let rx_msg_buf = static_buffer.2.write([0; MCTP_MAX_MESSAGE_SIZE]);
         let tx_msg_buf = static_buffer.3.write([0; MCTP_MAX_MESSAGE_SIZE]);
+        let held_request_buf = static_buffer
+            .4
+            .map(|buf| &mut buf.write([0; MCTP_MAX_MESSAGE_SIZE])[..]);
 
         let tx_state = static_buffer.0.write(MCTPTxState::new(self.mux_mctp));
 
@@ -110,12 +137,13 @@ impl<A: Alarm<'static>> Component for MCTPDriverComponent<A> {
             .1
             .write(MCTPRxState::new(rx_msg_buf, self.msg_type));
 
-        let mctp_driver = static_buffer.4.write(MCTPDriver::new(
+        let mctp_driver = static_buffer.5.write(MCTPDriver::new(
             tx_state,
             self.board_kernel.create_grant(self.driver_num, &grant_cap),
             self.msg_type,
             MCTP_MAX_MESSAGE_SIZE,
             SubSliceMut::new(tx_msg_buf),
+            held_request_buf,
         ));
 
         tx_state.set_client(mctp_driver);
@@ -8,5 +8,6 @@ pub mod chip;
 pub mod pic;
 #[cfg(target_arch = "riscv32")]
 pub mod pmp;
+pub mod pmp_layout;
 #[cfg(target_arch = "riscv32")]
 pub mod timers;
@@ -5,6 +5,7 @@
 // Based on https://github.com/tock/tock/blob/b128ae817b86706c8c4e39d27fae5c54b98659f1/arch/rv32i/src/pmp.rs
 // KernelProtectionMMLEPMP
 
+use crate::pmp_layout::{self, EncodedRange, Encoding};
 use core::cell::Cell;
 use core::fmt;
 use kernel::platform::mpu;
@@ -74,17 +75,50 @@ fn write_pmpaddr_pmpcfg(i: usize, pmpcfg: u8, pmpaddr: usize) {
 // these memory regions as arguments. They further encode whether a region
 // must adhere to the `NAPOT` or `TOR` addressing mode constraints:
 
+/// Address range of a kernel memory region.
+///
+/// A `NAPOT` region uses one PMP entry. A `TOR` region uses two, or one when
+/// it starts where the `TOR` region before it in the list ends.
+#[derive(Copy, Clone, Debug)]
+pub enum RegionSpec {
+    TOR(TORRegionSpec),
+    NAPOT(NAPOTRegionSpec),
+}
+
+impl RegionSpec {
+    pub fn start(&self) -> usize {
+        match self {
+            RegionSpec::TOR(spec) => spec.start() as usize,
+            RegionSpec::NAPOT(spec) => spec.start() as usize,
+        }
+    }
+
+    pub fn end(&self) -> usize {
+        match self {
+            RegionSpec::TOR(spec) => spec.end() as usize,
+            RegionSpec::NAPOT(spec) => spec.start() as usize + spec.size(),
+        }
+    }
+
+    fn mode(&self) -> &'static str {
+        match self {
+            RegionSpec::TOR(_) => "TOR",
+            RegionSpec::NAPOT(_) => "NAPOT",
+        }
+    }
+}
+
 /// The code (kernel + apps) RAM region address range.
 ///
-/// Configured in the PMP as a `NAPOT` region.
+/// Configured in the PMP as a `NAPOT` or `TOR` region.
 #[derive(Copy, Clone, Debug)]
-pub struct ReadOnlyRegion(pub TORRegionSpec);
+pub struct ReadOnlyRegion(pub RegionSpec);
 
 /// The Data RAM region address range.
 ///
-/// Configured in the PMP as a `NAPOT` region.
+/// Configured in the PMP as a `NAPOT` or `TOR` region.
 #[derive(Copy, Clone, Debug)]
-pub struct DataRegion(pub TORRegionSpec);
+pub struct DataRegion(pub RegionSpec);
 
 /// The MMIO region address range.
 ///
@@ -95,9 +129,9 @@ pub struct MMIORegion(pub NAPOTRegionSpec);
 /// The PMP region specification for the kernel `.text` section.
 ///
 /// This is to be made accessible to machine-mode as read-execute.
-/// Configured in the PMP as a `TOR` region.
+/// Configured in the PMP as a `NAPOT` or `TOR` region.
 #[derive(Copy, Clone, Debug)]
-pub struct KernelTextRegion(pub TORRegionSpec);
+pub struct KernelTextRegion(pub RegionSpec);
 
 /// Enum containing all possible PMP region types for platform configuration
 #[derive(Debug, Clone, Copy)]
@@ -109,6 +143,76 @@ pub enum PMPRegion {
     MachineMMIO(MMIORegion),
 }
 
+impl PMPRegion {
+    fn spec(&self) -> RegionSpec {
+        match self {
+            PMPRegion::ReadOnly(region) => region.0,
+            PMPRegion::Data(region) => region.0,
+            PMPRegion::KernelText(region) => region.0,
+            PMPRegion::UserMMIO(region) | PMPRegion::MachineMMIO(region) => {
+                RegionSpec::NAPOT(region.0)
+            }
+        }
+    }
+
+    /// Permission and lock bits of the entry matching the region.
+    fn pmpcfg(&self) -> FieldValue<u8, pmpcfg_octet::Register> {
+        match self {
+            PMPRegion::ReadOnly(_) => {
+                pmpcfg_octet::r::SET
+                    + pmpcfg_octet::w::CLEAR
+                    + pmpcfg_octet::x::CLEAR
+                    + pmpcfg_octet::l::SET
+            }
+            PMPRegion::Data(_) => {
+                pmpcfg_octet::r::SET
+                    + pmpcfg_octet::w::SET
+                    + pmpcfg_octet::x::CLEAR
+                    + pmpcfg_octet::l::SET
+            }
+            PMPRegion::KernelText(_) => {
+                pmpcfg_octet::r::SET
+                    + pmpcfg_octet::w::CLEAR
+                    + pmpcfg_octet::x::SET
+                    + pmpcfg_octet::l::SET
+            }
+            // Not locked - accessible to both user and machine
+            PMPRegion::UserMMIO(_) => {
+                pmpcfg_octet::r::CLEAR
+                    + pmpcfg_octet::w::SET
+                    + pmpcfg_octet::x::SET
+                    + pmpcfg_octet::l::CLEAR
+            }
+            // Locked - machine-only access
+            PMPRegion::MachineMMIO(_) => {
+                pmpcfg_octet::r::SET
+                    + pmpcfg_octet::w::SET
+                    + pmpcfg_octet::x::CLEAR
+                    + pmpcfg_octet::l::SET
+            }
+        }
+    }
+
+    /// Address range and encoding of the region, for the entry accounting.
+    fn range(&self) -> EncodedRange {
+        let spec = self.spec();
+        EncodedRange {
+            start: spec.start(),
+            end: spec.end(),
+            encoding: match spec {
+                RegionSpec::TOR(_) => Encoding::TOR,
+                RegionSpec::NAPOT(_) => Encoding::NAPOT,
+            },
+        }
+    }
+
+    /// Whether the region is a `TOR` region starting at the end of `prev`, a
+    /// `TOR` region too, so that the entry of `prev` is also its start entry.
+    fn shares_start_entry(&self, prev: Option<&PMPRegion>) -> bool {
+        pmp_layout::shares_start_entry(&self.range(), prev.map(PMPRegion::range).as_ref())
+    }
+}
+
 /// Configuration result containing all PMP regions in a simple list
 pub struct PMPRegionList {
     /// Fixed-size array of regions (no heap allocation)
@@ -142,6 +246,11 @@ impl PMPRegionList {
     pub fn iter(&self) -> impl Iterator<Item = &PMPRegion> {
         self.regions[..self.count].iter().filter_map(|r| r.as_ref())
     }
+
+    /// Number of PMP entries needed by the regions, in list order
+    pub fn entries(&self) -> usize {
+        pmp_layout::total_entries(self.iter().map(PMPRegion::range))
+    }
 }
 
 impl fmt::Display for PMPRegion {
@@ -150,25 +259,28 @@ impl fmt::Display for PMPRegion {
             PMPRegion::ReadOnly(region) => {
                 write!(
                     f,
-                    "ReadOnly({:#x}..{:#x}) [TOR, R--, LOCK]",
-                    region.0.start() as usize,
-                    region.0.end() as usize
+                    "ReadOnly({:#x}..{:#x}) [{}, R--, LOCK]",
+                    region.0.start(),
+                    region.0.end(),
+                    region.0.mode()
                 )
             }
             PMPRegion::Data(region) => {
                 write!(
                     f,
-                    "Data({:#x}..{:#x}) [TOR, RW-, LOCK]",
-                    region.0.start() as usize,
-                    region.0.end() as usize
+                    "Data({:#x}..{:#x}) [{}, RW-, LOCK]",
+                    region.0.start(),
+                    region.0.end(),
+                    region.0.mode()
                 )
             }
             PMPRegion::KernelText(region) => {
                 write!(
                     f,
-                    "KernelText({:#x}..{:#x}) [TOR, R-X, LOCK]",
-                    region.0.start() as usize,
-                    region.0.end() as usize
+                    "KernelText({:#x}..{:#x}) [{}, R-X, LOCK]",
+                    region.0.start(),
+                    region.0.end(),
+                    region.0.mode()
                 )
             }
             PMPRegion::UserMMIO(region) => {
@@ -193,7 +305,12 @@ impl fmt::Display for PMPRegion {
 
 impl fmt::Display for PMPRegionList {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
-        writeln!(f, "PMPRegionList ({} regions):", self.count)?;
+        writeln!(
+            f,
+            "PMPRegionList ({} regions, {} entries):",
+            self.count,
+            self.entries()
+        )?;
         writeln!(f, "  Format: [MODE, RWX, LOCK] where:")?;
         writeln!(
             f,
@@ -261,14 +378,20 @@ impl fmt::Display for PMPRegionList {
 pub struct VeeRProtectionMMLEPMP {
     user_pmp_enabled: Cell<bool>,
     shadow_user_pmpcfgs: [Cell<TORUserPMPCFG>; MPU_REGIONS],
+    /// Values of the pmpaddrX CSRs of the user regions, `None` until written
+    user_pmpaddrs: [Cell<Option<usize>>; MPU_REGIONS * 2],
+    /// Values of the pmpcfgX CSRs holding the user regions, two regions per CSR
+    user_pmpcfg_csrs: [Cell<usize>; MPU_REGIONS / 2],
 }
 
 impl VeeRProtectionMMLEPMP {
     // Start user-mode TOR regions at entry 0 (kernel regions are at the end)
     // Entries 0..(MPU_REGIONS*2-1) are used for dynamic user MPU regions (MPU_REGIONS TOR regions × 2 entries each)
     // Entries (64-N)..63 are reserved for kernel regions from PMPRegionList (where N = kernel entries needed)
+    const TOR_REGIONS_OFFSET: usize = 0;
+
     fn tor_regions_offset(&self) -> usize {
-        0
+        Self::TOR_REGIONS_OFFSET
     }
 
     pub unsafe fn new(pmp_regions: PMPRegionList) -> Result<Self, ()> {
@@ -277,17 +400,16 @@ impl VeeRProtectionMMLEPMP {
             reset_entry(i);
         }
 
-        // Conservative approach: assume worst-case that all regions are TOR regions (2 entries each)
-        let max_kernel_entries = pmp_regions.count * 2;
+        // Adjacent TOR regions share an entry, see `pmp_layout::entries`
+        let kernel_entries = pmp_regions.entries();
 
         // Ensure we don't exceed available PMP entries (reserve MPU_REGIONS*2 for user MPU)
-        if max_kernel_entries > (AVAILABLE_ENTRIES - MPU_REGIONS * 2) {
+        if kernel_entries > (AVAILABLE_ENTRIES - MPU_REGIONS * 2) {
             return Err(()); // Too many kernel regions
         }
 
         // Calculate starting entry for kernel regions (at the end of PMP entries)
-        // We'll use conservative allocation but only consume what we actually need
-        let kernel_start_entry = AVAILABLE_ENTRIES - max_kernel_entries;
+        let kernel_start_entry = AVAILABLE_ENTRIES - kernel_entries;
 
         // Process regions from PMPRegionList in order, writing directly to PMP registers
         // This creates a 1:1 mapping from PMPRegionList to PMP hardware entries.
@@ -296,114 +418,46 @@ impl VeeRProtectionMMLEPMP {
         // - Entries 0..(MPU_REGIONS*2-1): User MPU regions (using shadow_user_pmpcfgs for dynamic config)
         // - Entries (64-N)..63: Direct mapping from PMPRegionList regions (where N = kernel entries needed)
         // - NAPOT regions: Use 1 PMP entry each
-        // - TOR regions: Use 2 PMP entries each (start=OFF, end=TOR)
+        // - TOR regions: Use 2 PMP entries each (start=OFF, end=TOR), or only the end
+        //   entry when the previous region is a TOR region ending at their start
         //
         // Maximum entries used: up to (MPU_REGIONS*2) for user regions + up to (64-MPU_REGIONS*2) for kernel regions = 64 total
         let mut pmp_entry = kernel_start_entry;
+        let mut prev = None;
 
         for region in pmp_regions.iter() {
-            match region {
-                PMPRegion::KernelText(r) => {
-                    // TOR region: start address (OFF) + end address (TOR with R+X)
-                    write_pmpaddr_pmpcfg(
-                        pmp_entry,
-                        (pmpcfg_octet::a::OFF
-                            + pmpcfg_octet::r::CLEAR
-                            + pmpcfg_octet::w::CLEAR
-                            + pmpcfg_octet::x::CLEAR
-                            + pmpcfg_octet::l::SET)
-                            .into(),
-                        (r.0.start() as usize) >> 2,
-                    );
-                    write_pmpaddr_pmpcfg(
-                        pmp_entry + 1,
-                        (pmpcfg_octet::a::TOR
-                            + pmpcfg_octet::r::SET
-                            + pmpcfg_octet::w::CLEAR
-                            + pmpcfg_octet::x::SET
-                            + pmpcfg_octet::l::SET)
-                            .into(),
-                        (r.0.end() as usize) >> 2,
-                    );
-                    pmp_entry += 2;
-                }
-                PMPRegion::ReadOnly(r) => {
-                    // TOR region: start address (OFF) + end address (TOR with R only)
-                    write_pmpaddr_pmpcfg(
-                        pmp_entry,
-                        (pmpcfg_octet::a::OFF
-                            + pmpcfg_octet::r::CLEAR
-                            + pmpcfg_octet::w::CLEAR
-                            + pmpcfg_octet::x::CLEAR
-                            + pmpcfg_octet::l::SET)
-                            .into(),
-                        (r.0.start() as usize) >> 2,
-                    );
-                    write_pmpaddr_pmpcfg(
-                        pmp_entry + 1,
-                        (pmpcfg_octet::a::TOR
-                            + pmpcfg_octet::r::SET
-                            + pmpcfg_octet::w::CLEAR
-                            + pmpcfg_octet::x::CLEAR
-                            + pmpcfg_octet::l::SET)
-                            .into(),
-                        (r.0.end() as usize) >> 2,
-                    );
-                    pmp_entry += 2;
-                }
-                PMPRegion::Data(r) => {
-                    // TOR region: start address (OFF) + end address (TOR with R+W)
-                    write_pmpaddr_pmpcfg(
-                        pmp_entry,
-                        (pmpcfg_octet::a::OFF
-                            + pmpcfg_octet::r::CLEAR
-                            + pmpcfg_octet::w::CLEAR
-                            + pmpcfg_octet::x::CLEAR
-                            + pmpcfg_octet::l::SET)
-                            .into(),
-                        (r.0.start() as usize) >> 2,
-                    );
-                    write_pmpaddr_pmpcfg(
-                        pmp_entry + 1,
-                        (pmpcfg_octet::a::TOR
-                            + pmpcfg_octet::r::SET
-                            + pmpcfg_octet::w::SET
-                            + pmpcfg_octet::x::CLEAR
-                            + pmpcfg_octet::l::SET)
-                            .into(),
-                        (r.0.end() as usize) >> 2,
-                    );
-                    pmp_entry += 2;
-                }
-                PMPRegion::UserMMIO(r) => {
-                    // NAPOT region: user-accessible MMIO (R+W for both user and machine)
+            match region.spec() {
+                RegionSpec::NAPOT(spec) => {
                     write_pmpaddr_pmpcfg(
                         pmp_entry,
-                        (pmpcfg_octet::a::NAPOT
-                            + pmpcfg_octet::r::CLEAR
-                            + pmpcfg_octet::w::SET
-                            + pmpcfg_octet::x::SET
-                            + pmpcfg_octet::l::CLEAR) // Not locked - accessible to both user and machine
-                            .into(),
-                        r.0.napot_addr(),
+                        (pmpcfg_octet::a::NAPOT + region.pmpcfg()).into(),
+                        spec.napot_addr(),
                     );
                     pmp_entry += 1;
                 }
-                PMPRegion::MachineMMIO(r) => {
-                    // NAPOT region: machine-only MMIO (R+W for machine only)
+                RegionSpec::TOR(spec) => {
+                    if !region.shares_start_entry(prev) {
+                        write_pmpaddr_pmpcfg(
+                            pmp_entry,
+                            (pmpcfg_octet::a::OFF
+                                + pmpcfg_octet::r::CLEAR
+                                + pmpcfg_octet::w::CLEAR
+                                + pmpcfg_octet::x::CLEAR
+                                + pmpcfg_octet::l::SET)
+                                .into(),
+                            (spec.start() as usize) >> 2,
+                        );
+                        pmp_entry += 1;
+                    }
                     write_pmpaddr_pmpcfg(
                         pmp_entry,
-                        (pmpcfg_octet::a::NAPOT
-                            + pmpcfg_octet::r::SET
-                            + pmpcfg_octet::w::SET
-                            + pmpcfg_octet::x::CLEAR
-                            + pmpcfg_octet::l::SET) // Locked - machine-only access
-                            .into(),
-                        r.0.napot_addr(),
+                        (pmpcfg_octet::a::TOR + region.pmpcfg()).into(),
+                        (spec.end() as usize) >> 2,
                     );
                     pmp_entry += 1;
                 }
             }
+            prev = Some(region);
         }
 
         // Finally, attempt to enable the MSECCFG security bits, and verify
@@ -432,8 +486,46 @@ impl VeeRProtectionMMLEPMP {
         Ok(VeeRProtectionMMLEPMP {
             user_pmp_enabled: Cell::new(false),
             shadow_user_pmpcfgs: [DEFAULT_USER_PMPCFG_OCTET; MPU_REGIONS],
+            user_pmpaddrs: core::array::from_fn(|_| Cell::new(None)),
+            user_pmpcfg_csrs: core::array::from_fn(|i| {
+                Cell::new(csr::CSR.pmpconfig_get(Self::TOR_REGIONS_OFFSET / 2 + i))
+            }),
         })
     }
+
+    /// Writes the pmpaddrX CSR of a user region entry, unless it already has `pmpaddr`.
+    fn set_user_pmpaddr(&self, entry: usize, pmpaddr: usize) {
+        let written = &self.user_pmpaddrs[entry];
+        if written.get() != Some(pmpaddr) {
+            csr::CSR.pmpaddr_set(self.tor_regions_offset() * 2 + entry, pmpaddr);
+            written.set(Some(pmpaddr));
+        }
+    }
+
+    /// Enabled value of the pmpcfgX CSR holding user regions `2 * i` and `2 * i + 1`.
+    fn shadow_user_pmpcfg_csr(&self, i: usize) -> usize {
+        u32::from_be_bytes([
+            self.shadow_user_pmpcfgs[2 * i + 1].get().get(),
+            TORUserPMPCFG::OFF.get(),
+            self.shadow_user_pmpcfgs[2 * i].get().get(),
+            TORUserPMPCFG::OFF.get(),
+        ]) as usize
+    }
+
+    /// Writes the pmpcfgX CSRs of the user regions that differ from `value(i)`.
+    ///
+    /// As CSR writes are expensive and a process typically uses a few of its
+    /// regions, only the CSRs of the regions that change between processes, or
+    /// between enabled and disabled, are written.
+    fn update_user_pmpcfg_csrs(&self, value: impl Fn(usize) -> usize) {
+        for (i, written) in self.user_pmpcfg_csrs.iter().enumerate() {
+            let value = value(i);
+            if written.get() != value {
+                csr::CSR.pmpconfig_set(self.tor_regions_offset() / 2 + i, value);
+                written.set(value);
+            }
+        }
+    }
 }
 
 impl TORUserPMP<MPU_REGIONS> for VeeRProtectionMMLEPMP {
@@ -479,16 +571,11 @@ impl TORUserPMP<MPU_REGIONS> for VeeRProtectionMMLEPMP {
             }
 
             // Set the CSR addresses for this region (if its not OFF, in which
-            // case the hardware-configured addresses are irrelevant):
+            // case the hardware-configured addresses are irrelevant). Addresses
+            // the previous process had in the same region are not rewritten:
             if region.0 != TORUserPMPCFG::OFF {
-                csr::CSR.pmpaddr_set(
-                    (i + self.tor_regions_offset()) * 2 + 0,
-                    (region.1 as usize).overflowing_shr(2).0,
-                );
-                csr::CSR.pmpaddr_set(
-                    (i + self.tor_regions_offset()) * 2 + 1,
-                    (region.2 as usize).overflowing_shr(2).0,
-                );
+                self.set_user_pmpaddr(i * 2, (region.1 as usize).overflowing_shr(2).0);
+                self.set_user_pmpaddr(i * 2 + 1, (region.2 as usize).overflowing_shr(2).0);
             }
 
             // Store the region's pmpcfg octet:
@@ -508,74 +595,7 @@ impl TORUserPMP<MPU_REGIONS> for VeeRProtectionMMLEPMP {
         // `shadow_user_pmpcfg` field, such that we can re-enable the PMP
         // without a call to `configure_pmp` (where the `TORUserPMPCFG`s are
         // provided by the caller).
-
-        // Could use `iter_array_chunks` once that's stable.
-        let mut shadow_user_pmpcfgs_iter = self.shadow_user_pmpcfgs.iter();
-        let mut i = self.tor_regions_offset();
-
-        while let Some(first_region_pmpcfg) = shadow_user_pmpcfgs_iter.next() {
-            // If we're at a "region" offset divisible by two (where "region" =
-            // 2 PMP "entries"), then we can configure an entire `pmpcfgX` CSR
-            // in one operation. As CSR writes are expensive, this is an
-            // operation worth making:
-            let second_region_opt = if i % 2 == 0 {
-                shadow_user_pmpcfgs_iter.next()
-            } else {
-                None
-            };
-
-            if let Some(second_region_pmpcfg) = second_region_opt {
-                // We're at an even index and have two regions to configure, so
-                // do that with a single CSR write:
-                csr::CSR.pmpconfig_set(
-                    i / 2,
-                    u32::from_be_bytes([
-                        second_region_pmpcfg.get().get(),
-                        TORUserPMPCFG::OFF.get(),
-                        first_region_pmpcfg.get().get(),
-                        TORUserPMPCFG::OFF.get(),
-                    ]) as usize,
-                );
-
-                i += 2;
-            } else if i % 2 == 0 {
-                // This is a single region at an even index. Thus, modify the
-                // first two pmpcfgX octets for this region.
-                csr::CSR.pmpconfig_modify(
-                    i / 2,
-                    FieldValue::<usize, csr::pmpconfig::pmpcfg::Register>::new(
-                        0x0000FFFF,
-                        0, // lower two octets
-                        u32::from_be_bytes([
-                            0,
-                            0,
-                            first_region_pmpcfg.get().get(),
-                            TORUserPMPCFG::OFF.get(),
-                        ]) as usize,
-                    ),
-                );
-
-                i += 1;
-            } else {
-                // This is a single region at an odd index. Thus, modify the
-                // latter two pmpcfgX octets for this region.
-                csr::CSR.pmpconfig_modify(
-                    i / 2,
-                    FieldValue::<usize, csr::pmpconfig::pmpcfg::Register>::new(
-                        0x0000FFFF,
-                        16, // higher two octets
-                        u32::from_be_bytes([
-                            0,
-                            0,
-                            first_region_pmpcfg.get().get(),
-                            TORUserPMPCFG::OFF.get(),
-                        ]) as usize,
-                    ),
-                );
-
-                i += 1;
-            }
-        }
+        self.update_user_pmpcfg_csrs(|i| self.shadow_user_pmpcfg_csr(i));
 
         self.user_pmp_enabled.set(true);
 
@@ -584,62 +604,9 @@ impl TORUserPMP<MPU_REGIONS> for VeeRProtectionMMLEPMP {
 
     fn disable_user_pmp(&self) {
         // Simply set all of the user-region pmpcfg octets to OFF:
-
-        let mut user_region_pmpcfg_octet_pairs =
-            (self.tor_regions_offset())..(self.tor_regions_offset() + MPU_REGIONS);
-        while let Some(first_region_idx) = user_region_pmpcfg_octet_pairs.next() {
-            let second_region_opt = if first_region_idx % 2 == 0 {
-                user_region_pmpcfg_octet_pairs.next()
-            } else {
-                None
-            };
-
-            if let Some(_second_region_idx) = second_region_opt {
-                // We're at an even index and have two regions to configure, so
-                // do that with a single CSR write:
-                csr::CSR.pmpconfig_set(
-                    first_region_idx / 2,
-                    u32::from_be_bytes([
-                        TORUserPMPCFG::OFF.get(),
-                        TORUserPMPCFG::OFF.get(),
-                        TORUserPMPCFG::OFF.get(),
-                        TORUserPMPCFG::OFF.get(),
-                    ]) as usize,
-                );
-            } else if first_region_idx % 2 == 0 {
-                // This is a single region at an even index. Thus, modify the
-                // first two pmpcfgX octets for this region.
-                csr::CSR.pmpconfig_modify(
-                    first_region_idx / 2,
-                    FieldValue::<usize, csr::pmpconfig::pmpcfg::Register>::new(
-                        0x0000FFFF,
-                        0, // lower two octets
-                        u32::from_be_bytes([
-                            0,
-                            0,
-                            TORUserPMPCFG::OFF.get(),
-                            TORUserPMPCFG::OFF.get(),
-                        ]) as usize,
-                    ),
-                );
-            } else {
-                // This is a single region at an odd index. Thus, modify the
-                // latter two pmpcfgX octets for this region.
-                csr::CSR.pmpconfig_modify(
-                    first_region_idx / 2,
-                    FieldValue::<usize, csr::pmpconfig::pmpcfg::Register>::new(
-                        0x0000FFFF,
-                        16, // higher two octets
-                        u32::from_be_bytes([
-                            0,
-                            0,
-                            TORUserPMPCFG::OFF.get(),
-                            TORUserPMPCFG::OFF.get(),
-                        ]) as usize,
-                    ),
-                );
-            }
-        }
+        self.update_user_pmpcfg_csrs(|_| {
+            u32::from_be_bytes([TORUserPMPCFG::OFF.get(); 4]) as usize
+        });
 
         self.user_pmp_enabled.set(false);
     }
@@ -0,0 +1,115 @@
+// Licensed under the Apache-2.0 license.
+
+//! PMP entry accounting of the kernel regions, shared by the PMP driver
+//! (`pmp::PMPRegionList`) and the platform PMP configuration, which picks the
+//! encoding of each region to use the fewest entries.
+
+/// Address matching mode of a kernel region, see `pmp::RegionSpec`.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub enum Encoding {
+    TOR,
+    NAPOT,
+}
+
+/// Address range of a kernel region and its encoding.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub struct EncodedRange {
+    pub start: usize,
+    pub end: usize,
+    pub encoding: Encoding,
+}
+
+/// Whether `start..start + size` can be a `NAPOT` region: a power of two of at
+/// least 8 bytes, naturally aligned.
+pub fn is_napot(start: usize, size: usize) -> bool {
+    size >= 8 && size.is_power_of_two() && start % size == 0
+}
+
+/// Whether `range` is a `TOR` region starting at the end of `prev`, a `TOR`
+/// region too, so that the entry of `prev` is also its start entry.
+pub fn shares_start_entry(range: &EncodedRange, prev: Option<&EncodedRange>) -> bool {
+    match prev {
+        Some(prev) => {
+            range.encoding == Encoding::TOR
+                && prev.encoding == Encoding::TOR
+                && prev.end == range.start
+        }
+        None => false,
+    }
+}
+
+/// Number of PMP entries used by `range` after `prev`.
+pub fn entries(range: &EncodedRange, prev: Option<&EncodedRange>) -> usize {
+    match range.encoding {
+        Encoding::NAPOT => 1,
+        Encoding::TOR if shares_start_entry(range, prev) => 1,
+        Encoding::TOR => 2,
+    }
+}
+
+/// Number of PMP entries used by `ranges`, in order.
+pub fn total_entries(ranges: impl IntoIterator<Item = EncodedRange>) -> usize {
+    let mut prev = None;
+    ranges
+        .into_iter()
+        .map(|range| {
+            let entries = entries(&range, prev.as_ref());
+            prev = Some(range);
+            entries
+        })
+        .sum()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn tor(start: usize, end: usize) -> EncodedRange {
+        EncodedRange {
+            start,
+            end,
+            encoding: Encoding::TOR,
+        }
+    }
+
+    fn napot(start: usize, size: usize) -> EncodedRange {
+        EncodedRange {
+            start,
+            end: start + size,
+            encoding: Encoding::NAPOT,
+        }
+    }
+
+    #[test]
+    fn test_is_napot() {
+        assert!(is_napot(0x4000_0000, 0x8_0000));
+        assert!(is_napot(0x1000_2000, 8));
+        assert!(!is_napot(0x1000_2000, 4));
+        assert!(!is_napot(0x1000_2000, 0x3000));
+        assert!(!is_napot(0x1000_1000, 0x2000));
+    }
+
+    #[test]
+    fn test_shared_tor_entries() {
+        let text = tor(0x4000_0000, 0x4000_3000);
+        let data = tor(0x4000_3000, 0x4000_5000);
+        let gap = tor(0x4000_6000, 0x4000_7000);
+        assert!(!shares_start_entry(&text, None));
+        assert!(shares_start_entry(&data, Some(&text)));
+        assert!(!shares_start_entry(&gap, Some(&data)));
+        assert_eq!(entries(&text, None), 2);
+        assert_eq!(entries(&data, Some(&text)), 1);
+        assert_eq!(entries(&gap, Some(&data)), 2);
+
+        // A NAPOT region neither shares nor provides a start entry
+        let ram = napot(0x4000_0000, 0x1000);
+        let after_ram = tor(0x4000_1000, 0x4000_3000);
+        assert_eq!(entries(&ram, Some(&text)), 1);
+        assert!(!shares_start_entry(&after_ram, Some(&ram)));
+        assert_eq!(entries(&after_ram, Some(&ram)), 2);
+
+        assert_eq!(total_entries([text, data, gap]), 5);
+        assert_eq!(total_entries([ram, after_ram, data]), 4);
+        assert_eq!(total_entries([]), 0);
+    }
+}
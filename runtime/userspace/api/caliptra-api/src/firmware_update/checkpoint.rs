@@ -0,0 +1,182 @@
+// Licensed under the Apache-2.0 license
+
+//! Download checkpoints for resumable firmware updates.
+//!
+//! While a component is downloaded into staging memory, the FD periodically records the
+//! offset up to which the staged data has been written, together with a running digest of
+//! the staged bytes. When the UA restarts the update of the same component (after a reset
+//! or a cancel), the staged data is re-hashed up to the recorded offset and, if it still
+//! matches, the download resumes from there instead of from offset 0.
+
+extern crate alloc;
+
+use alloc::boxed::Box;
+use async_trait::async_trait;
+use core::mem::offset_of;
+use libtock_platform::ErrorCode;
+use pldm_common::util::fw_component::FirmwareComponent;
+use zerocopy::{FromBytes, Immutable, IntoBytes, KnownLayout};
+
+use super::StagingMemory;
+
+pub const DOWNLOAD_CHECKPOINT_MAGIC: u32 = u32::from_be_bytes(*b"FWCP");
+
+/// Number of downloaded bytes between two persisted checkpoints.
+pub const DOWNLOAD_CHECKPOINT_INTERVAL: usize = 4096;
+
+/// Persistent, reset-safe storage holding a single `DownloadCheckpoint` record.
+#[async_trait]
+pub trait CheckpointStorage: core::fmt::Debug + Send + Sync {
+    async fn read(&self, data: &mut [u8]) -> Result<(), ErrorCode>;
+    async fn write(&self, data: &[u8]) -> Result<(), ErrorCode>;
+}
+
+#[repr(C)]
+#[derive(Debug, Default, FromBytes, IntoBytes, Clone, Copy, Immutable, KnownLayout)]
+pub struct DownloadCheckpoint {
+    pub magic: u32,
+    pub comp_classification: u16,
+    pub comp_identifier: u16,
+    pub comp_comparison_stamp: u32,
+    pub comp_image_size: u32,
+    pub verified_offset: u32,
+    pub staged_digest: u32,
+    pub checksum: u32,
+}
+
+impl DownloadCheckpoint {
+    pub fn new(component: &FirmwareComponent, verified_offset: usize, staged_digest: u32) -> Self {
+        let mut checkpoint = Self {
+            magic: DOWNLOAD_CHECKPOINT_MAGIC,
+            comp_classification: component.comp_classification,
+            comp_identifier: component.comp_identifier,
+            comp_comparison_stamp: component.comp_comparison_stamp,
+            comp_image_size: component.comp_image_size.unwrap_or(0),
+            verified_offset: verified_offset as u32,
+            staged_digest,
+            checksum: 0,
+        };
+        checkpoint.checksum = checkpoint.calc_checksum();
+        checkpoint
+    }
+
+    fn calc_checksum(&self) -> u32 {
+        0u32.wrapping_sub(
+            self.as_bytes()[..offset_of!(DownloadCheckpoint, checksum)]
+                .iter()
+                .fold(0u32, |acc, &byte| acc.wrapping_add(byte as u32)),
+        )
+    }
+
+    pub fn verify(&self) -> bool {
+        self.magic == DOWNLOAD_CHECKPOINT_MAGIC && self.calc_checksum() == self.checksum
+    }
+
+    /// Returns true if this checkpoint is valid and was taken for a partial download of `component`.
+    pub fn matches(&self, component: &FirmwareComponent) -> bool {
+        self.verify()
+            && self.comp_classification == component.comp_classification
+            && self.comp_identifier == component.comp_identifier
+            && self.comp_comparison_stamp == component.comp_comparison_stamp
+            && Some(self.comp_image_size) == component.comp_image_size
+            && self.verified_offset > 0
+            && self.verified_offset < self.comp_image_size
+    }
+
+    pub async fn load(storage: &dyn CheckpointStorage) -> Option<Self> {
+        let mut data = [0u8; core::mem::size_of::<DownloadCheckpoint>()];
+        storage.read(&mut data).await.ok()?;
+        let (checkpoint, _) = DownloadCheckpoint::read_from_prefix(&data).ok()?;
+        checkpoint.verify().then_some(checkpoint)
+    }
+
+    pub async fn store(&self, storage: &dyn CheckpointStorage) -> Result<(), ErrorCode> {
+        storage.write(self.as_bytes()).await
+    }
+
+    /// Invalidates any checkpoint held by `storage`.
+    pub async fn clear(storage: &dyn CheckpointStorage) -> Result<(), ErrorCode> {
+        DownloadCheckpoint::default().store(storage).await
+    }
+}
+
+/// Folds `data` into a running Fletcher-32 digest of the staged image.
+///
+/// Feeding the image in any sequence of chunks yields the same digest as feeding it at once,
+/// which lets the digest be maintained per received chunk and recomputed from staging memory.
+pub fn update_staged_digest(digest: u32, data: &[u8]) -> u32 {
+    let mut sum1 = digest & 0xffff;
+    let mut sum2 = digest >> 16;
+    for byte in data {
+        sum1 = (sum1 + *byte as u32) % 0xffff;
+        sum2 = (sum2 + sum1) % 0xffff;
+    }
+    (sum2 << 16) | sum1
+}
+
+/// Recomputes the digest of the first `len` bytes held in `staging_memory`.
+pub async fn staged_digest(
+    staging_memory: &dyn StagingMemory,
+    len: usize,
+) -> Result<u32, ErrorCode> {
+    let mut digest = 0u32;
+    let mut buffer = [0u8; 256];
+    let mut offset = 0;
+    while offset < len {
+        let chunk_len = (len - offset).min(buffer.len());
+        staging_memory
+            .read(offset, &mut buffer[..chunk_len])
+            .await?;
+        digest = update_staged_digest(digest, &buffer[..chunk_len]);
+        offset += chunk_len;
+    }
+    Ok(digest)
+}
+
+#[cfg(all(test, target_family = "unix"))]
+mod tests {
+    use super::*;
+    use pldm_common::protocol::firmware_update::PldmFirmwareString;
+
+    fn component(image_size: u32) -> FirmwareComponent {
+        FirmwareComponent::new(
+            0x000A,
+            0xffff,
+            0,
+            0xffffffff,
+            PldmFirmwareString::new("UTF-8", "soc-fw-1.2").unwrap(),
+            Some(image_size),
+            None,
+        )
+    }
+
+    #[test]
+    fn test_staged_digest_is_chunking_independent() {
+        let data: [u8; 300] = core::array::from_fn(|i| (i * 7) as u8);
+        let whole = update_staged_digest(0, &data);
+        let chunked = data
+            .chunks(37)
+            .fold(0, |digest, chunk| update_staged_digest(digest, chunk));
+        assert_eq!(whole, chunked);
+        assert_ne!(whole, update_staged_digest(0, &data[1..]));
+    }
+
+    #[test]
+    fn test_checkpoint_matches_component() {
+        let checkpoint = DownloadCheckpoint::new(&component(8192), 4096, 0x1234_5678);
+        assert!(checkpoint.verify());
+        assert!(checkpoint.matches(&component(8192)));
+        assert!(!checkpoint.matches(&component(4096)));
+
+        let mut corrupted = checkpoint;
+        corrupted.verified_offset += 1;
+        assert!(!corrupted.verify());
+        assert!(!DownloadCheckpoint::default().verify());
+    }
+
+    #[test]
+    fn test_checkpoint_rejects_complete_download() {
+        let checkpoint = DownloadCheckpoint::new(&component(4096), 4096, 0);
+        assert!(!checkpoint.matches(&component(4096)));
+    }
+}
@@ -1,6 +1,7 @@
 // Licensed under the Apache-2.0 license
 
 extern crate alloc;
+pub mod checkpoint;
 mod pldm_client;
 mod pldm_context;
 mod pldm_fdops;
@@ -21,8 +22,11 @@ use pldm_common::protocol::firmware_update::Descriptor;
 use pldm_lib::daemon::PldmService;
 use zerocopy::{FromBytes, Immutable, IntoBytes, KnownLayout};
 
+pub use checkpoint::CheckpointStorage;
+
 pub struct FirmwareUpdater<'a> {
     staging_memory: &'static dyn StagingMemory,
+    checkpoint_storage: Option<&'static dyn CheckpointStorage>,
     mailbox: Mailbox,
     params: &'a PldmFirmwareDeviceParams,
     spawner: Spawner,
@@ -35,13 +39,19 @@ pub struct PldmFirmwareDeviceParams {
 }
 
 impl<'a> FirmwareUpdater<'a> {
+    /// Creates a new firmware updater.
+    ///
+    /// If `checkpoint_storage` is provided, download progress is persisted there so that an
+    /// interrupted download resumes from the last verified offset when the UA restarts the update.
     pub fn new(
         staging_memory: &'static dyn StagingMemory,
+        checkpoint_storage: Option<&'static dyn CheckpointStorage>,
         params: &'a PldmFirmwareDeviceParams,
         spawner: Spawner,
     ) -> Self {
         Self {
             staging_memory,
+            checkpoint_storage,
             mailbox: Mailbox::new(),
             params,
             spawner,
@@ -55,6 +65,7 @@ impl<'a> FirmwareUpdater<'a> {
             self.params.descriptors,
             self.params.fw_params,
             self.staging_memory,
+            self.checkpoint_storage,
         )
         .await?;
         pldm_client::pldm_wait_completion().await?;
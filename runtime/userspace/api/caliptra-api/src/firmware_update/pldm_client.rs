@@ -1,6 +1,7 @@
 // Licensed under the Apache-2.0 license
 
 extern crate alloc;
+use super::checkpoint::CheckpointStorage;
 use super::pldm_context::State;
 use super::pldm_context::{DOWNLOAD_CTX, PLDM_STATE};
 use super::pldm_fdops::UpdateFdOps;
@@ -28,6 +29,7 @@ pub async fn initialize_pldm(
     descriptors: &'static [Descriptor],
     fw_params: &'static FirmwareParameters,
     staging_memory: &'static dyn StagingMemory,
+    checkpoint_storage: Option<&'static dyn CheckpointStorage>,
 ) -> Result<(), ErrorCode> {
     let is_initialiazed = PLDM_STATE.lock(|state| {
         let mut state = state.borrow_mut();
@@ -46,21 +48,7 @@ pub async fn initialize_pldm(
         let static_update_fd_ops: &'static mut UpdateFdOps =
             unsafe { core::mem::transmute(&mut update_fd_ops) };
 
-        PLDM_STATE.lock(|state| {
-            let mut state = state.borrow_mut();
-            *state = State::DownloadingImage;
-        });
-
-        DOWNLOAD_CTX.lock(|ctx| {
-            let mut ctx = ctx.borrow_mut();
-            ctx.total_length = 0;
-            ctx.initial_offset = 0;
-            ctx.current_offset = 0;
-            ctx.total_downloaded = 0;
-            ctx.descriptors = Some(descriptors);
-            ctx.fw_params = Some(fw_params);
-            ctx.staging_memory = Some(staging_memory);
-        });
+        reset_download_state(descriptors, fw_params, staging_memory, checkpoint_storage);
 
         spawner
             .spawn(pldm_service_task(static_update_fd_ops, spawner))
@@ -69,6 +57,34 @@ pub async fn initialize_pldm(
     Ok(())
 }
 
+/// Puts the download state in the state it has after a reset, with nothing downloaded.
+/// The staging memory and the checkpoint storage keep their contents.
+pub(crate) fn reset_download_state(
+    descriptors: &'static [Descriptor],
+    fw_params: &'static FirmwareParameters,
+    staging_memory: &'static dyn StagingMemory,
+    checkpoint_storage: Option<&'static dyn CheckpointStorage>,
+) {
+    PLDM_STATE.lock(|state| {
+        let mut state = state.borrow_mut();
+        *state = State::DownloadingImage;
+    });
+
+    DOWNLOAD_CTX.lock(|ctx| {
+        let mut ctx = ctx.borrow_mut();
+        ctx.total_length = 0;
+        ctx.initial_offset = 0;
+        ctx.current_offset = 0;
+        ctx.total_downloaded = 0;
+        ctx.staged_digest = 0;
+        ctx.last_checkpoint_offset = 0;
+        ctx.descriptors = Some(descriptors);
+        ctx.fw_params = Some(fw_params);
+        ctx.staging_memory = Some(staging_memory);
+        ctx.checkpoint_storage = checkpoint_storage;
+    });
+}
+
 pub async fn pldm_wait_completion() -> Result<(), ErrorCode> {
     FW_UPDATE_TASK_YIELD.wait().await;
     let state = PLDM_STATE.lock(|state| *state.borrow());
@@ -8,6 +8,7 @@ use pldm_common::message::firmware_update::get_fw_params::FirmwareParameters;
 use pldm_common::message::firmware_update::verify_complete::VerifyResult;
 use pldm_common::protocol::firmware_update::Descriptor;
 
+use super::checkpoint::CheckpointStorage;
 use super::StagingMemory;
 
 #[derive(Debug, Clone, Copy, PartialEq)]
@@ -25,10 +26,13 @@ pub struct DownloadCtx<'a> {
     pub current_offset: usize,
     pub total_downloaded: usize,
     pub last_requested_length: usize,
+    pub staged_digest: u32,
+    pub last_checkpoint_offset: usize,
     pub verify_result: VerifyResult,
     pub descriptors: Option<&'a [Descriptor]>,
     pub fw_params: Option<&'a FirmwareParameters>,
     pub staging_memory: Option<&'a dyn StagingMemory>,
+    pub checkpoint_storage: Option<&'a dyn CheckpointStorage>,
 }
 
 pub static DOWNLOAD_CTX: Mutex<CriticalSectionRawMutex, RefCell<DownloadCtx>> =
@@ -39,9 +43,12 @@ pub static DOWNLOAD_CTX: Mutex<CriticalSectionRawMutex, RefCell<DownloadCtx>> =
         total_downloaded: 0,
         verify_result: VerifyResult::VerifySuccess,
         last_requested_length: 0,
+        staged_digest: 0,
+        last_checkpoint_offset: 0,
         descriptors: None,
         fw_params: None,
         staging_memory: None,
+        checkpoint_storage: None,
     }));
 
 pub static PLDM_STATE: Mutex<CriticalSectionRawMutex, RefCell<State>> =
@@ -2,6 +2,9 @@
 
 extern crate alloc;
 
+use super::checkpoint::{
+    staged_digest, update_staged_digest, DownloadCheckpoint, DOWNLOAD_CHECKPOINT_INTERVAL,
+};
 use super::pldm_client::FW_UPDATE_TASK_YIELD;
 use super::pldm_context::{State, DOWNLOAD_CTX, PLDM_STATE};
 use alloc::boxed::Box;
@@ -47,6 +50,62 @@ impl UpdateFdOps {
         }
         Err(FdOpsError::FwDownloadError)
     }
+
+    /// Restores the download position from a persisted checkpoint, if one exists for
+    /// `component` and the data held in staging memory still matches its digest.
+    async fn resume_from_checkpoint(&self, component: &FirmwareComponent) {
+        let (checkpoint_storage, staging_memory) = DOWNLOAD_CTX.lock(|ctx| {
+            let ctx = ctx.borrow();
+            (ctx.checkpoint_storage, ctx.staging_memory)
+        });
+        let (Some(checkpoint_storage), Some(staging_memory)) = (checkpoint_storage, staging_memory)
+        else {
+            return;
+        };
+
+        let checkpoint = match DownloadCheckpoint::load(checkpoint_storage).await {
+            Some(checkpoint) if checkpoint.matches(component) => checkpoint,
+            _ => return,
+        };
+        let resume_offset = checkpoint.verified_offset as usize;
+        match staged_digest(staging_memory, resume_offset).await {
+            Ok(digest) if digest == checkpoint.staged_digest => {}
+            // Staged data no longer matches, restart the download from the beginning
+            _ => return,
+        }
+
+        DOWNLOAD_CTX.lock(|ctx| {
+            let mut ctx = ctx.borrow_mut();
+            ctx.current_offset = ctx.initial_offset + resume_offset;
+            ctx.total_downloaded = resume_offset;
+            ctx.staged_digest = checkpoint.staged_digest;
+            ctx.last_checkpoint_offset = resume_offset;
+        });
+    }
+
+    /// Persists the download position once enough data has been staged since the last checkpoint.
+    async fn checkpoint_download(&self, component: &FirmwareComponent) {
+        let checkpoint = DOWNLOAD_CTX.lock(|ctx| {
+            let mut ctx = ctx.borrow_mut();
+            if ctx.checkpoint_storage.is_none()
+                || ctx.total_downloaded >= ctx.total_length
+                || ctx.total_downloaded - ctx.last_checkpoint_offset < DOWNLOAD_CHECKPOINT_INTERVAL
+            {
+                return None;
+            }
+            ctx.last_checkpoint_offset = ctx.total_downloaded;
+            Some(DownloadCheckpoint::new(
+                component,
+                ctx.total_downloaded,
+                ctx.staged_digest,
+            ))
+        });
+        let checkpoint_storage = DOWNLOAD_CTX.lock(|ctx| ctx.borrow().checkpoint_storage);
+        if let (Some(checkpoint), Some(checkpoint_storage)) = (checkpoint, checkpoint_storage) {
+            // A failed checkpoint only costs progress on the next resume, keep downloading
+            let _ = checkpoint.store(checkpoint_storage).await;
+        }
+    }
 }
 
 #[async_trait(?Send)]
@@ -92,7 +151,7 @@ impl FdOps for UpdateFdOps {
         &self,
         component: &FirmwareComponent,
         fw_params: &FirmwareParameters,
-        _op: ComponentOperation,
+        op: ComponentOperation,
     ) -> Result<ComponentResponseCode, FdOpsError> {
         if let Some(size) = component.comp_image_size {
             if size
@@ -119,7 +178,21 @@ impl FdOps for UpdateFdOps {
             ctx.total_length = component.comp_image_size.unwrap_or(0) as usize;
         });
 
-        Ok(component.evaluate_update_eligibility(fw_params))
+        let response_code = component.evaluate_update_eligibility(fw_params);
+        if op == ComponentOperation::UpdateComponent
+            && response_code == ComponentResponseCode::CompCanBeUpdated
+        {
+            DOWNLOAD_CTX.lock(|ctx| {
+                let mut ctx = ctx.borrow_mut();
+                ctx.current_offset = ctx.initial_offset;
+                ctx.total_downloaded = 0;
+                ctx.staged_digest = 0;
+                ctx.last_checkpoint_offset = 0;
+            });
+            self.resume_from_checkpoint(component).await;
+        }
+
+        Ok(response_code)
     }
 
     async fn query_download_offset_and_length(
@@ -147,12 +220,13 @@ impl FdOps for UpdateFdOps {
         &self,
         offset: usize,
         data: &[u8],
-        _component: &FirmwareComponent,
+        component: &FirmwareComponent,
     ) -> Result<TransferResult, FdOpsError> {
         self.copy_data_to_buffer(offset, data).await?;
         // update self.download_ctx
         DOWNLOAD_CTX.lock(|ctx| {
             let mut ctx = ctx.borrow_mut();
+            ctx.staged_digest = update_staged_digest(ctx.staged_digest, data);
             if ctx.total_downloaded >= ctx.total_length {
                 PLDM_STATE.lock(|state| {
                     let mut state = state.borrow_mut();
@@ -164,6 +238,7 @@ impl FdOps for UpdateFdOps {
                 ctx.current_offset += data.len();
             }
         });
+        self.checkpoint_download(component).await;
 
         Ok(TransferResult::TransferSuccess)
     }
@@ -216,8 +291,191 @@ impl FdOps for UpdateFdOps {
         estimated_time: &mut u16,
     ) -> Result<u8, FdOpsError> {
         *estimated_time = 0;
+        // The staged image is consumed from here on, a later update must start from scratch
+        let checkpoint_storage = DOWNLOAD_CTX.lock(|ctx| ctx.borrow().checkpoint_storage);
+        if let Some(checkpoint_storage) = checkpoint_storage {
+            DownloadCheckpoint::clear(checkpoint_storage)
+                .await
+                .map_err(|_| FdOpsError::ActivateError)?;
+        }
         // TODO: Implement activation logic
         FW_UPDATE_TASK_YIELD.signal(());
         Ok(0) // PLDM completion code for success
     }
 }
+
+#[cfg(all(test, target_family = "unix"))]
+mod tests {
+    extern crate std;
+
+    use super::super::checkpoint::CheckpointStorage;
+    use super::super::pldm_client::reset_download_state;
+    use super::super::StagingMemory;
+    use super::*;
+    use alloc::vec;
+    use alloc::vec::Vec;
+    use async_trait::async_trait;
+    use libtock_platform::ErrorCode;
+    use pldm_common::protocol::firmware_update::{
+        ComponentActivationMethods, ComponentClassification, ComponentParameterEntry,
+        FirmwareDeviceCapability, PldmFirmwareString, PldmFirmwareVersion,
+    };
+    use std::sync::Mutex;
+
+    const IMAGE_SIZE: usize = 3 * DOWNLOAD_CHECKPOINT_INTERVAL;
+    // Past the second checkpoint of the download
+    const RESET_OFFSET: usize = 2 * DOWNLOAD_CHECKPOINT_INTERVAL + 1000;
+
+    #[derive(Debug)]
+    struct RamStaging(Mutex<Vec<u8>>);
+
+    #[async_trait]
+    impl StagingMemory for RamStaging {
+        async fn write(&self, offset: usize, data: &[u8]) -> Result<(), ErrorCode> {
+            self.0.lock().unwrap()[offset..offset + data.len()].copy_from_slice(data);
+            Ok(())
+        }
+
+        async fn read(&self, offset: usize, data: &mut [u8]) -> Result<(), ErrorCode> {
+            data.copy_from_slice(&self.0.lock().unwrap()[offset..offset + data.len()]);
+            Ok(())
+        }
+
+        fn size(&self) -> usize {
+            self.0.lock().unwrap().len()
+        }
+    }
+
+    #[derive(Debug)]
+    struct RamCheckpointStorage(Mutex<Vec<u8>>);
+
+    #[async_trait]
+    impl CheckpointStorage for RamCheckpointStorage {
+        async fn read(&self, data: &mut [u8]) -> Result<(), ErrorCode> {
+            data.copy_from_slice(&self.0.lock().unwrap()[..data.len()]);
+            Ok(())
+        }
+
+        async fn write(&self, data: &[u8]) -> Result<(), ErrorCode> {
+            self.0.lock().unwrap()[..data.len()].copy_from_slice(data);
+            Ok(())
+        }
+    }
+
+    fn firmware_params() -> FirmwareParameters {
+        let active_firmware_string = PldmFirmwareString::new("UTF-8", "soc-fw-1.0").unwrap();
+        let active_firmware_version =
+            PldmFirmwareVersion::new(0x12345678, &active_firmware_string, Some("20250210"));
+        let pending_firmware_string = PldmFirmwareString::new("UTF-8", "soc-fw-1.1").unwrap();
+        let pending_firmware_version =
+            PldmFirmwareVersion::new(0x87654321, &pending_firmware_string, Some("20250213"));
+        let capabilities_during_update = FirmwareDeviceCapability(0x0010);
+        let component_parameter_entry = ComponentParameterEntry::new(
+            ComponentClassification::Firmware,
+            0x0001,
+            0,
+            &active_firmware_version,
+            &pending_firmware_version,
+            ComponentActivationMethods(0x0001),
+            capabilities_during_update,
+        );
+        FirmwareParameters::new(
+            capabilities_during_update,
+            1,
+            &active_firmware_string,
+            &pending_firmware_string,
+            &[component_parameter_entry],
+        )
+    }
+
+    fn component() -> FirmwareComponent {
+        FirmwareComponent::new(
+            ComponentClassification::Firmware as u16,
+            0x0001,
+            0,
+            0x12345680,
+            PldmFirmwareString::new("UTF-8", "soc-fw-1.2").unwrap(),
+            Some(IMAGE_SIZE as u32),
+            None,
+        )
+    }
+
+    /// Starts the update of `component` after a reset, and returns the offset the device
+    /// asks for first.
+    async fn start_update(
+        fw_params: &'static FirmwareParameters,
+        staging: &'static RamStaging,
+        storage: &'static RamCheckpointStorage,
+        component: &FirmwareComponent,
+    ) -> (UpdateFdOps, usize) {
+        reset_download_state(&[], fw_params, staging, Some(storage));
+        let fd_ops = UpdateFdOps::new();
+        assert_eq!(
+            fd_ops
+                .handle_component(component, fw_params, ComponentOperation::UpdateComponent)
+                .await
+                .unwrap(),
+            ComponentResponseCode::CompCanBeUpdated
+        );
+        let (offset, _) = fd_ops
+            .query_download_offset_and_length(component)
+            .await
+            .unwrap();
+        (fd_ops, offset)
+    }
+
+    /// Sends the parts of `image` the device asks for, until it asks for `stop_offset`
+    /// or has the whole image.
+    async fn download(
+        fd_ops: &UpdateFdOps,
+        component: &FirmwareComponent,
+        image: &[u8],
+        stop_offset: usize,
+    ) {
+        while !fd_ops.is_download_complete(component).await {
+            let (offset, length) = fd_ops
+                .query_download_offset_and_length(component)
+                .await
+                .unwrap();
+            if offset >= stop_offset {
+                return;
+            }
+            let end = (offset + length).min(image.len());
+            fd_ops
+                .download_fw_data(offset, &image[offset..end], component)
+                .await
+                .unwrap();
+        }
+    }
+
+    #[test]
+    fn test_download_resumes_after_reset() {
+        let fw_params: &'static FirmwareParameters = Box::leak(Box::new(firmware_params()));
+        let staging: &'static RamStaging =
+            Box::leak(Box::new(RamStaging(Mutex::new(vec![0; IMAGE_SIZE]))));
+        let storage: &'static RamCheckpointStorage =
+            Box::leak(Box::new(RamCheckpointStorage(Mutex::new(vec![0xff; 256]))));
+        let component = component();
+        let image: Vec<u8> = (0..IMAGE_SIZE).map(|i| (i * 7 + i / 251) as u8).collect();
+
+        futures::executor::block_on(async {
+            let (fd_ops, offset) = start_update(fw_params, staging, storage, &component).await;
+            assert_eq!(offset, 0);
+            download(&fd_ops, &component, &image, RESET_OFFSET).await;
+
+            // The reset loses the download state, the device resumes from its last checkpoint
+            let checkpoint = DownloadCheckpoint::load(storage).await.unwrap();
+            assert!(checkpoint.verified_offset as usize > DOWNLOAD_CHECKPOINT_INTERVAL);
+            let (fd_ops, offset) = start_update(fw_params, staging, storage, &component).await;
+            assert_eq!(offset, checkpoint.verified_offset as usize);
+            download(&fd_ops, &component, &image, usize::MAX).await;
+            assert!(fd_ops.is_download_complete(&component).await);
+            assert!(*staging.0.lock().unwrap() == image);
+
+            // Staged data that no longer matches the checkpoint is downloaded again
+            staging.0.lock().unwrap()[0] ^= 0xff;
+            let (_, offset) = start_update(fw_params, staging, storage, &component).await;
+            assert_eq!(offset, 0);
+        });
+    }
+}
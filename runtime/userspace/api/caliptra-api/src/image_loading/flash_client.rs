@@ -1,84 +1,238 @@
 // Licensed under the Apache-2.0 license
 
+use crate::crypto::hash::{HashAlgoType, HashContext};
 use libsyscall_caliptra::dma::{AXIAddr, DMASource, DMATransaction, DMA as DMASyscall};
 use libtock_platform::ErrorCode;
 use zerocopy::FromBytes;
 
-use flash_image::{FlashHeader, ImageHeader};
+use flash_image::{
+    image_digest_table_offset, FlashHeader, ImageDigest, ImageDigestTableHeader, ImageHeader,
+    IMAGE_DIGEST_SIZE,
+};
 
 use libsyscall_caliptra::flash::SpiFlash as FlashSyscall;
 
-/// This is the size of the buffer used for DMA transfers.
-const MAX_DMA_TRANSFER_SIZE: usize = 128;
+use super::pldm_context::MAX_IMAGE_COUNT;
+
+/// Size of each staging buffer, the largest read the flash partition driver serves at once.
+const STAGING_BUFFER_SIZE: usize = 512;
 
 const FLASH_HEADER_OFFSET: usize = 0;
+const TOC_MAX_SIZE: usize = MAX_IMAGE_COUNT * core::mem::size_of::<ImageHeader>();
+
+/// The image headers of a flash image, read once and looked up for every image loaded.
+pub struct FlashToc {
+    toc: [u8; TOC_MAX_SIZE],
+    image_count: usize,
+    /// Flash offset of the first image digest, if the flash image has an image digest table
+    digests_offset: Option<usize>,
+}
+
+impl Default for FlashToc {
+    fn default() -> Self {
+        Self {
+            toc: [0; TOC_MAX_SIZE],
+            image_count: 0,
+            digests_offset: None,
+        }
+    }
+}
+
+impl FlashToc {
+    pub fn is_loaded(&self) -> bool {
+        self.image_count != 0
+    }
+
+    /// Returns the offset and size of `image_id` within the flash image.
+    pub fn find(&self, image_id: u32) -> Result<(u32, u32), ErrorCode> {
+        self.entry(image_id)
+            .map(|(_, image_header)| (image_header.offset, image_header.size))
+            .ok_or(ErrorCode::Fail)
+    }
+
+    /// Returns the flash offset of the digest of `image_id`, `None` if the flash image
+    /// carries no digests.
+    pub fn digest_offset(&self, image_id: u32) -> Result<Option<usize>, ErrorCode> {
+        let (index, _) = self.entry(image_id).ok_or(ErrorCode::Fail)?;
+        Ok(self
+            .digests_offset
+            .map(|digests_offset| digests_offset + index * core::mem::size_of::<ImageDigest>()))
+    }
 
-pub async fn flash_read_header(
+    /// Returns the index and header of `image_id` in the image headers.
+    fn entry(&self, image_id: u32) -> Option<(usize, ImageHeader)> {
+        self.toc[..self.image_count * core::mem::size_of::<ImageHeader>()]
+            .chunks_exact(core::mem::size_of::<ImageHeader>())
+            .enumerate()
+            .filter_map(|(index, entry)| {
+                ImageHeader::read_from_bytes(entry)
+                    .ok()
+                    .map(|image_header| (index, image_header))
+            })
+            .find(|(_, image_header)| image_header.identifier == image_id)
+    }
+}
+
+/// Reads the digest of `image_id` at `digest_offset` in flash, as returned by
+/// [`FlashToc::digest_offset`].
+pub async fn flash_read_digest(
     flash: &FlashSyscall,
-    header: &mut [u8; core::mem::size_of::<FlashHeader>()],
-) -> Result<(), ErrorCode> {
+    digest_offset: Option<usize>,
+    image_id: u32,
+) -> Result<Option<[u8; IMAGE_DIGEST_SIZE]>, ErrorCode> {
+    let Some(digest_offset) = digest_offset else {
+        return Ok(None);
+    };
+    let mut entry = [0u8; core::mem::size_of::<ImageDigest>()];
     flash
         .read(
-            FLASH_HEADER_OFFSET,
-            core::mem::size_of::<FlashHeader>(),
-            header,
+            digest_offset,
+            core::mem::size_of::<ImageDigest>(),
+            &mut entry,
         )
         .await?;
-    Ok(())
+    let image_digest = ImageDigest::read_from_bytes(&entry).map_err(|_| ErrorCode::Fail)?;
+    if image_digest.identifier != image_id {
+        return Err(ErrorCode::Fail);
+    }
+    Ok(Some(image_digest.digest))
 }
 
-pub async fn flash_read_toc(
-    flash: &FlashSyscall,
-    header: &[u8; core::mem::size_of::<FlashHeader>()],
-    image_id: u32,
-) -> Result<(u32, u32), ErrorCode> {
-    let (header, _) = FlashHeader::ref_from_prefix(header).map_err(|_| ErrorCode::Fail)?;
-    for index in 0..header.image_count as usize {
-        let flash_offset =
-            core::mem::size_of::<FlashHeader>() + index * core::mem::size_of::<ImageHeader>();
-        let buffer = &mut [0u8; core::mem::size_of::<ImageHeader>()];
-        flash
-            .read(flash_offset, core::mem::size_of::<ImageHeader>(), buffer)
-            .await?;
-        let (image_header, _) =
-            ImageHeader::ref_from_prefix(buffer).map_err(|_| ErrorCode::Fail)?;
-        if image_header.identifier == image_id {
-            return Ok((image_header.offset, image_header.size));
-        }
+/// Reads the flash header and all the image headers that follow it into `toc`, and locates
+/// the image digest table if the header version says there is one.
+pub async fn flash_read_toc(flash: &FlashSyscall, toc: &mut FlashToc) -> Result<(), ErrorCode> {
+    let mut header = [0u8; core::mem::size_of::<FlashHeader>()];
+    flash
+        .read(
+            FLASH_HEADER_OFFSET,
+            core::mem::size_of::<FlashHeader>(),
+            &mut header,
+        )
+        .await?;
+    let (header, _) = FlashHeader::ref_from_prefix(&header).map_err(|_| ErrorCode::Fail)?;
+    let image_count = header.image_count as usize;
+    if image_count == 0 || image_count > MAX_IMAGE_COUNT {
+        return Err(ErrorCode::Fail);
     }
 
-    Err(ErrorCode::Fail)
+    let toc_size = image_count * core::mem::size_of::<ImageHeader>();
+    flash
+        .read(
+            FLASH_HEADER_OFFSET + core::mem::size_of::<FlashHeader>(),
+            toc_size,
+            &mut toc.toc[..toc_size],
+        )
+        .await?;
+    toc.image_count = image_count;
+
+    // Only flash images built with digests have a table, as their header version says
+    toc.digests_offset = None;
+    let Some(table_offset) = image_digest_table_offset(header) else {
+        return Ok(());
+    };
+    let table_offset = FLASH_HEADER_OFFSET + table_offset;
+    let mut table_header = [0u8; core::mem::size_of::<ImageDigestTableHeader>()];
+    flash
+        .read(
+            table_offset,
+            core::mem::size_of::<ImageDigestTableHeader>(),
+            &mut table_header,
+        )
+        .await?;
+    let table_header =
+        ImageDigestTableHeader::read_from_bytes(&table_header).map_err(|_| ErrorCode::Fail)?;
+    if !table_header.verify(header.image_count) {
+        return Err(ErrorCode::Fail);
+    }
+    toc.digests_offset = Some(table_offset + core::mem::size_of::<ImageDigestTableHeader>());
+    Ok(())
 }
 
+/// Copies `img_size` bytes at `offset` in flash to `load_address`.
+///
+/// The image goes through two staging buffers: the next part of the image is read from
+/// flash into one of them while the other is being transferred by DMA.
+///
+/// If `digest` is given, each part is also hashed by Caliptra as it goes through, and the
+/// load fails if the SHA-384 of the image does not match, so that a corrupted image is not
+/// submitted for authorization. This uses the mailbox, which must not be busy meanwhile.
 pub async fn flash_load_image(
     flash: &FlashSyscall,
     load_address: AXIAddr,
     offset: usize,
     img_size: usize,
+    digest: Option<&[u8; IMAGE_DIGEST_SIZE]>,
 ) -> Result<(), ErrorCode> {
     let dma_syscall: DMASyscall = DMASyscall::new();
-    let mut remaining_size = img_size;
-    let mut current_offset = offset;
-    let mut current_address = load_address;
-
-    while remaining_size > 0 {
-        let transfer_size = remaining_size.min(MAX_DMA_TRANSFER_SIZE);
-        let mut buffer = [0; MAX_DMA_TRANSFER_SIZE];
-        flash
-            .read(current_offset, transfer_size, &mut buffer)
-            .await?;
-
-        let source_address = super::local_ram_to_axi_address(buffer.as_ptr() as u32);
+    let mut hash_ctx = match digest {
+        Some(_) => {
+            let mut hash_ctx = HashContext::new();
+            hash_ctx
+                .init(HashAlgoType::SHA384, None)
+                .await
+                .map_err(|_| ErrorCode::Fail)?;
+            Some(hash_ctx)
+        }
+        None => None,
+    };
+    let chunk_size = flash.get_chunk_size()?.min(STAGING_BUFFER_SIZE);
+    let mut staging = [[0u8; STAGING_BUFFER_SIZE]; 2];
+    let [first, second] = &mut staging;
+    let (mut ready, mut prefetch) = (first, second);
+
+    let mut loaded = 0;
+    let mut len = img_size.min(chunk_size);
+    flash.read(offset, len, &mut ready[..]).await?;
+
+    while len > 0 {
+        let next = loaded + len;
+        let next_len = (img_size - next).min(chunk_size);
+
         let transaction = DMATransaction {
-            byte_count: transfer_size,
-            source: DMASource::Address(source_address),
-            dest_addr: current_address,
+            byte_count: len,
+            source: DMASource::Address(super::local_ram_to_axi_address(ready.as_ptr() as u32)),
+            dest_addr: load_address + loaded as u64,
         };
-        dma_syscall.xfer(&transaction).await?;
-        remaining_size -= transfer_size;
-        current_offset += transfer_size;
-        current_address += transfer_size as u64;
+        let hash_chunk = async {
+            if let Some(hash_ctx) = hash_ctx.as_mut() {
+                hash_ctx
+                    .update(&ready[..len])
+                    .await
+                    .map_err(|_| ErrorCode::Fail)?;
+            }
+            Ok::<(), ErrorCode>(())
+        };
+        let read_ahead = async {
+            if next_len > 0 {
+                flash
+                    .read(offset + next, next_len, &mut prefetch[..])
+                    .await?;
+            }
+            Ok::<(), ErrorCode>(())
+        };
+        let ((transferred, hashed), read) = super::join(
+            super::join(dma_syscall.xfer(&transaction), hash_chunk),
+            read_ahead,
+        )
+        .await;
+        transferred?;
+        hashed?;
+        read?;
+
+        core::mem::swap(&mut ready, &mut prefetch);
+        loaded = next;
+        len = next_len;
     }
 
+    if let (Some(mut hash_ctx), Some(expected)) = (hash_ctx, digest) {
+        let mut actual = [0u8; IMAGE_DIGEST_SIZE];
+        hash_ctx
+            .finalize(&mut actual)
+            .await
+            .map_err(|_| ErrorCode::Fail)?;
+        if actual != *expected {
+            return Err(ErrorCode::Fail);
+        }
+    }
     Ok(())
 }
@@ -0,0 +1,126 @@
+// Licensed under the Apache-2.0 license
+
+//! Record of the images loaded from flash, kept across warm resets.
+//!
+//! Once all images have been loaded and authorized, the flash image loader records the
+//! identifier, load address, size and digest of each of them (the digest comes from the
+//! image digest table of the flash image). On the next boot, an image whose record still
+//! matches the flash image and the load address given by Caliptra is re-authorized where it
+//! is instead of being transferred again. If Caliptra rejects it, it is loaded as usual.
+
+use alloc::boxed::Box;
+use async_trait::async_trait;
+use flash_image::IMAGE_DIGEST_SIZE;
+use libsyscall_caliptra::dma::AXIAddr;
+use libtock_platform::ErrorCode;
+use zerocopy::{FromBytes, FromZeros, Immutable, IntoBytes, KnownLayout};
+
+pub const IMAGE_CACHE_MAGIC: u32 = u32::from_be_bytes(*b"IMGC");
+pub const MAX_CACHED_IMAGES: usize = 32;
+
+/// Storage holding a single `ImageCache` record.
+///
+/// The record must survive a warm reset but not a cold one, like the memory the images
+/// are loaded to.
+#[async_trait(?Send)]
+pub trait ImageCacheStorage {
+    async fn read(&self, data: &mut [u8]) -> Result<(), ErrorCode>;
+    async fn write(&self, data: &[u8]) -> Result<(), ErrorCode>;
+}
+
+/// How an image still in place after a warm reset is authorized again.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum ReauthorizePolicy {
+    /// Caliptra hashes the image at its load address again, only the transfer is skipped.
+    LoadAddress,
+    /// Caliptra is given the cached digest, which trusts that nothing wrote to the image
+    /// since it was loaded.
+    CachedDigest,
+}
+
+#[repr(C)]
+#[derive(Debug, FromBytes, IntoBytes, Clone, Copy, Immutable, KnownLayout)]
+pub struct CachedImage {
+    pub image_id: u32,
+    pub size: u32,
+    pub load_address: AXIAddr,
+    pub digest: [u8; IMAGE_DIGEST_SIZE],
+}
+
+#[repr(C)]
+#[derive(FromBytes, IntoBytes, Immutable, KnownLayout)]
+pub struct ImageCache {
+    magic: u32,
+    count: u32,
+    images: [CachedImage; MAX_CACHED_IMAGES],
+}
+
+impl ImageCache {
+    pub fn new() -> Self {
+        let mut cache = Self::new_zeroed();
+        cache.magic = IMAGE_CACHE_MAGIC;
+        cache
+    }
+
+    /// Reads the record held by `storage`, an empty cache if there is none.
+    pub async fn load(storage: &dyn ImageCacheStorage) -> Self {
+        let mut cache = Self::new_zeroed();
+        if storage.read(cache.as_mut_bytes()).await.is_err()
+            || cache.magic != IMAGE_CACHE_MAGIC
+            || cache.count as usize > MAX_CACHED_IMAGES
+        {
+            return Self::new();
+        }
+        cache
+    }
+
+    pub async fn store(&self, storage: &dyn ImageCacheStorage) -> Result<(), ErrorCode> {
+        storage.write(self.as_bytes()).await
+    }
+
+    /// Invalidates the record held by `storage`.
+    pub async fn clear(storage: &dyn ImageCacheStorage) -> Result<(), ErrorCode> {
+        Self::new().store(storage).await
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.count == 0
+    }
+
+    /// Returns the cached image if `image_id` was loaded to `load_address` with `digest`.
+    pub fn find(
+        &self,
+        image_id: u32,
+        load_address: AXIAddr,
+        size: u32,
+        digest: &[u8; IMAGE_DIGEST_SIZE],
+    ) -> Option<&CachedImage> {
+        self.images[..self.count as usize].iter().find(|image| {
+            image.image_id == image_id
+                && image.load_address == load_address
+                && image.size == size
+                && image.digest == *digest
+        })
+    }
+
+    /// Records `image`, replacing any previous record of the same image. Images beyond
+    /// `MAX_CACHED_IMAGES` are not recorded, and are loaded again on the next boot.
+    pub fn insert(&mut self, image: CachedImage) {
+        let count = self.count as usize;
+        if let Some(cached) = self.images[..count]
+            .iter_mut()
+            .find(|cached| cached.image_id == image.image_id)
+        {
+            *cached = image;
+        } else if count < MAX_CACHED_IMAGES {
+            self.images[count] = image;
+            self.count += 1;
+        }
+    }
+}
+
+impl Default for ImageCache {
+    fn default() -> Self {
+        Self::new()
+    }
+}
@@ -2,6 +2,7 @@
 
 extern crate alloc;
 mod flash_client;
+mod image_cache;
 mod pldm_client;
 mod pldm_context;
 mod pldm_fdops;
@@ -13,8 +14,14 @@ use caliptra_api::mailbox::{
     ImageHashSource, MailboxReqHeader, Request,
 };
 use caliptra_auth_man_types::ImageMetadataFlags;
+use core::cell::RefCell;
+use core::future::{poll_fn, Future};
+use core::pin::pin;
+use core::task::Poll;
 use embassy_executor::Spawner;
-use flash_image::FlashHeader;
+use flash_client::FlashToc;
+use flash_image::IMAGE_DIGEST_SIZE;
+use image_cache::{CachedImage, ImageCache};
 use libsyscall_caliptra::flash::SpiFlash as FlashSyscall;
 use libsyscall_caliptra::mailbox::MailboxError;
 use libsyscall_caliptra::{dma::AXIAddr, mailbox::Mailbox};
@@ -26,6 +33,8 @@ use pldm_common::protocol::firmware_update::Descriptor;
 use pldm_lib::daemon::PldmService;
 use zerocopy::{FromBytes, IntoBytes};
 
+pub use image_cache::{ImageCacheStorage, ReauthorizePolicy};
+
 pub const IMAGE_AUTHORIZED: u32 = 0xDEADC0DE;
 
 pub struct PldmInstance<'a> {
@@ -44,11 +53,35 @@ pub trait ImageLoader {
     /// - `Ok()`: Image has been loaded and authorized succesfully.
     /// - `Err(ErrorCode)`: Indication of the failure to load or authorize the image.
     async fn load_and_authorize(&self, image_id: u32) -> Result<(), ErrorCode>;
+
+    /// Loads and authorizes the specified images in order, stopping at the first failure.
+    ///
+    /// Implementations may load an image while the previous one is being authorized, but
+    /// images are always authorized in the order given, and an image is only authorized
+    /// once it has been completely loaded. When an error is returned, no load or
+    /// authorization is left in progress.
+    ///
+    /// # Parameters
+    /// image_ids: The identifiers of the images, in the order they should be loaded.
+    ///
+    /// # Returns
+    /// - `Ok()`: All images have been loaded and authorized succesfully.
+    /// - `Err(ErrorCode)`: Indication of the failure to load or authorize one of the images.
+    async fn load_and_authorize_all(&self, image_ids: &[u32]) -> Result<(), ErrorCode> {
+        for &image_id in image_ids {
+            self.load_and_authorize(image_id).await?;
+        }
+        Ok(())
+    }
 }
 
-pub struct FlashImageLoader {
+pub struct FlashImageLoader<'a> {
     mailbox: Mailbox,
     flash: FlashSyscall,
+    /// Image headers, read from flash by the first load
+    toc: RefCell<FlashToc>,
+    /// Where the images loaded are recorded, and how the ones still in place are authorized
+    image_cache: Option<(&'a dyn ImageCacheStorage, ReauthorizePolicy)>,
 }
 
 pub struct PldmImageLoader<'a> {
@@ -63,26 +96,121 @@ pub struct PldmFirmwareDeviceParams<'a> {
     pub fw_params: &'a FirmwareParameters,
 }
 
-impl FlashImageLoader {
+impl<'a> FlashImageLoader<'a> {
     pub fn new(flash_syscall: FlashSyscall) -> Self {
         Self {
             mailbox: Mailbox::new(),
             flash: flash_syscall,
+            toc: RefCell::new(FlashToc::default()),
+            image_cache: None,
+        }
+    }
+
+    /// Creates a loader that records the images it loads in `storage`.
+    ///
+    /// After a warm reset, images that are still at their load address with the same digest
+    /// are authorized again according to `policy` instead of being loaded again. Only images
+    /// with a digest in the flash image are recorded.
+    pub fn with_image_cache(
+        flash_syscall: FlashSyscall,
+        storage: &'a dyn ImageCacheStorage,
+        policy: ReauthorizePolicy,
+    ) -> Self {
+        Self {
+            image_cache: Some((storage, policy)),
+            ..Self::new(flash_syscall)
         }
     }
 }
 
 #[async_trait(?Send)]
-impl ImageLoader for FlashImageLoader {
+impl ImageLoader for FlashImageLoader<'_> {
     async fn load_and_authorize(&self, image_id: u32) -> Result<(), ErrorCode> {
-        let load_address = get_image_load_address(&self.mailbox, image_id).await?;
-        let mut header: [u8; core::mem::size_of::<FlashHeader>()] =
-            [0; core::mem::size_of::<FlashHeader>()];
-        flash_client::flash_read_header(&self.flash, &mut header).await?;
-        let (offset, size) = flash_client::flash_read_toc(&self.flash, &header, image_id).await?;
-        flash_client::flash_load_image(&self.flash, load_address, offset as usize, size as usize)
-            .await?;
-        authorize_image(&self.mailbox, image_id, size).await?;
+        self.load_and_authorize_all(&[image_id]).await
+    }
+
+    /// Loads each image from flash while the previous one is being authorized.
+    async fn load_and_authorize_all(&self, image_ids: &[u32]) -> Result<(), ErrorCode> {
+        if !self.toc.borrow().is_loaded() {
+            let mut toc = FlashToc::default();
+            flash_client::flash_read_toc(&self.flash, &mut toc).await?;
+            self.toc.replace(toc);
+        }
+
+        // The previous record is invalidated until all images are loaded, so that it does not
+        // describe memory a failed boot has partially overwritten.
+        let (mut previous_cache, mut cache) = (None, None);
+        if let Some((storage, _)) = self.image_cache {
+            let previous = ImageCache::load(storage).await;
+            if !previous.is_empty() {
+                ImageCache::clear(storage).await?;
+            }
+            previous_cache = Some(previous);
+            cache = Some(ImageCache::new());
+        }
+
+        let mut loaded: Option<LoadedImage> = None;
+        for &image_id in image_ids {
+            let load_address = get_image_load_address(&self.mailbox, image_id).await?;
+            let (offset, size) = self.toc.borrow().find(image_id)?;
+            let digest_offset = self.toc.borrow().digest_offset(image_id)?;
+            let digest =
+                flash_client::flash_read_digest(&self.flash, digest_offset, image_id).await?;
+            let image = LoadedImage {
+                image_id,
+                load_address,
+                size,
+            };
+
+            if let (Some(cache), Some(digest)) = (cache.as_mut(), &digest) {
+                let cached = CachedImage {
+                    image_id,
+                    size,
+                    load_address,
+                    digest: *digest,
+                };
+                cache.insert(cached);
+                let in_place = previous_cache
+                    .as_ref()
+                    .and_then(|previous| previous.find(image_id, load_address, size, digest))
+                    .is_some();
+                if let (true, Some((_, policy))) = (in_place, self.image_cache) {
+                    // Images are authorized in order, the previous one has to be done first
+                    if let Some(previous) = loaded.take() {
+                        authorize_image(&self.mailbox, previous.image_id, previous.size).await?;
+                    }
+                    if reauthorize_image(&self.mailbox, &cached, policy)
+                        .await
+                        .is_ok()
+                    {
+                        continue;
+                    }
+                }
+            }
+
+            if digest.is_some() {
+                // The digest is computed through the mailbox, which authorization also uses
+                if let Some(previous) = loaded.take() {
+                    authorize_image(&self.mailbox, previous.image_id, previous.size).await?;
+                }
+            }
+            let load = flash_client::flash_load_image(
+                &self.flash,
+                load_address,
+                offset as usize,
+                size as usize,
+                digest.as_ref(),
+            );
+            authorize_while_loading(&self.mailbox, loaded.take(), &image, load).await?;
+            loaded = Some(image);
+        }
+        if let Some(image) = loaded {
+            authorize_image(&self.mailbox, image.image_id, image.size).await?;
+        }
+
+        if let (Some((storage, _)), Some(cache)) = (self.image_cache, cache) {
+            cache.store(storage).await?;
+        }
         Ok(())
     }
 }
@@ -103,19 +231,40 @@ impl<'a> PldmImageLoader<'a> {
 #[async_trait(?Send)]
 impl ImageLoader for PldmImageLoader<'_> {
     async fn load_and_authorize(&self, image_id: u32) -> Result<(), ErrorCode> {
-        let load_address = get_image_load_address(&self.mailbox, image_id).await?;
+        self.load_and_authorize_all(&[image_id]).await
+    }
 
-        let result: Result<(), ErrorCode> = {
+    /// Streams all images within a single PLDM session.
+    ///
+    /// The session is opened and the TOC downloaded only once, each image is then downloaded
+    /// to its load address while the previous one is being authorized.
+    async fn load_and_authorize_all(&self, image_ids: &[u32]) -> Result<(), ErrorCode> {
+        let result: Result<(), ErrorCode> = async {
             pldm_client::initialize_pldm(
                 self.spawner,
                 self.params.descriptors,
                 self.params.fw_params,
             )
             .await?;
-            let (offset, size) = pldm_client::pldm_download_toc(image_id).await?;
-            pldm_client::pldm_download_image(load_address, offset, size).await?;
-            authorize_image(&self.mailbox, image_id, size).await
-        };
+            let mut loaded: Option<LoadedImage> = None;
+            for &image_id in image_ids {
+                let load_address = get_image_load_address(&self.mailbox, image_id).await?;
+                let (offset, size) = pldm_client::pldm_download_toc(image_id).await?;
+                let image = LoadedImage {
+                    image_id,
+                    load_address,
+                    size,
+                };
+                let load = pldm_client::pldm_download_image(load_address, offset, size);
+                authorize_while_loading(&self.mailbox, loaded.take(), &image, load).await?;
+                loaded = Some(image);
+            }
+            if let Some(image) = loaded {
+                authorize_image(&self.mailbox, image.image_id, image.size).await?;
+            }
+            Ok(())
+        }
+        .await;
         if result.is_err() {
             self.finalize().await?;
             return Err(ErrorCode::Fail);
@@ -125,6 +274,76 @@ impl ImageLoader for PldmImageLoader<'_> {
     }
 }
 
+/// An image that has been loaded and is waiting to be authorized.
+#[derive(Debug, Clone, Copy)]
+struct LoadedImage {
+    image_id: u32,
+    load_address: AXIAddr,
+    size: u32,
+}
+
+impl LoadedImage {
+    fn overlaps(&self, other: &LoadedImage) -> bool {
+        self.load_address < other.load_address + other.size as u64
+            && other.load_address < self.load_address + self.size as u64
+    }
+}
+
+/// Authorizes the previously loaded image, if any, while `load` brings in `next`.
+///
+/// Caliptra hashes the previous image from its load address, so `next` is only loaded
+/// concurrently when the two load regions do not overlap. Both operations have completed
+/// when this returns, and an authorization failure takes precedence over a load failure.
+async fn authorize_while_loading(
+    mailbox: &Mailbox,
+    previous: Option<LoadedImage>,
+    next: &LoadedImage,
+    load: impl Future<Output = Result<(), ErrorCode>>,
+) -> Result<(), ErrorCode> {
+    match previous {
+        None => load.await,
+        Some(previous) if previous.overlaps(next) => {
+            authorize_image(mailbox, previous.image_id, previous.size).await?;
+            load.await
+        }
+        Some(previous) => {
+            let (authorized, loaded) = join(
+                authorize_image(mailbox, previous.image_id, previous.size),
+                load,
+            )
+            .await;
+            authorized?;
+            loaded
+        }
+    }
+}
+
+/// Runs two futures concurrently on the current task and returns both outputs.
+async fn join<A: Future, B: Future>(a: A, b: B) -> (A::Output, B::Output) {
+    let mut a = pin!(a);
+    let mut b = pin!(b);
+    let mut a_output = None;
+    let mut b_output = None;
+    poll_fn(|cx| {
+        if a_output.is_none() {
+            if let Poll::Ready(output) = a.as_mut().poll(cx) {
+                a_output = Some(output);
+            }
+        }
+        if b_output.is_none() {
+            if let Poll::Ready(output) = b.as_mut().poll(cx) {
+                b_output = Some(output);
+            }
+        }
+        if a_output.is_some() && b_output.is_some() {
+            Poll::Ready((a_output.take().unwrap(), b_output.take().unwrap()))
+        } else {
+            Poll::Pending
+        }
+    })
+    .await
+}
+
 const MCU_SRAM_HI_OFFSET: u64 = 0x1000_0000;
 pub fn local_ram_to_axi_address(addr: u32) -> u64 {
     // Convert a local address to an AXI address
@@ -180,18 +399,56 @@ async fn get_image_load_address(mailbox: &Mailbox, image_id: u32) -> Result<AXIA
 
 /// Authorizes an image based on its ID.
 async fn authorize_image(mailbox: &Mailbox, image_id: u32, size: u32) -> Result<(), ErrorCode> {
+    authorize(mailbox, image_id, size, ImageHashSource::LoadAddress, None).await
+}
+
+/// Authorizes an image that is still in place from a previous boot.
+async fn reauthorize_image(
+    mailbox: &Mailbox,
+    image: &CachedImage,
+    policy: ReauthorizePolicy,
+) -> Result<(), ErrorCode> {
+    match policy {
+        ReauthorizePolicy::LoadAddress => {
+            authorize_image(mailbox, image.image_id, image.size).await
+        }
+        ReauthorizePolicy::CachedDigest => {
+            authorize(
+                mailbox,
+                image.image_id,
+                image.size,
+                ImageHashSource::InRequest,
+                Some(&image.digest),
+            )
+            .await
+        }
+    }
+}
+
+/// Authorizes an image, hashed by Caliptra from `source` or given as `measurement`.
+async fn authorize(
+    mailbox: &Mailbox,
+    image_id: u32,
+    size: u32,
+    source: ImageHashSource,
+    measurement: Option<&[u8; IMAGE_DIGEST_SIZE]>,
+) -> Result<(), ErrorCode> {
+    let source = source as u32;
     let mut flags = ImageMetadataFlags(0);
     flags.set_ignore_auth_check(false);
-    flags.set_image_source(ImageHashSource::LoadAddress as u32);
+    flags.set_image_source(source);
 
     let mut req = AuthorizeAndStashReq {
         hdr: MailboxReqHeader::default(),
         fw_id: image_id.to_le_bytes(),
         flags: flags.0,
-        source: ImageHashSource::LoadAddress as u32,
+        source,
         image_size: size,
         ..Default::default()
     };
+    if let Some(measurement) = measurement {
+        req.measurement = *measurement;
+    }
     let req_data = req.as_mut_bytes();
     mailbox
         .populate_checksum(AuthorizeAndStashReq::ID.into(), req_data)
@@ -2,7 +2,7 @@
 
 extern crate alloc;
 use crate::image_loading::pldm_context::State;
-use crate::image_loading::pldm_fdops::StreamingFdOps;
+use crate::image_loading::pldm_fdops::{staging_flush_task, StreamingFdOps};
 use flash_image::{FlashHeader, ImageHeader};
 
 use embassy_sync::blocking_mutex::raw::CriticalSectionRawMutex;
@@ -21,9 +21,7 @@ use pldm_lib::firmware_device::fd_ops::FdOps;
 
 use zerocopy::FromBytes;
 
-use super::pldm_context::{DOWNLOAD_CTX, PLDM_STATE};
-
-const MAX_IMAGE_COUNT: u32 = 127;
+use super::pldm_context::{DOWNLOAD_CTX, MAX_IMAGE_COUNT, PLDM_STATE};
 
 pub static PLDM_TASK_YIELD: Signal<CriticalSectionRawMutex, ()> = Signal::new();
 pub static IMAGE_LOADING_TASK_YIELD: Signal<CriticalSectionRawMutex, ()> = Signal::new();
@@ -64,73 +62,71 @@ async fn pldm_download_header() -> Result<(), ErrorCode> {
         header.image_count as usize
     });
 
-    if num_images > MAX_IMAGE_COUNT as usize {
+    if num_images > MAX_IMAGE_COUNT {
         return Err(ErrorCode::Fail);
     }
     Ok(())
 }
 
+/// Returns the offset and size of `image_id` within the streamed flash image.
+///
+/// The whole TOC is downloaded in a single transfer the first time it is needed and kept
+/// for the rest of the PLDM session, so looking up further images costs no PLDM traffic.
 pub async fn pldm_download_toc(image_id: u32) -> Result<(u32, u32), ErrorCode> {
+    let toc_image_count = DOWNLOAD_CTX.lock(|ctx| ctx.borrow().toc_image_count);
+    if toc_image_count == 0 {
+        pldm_download_full_toc().await?;
+    }
+
+    DOWNLOAD_CTX.lock(|ctx| {
+        let ctx = ctx.borrow();
+        ctx.toc[..ctx.toc_image_count * core::mem::size_of::<ImageHeader>()]
+            .chunks_exact(core::mem::size_of::<ImageHeader>())
+            .filter_map(|entry| ImageHeader::ref_from_bytes(entry).ok())
+            .find(|info| info.identifier == image_id)
+            .map(|info| (info.offset, info.size))
+            .ok_or(ErrorCode::Fail)
+    })
+}
+
+async fn pldm_download_full_toc() -> Result<(), ErrorCode> {
     let num_images = DOWNLOAD_CTX.lock(|ctx| {
         let ctx = ctx.borrow();
         let (header, _rest) = FlashHeader::ref_from_prefix(&ctx.header).unwrap();
         header.image_count as usize
     });
+    if num_images == 0 {
+        return Err(ErrorCode::Fail);
+    }
 
-    // Set State to DownloadingToc
     PLDM_STATE.lock(|state| {
         let mut state = state.borrow_mut();
         *state = State::DownloadingToc;
     });
+    DOWNLOAD_CTX.lock(|ctx| {
+        let mut ctx = ctx.borrow_mut();
+        ctx.total_length = num_images * core::mem::size_of::<ImageHeader>();
+        ctx.initial_offset = core::mem::size_of::<FlashHeader>();
+        ctx.current_offset = ctx.initial_offset;
+        ctx.total_downloaded = 0;
+    });
 
-    let mut image_offset_and_size = None;
-    for index in 0..num_images {
-        DOWNLOAD_CTX.lock(|ctx| {
-            let mut ctx = ctx.borrow_mut();
-            ctx.total_length = core::mem::size_of::<ImageHeader>(); // image info length
-            ctx.initial_offset =
-                core::mem::size_of::<FlashHeader>() + index * core::mem::size_of::<ImageHeader>();
-            ctx.current_offset = ctx.initial_offset;
-            ctx.total_downloaded = 0;
-        });
-
-        // Wait for TOC DownloadComplete to be ready
-        loop {
-            PLDM_TASK_YIELD.signal(());
-            IMAGE_LOADING_TASK_YIELD.wait().await;
-            let is_dowload_complete = PLDM_STATE.lock(|state| {
-                let mut state = state.borrow_mut();
-                if *state == State::TocDownloadComplete {
-                    DOWNLOAD_CTX.lock(|ctx| {
-                        let ctx = ctx.borrow();
-                        let (info, _rest) = ImageHeader::ref_from_prefix(&ctx.image_info).unwrap();
-                        if info.identifier == image_id {
-                            image_offset_and_size = Some((info.offset, info.size));
-                            *state = State::ImageDownloadReady;
-                        } else {
-                            *state = State::DownloadingToc;
-                        }
-                    });
-
-                    true
-                } else {
-                    false
-                }
-            });
-            if is_dowload_complete {
-                break;
-            }
-        }
-
-        if image_offset_and_size.is_some() {
-            break;
+    PLDM_TASK_YIELD.signal(());
+    IMAGE_LOADING_TASK_YIELD.wait().await;
+    let is_download_complete = PLDM_STATE.lock(|state| {
+        let mut state = state.borrow_mut();
+        if *state != State::TocDownloadComplete {
+            return false;
         }
+        *state = State::ImageDownloadReady;
+        true
+    });
+    if !is_download_complete {
+        return Err(ErrorCode::Fail);
     }
 
-    match image_offset_and_size {
-        Some(offset_size) => Ok(offset_size),
-        None => Err(ErrorCode::Fail),
-    }
+    DOWNLOAD_CTX.lock(|ctx| ctx.borrow_mut().toc_image_count = num_images);
+    Ok(())
 }
 
 pub async fn pldm_download_image(
@@ -150,6 +146,8 @@ pub async fn pldm_download_image(
         ctx.current_offset = offset as usize;
         ctx.total_downloaded = 0;
         ctx.load_address = load_address;
+        ctx.staging_offset = 0;
+        ctx.staging_len = 0;
     });
 
     PLDM_TASK_YIELD.signal(());
@@ -183,6 +181,7 @@ pub async fn initialize_pldm<'a>(
         let stud_fd_ops: &'static mut StreamingFdOps =
             unsafe { core::mem::transmute(&mut stud_fd_ops) };
 
+        spawner.spawn(staging_flush_task()).unwrap();
         spawner
             .spawn(pldm_service_task(stud_fd_ops, spawner))
             .unwrap();
@@ -203,6 +202,7 @@ pub async fn finalize(verify_result: VerifyResult) -> Result<(), ErrorCode> {
         let mut ctx = ctx.borrow_mut();
         ctx.download_complete = true;
         ctx.verify_result = verify_result;
+        ctx.toc_image_count = 0;
     });
     PLDM_TASK_YIELD.signal(());
     Ok(())
@@ -9,6 +9,13 @@ use embassy_sync::blocking_mutex::raw::CriticalSectionRawMutex;
 use embassy_sync::blocking_mutex::Mutex;
 use pldm_common::message::firmware_update::verify_complete::VerifyResult;
 
+/// Maximum number of images listed in the TOC of a streamed flash image.
+pub const MAX_IMAGE_COUNT: usize = 127;
+const TOC_MAX_SIZE: usize = MAX_IMAGE_COUNT * core::mem::size_of::<ImageHeader>();
+/// Size of each of the two windows in which image data is staged before being
+/// copied to the load address.
+pub const STAGING_WINDOW_SIZE: usize = 4096;
+
 #[derive(Debug, Clone, Copy, PartialEq)]
 pub enum State {
     NotRunning,
@@ -33,8 +40,19 @@ pub struct DownloadCtx {
     pub download_complete: bool,
     pub verify_result: VerifyResult,
     pub header: [u8; core::mem::size_of::<FlashHeader>()],
-    pub image_info: [u8; core::mem::size_of::<ImageHeader>()],
+    /// TOC of the streamed flash image, downloaded once per PLDM session
+    pub toc: [u8; TOC_MAX_SIZE],
+    /// Number of entries held in `toc`, 0 until the TOC has been downloaded
+    pub toc_image_count: usize,
     pub load_address: AXIAddr,
+    /// Offset within the image at which the active staging window starts
+    pub staging_offset: usize,
+    /// Number of bytes held in the active staging window
+    pub staging_len: usize,
+    /// Index of the staging window being filled
+    pub staging_index: usize,
+    /// Whether a staging window is being copied to the load address
+    pub flush_pending: bool,
 }
 
 pub static DOWNLOAD_CTX: Mutex<CriticalSectionRawMutex, RefCell<DownloadCtx>> =
@@ -46,10 +64,20 @@ pub static DOWNLOAD_CTX: Mutex<CriticalSectionRawMutex, RefCell<DownloadCtx>> =
         download_complete: false,
         verify_result: VerifyResult::VerifySuccess,
         header: [0; core::mem::size_of::<FlashHeader>()],
-        image_info: [0; core::mem::size_of::<ImageHeader>()],
+        toc: [0; TOC_MAX_SIZE],
+        toc_image_count: 0,
         load_address: 0,
         last_requested_length: 0,
+        staging_offset: 0,
+        staging_len: 0,
+        staging_index: 0,
+        flush_pending: false,
     }));
 
+pub static STAGING_WINDOWS: Mutex<
+    CriticalSectionRawMutex,
+    RefCell<[[u8; STAGING_WINDOW_SIZE]; 2]>,
+> = Mutex::new(RefCell::new([[0; STAGING_WINDOW_SIZE]; 2]));
+
 pub static PLDM_STATE: Mutex<CriticalSectionRawMutex, RefCell<State>> =
     Mutex::new(RefCell::new(State::NotRunning));
@@ -3,11 +3,14 @@
 extern crate alloc;
 
 use super::pldm_client::{IMAGE_LOADING_TASK_YIELD, PLDM_TASK_YIELD};
-use super::pldm_context::{State, DOWNLOAD_CTX, PLDM_STATE};
+use super::pldm_context::{State, DOWNLOAD_CTX, PLDM_STATE, STAGING_WINDOWS, STAGING_WINDOW_SIZE};
 use alloc::boxed::Box;
 use async_trait::async_trait;
+use embassy_sync::blocking_mutex::raw::CriticalSectionRawMutex;
+use embassy_sync::signal::Signal;
 use flash_image::{FlashHeader, ImageHeader};
 use libsyscall_caliptra::dma::{AXIAddr, DMASource, DMATransaction, DMA as DMASyscall};
+use libtock_platform::ErrorCode;
 use pldm_common::message::firmware_update::apply_complete::ApplyResult;
 use pldm_common::message::firmware_update::get_fw_params::FirmwareParameters;
 use pldm_common::message::firmware_update::get_status::ProgressPercent;
@@ -18,9 +21,40 @@ use pldm_common::protocol::firmware_update::{
     ComponentResponseCode, Descriptor, PLDM_FWUP_BASELINE_TRANSFER_SIZE,
 };
 use pldm_common::util::fw_component::FirmwareComponent;
+use pldm_common::util::mctp_transport::MctpCommonHeader;
+use pldm_lib::daemon::MAX_MCTP_PLDM_MSG_SIZE;
 use pldm_lib::firmware_device::fd_ops::{ComponentOperation, FdOps, FdOpsError};
 
-const MAX_PLDM_TRANSFER_SIZE: usize = core::mem::size_of::<RequestFirmwareDataResponseFixed>();
+/// Largest firmware data payload that fits in a PLDM message received over MCTP.
+const MAX_PLDM_TRANSFER_SIZE: usize = MAX_MCTP_PLDM_MSG_SIZE
+    - core::mem::size_of::<MctpCommonHeader>()
+    - core::mem::size_of::<RequestFirmwareDataResponseFixed>();
+
+/// A staging window to be copied to the load address.
+struct StagingFlush {
+    source: AXIAddr,
+    dest: AXIAddr,
+    len: usize,
+}
+
+static FLUSH_REQUEST: Signal<CriticalSectionRawMutex, StagingFlush> = Signal::new();
+static FLUSH_DONE: Signal<CriticalSectionRawMutex, Result<(), ErrorCode>> = Signal::new();
+
+/// Copies full staging windows to the load address while the PLDM task keeps
+/// requesting the next chunks of the image.
+#[embassy_executor::task]
+pub async fn staging_flush_task() {
+    let dma_syscall: DMASyscall = DMASyscall::new();
+    loop {
+        let flush = FLUSH_REQUEST.wait().await;
+        let transaction = DMATransaction {
+            byte_count: flush.len,
+            source: DMASource::Address(flush.source),
+            dest_addr: flush.dest,
+        };
+        FLUSH_DONE.signal(dma_syscall.xfer(&transaction).await);
+    }
+}
 
 pub struct StreamingFdOps<'a> {
     descriptors: &'a [Descriptor],
@@ -36,28 +70,73 @@ impl<'a> StreamingFdOps<'a> {
         }
     }
 
-    async fn copy_buffer_to_load_address(
-        &self,
-        load_address: AXIAddr,
-        offset: usize,
-        data: &[u8],
-    ) -> Result<(), FdOpsError> {
-        let dma_syscall: DMASyscall = DMASyscall::new();
-        let source_address = super::local_ram_to_axi_address(data.as_ptr() as u32);
+    /// Appends image data to the staging windows, flushing every window that fills up.
+    async fn stage_image_data(&self, mut data: &[u8]) -> Result<(), FdOpsError> {
+        while !data.is_empty() {
+            let (copied, window_full) = DOWNLOAD_CTX.lock(|ctx| {
+                let mut ctx = ctx.borrow_mut();
+                STAGING_WINDOWS.lock(|windows| {
+                    let mut windows = windows.borrow_mut();
+                    let start = ctx.staging_len;
+                    let len = data.len().min(STAGING_WINDOW_SIZE - start);
+                    windows[ctx.staging_index][start..start + len].copy_from_slice(&data[..len]);
+                    ctx.staging_len += len;
+                    (len, ctx.staging_len == STAGING_WINDOW_SIZE)
+                })
+            });
+            data = &data[copied..];
+            if window_full {
+                self.flush_staging_window().await?;
+            }
+        }
+        Ok(())
+    }
 
-        let transaction = DMATransaction {
-            byte_count: data.len(),
-            source: DMASource::Address(source_address),
-            dest_addr: load_address + offset as u64,
-        };
-        dma_syscall.xfer(&transaction).await.unwrap();
+    /// Hands the active staging window over to the flush task and switches to the other one.
+    async fn flush_staging_window(&self) -> Result<(), FdOpsError> {
+        // The other window can only be refilled once its own flush is done
+        self.wait_for_flush().await?;
+        let flush = DOWNLOAD_CTX.lock(|ctx| {
+            let mut ctx = ctx.borrow_mut();
+            if ctx.staging_len == 0 {
+                return None;
+            }
+            let source =
+                STAGING_WINDOWS.lock(|windows| windows.borrow()[ctx.staging_index].as_ptr() as u32);
+            let flush = StagingFlush {
+                source: super::local_ram_to_axi_address(source),
+                dest: ctx.load_address + ctx.staging_offset as u64,
+                len: ctx.staging_len,
+            };
+            ctx.staging_offset += ctx.staging_len;
+            ctx.staging_len = 0;
+            ctx.staging_index ^= 1;
+            ctx.flush_pending = true;
+            Some(flush)
+        });
+        if let Some(flush) = flush {
+            FLUSH_REQUEST.signal(flush);
+        }
+        Ok(())
+    }
 
+    async fn wait_for_flush(&self) -> Result<(), FdOpsError> {
+        let pending = DOWNLOAD_CTX.lock(|ctx| {
+            let mut ctx = ctx.borrow_mut();
+            core::mem::replace(&mut ctx.flush_pending, false)
+        });
+        if pending {
+            FLUSH_DONE
+                .wait()
+                .await
+                .map_err(|_| FdOpsError::FwDownloadError)?;
+        }
         Ok(())
     }
 
     async fn copy_data_to_buffer(&self, _offset: usize, data: &[u8]) -> Result<(), FdOpsError> {
         let state = PLDM_STATE.lock(|state| *state.borrow());
-        let dma_params = DOWNLOAD_CTX.lock(|ctx| {
+        let image_data = DOWNLOAD_CTX.lock(|ctx| {
             let mut ctx = ctx.borrow_mut();
             ctx.total_downloaded += data.len();
             let start = ctx.current_offset - ctx.initial_offset;
@@ -66,18 +145,24 @@ impl<'a> StreamingFdOps<'a> {
                 let end = (start + data.len()).min(ctx.header.len());
                 ctx.header[start..end].copy_from_slice(&data[..end - start]);
             } else if state == State::DownloadingToc {
-                let end = (start + data.len()).min(ctx.image_info.len());
-                ctx.image_info[start..end].copy_from_slice(&data[..end - start]);
+                let end = (start + data.len()).min(ctx.total_length);
+                ctx.toc[start..end].copy_from_slice(&data[..end - start]);
             } else if state == State::DownloadingImage {
-                return Some((ctx.load_address, start));
+                // Padding past the end of the image is not loaded
+                let end = (start + data.len()).min(ctx.total_length);
+                let image_complete = ctx.total_downloaded >= ctx.total_length;
+                return Some((end.saturating_sub(start), image_complete));
             }
 
             None
         });
-        if let Some(dma_params) = dma_params {
-            return self
-                .copy_buffer_to_load_address(dma_params.0, dma_params.1, data)
-                .await;
+        if let Some((len, image_complete)) = image_data {
+            self.stage_image_data(&data[..len]).await?;
+            if image_complete {
+                // The whole image must be at the load address before it gets authorized
+                self.flush_staging_window().await?;
+                self.wait_for_flush().await?;
+            }
         }
         Ok(())
     }
@@ -109,8 +194,8 @@ impl FdOps for StreamingFdOps<'_> {
     }
 
     async fn get_xfer_size(&self, ua_transfer_size: usize) -> Result<usize, FdOpsError> {
-        // Return the minimum of requested and baseline transfer size
-        let size = core::cmp::min(ua_transfer_size, PLDM_FWUP_BASELINE_TRANSFER_SIZE);
+        // Accept transfers up to the largest payload a single MCTP message can carry
+        let size = core::cmp::min(ua_transfer_size, MAX_PLDM_TRANSFER_SIZE);
         Ok(size)
     }
 
@@ -9,6 +9,7 @@ pub struct FakeDMADriver {
     src_addr: RefCell<Option<u64>>,
     dest_addr: RefCell<Option<u64>>,
     last_ro_buffer: RefCell<RoAllowBuffer>,
+    descriptors: RefCell<RoAllowBuffer>,
     share_ref: DriverShareRef,
     memory: RefCell<Vec<u8>>,
 }
@@ -25,6 +26,7 @@ impl FakeDMADriver {
             src_addr: RefCell::new(None),
             dest_addr: RefCell::new(None),
             last_ro_buffer: Default::default(),
+            descriptors: Default::default(),
             share_ref: Default::default(),
             memory: RefCell::new(Vec::new()),
         }
@@ -98,6 +100,17 @@ impl SyscallDriver for FakeDMADriver {
                     .expect("Unable to schedule upcall");
                 crate::command_return::success()
             }
+            dma_cmd::XFER_LIST => {
+                let count = arg0 as usize;
+                if count == 0 || self.descriptors.borrow().len() < count * DESCRIPTOR_SIZE {
+                    return crate::command_return::failure(ErrorCode::Invalid);
+                }
+                // AXI transfers are not emulated, complete the whole list at once
+                self.share_ref
+                    .schedule_upcall(dma_subscribe::XFER_DONE, (0, count as u32, 0))
+                    .expect("Unable to schedule upcall");
+                crate::command_return::success()
+            }
             dma_cmd::XFER_AXI_TO_AXI => {
                 // Not supported at the moment
                 // Simulate the transfer completion by scheduling an upcall
@@ -117,6 +130,8 @@ impl SyscallDriver for FakeDMADriver {
     ) -> Result<RoAllowBuffer, (RoAllowBuffer, ErrorCode)> {
         if allow_num == dma_ro_buffer::LOCAL_SOURCE {
             Ok(self.last_ro_buffer.replace(buffer))
+        } else if allow_num == dma_ro_buffer::DESCRIPTORS {
+            Ok(self.descriptors.replace(buffer))
         } else {
             Err((buffer, ErrorCode::Invalid))
         }
@@ -140,12 +155,16 @@ mod dma_cmd {
     pub const SET_DEST_ADDR: u32 = 2;
     pub const XFER_AXI_TO_AXI: u32 = 3;
     pub const XFER_LOCAL_TO_AXI: u32 = 4;
+    pub const XFER_LIST: u32 = 5;
 }
 
 mod dma_ro_buffer {
     pub const LOCAL_SOURCE: u32 = 0;
+    pub const DESCRIPTORS: u32 = 1;
 }
 
+const DESCRIPTOR_SIZE: usize = 24;
+
 mod dma_subscribe {
     pub const XFER_DONE: u32 = 0;
 }
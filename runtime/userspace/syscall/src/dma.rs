@@ -9,6 +9,7 @@ use crate::DefaultSyscalls;
 use core::marker::PhantomData;
 use libtock_platform::{share, AllowRo, DefaultConfig, ErrorCode, Syscalls};
 use libtockasync::TockSubscribe;
+use zerocopy::{Immutable, IntoBytes};
 /// DMA interface.
 pub struct DMA<S: Syscalls = DefaultSyscalls> {
     syscall: PhantomData<S>,
@@ -38,6 +39,30 @@ pub enum DMASource<'a> {
     Buffer(&'a [u8]),
 }
 
+/// One segment of a scatter-gather transfer, in the layout read by the kernel.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default, IntoBytes, Immutable)]
+pub struct DMADescriptor {
+    /// Source AXI address of the segment.
+    pub source_addr: AXIAddr,
+    /// Destination AXI address of the segment.
+    pub dest_addr: AXIAddr,
+    /// Number of bytes to transfer.
+    pub byte_count: u32,
+    reserved: u32,
+}
+
+impl DMADescriptor {
+    pub fn new(source_addr: AXIAddr, dest_addr: AXIAddr, byte_count: u32) -> Self {
+        Self {
+            source_addr,
+            dest_addr,
+            byte_count,
+            reserved: 0,
+        }
+    }
+}
+
 impl<S: Syscalls> Default for DMA<S> {
     fn default() -> Self {
         Self::new()
@@ -71,6 +96,58 @@ impl<S: Syscalls> DMA<S> {
         }
     }
 
+    /// Do a scatter-gather DMA transfer.
+    ///
+    /// The kernel executes the descriptors in order and completes the whole list with a
+    /// single upcall, so a multi-segment transfer costs one syscall and one wakeup.
+    ///
+    /// # Arguments
+    /// * `descriptors` - The segments to transfer, all between AXI addresses.
+    ///
+    /// # Returns
+    /// * `Ok(())` if all the segments were transferred.
+    /// * `Err(ErrorCode)` if the list could not be started or a segment failed.
+    pub async fn xfer_list(&self, descriptors: &[DMADescriptor]) -> Result<(), ErrorCode> {
+        if descriptors.is_empty() {
+            return Ok(());
+        }
+
+        let result = share::scope::<(), _, _>(|_handle| {
+            let mut sub = TockSubscribe::subscribe_allow_ro::<S, DefaultConfig>(
+                self.driver_num,
+                dma_subscribe::XFER_DONE,
+                dma_ro_buffer::DESCRIPTORS,
+                descriptors.as_bytes(),
+            );
+
+            if let Err(e) = S::command(
+                self.driver_num,
+                dma_cmd::XFER_LIST,
+                descriptors.len() as u32,
+                0,
+            )
+            .to_result::<(), ErrorCode>()
+            {
+                S::unallow_ro(self.driver_num, dma_ro_buffer::DESCRIPTORS);
+                // Cancel the future if the command fails
+                sub.cancel();
+                Err(e)?;
+            }
+
+            Ok(TockSubscribe::subscribe_finish(sub))
+        })?
+        .await;
+
+        S::unallow_ro(self.driver_num, dma_ro_buffer::DESCRIPTORS);
+
+        // The upcall reports how many descriptors were transferred
+        let (_, completed, _) = result?;
+        if completed as usize != descriptors.len() {
+            return Err(ErrorCode::Fail);
+        }
+        Ok(())
+    }
+
     async fn xfer_src_address(&self) -> Result<(), ErrorCode> {
         let async_start = TockSubscribe::subscribe::<S>(self.driver_num, dma_subscribe::XFER_DONE);
         S::command(self.driver_num, dma_cmd::XFER_AXI_TO_AXI, 0, 0).to_result::<(), ErrorCode>()?;
@@ -142,12 +219,15 @@ mod dma_cmd {
     pub const SET_DEST_ADDR: u32 = 2;
     pub const XFER_AXI_TO_AXI: u32 = 3;
     pub const XFER_LOCAL_TO_AXI: u32 = 4;
+    pub const XFER_LIST: u32 = 5;
 }
 
 /// Buffer IDs for DMA (read-only)
 mod dma_ro_buffer {
     /// Buffer ID for local buffers (read-only)
     pub const LOCAL_SOURCE: u32 = 0;
+    /// Buffer ID for the descriptor list of a scatter-gather transfer
+    pub const DESCRIPTORS: u32 = 1;
 }
 
 /// Subscription IDs for asynchronous notifications.
@@ -1,9 +1,12 @@
 // Licensed under the Apache-2.0 license
 mod test_firmware_update;
+mod test_firmware_update_perf;
+mod test_lockstep;
 mod test_soc_boot;
 #[cfg(test)]
 mod test {
     use mcu_builder::{CaliptraBuilder, SocImage, TARGET};
+    use mcu_config::milestone::{check_budgets, CycleBudget, Milestone};
     use std::process::ExitStatus;
     use std::sync::atomic::AtomicU32;
     use std::sync::Mutex;
@@ -13,7 +16,7 @@ mod test {
         sync::LazyLock,
     };
 
-    static PROJECT_ROOT: LazyLock<PathBuf> = LazyLock::new(|| {
+    pub static PROJECT_ROOT: LazyLock<PathBuf> = LazyLock::new(|| {
         Path::new(&env!("CARGO_MANIFEST_DIR"))
             .parent()
             .unwrap()
@@ -68,6 +71,72 @@ mod test {
         output
     }
 
+    /// Runs the emulator `command` with its milestones written to a temporary file, and
+    /// returns its exit status with the milestones, in the order they were reached.
+    pub fn run_with_milestones(mut command: Command) -> (ExitStatus, Vec<(Milestone, u64)>) {
+        let milestones_file =
+            tempfile::NamedTempFile::new().expect("Failed to create milestones file");
+        let status = command
+            .arg("--milestones")
+            .arg(milestones_file.path())
+            .status()
+            .unwrap();
+
+        let milestones = std::fs::read_to_string(milestones_file.path())
+            .unwrap_or_default()
+            .lines()
+            .filter_map(|line| {
+                let (name, cycles) = line.split_once(' ')?;
+                Some((Milestone::from_name(name)?, cycles.parse().ok()?))
+            })
+            .collect();
+        (status, milestones)
+    }
+
+    /// Margin of the cycle budgets over their recorded baselines, in percent.
+    pub const CYCLE_BUDGET_MARGIN_PERCENT: u64 = 150;
+
+    /// Asserts that the firmware reached the milestones of `budgets` within their cycle
+    /// budgets. The measured cycles are printed as JSON lines, and also appended to the
+    /// file named by `MCU_CYCLE_BUDGET_RESULTS` if set.
+    pub fn check_cycle_budgets(
+        test: &str,
+        milestones: &[(Milestone, u64)],
+        budgets: &[CycleBudget],
+    ) {
+        let results: String = budgets
+            .iter()
+            .filter_map(|budget| {
+                let cycles = budget.measure(milestones)?;
+                Some(format!(
+                    "{{\"test\":\"{}\",\"from\":\"{}\",\"to\":\"{}\",\"cycles\":{},\"budget\":{}}}\n",
+                    test,
+                    budget.from.name(),
+                    budget.to.name(),
+                    cycles,
+                    budget.max_cycles
+                ))
+            })
+            .collect();
+        print!("{}", results);
+        if let Ok(results_path) = std::env::var("MCU_CYCLE_BUDGET_RESULTS") {
+            use std::io::Write;
+            std::fs::OpenOptions::new()
+                .create(true)
+                .append(true)
+                .open(&results_path)
+                .and_then(|mut file| file.write_all(results.as_bytes()))
+                .expect("Failed to write cycle budget results");
+        }
+
+        if let Err(err) = check_budgets(milestones, budgets) {
+            panic!(
+                "{}: cycle budget check failed: {:?}, milestones: {:?}",
+                test, err, milestones
+            );
+        }
+    }
+
     #[allow(clippy::too_many_arguments)]
     pub fn run_runtime(
         feature: &str,
@@ -83,6 +152,41 @@ mod test {
         caliptra_builder: Option<CaliptraBuilder>,
         hw_revision: Option<String>,
     ) -> ExitStatus {
+        runtime_command(
+            feature,
+            rom_path,
+            runtime_path,
+            i3c_port,
+            active_mode,
+            manufacturing_mode,
+            soc_images,
+            streaming_boot_package_path,
+            primary_flash_image_path,
+            secondary_flash_image_path,
+            caliptra_builder,
+            hw_revision,
+        )
+        .status()
+        .unwrap()
+    }
+
+    /// Returns the command that runs the emulator with the given firmware, as `run_runtime`
+    /// does. Arguments added to it are passed to the emulator.
+    #[allow(clippy::too_many_arguments)]
+    pub fn runtime_command(
+        feature: &str,
+        rom_path: PathBuf,
+        runtime_path: PathBuf,
+        i3c_port: String,
+        active_mode: bool,
+        manufacturing_mode: bool,
+        soc_images: Option<Vec<SocImage>>,
+        streaming_boot_package_path: Option<PathBuf>,
+        primary_flash_image_path: Option<PathBuf>,
+        secondary_flash_image_path: Option<PathBuf>,
+        caliptra_builder: Option<CaliptraBuilder>,
+        hw_revision: Option<String>,
+    ) -> Command {
         let mut cargo_run_args = vec![
             "run",
             "-p",
@@ -235,13 +339,13 @@ mod test {
 
             println!("Running test firmware {}", feature.replace("_", "-"));
             let mut cmd = Command::new("cargo");
-            let cmd = cmd.args(&cargo_run_args).current_dir(&*PROJECT_ROOT);
-            cmd.status().unwrap()
+            cmd.args(&cargo_run_args).current_dir(&*PROJECT_ROOT);
+            cmd
         } else {
             println!("Running test firmware {}", feature.replace("_", "-"));
             let mut cmd = Command::new("cargo");
-            let cmd = cmd.args(&cargo_run_args).current_dir(&*PROJECT_ROOT);
-            cmd.status().unwrap()
+            cmd.args(&cargo_run_args).current_dir(&*PROJECT_ROOT);
+            cmd
         }
     }
 
@@ -316,6 +420,7 @@ mod test {
     run_test!(test_caliptra_crypto, example_app);
     run_test!(test_caliptra_mailbox, example_app);
     run_test!(test_dma, example_app);
+    run_test!(test_syscall_perf, example_app);
     run_test!(test_doe_transport_loopback, example_app);
     run_test!(test_doe_user_loopback, example_app);
     run_test!(test_doe_discovery, example_app);
@@ -331,6 +436,7 @@ mod test {
     run_test!(test_log_flash_circular);
     run_test!(test_log_flash_usermode, example_app);
     run_test!(test_mctp_ctrl_cmds);
+    run_test!(test_mctp_bridge);
     run_test!(test_mctp_capsule_loopback);
     run_test!(test_mctp_user_loopback, example_app);
     run_test!(test_pldm_discovery);
@@ -2,9 +2,13 @@
 
 #[cfg(test)]
 mod test {
-    use crate::test::{compile_runtime, get_rom_with_feature, run_runtime, TEST_LOCK};
+    use crate::test::{
+        check_cycle_budgets, compile_runtime, get_rom_with_feature, run_with_milestones,
+        runtime_command, CYCLE_BUDGET_MARGIN_PERCENT, TEST_LOCK,
+    };
     use chrono::{TimeZone, Utc};
     use mcu_builder::{CaliptraBuilder, SocImage};
+    use mcu_config::milestone::{CycleBudget, Milestone};
     use mcu_config_emulator::flash::PartitionTable;
     use pldm_fw_pkg::manifest::{
         ComponentImageInformation, Descriptor, DescriptorType, FirmwareDeviceIdRecord,
@@ -12,10 +16,30 @@ mod test {
     };
     use pldm_fw_pkg::FirmwareManifest;
     use std::path::PathBuf;
-    use std::process::ExitStatus;
+    use std::process::Command;
 
     const CALIPTRA_EXTERNAL_RAM_BASE: u64 = 0x8000_0000;
 
+    /// Cycle budgets of a successful update: the baseline cycles of each step, as
+    /// printed by `check_cycle_budgets` for a successful emulator run, plus
+    /// `CYCLE_BUDGET_MARGIN_PERCENT`. Update a baseline when a change moves it on purpose.
+    const UPDATE_CYCLE_BUDGETS: &[CycleBudget] = &[
+        // Baseline: 165M cycles, the same boot as the SoC boot test
+        CycleBudget::from_baseline(
+            Milestone::RomStart,
+            Milestone::RuntimeStart,
+            165_000_000,
+            CYCLE_BUDGET_MARGIN_PERCENT,
+        ),
+        // Baseline: 1.3G cycles
+        CycleBudget::from_baseline(
+            Milestone::RuntimeStart,
+            Milestone::UpdateComplete,
+            1_300_000_000,
+            CYCLE_BUDGET_MARGIN_PERCENT,
+        ),
+    ];
+
     #[derive(Clone)]
     struct TestOptions {
         feature: &'static str,
@@ -88,6 +112,7 @@ mod test {
             ),
             flash_offset,
             flash_image_path.to_str().unwrap(),
+            false,
         )
         .expect("Failed to create flash image");
 
@@ -163,7 +188,7 @@ mod test {
                 version_string: Some("soc-fw-1.2".to_string()),
 
                 size: image.len() as u32,
-                image_data: Some(image.to_vec()),
+                image_data: Some(image.to_vec().into()),
                 ..Default::default()
             }],
         }
@@ -179,13 +204,13 @@ mod test {
         ]
     }
 
-    fn run_runtime_with_options(opts: &TestOptions) -> ExitStatus {
+    fn runtime_command_with_options(opts: &TestOptions) -> Command {
         // prevent warning on unused options, this will be used in the future
         let _ = &opts.soc_images_paths;
         let _ = &opts.partition_table;
         let _ = &opts.flash_offset;
 
-        run_runtime(
+        runtime_command(
             opts.feature,
             opts.rom.clone(),
             opts.runtime.clone(),
@@ -203,15 +228,14 @@ mod test {
 
     /// Test case: happy path
     fn test_successful_update(opts: &TestOptions) {
-        let test = run_runtime_with_options(opts);
+        let (test, milestones) = run_with_milestones(runtime_command_with_options(opts));
         assert_eq!(0, test.code().unwrap_or_default());
+        check_cycle_budgets(opts.feature, &milestones, UPDATE_CYCLE_BUDGETS);
     }
 
     // Common test function for both flash-based and streaming boot
-    fn test_firmware_update_common() {
+    fn test_firmware_update_common(feature: &'static str, i3c_port: u32) {
         let lock = TEST_LOCK.lock().unwrap();
-        let feature = "test-firmware-update";
-        let i3c_port = 65500;
         let soc_image_fw_1 = [0x55u8; 512]; // Example firmware data for SOC image 1
         let soc_image_fw_2 = [0xAAu8; 256]; // Example firmware data for SOC image 2
 
@@ -315,6 +339,13 @@ mod test {
 
     #[test]
     fn test_firmware_update() {
-        test_firmware_update_common();
+        test_firmware_update_common("test-firmware-update", 65500);
+    }
+
+    #[test]
+    fn test_firmware_update_resume() {
+        // The update agent cancels the download midway and restarts the update,
+        // the device must resume from its download checkpoint
+        test_firmware_update_common("test-firmware-update-resume", 65501);
     }
 }
@@ -0,0 +1,104 @@
+// Licensed under the Apache-2.0 license
+
+#[cfg(test)]
+mod test {
+    use crate::test::{compile_runtime, runtime_command, ROM, TEST_LOCK};
+    use std::path::PathBuf;
+
+    const FEATURE: &str = "test-pldm-fw-update-perf";
+
+    struct PerfCase {
+        package_size: usize,
+        components: usize,
+        transfer_size: u32,
+        link_latency_us: u64,
+    }
+
+    const PERF_CASES: &[PerfCase] = &[
+        PerfCase {
+            package_size: 4096,
+            components: 1,
+            transfer_size: 64,
+            link_latency_us: 0,
+        },
+        PerfCase {
+            package_size: 4096,
+            components: 1,
+            transfer_size: 512,
+            link_latency_us: 0,
+        },
+        PerfCase {
+            package_size: 65536,
+            components: 1,
+            transfer_size: 512,
+            link_latency_us: 0,
+        },
+        PerfCase {
+            package_size: 65536,
+            components: 4,
+            transfer_size: 512,
+            link_latency_us: 0,
+        },
+        PerfCase {
+            package_size: 65536,
+            components: 1,
+            transfer_size: 512,
+            link_latency_us: 500,
+        },
+    ];
+
+    /// Runs a full PLDM firmware update for every case of the matrix and collects the
+    /// per-phase timings reported by the update agent as JSON lines.
+    ///
+    /// The results are written to the file named by `PLDM_PERF_RESULTS` if set,
+    /// otherwise to a temporary file whose contents are printed.
+    #[ignore]
+    #[test]
+    fn test_firmware_update_perf() {
+        let lock = TEST_LOCK.lock().unwrap();
+        lock.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+
+        let results_file = tempfile::NamedTempFile::new().expect("Failed to create results file");
+        let results_path = std::env::var("PLDM_PERF_RESULTS")
+            .map(PathBuf::from)
+            .unwrap_or_else(|_| results_file.path().to_path_buf());
+        let _ = std::fs::remove_file(&results_path);
+
+        let test_runtime = compile_runtime(FEATURE, false);
+        for case in PERF_CASES {
+            // The emulator configures the update agent from these
+            let test = runtime_command(
+                FEATURE,
+                ROM.to_path_buf(),
+                test_runtime.clone(),
+                "65502".to_string(),
+                true,
+                false,
+                None,
+                None,
+                None,
+                None,
+                None,
+                None,
+            )
+            .env("PLDM_PERF_RESULTS", &results_path)
+            .env("PLDM_PERF_PACKAGE_SIZE", case.package_size.to_string())
+            .env("PLDM_PERF_COMPONENTS", case.components.to_string())
+            .env("PLDM_PERF_TRANSFER_SIZE", case.transfer_size.to_string())
+            .env(
+                "PLDM_PERF_LINK_LATENCY_US",
+                case.link_latency_us.to_string(),
+            )
+            .status()
+            .unwrap();
+            assert_eq!(0, test.code().unwrap_or_default());
+        }
+
+        let results = std::fs::read_to_string(&results_path).expect("Failed to read results");
+        println!("{}", results);
+        assert_eq!(results.lines().count(), PERF_CASES.len());
+
+        // force the compiler to keep the lock
+        lock.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+    }
+}
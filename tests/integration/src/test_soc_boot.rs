@@ -2,12 +2,18 @@
 
 #[cfg(test)]
 mod test {
-    use crate::test::{compile_runtime, get_rom_with_feature, run_runtime, TEST_LOCK};
+    use crate::test::{
+        check_cycle_budgets, compile_runtime, get_rom_with_feature, run_with_milestones,
+        runtime_command, CYCLE_BUDGET_MARGIN_PERCENT, PROJECT_ROOT, TEST_LOCK,
+    };
     use chrono::{TimeZone, Utc};
     use mcu_builder::{CaliptraBuilder, SocImage};
     use mcu_config::boot::{PartitionId, PartitionStatus, RollbackEnable};
+    use mcu_config::milestone::{CycleBudget, Milestone};
     use mcu_config_emulator::flash::{
-        PartitionTable, StandAloneChecksumCalculator, IMAGE_A_PARTITION, IMAGE_B_PARTITION,
+        BootCfgRecord, PartitionTable, StandAloneChecksumCalculator, BOOT_CFG_JOURNAL_BANKS,
+        BOOT_CFG_JOURNAL_BANK_SIZE, BOOT_CFG_JOURNAL_OFFSET, BOOT_CFG_RECORDS_PER_BANK,
+        IMAGE_A_PARTITION, IMAGE_B_PARTITION, PARTITION_TABLE,
     };
     use pldm_fw_pkg::manifest::{
         ComponentImageInformation, Descriptor, DescriptorType, FirmwareDeviceIdRecord,
@@ -15,10 +21,45 @@ mod test {
     };
     use pldm_fw_pkg::FirmwareManifest;
     use std::path::PathBuf;
-    use std::process::ExitStatus;
+    use std::process::{Command, ExitStatus};
+    use zerocopy::FromBytes;
 
     const CALIPTRA_EXTERNAL_RAM_BASE: u64 = 0x8000_0000;
 
+    /// Cycle budgets of a successful boot: the baseline cycles of each step, as
+    /// printed by `check_cycle_budgets` for a successful emulator run, plus
+    /// `CYCLE_BUDGET_MARGIN_PERCENT`. Update a baseline when a change moves it on purpose.
+    const BOOT_CYCLE_BUDGETS: &[CycleBudget] = &[
+        // Baseline: 1.3M cycles
+        CycleBudget::from_baseline(
+            Milestone::RomStart,
+            Milestone::FusesRead,
+            1_300_000,
+            CYCLE_BUDGET_MARGIN_PERCENT,
+        ),
+        // Baseline: 13M cycles
+        CycleBudget::from_baseline(
+            Milestone::FusesRead,
+            Milestone::CaliptraReady,
+            13_000_000,
+            CYCLE_BUDGET_MARGIN_PERCENT,
+        ),
+        // Baseline: 130M cycles
+        CycleBudget::from_baseline(
+            Milestone::CaliptraReady,
+            Milestone::RuntimeStart,
+            130_000_000,
+            CYCLE_BUDGET_MARGIN_PERCENT,
+        ),
+        // Baseline: 165M cycles
+        CycleBudget::from_baseline(
+            Milestone::RomStart,
+            Milestone::RuntimeStart,
+            165_000_000,
+            CYCLE_BUDGET_MARGIN_PERCENT,
+        ),
+    ];
+
     #[derive(Clone)]
     struct TestOptions {
         feature: &'static str,
@@ -64,6 +105,46 @@ mod test {
         partition_table: Option<PartitionTable>,
         flash_offset: usize,
         soc_images_paths: Vec<PathBuf>,
+    ) -> (Vec<PathBuf>, PathBuf) {
+        build_flash_image(
+            caliptra_fw_path,
+            soc_manifest_path,
+            mcu_runtime_path,
+            partition_table,
+            flash_offset,
+            soc_images_paths,
+            false,
+        )
+    }
+
+    // Helper function to create a flash image that carries the digest of each image
+    fn create_flash_image_with_digests(
+        caliptra_fw_path: Option<PathBuf>,
+        soc_manifest_path: Option<PathBuf>,
+        mcu_runtime_path: Option<PathBuf>,
+        partition_table: Option<PartitionTable>,
+        flash_offset: usize,
+        soc_images_paths: Vec<PathBuf>,
+    ) -> (Vec<PathBuf>, PathBuf) {
+        build_flash_image(
+            caliptra_fw_path,
+            soc_manifest_path,
+            mcu_runtime_path,
+            partition_table,
+            flash_offset,
+            soc_images_paths,
+            true,
+        )
+    }
+
+    fn build_flash_image(
+        caliptra_fw_path: Option<PathBuf>,
+        soc_manifest_path: Option<PathBuf>,
+        mcu_runtime_path: Option<PathBuf>,
+        partition_table: Option<PartitionTable>,
+        flash_offset: usize,
+        soc_images_paths: Vec<PathBuf>,
+        with_digests: bool,
     ) -> (Vec<PathBuf>, PathBuf) {
         let flash_image_path = tempfile::NamedTempFile::new()
             .expect("Failed to create flash image file")
@@ -91,6 +172,7 @@ mod test {
             ),
             flash_offset,
             flash_image_path.to_str().unwrap(),
+            with_digests,
         )
         .expect("Failed to create flash image");
 
@@ -166,7 +248,7 @@ mod test {
                 version_string: Some("soc-fw-1.2".to_string()),
 
                 size: image.len() as u32,
-                image_data: Some(image.to_vec()),
+                image_data: Some(image.to_vec().into()),
                 ..Default::default()
             }],
         }
@@ -183,7 +265,11 @@ mod test {
     }
 
     fn run_runtime_with_options(opts: &TestOptions) -> ExitStatus {
-        run_runtime(
+        runtime_command_with_options(opts).status().unwrap()
+    }
+
+    fn runtime_command_with_options(opts: &TestOptions) -> Command {
+        runtime_command(
             opts.feature,
             opts.rom.clone(),
             opts.runtime.clone(),
@@ -201,8 +287,147 @@ mod test {
 
     /// Test case: happy path
     fn test_successful_boot(opts: &TestOptions) {
-        let test = run_runtime_with_options(opts);
+        let (test, milestones) = run_with_milestones(runtime_command_with_options(opts));
+        assert_eq!(0, test.code().unwrap_or_default());
+        check_cycle_budgets(opts.feature, &milestones, BOOT_CYCLE_BUDGETS);
+    }
+
+    /// Returns the latest boot configuration record in the journal of `flash`, the
+    /// primary flash contents, and the journal bank holding it.
+    fn latest_boot_cfg_record(flash: &[u8]) -> Option<(BootCfgRecord, usize)> {
+        let journal = PARTITION_TABLE.offset + BOOT_CFG_JOURNAL_OFFSET;
+        let record_size = std::mem::size_of::<BootCfgRecord>();
+        let checksum_calculator = StandAloneChecksumCalculator::new();
+        (0..BOOT_CFG_JOURNAL_BANKS)
+            .flat_map(|bank| (0..BOOT_CFG_RECORDS_PER_BANK).map(move |slot| (bank, slot)))
+            .filter_map(|(bank, slot)| {
+                let offset = journal + bank * BOOT_CFG_JOURNAL_BANK_SIZE + slot * record_size;
+                let record =
+                    BootCfgRecord::read_from_bytes(flash.get(offset..offset + record_size)?)
+                        .ok()?;
+                record
+                    .is_valid(&checksum_calculator)
+                    .then_some((record, bank))
+            })
+            .max_by_key(|(record, _)| record.sequence)
+    }
+
+    /// Page operations of a boot on the pages of the partition table partition, which
+    /// holds the partition table and the boot configuration journal.
+    #[derive(Debug, Default)]
+    struct BootCfgFlashOps {
+        reads: usize,
+        writes: usize,
+        erases: usize,
+    }
+
+    /// Counts the page operations on the partition table partition in `log`, written by
+    /// the emulator `--flash-op-log`.
+    fn boot_cfg_flash_ops(log: &str) -> BootCfgFlashOps {
+        let page_size = BOOT_CFG_JOURNAL_BANK_SIZE;
+        let pages = PARTITION_TABLE.offset / page_size
+            ..(PARTITION_TABLE.offset + PARTITION_TABLE.size) / page_size;
+        let mut ops = BootCfgFlashOps::default();
+        for line in log.lines() {
+            let mut fields = line.split(' ');
+            let (Some("primary_flash"), Some(op), Some(page)) =
+                (fields.next(), fields.next(), fields.next())
+            else {
+                continue;
+            };
+            if !page.parse().is_ok_and(|page| pages.contains(&page)) {
+                continue;
+            }
+            match op {
+                "ReadPage" => ops.reads += 1,
+                "WritePage" => ops.writes += 1,
+                "ErasePage" => ops.erases += 1,
+                _ => {}
+            }
+        }
+        ops
+    }
+
+    // Test case: the runtime appends the boot count to the boot configuration journal on
+    // every boot. Each boot starts from the primary flash left by the previous one, until
+    // the journal fills a bank and wraps into the other one.
+    fn test_boot_count_journal_wraps(opts: &TestOptions) {
+        let mut new_options = opts.clone();
+        // The emulator keeps the primary flash in this file, relative to the project root
+        let primary_flash = PROJECT_ROOT.join("primary_flash");
+        let flash_image = tempfile::NamedTempFile::new().expect("Failed to create flash image");
+        let flash_op_log =
+            tempfile::NamedTempFile::new().expect("Failed to create flash operation log");
+        let mut banks = vec![];
+        for boot in 1..=(BOOT_CFG_RECORDS_PER_BANK + 1) as u16 {
+            let test = runtime_command_with_options(&new_options)
+                .arg("--flash-op-log")
+                .arg(flash_op_log.path())
+                .status()
+                .unwrap();
+            assert_eq!(0, test.code().unwrap_or_default(), "boot {}", boot);
+
+            let flash = std::fs::read(&primary_flash).expect("Failed to read primary flash");
+            let (record, bank) =
+                latest_boot_cfg_record(&flash).expect("No boot configuration record");
+            let partition_a_boot_count = record.partition_table.partition_a_boot_count;
+            assert_eq!(boot, partition_a_boot_count);
+            banks.push(bank);
+
+            // The ROM and the runtime each read the configuration once: the journal, and
+            // the partition table while the journal is empty. The runtime appends at most
+            // the boot status and the boot count, each a read-modify-write of one page, and
+            // erases a bank when the journal wraps.
+            let log = std::fs::read_to_string(flash_op_log.path())
+                .expect("Failed to read flash operation log");
+            let ops = boot_cfg_flash_ops(&log);
+            let config_pages = BOOT_CFG_JOURNAL_BANKS + 1;
+            assert!(ops.writes <= 2, "boot {}: {:?}", boot, ops);
+            assert!(ops.erases <= 1, "boot {}: {:?}", boot, ops);
+            assert!(
+                ops.reads <= 2 * config_pages + ops.writes,
+                "boot {}: {:?}",
+                boot,
+                ops
+            );
+
+            std::fs::write(flash_image.path(), &flash).expect("Failed to write flash image");
+            new_options.primary_flash_image_path = Some(flash_image.path().to_path_buf());
+        }
+        assert!(
+            banks.windows(2).any(|w| w[0] != w[1]),
+            "journal did not wrap: {:?}",
+            banks
+        );
+    }
+
+    // Test case: the flash image carries an image digest table. The images are hashed while
+    // they are loaded, and a corrupted image is rejected.
+    fn test_boot_image_digests(opts: &TestOptions) {
+        let mut new_options = opts.clone();
+        let (_, flash_image_path) = create_flash_image_with_digests(
+            new_options.builder.as_mut().unwrap().get_caliptra_fw().ok(),
+            new_options
+                .builder
+                .as_mut()
+                .unwrap()
+                .get_soc_manifest()
+                .ok(),
+            Some(opts.runtime.clone()),
+            opts.partition_table.clone(),
+            opts.flash_offset,
+            opts.soc_images_paths.clone(),
+        );
+        new_options.primary_flash_image_path = Some(flash_image_path.clone());
+        let test = run_runtime_with_options(&new_options);
         assert_eq!(0, test.code().unwrap_or_default());
+
+        // The last SoC image ends the flash image, corrupt its last byte
+        let mut flash_image = std::fs::read(&flash_image_path).expect("Failed to read flash image");
+        *flash_image.last_mut().unwrap() ^= 0xFF;
+        std::fs::write(&flash_image_path, &flash_image).expect("Failed to write flash image");
+        let test = run_runtime_with_options(&new_options);
+        assert_ne!(0, test.code().unwrap_or_default());
     }
 
     // Test case: Image ID in the SOC manifest is different from the one being authorized in the firmware
@@ -499,7 +724,7 @@ mod test {
                 create_flash_image(None, None, None, None, 0, soc_images_paths.clone());
             let flash_image = std::fs::read(flash_image_path).expect("Failed to read flash image");
             let mut pldm_manifest = get_streaming_boot_pldm_fw_manifest(&device_uuid, &flash_image);
-            pldm_manifest.component_image_information[0].image_data = Some(vec![0x00]); // Remove the image data to simulate corruption
+            pldm_manifest.component_image_information[0].image_data = Some(vec![0x00].into()); // Remove the image data to simulate corruption
             Some(create_pldm_fw_package(&pldm_manifest))
         } else {
             None
@@ -666,6 +891,8 @@ mod test {
             // Flash-based boot-only tests
             run_test!(test_successful_boot, &pass_options.clone());
             run_test!(test_boot_secondary_flash, pass_options.clone());
+            run_test!(test_boot_count_journal_wraps, &pass_options.clone());
+            run_test!(test_boot_image_digests, &pass_options.clone());
             run_test!(test_boot_invalid_image_id, &pass_options.clone());
             run_test!(test_boot_unathorized_image, &pass_options.clone());
             run_test!(test_invalid_load_address, &pass_options.clone());
@@ -687,4 +914,173 @@ mod test {
     fn test_streaming_soc_boot() {
         test_soc_boot(false);
     }
+
+    /// Boots many SoC images and reports the total boot time.
+    ///
+    /// The image count must match `PERF_IMAGE_COUNT` in
+    /// platforms/emulator/runtime/userspace/apps/user/src/image_loader/config.rs.
+    /// The device prints the time spent loading and authorizing the images, the
+    /// wall-clock time of the whole emulator run is printed here.
+    ///
+    /// `rom_feature_override` replaces the ROM feature, e.g. to select how the ROM copies the
+    /// recovery images out of flash, and `feature_override` the runtime feature.
+    fn test_soc_boot_perf(
+        is_flash_based_boot: bool,
+        rom_feature_override: Option<&str>,
+        feature_override: Option<&'static str>,
+    ) {
+        const PERF_IMAGE_COUNT: usize = 16;
+        const PERF_IMAGE_SIZE: usize = 4096;
+
+        let lock = TEST_LOCK.lock().unwrap();
+        let (feature, rom_feature, i3c_port) = if is_flash_based_boot {
+            ("test-flash-based-boot-perf", "test-flash-based-boot", 65504)
+        } else {
+            (
+                "test-pldm-streaming-boot-perf",
+                "test-pldm-streaming-boot",
+                65503,
+            )
+        };
+        let feature = feature_override.unwrap_or(feature);
+        let test_runtime = compile_runtime(feature, false);
+
+        let soc_images_paths = create_soc_images(
+            (0..PERF_IMAGE_COUNT)
+                .map(|i| vec![i as u8; PERF_IMAGE_SIZE])
+                .collect(),
+        );
+        let soc_images: Vec<SocImage> = soc_images_paths
+            .iter()
+            .enumerate()
+            .map(|(i, path)| SocImage {
+                path: path.clone(),
+                load_addr: CALIPTRA_EXTERNAL_RAM_BASE + (i * PERF_IMAGE_SIZE) as u64,
+                image_id: 4096 + i as u32,
+            })
+            .collect();
+
+        let mut builder = CaliptraBuilder::new(
+            false,
+            None,
+            None,
+            None,
+            None,
+            Some(test_runtime.clone()),
+            Some(soc_images.clone()),
+        );
+        let caliptra_fw = builder
+            .get_caliptra_fw()
+            .expect("Failed to build Caliptra firmware");
+        let soc_manifest = builder
+            .get_soc_manifest()
+            .expect("Failed to build SOC manifest");
+
+        let mut options = TestOptions {
+            feature,
+            rom: get_rom_with_feature(rom_feature_override.unwrap_or(rom_feature)),
+            runtime: test_runtime.clone(),
+            i3c_port,
+            soc_images,
+            soc_images_paths: soc_images_paths.clone(),
+            primary_flash_image_path: None,
+            secondary_flash_image_path: None,
+            pldm_fw_pkg_path: None,
+            partition_table: None,
+            builder: Some(builder),
+            flash_offset: 0,
+        };
+
+        if is_flash_based_boot {
+            let mut partition_table = PartitionTable {
+                active_partition: PartitionId::A as u32,
+                partition_a_status: PartitionStatus::Valid as u16,
+                partition_b_status: PartitionStatus::Invalid as u16,
+                rollback_enable: RollbackEnable::Enabled as u32,
+                ..Default::default()
+            };
+            partition_table.populate_checksum(&StandAloneChecksumCalculator::new());
+            let flash_offset = partition_table
+                .get_active_partition()
+                .1
+                .map_or(0, |p| p.offset);
+            let (_, flash_image_path) = create_flash_image(
+                Some(caliptra_fw),
+                Some(soc_manifest),
+                Some(test_runtime),
+                Some(partition_table.clone()),
+                flash_offset,
+                soc_images_paths,
+            );
+            options.primary_flash_image_path = Some(flash_image_path.clone());
+            options.secondary_flash_image_path = Some(flash_image_path);
+            options.partition_table = Some(partition_table);
+            options.flash_offset = flash_offset;
+        } else {
+            let (_, flash_image_path) =
+                create_flash_image(None, None, None, None, 0, soc_images_paths);
+            let flash_image = std::fs::read(flash_image_path).expect("Failed to read flash image");
+            let pldm_manifest =
+                get_streaming_boot_pldm_fw_manifest(&get_device_uuid(), &flash_image);
+            options.pldm_fw_pkg_path = Some(create_pldm_fw_package(&pldm_manifest));
+        }
+
+        let start = std::time::Instant::now();
+        let (test, milestones) = run_with_milestones(runtime_command_with_options(&options));
+        let elapsed = start.elapsed();
+        assert_eq!(0, test.code().unwrap_or_default());
+        println!(
+            "{} ({}) of {} images of {} bytes: {:?} total",
+            if is_flash_based_boot {
+                "Flash-based boot"
+            } else {
+                "Streaming boot"
+            },
+            rom_feature_override.unwrap_or(rom_feature),
+            PERF_IMAGE_COUNT,
+            PERF_IMAGE_SIZE,
+            elapsed
+        );
+        if let Some(cycles) = CycleBudget::new(
+            Milestone::FlashRecoveryStart,
+            Milestone::FlashRecoveryComplete,
+            u64::MAX,
+        )
+        .measure(&milestones)
+        {
+            println!("ROM flash recovery flow: {} cycles", cycles);
+        }
+
+        lock.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+    }
+
+    #[ignore]
+    #[test]
+    fn test_streaming_soc_boot_perf() {
+        test_soc_boot_perf(false, None, None);
+    }
+
+    #[ignore]
+    #[test]
+    fn test_flash_soc_boot_perf() {
+        test_soc_boot_perf(true, None, None);
+    }
+
+    /// Same as `test_flash_soc_boot_perf`, with the ROM copying the recovery images out of
+    /// flash through the CPU instead of letting the flash controller write whole pages to
+    /// its buffer. Both ROMs print the cycles spent transferring the recovery images.
+    #[ignore]
+    #[test]
+    fn test_flash_soc_boot_perf_cpu_copy() {
+        test_soc_boot_perf(true, Some("test-flash-recovery-cpu-copy"), None);
+    }
+
+    /// Same as `test_flash_soc_boot_perf`, then the images are loaded again with the record
+    /// left by the first load, as after a warm reset. The device prints the time to ready of
+    /// both loads.
+    #[ignore]
+    #[test]
+    fn test_flash_soc_boot_warm_reset_perf() {
+        test_soc_boot_perf(true, None, Some("test-flash-based-boot-warm-reset"));
+    }
 }
@@ -248,6 +248,10 @@ enum FlashImageCommands {
         /// Paths to the output image file
         #[arg(long, value_name = "OUTPUT", required = true)]
         output: String,
+
+        /// Add the SHA-384 digest of each image, checked by the MCU while loading
+        #[arg(long, default_value_t = false)]
+        digests: bool,
     },
     /// Verify an existing flash image
     Verify {
@@ -346,6 +350,7 @@ fn main() {
                 mcu_runtime,
                 soc_images,
                 output,
+                digests,
             } => mcu_builder::flash_image::flash_image_create(
                 caliptra_fw,
                 soc_manifest,
@@ -353,6 +358,7 @@ fn main() {
                 soc_images,
                 0,
                 output,
+                *digests,
             ),
             FlashImageCommands::Verify { file, offset } => {
                 mcu_builder::flash_image::flash_image_verify(file, *offset)